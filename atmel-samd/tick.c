@@ -2,6 +2,9 @@
 
 #include "tick.h"
 
+#include "py/mphal.h"
+#include "py/runtime.h"
+
 #include "asf/sam0/drivers/tc/tc_interrupt.h"
 
 // Global millisecond tick count
@@ -9,6 +12,27 @@ volatile uint64_t ticks_ms = 0;
 
 static struct tc_module ms_timer;
 
+#if MICROPY_EXEC_PROFILE
+// Profiling samples are taken every exec_profile_period_ms ticks, or never if
+// it's 0.
+static volatile uint32_t exec_profile_period_ms = 0;
+static volatile uint32_t exec_profile_countdown = 0;
+
+void mp_hal_exec_profile_start(mp_uint_t period_us) {
+    uint32_t period_ms = period_us / 1000;
+    if (period_ms == 0) {
+        // the tick is the finest resolution we have
+        period_ms = 1;
+    }
+    exec_profile_countdown = period_ms;
+    exec_profile_period_ms = period_ms;
+}
+
+void mp_hal_exec_profile_stop(void) {
+    exec_profile_period_ms = 0;
+}
+#endif
+
 static void ms_tick(struct tc_module *const module_inst) {
     // SysTick interrupt handler called when the SysTick timer reaches zero
     // (every millisecond).
@@ -17,6 +41,13 @@ static void ms_tick(struct tc_module *const module_inst) {
     #ifdef AUTORESET_DELAY_MS
         autoreset_tick();
     #endif
+
+    #if MICROPY_EXEC_PROFILE
+    if (exec_profile_period_ms != 0 && --exec_profile_countdown == 0) {
+        exec_profile_countdown = exec_profile_period_ms;
+        mp_exec_profile_sample();
+    }
+    #endif
 }
 
 void tick_init() {
@@ -136,6 +136,8 @@ typedef uint32_t sys_prot_t; // for modlwip
 #define MP_PLAT_PRINT_STRN(str, len) mp_hal_stdout_tx_strn_cooked(str, len)
 void *esp_native_code_commit(void*, size_t);
 #define MP_PLAT_COMMIT_EXEC(buf, len) esp_native_code_commit(buf, len)
+// Frozen native code must be in executable memory, so put it in irom0 (see esp8266.ld)
+#define MICROPY_FROZEN_NATIVE_CODE_ATTR __attribute__((section(".irom0.frozen_native")))
 
 #define mp_type_fileio fatfs_type_fileio
 #define mp_type_textio fatfs_type_textio
@@ -28,7 +28,6 @@
 
 #include "py/nlr.h"
 #include "py/objlist.h"
-#include "py/objstringio.h"
 #include "py/parsenum.h"
 #include "py/runtime.h"
 #include "py/stream.h"
@@ -57,32 +56,56 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_dumps_obj, mod_ujson_dumps);
 // strings).  It does 1 pass over the input stream.  It tries to be fast and
 // small in code size, while not using more RAM than necessary.
 
+// Size of the chunks that load() reads from a stream
+#define UJSON_STREAM_CHUNK_SIZE (128)
+
+// Input is consumed from the buffer between ptr and end.  For a stream the
+// buffer holds the last chunk read (and read is non-NULL to refill it), for
+// loads() it is the whole string.  While not at the end, ptr[-1] is cur.
 typedef struct _ujson_stream_t {
     mp_obj_t stream_obj;
     mp_uint_t (*read)(mp_obj_t obj, void *buf, mp_uint_t size, int *errcode);
     int errcode;
     byte cur;
+    const byte *ptr;
+    const byte *end;
+    byte *buf;
 } ujson_stream_t;
 
 #define S_EOF (0) // null is not allowed in json stream so is ok as EOF marker
 #define S_END(s) ((s).cur == S_EOF)
 #define S_CUR(s) ((s).cur)
-#define S_NEXT(s) (ujson_stream_next(&(s)))
+#define S_NEXT(s) ((s).ptr < (s).end ? ((s).cur = *(s).ptr++) : ujson_stream_next(&(s)))
 
 STATIC byte ujson_stream_next(ujson_stream_t *s) {
-    mp_uint_t ret = s->read(s->stream_obj, &s->cur, 1, &s->errcode);
-    if (s->errcode != 0) {
-        mp_raise_OSError(s->errcode);
-    }
-    if (ret == 0) {
-        s->cur = S_EOF;
+    if (s->ptr == s->end) {
+        if (s->read == NULL) {
+            s->cur = S_EOF;
+            return S_EOF;
+        }
+        mp_uint_t ret = s->read(s->stream_obj, s->buf, UJSON_STREAM_CHUNK_SIZE, &s->errcode);
+        if (ret == MP_STREAM_ERROR) {
+            mp_raise_OSError(s->errcode);
+        }
+        if (ret == 0) {
+            s->cur = S_EOF;
+            return S_EOF;
+        }
+        s->ptr = s->buf;
+        s->end = s->buf + ret;
     }
+    s->cur = *s->ptr++;
     return s->cur;
 }
 
-STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
-    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ);
-    ujson_stream_t s = {stream_obj, stream_p->read, 0, 0};
+// Parse from stream_obj if it's not MP_OBJ_NULL, otherwise from str.
+STATIC mp_obj_t ujson_load_helper(mp_obj_t stream_obj, const byte *str, size_t len) {
+    byte chunk[UJSON_STREAM_CHUNK_SIZE];
+    ujson_stream_t s = {stream_obj, NULL, 0, 0, str, str + len, chunk};
+    if (stream_obj != MP_OBJ_NULL) {
+        s.read = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ)->read;
+        s.ptr = s.end = chunk;
+    }
     vstr_t vstr;
     vstr_init(&vstr, 8);
     mp_obj_list_t stack; // we use a list as a simple stack for nested JSON
@@ -137,26 +160,36 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
                 vstr_reset(&vstr);
                 for (; !S_END(s) && S_CUR(s) != '"';) {
                     byte c = S_CUR(s);
-                    if (c == '\\') {
-                        c = S_NEXT(s);
-                        switch (c) {
-                            case 'b': c = 0x08; break;
-                            case 'f': c = 0x0c; break;
-                            case 'n': c = 0x0a; break;
-                            case 'r': c = 0x0d; break;
-                            case 't': c = 0x09; break;
-                            case 'u': {
-                                mp_uint_t num = 0;
-                                for (int i = 0; i < 4; i++) {
-                                    c = (S_NEXT(s) | 0x20) - '0';
-                                    if (c > 9) {
-                                        c -= ('a' - ('9' + 1));
-                                    }
-                                    num = (num << 4) | c;
+                    if (c != '\\') {
+                        // copy a run of plain characters in one go
+                        const byte *start = s.ptr - 1;
+                        const byte *p = s.ptr;
+                        while (p < s.end && *p != '"' && *p != '\\' && *p != S_EOF) {
+                            p++;
+                        }
+                        vstr_add_strn(&vstr, (const char*)start, p - start);
+                        s.ptr = p;
+                        S_NEXT(s);
+                        continue;
+                    }
+                    c = S_NEXT(s);
+                    switch (c) {
+                        case 'b': c = 0x08; break;
+                        case 'f': c = 0x0c; break;
+                        case 'n': c = 0x0a; break;
+                        case 'r': c = 0x0d; break;
+                        case 't': c = 0x09; break;
+                        case 'u': {
+                            mp_uint_t num = 0;
+                            for (int i = 0; i < 4; i++) {
+                                c = (S_NEXT(s) | 0x20) - '0';
+                                if (c > 9) {
+                                    c -= ('a' - ('9' + 1));
                                 }
-                                vstr_add_char(&vstr, num);
-                                goto str_cont;
+                                num = (num << 4) | c;
                             }
+                            vstr_add_char(&vstr, num);
+                            goto str_cont;
                         }
                     }
                     vstr_add_byte(&vstr, c);
@@ -173,17 +206,25 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
             case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': {
                 bool flt = false;
                 vstr_reset(&vstr);
-                for (;;) {
-                    vstr_add_byte(&vstr, cur);
-                    cur = S_CUR(s);
-                    if (cur == '.' || cur == 'E' || cur == 'e') {
-                        flt = true;
-                    } else if (cur == '-' || unichar_isdigit(cur)) {
-                        // pass
-                    } else {
-                        break;
+                vstr_add_byte(&vstr, cur);
+                while (!S_END(s)) {
+                    // copy the rest of the number that is in the buffer
+                    const byte *start = s.ptr - 1;
+                    const byte *p = start;
+                    for (; p < s.end; p++) {
+                        if (*p == '.' || *p == 'E' || *p == 'e') {
+                            flt = true;
+                        } else if (*p != '-' && !unichar_isdigit(*p)) {
+                            break;
+                        }
                     }
+                    vstr_add_strn(&vstr, (const char*)start, p - start);
+                    bool at_end = p == s.end;
+                    s.ptr = p;
                     S_NEXT(s);
+                    if (!at_end) {
+                        break;
+                    }
                 }
                 if (flt) {
                     next = mp_parse_num_decimal(vstr.buf, vstr.len, false, false, NULL);
@@ -271,14 +312,16 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
     fail:
     nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "syntax error in JSON"));
 }
+
+STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
+    return ujson_load_helper(stream_obj, NULL, 0);
+}
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_load_obj, mod_ujson_load);
 
 STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
     mp_uint_t len;
     const char *buf = mp_obj_str_get_data(obj, &len);
-    vstr_t vstr = {len, len, (char*)buf, true};
-    mp_obj_stringio_t sio = {{&mp_type_stringio}, &vstr, 0};
-    return mod_ujson_load(MP_OBJ_FROM_PTR(&sio));
+    return ujson_load_helper(MP_OBJ_NULL, (const byte*)buf, len);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_loads_obj, mod_ujson_loads);
 
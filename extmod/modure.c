@@ -31,6 +31,8 @@
 #include "py/nlr.h"
 #include "py/runtime.h"
 #include "py/binary.h"
+#include "py/objstr.h"
+#include "py/unicode.h"
 
 #if MICROPY_PY_URE
 
@@ -40,6 +42,7 @@
 
 typedef struct _mp_obj_re_t {
     mp_obj_base_t base;
+    mp_obj_t pattern; // the source string, to look up compiled regexes by
     ByteProg re;
 } mp_obj_re_t;
 
@@ -73,8 +76,64 @@ STATIC mp_obj_t match_group(mp_obj_t self_in, mp_obj_t no_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(match_group_obj, match_group);
 
+// Get the start and end offsets within the subject of the given group, which
+// are -1 if the group didn't take part in the match.
+STATIC void match_span_helper(size_t n_args, const mp_obj_t *args, mp_obj_t span[2]) {
+    mp_obj_match_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t no = 0;
+    if (n_args == 2) {
+        no = mp_obj_get_int(args[1]);
+        if (no < 0 || no >= self->num_matches) {
+            nlr_raise(mp_obj_new_exception_arg1(&mp_type_IndexError, args[1]));
+        }
+    }
+
+    mp_int_t s = -1;
+    mp_int_t e = -1;
+    const char *start = self->caps[no * 2];
+    if (start != NULL) {
+        mp_uint_t len;
+        const char *begin = mp_obj_str_get_data(self->str, &len);
+        s = start - begin;
+        e = self->caps[no * 2 + 1] - begin;
+        #if MICROPY_PY_BUILTINS_STR_UNICODE
+        if (MP_OBJ_IS_STR(self->str)) {
+            // offsets are in characters
+            s = utf8_ptr_to_index((const byte*)begin, (const byte*)start);
+            e = s + utf8_ptr_to_index((const byte*)start, (const byte*)self->caps[no * 2 + 1]);
+        }
+        #endif
+    }
+    span[0] = mp_obj_new_int(s);
+    span[1] = mp_obj_new_int(e);
+}
+
+STATIC mp_obj_t match_span(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t span[2];
+    match_span_helper(n_args, args, span);
+    return mp_obj_new_tuple(2, span);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_span_obj, 1, 2, match_span);
+
+STATIC mp_obj_t match_start(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t span[2];
+    match_span_helper(n_args, args, span);
+    return span[0];
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_start_obj, 1, 2, match_start);
+
+STATIC mp_obj_t match_end(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t span[2];
+    match_span_helper(n_args, args, span);
+    return span[1];
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(match_end_obj, 1, 2, match_end);
+
 STATIC const mp_rom_map_elem_t match_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_group), MP_ROM_PTR(&match_group_obj) },
+    { MP_ROM_QSTR(MP_QSTR_span), MP_ROM_PTR(&match_span_obj) },
+    { MP_ROM_QSTR(MP_QSTR_start), MP_ROM_PTR(&match_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_end), MP_ROM_PTR(&match_end_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(match_locals_dict, match_locals_dict_table);
@@ -92,6 +151,39 @@ STATIC void re_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t
     mp_printf(print, "<re %p>", self);
 }
 
+// The backtracking matcher is fast for typical patterns, but is exponential in
+// the worst case and recurses as it goes, so it is run with a limit on its depth
+// and on the number of steps it takes.  If it gives up, the Pike VM is used,
+// which runs in time linear in the subject and with bounded C stack.
+#define URE_BACKTRACK_MAX_DEPTH (64)
+
+// Run the compiled regex over the subject, filling in caps (which must be
+// zeroed by the caller) on a match.
+STATIC int ure_run(mp_obj_re_t *self, Subject *subj, const char **caps, int caps_num, bool is_anchored) {
+    // the step limit keeps the combined running time to that of the Pike VM
+    size_t max_steps = (subj->end - subj->begin + 1) * (size_t)self->re.len;
+    if (max_steps > INT_MAX) {
+        max_steps = INT_MAX;
+    }
+    int res = re1_5_recursiveloopprog_bounded(&self->re, subj, caps, caps_num, is_anchored,
+        URE_BACKTRACK_MAX_DEPTH, max_steps);
+    if (res >= 0) {
+        return res;
+    }
+
+    // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
+    memset((char**)caps, 0, caps_num * sizeof(char*));
+    size_t work_len = re1_5_pikevm_worksize(&self->re, caps_num);
+    void *work = m_new_maybe(byte, work_len);
+    if (work == NULL) {
+        // not enough memory for the Pike VM, so backtrack without limits
+        return re1_5_recursiveloopprog(&self->re, subj, caps, caps_num, is_anchored);
+    }
+    res = re1_5_pikevm(&self->re, subj, caps, caps_num, is_anchored, work);
+    m_del(byte, work, work_len);
+    return res;
+}
+
 STATIC mp_obj_t ure_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     (void)n_args;
     mp_obj_re_t *self = MP_OBJ_TO_PTR(args[0]);
@@ -99,11 +191,13 @@ STATIC mp_obj_t ure_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     mp_uint_t len;
     subj.begin = mp_obj_str_get_data(args[1], &len);
     subj.end = subj.begin + len;
+    subj.begin_line = subj.begin;
+    subj.nonempty_at = NULL;
     int caps_num = (self->re.sub + 1) * 2;
     mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
     // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
     memset((char*)match->caps, 0, caps_num * sizeof(char*));
-    int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, is_anchored);
+    int res = ure_run(self, &subj, match->caps, caps_num, is_anchored);
     if (res == 0) {
         m_del_var(mp_obj_match_t, char*, caps_num, match);
         return mp_const_none;
@@ -131,6 +225,8 @@ STATIC mp_obj_t re_split(size_t n_args, const mp_obj_t *args) {
     mp_uint_t len;
     subj.begin = mp_obj_str_get_data(args[1], &len);
     subj.end = subj.begin + len;
+    subj.begin_line = subj.begin;
+    subj.nonempty_at = NULL;
     int caps_num = (self->re.sub + 1) * 2;
 
     int maxsplit = 0;
@@ -143,7 +239,7 @@ STATIC mp_obj_t re_split(size_t n_args, const mp_obj_t *args) {
     while (true) {
         // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
         memset((char**)caps, 0, caps_num * sizeof(char*));
-        int res = re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, false);
+        int res = ure_run(self, &subj, caps, caps_num, false);
 
         // if we didn't have a match, or had an empty match, it's time to stop
         if (!res || caps[0] == caps[1]) {
@@ -167,10 +263,237 @@ STATIC mp_obj_t re_split(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_split_obj, 2, 3, re_split);
 
+// Step over the character at p in the subject, which is non-empty, so that
+// a search can resume after an empty match.
+STATIC const char *ure_next_char(mp_obj_t str, const char *p, const char *end) {
+    ++p;
+    #if MICROPY_PY_BUILTINS_STR_UNICODE
+    if (MP_OBJ_IS_STR(str)) {
+        while (p < end && UTF8_IS_CONT(*p)) {
+            ++p;
+        }
+    }
+    #else
+    (void)str;
+    (void)end;
+    #endif
+    return p;
+}
+
+// Find the next match in subj, following an empty match at subj->begin if
+// prev_empty is set.  As in CPython, a non-empty match may then start at the
+// same place, but an empty one may not.  Characters that are stepped over are
+// added to vstr, if it's not NULL.
+STATIC int ure_run_next(mp_obj_re_t *self, mp_obj_t str, Subject *subj, const char **caps, int caps_num, bool prev_empty, vstr_t *vstr) {
+    if (prev_empty) {
+        subj->nonempty_at = subj->begin;
+        int res = ure_run(self, subj, caps, caps_num, true);
+        subj->nonempty_at = NULL;
+        if (res) {
+            return res;
+        }
+        if (subj->begin == subj->end) {
+            return 0;
+        }
+        const char *next = ure_next_char(str, subj->begin, subj->end);
+        if (vstr != NULL) {
+            vstr_add_strn(vstr, subj->begin, next - subj->begin);
+        }
+        subj->begin = next;
+        // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
+        memset((char**)caps, 0, caps_num * sizeof(char*));
+    }
+    return ure_run(self, subj, caps, caps_num, false);
+}
+
+// Append the replacement for a match to vstr, substituting groups referred to
+// by \N or \g<N>, and the usual escapes such as \n.
+STATIC void re_sub_add_repl(vstr_t *vstr, mp_obj_match_t *match, const char *repl, size_t repl_len) {
+    static const char escape_names[] = "\\abfnrtv";
+    static const char escape_chars[] = "\\\a\b\f\n\r\t\v";
+    const char *top = repl + repl_len;
+    const char *esc;
+    while (repl < top) {
+        if (*repl != '\\' || repl + 1 == top) {
+            vstr_add_byte(vstr, *repl++);
+            continue;
+        }
+        const char *r = repl + 1;
+        bool is_g_format = false;
+        if (*r == 'g' && r + 1 < top && r[1] == '<') {
+            r += 2;
+            is_g_format = true;
+        }
+        if (r < top && unichar_isdigit(*r)) {
+            mp_int_t no = 0;
+            do {
+                no = no * 10 + *r++ - '0';
+            } while (r < top && unichar_isdigit(*r));
+            if (is_g_format) {
+                if (r == top || *r != '>') {
+                    goto error;
+                }
+                r++;
+            }
+            if (no >= match->num_matches) {
+                nlr_raise(mp_obj_new_exception_arg1(&mp_type_IndexError, MP_OBJ_NEW_SMALL_INT(no)));
+            }
+            const char *start = match->caps[no * 2];
+            if (start != NULL) {
+                vstr_add_strn(vstr, start, match->caps[no * 2 + 1] - start);
+            }
+            repl = r;
+        } else if (is_g_format) {
+            goto error;
+        } else if (*r != '\0' && (esc = strchr(escape_names, *r)) != NULL) {
+            vstr_add_byte(vstr, escape_chars[esc - escape_names]);
+            repl += 2;
+        } else {
+            vstr_add_byte(vstr, *repl++);
+        }
+    }
+    return;
+
+error:
+    nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "bad group reference"));
+}
+
+STATIC mp_obj_t re_sub(size_t n_args, const mp_obj_t *args) {
+    mp_obj_re_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_t repl = args[1];
+    mp_obj_t where = args[2];
+    mp_int_t count = 0;
+    if (n_args > 3) {
+        count = mp_obj_get_int(args[3]);
+        if (count < 0) {
+            // as in CPython, nothing is replaced
+            return where;
+        }
+    }
+    bool repl_is_callable = mp_obj_is_callable(repl);
+
+    Subject subj;
+    mp_uint_t len;
+    const char *where_str = mp_obj_str_get_data(where, &len);
+    subj.begin = where_str;
+    subj.end = subj.begin + len;
+    subj.begin_line = subj.begin;
+    subj.nonempty_at = NULL;
+    int caps_num = (self->re.sub + 1) * 2;
+
+    // a callable replacement may keep hold of the match objects it is given,
+    // so they must be new each time, otherwise one will do
+    mp_obj_match_t *match = NULL;
+    vstr_t vstr;
+    vstr.buf = NULL; // initialised on the first match, if there is one
+    bool prev_empty = false;
+    for (;;) {
+        if (match == NULL) {
+            match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
+            match->base.type = &match_type;
+            match->num_matches = caps_num / 2; // caps_num counts start and end pointers
+            match->str = where;
+        }
+        // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
+        memset((char*)match->caps, 0, caps_num * sizeof(char*));
+        if (!ure_run_next(self, where, &subj, match->caps, caps_num, prev_empty, &vstr)) {
+            break;
+        }
+        const char *start = match->caps[0];
+        const char *end = match->caps[1];
+
+        if (vstr.buf == NULL) {
+            vstr_init(&vstr, len);
+        }
+        vstr_add_strn(&vstr, subj.begin, start - subj.begin);
+        if (repl_is_callable) {
+            mp_obj_t r = mp_call_function_1(repl, MP_OBJ_FROM_PTR(match));
+            mp_uint_t r_len;
+            const char *r_str = mp_obj_str_get_data(r, &r_len);
+            vstr_add_strn(&vstr, r_str, r_len);
+            match = NULL;
+        } else {
+            mp_uint_t r_len;
+            const char *r_str = mp_obj_str_get_data(repl, &r_len);
+            re_sub_add_repl(&vstr, match, r_str, r_len);
+        }
+        subj.begin = end;
+        prev_empty = start == end;
+        if (count > 0 && --count == 0) {
+            break;
+        }
+    }
+
+    if (match != NULL) {
+        m_del_var(mp_obj_match_t, char*, caps_num, match);
+    }
+    if (vstr.buf == NULL) {
+        // nothing was replaced
+        return where;
+    }
+    vstr_add_strn(&vstr, subj.begin, subj.end - subj.begin);
+    return mp_obj_new_str_from_vstr(mp_obj_get_type(where), &vstr);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(re_sub_obj, 3, 4, re_sub);
+
+typedef struct _mp_obj_re_iter_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_t re;
+    mp_obj_t str;
+    size_t pos; // offset to search from next, or -1 when finished
+    bool prev_empty; // whether the previous match was empty and ended at pos
+} mp_obj_re_iter_t;
+
+STATIC mp_obj_t re_iter_iternext(mp_obj_t self_in) {
+    mp_obj_re_iter_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_re_t *re = MP_OBJ_TO_PTR(self->re);
+    Subject subj;
+    mp_uint_t len;
+    const char *begin = mp_obj_str_get_data(self->str, &len);
+    subj.end = begin + len;
+    int caps_num = (re->re.sub + 1) * 2;
+    if (self->pos == (size_t)-1) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    subj.begin = begin + self->pos;
+    subj.begin_line = begin;
+    subj.nonempty_at = NULL;
+    mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
+    // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
+    memset((char*)match->caps, 0, caps_num * sizeof(char*));
+    if (!ure_run_next(re, self->str, &subj, match->caps, caps_num, self->prev_empty, NULL)) {
+        m_del_var(mp_obj_match_t, char*, caps_num, match);
+        self->pos = -1;
+        return MP_OBJ_STOP_ITERATION;
+    }
+    self->pos = match->caps[1] - begin;
+    self->prev_empty = match->caps[0] == match->caps[1];
+
+    match->base.type = &match_type;
+    match->num_matches = caps_num / 2; // caps_num counts start and end pointers
+    match->str = self->str;
+    return MP_OBJ_FROM_PTR(match);
+}
+
+STATIC mp_obj_t re_finditer(mp_obj_t self_in, mp_obj_t str) {
+    mp_obj_re_iter_t *o = m_new_obj(mp_obj_re_iter_t);
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = re_iter_iternext;
+    o->re = self_in;
+    o->str = str;
+    o->pos = 0;
+    o->prev_empty = false;
+    return MP_OBJ_FROM_PTR(o);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(re_finditer_obj, re_finditer);
+
 STATIC const mp_rom_map_elem_t re_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_match), MP_ROM_PTR(&re_match_obj) },
     { MP_ROM_QSTR(MP_QSTR_search), MP_ROM_PTR(&re_search_obj) },
     { MP_ROM_QSTR(MP_QSTR_split), MP_ROM_PTR(&re_split_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&re_sub_obj) },
+    { MP_ROM_QSTR(MP_QSTR_finditer), MP_ROM_PTR(&re_finditer_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(re_locals_dict, re_locals_dict_table);
@@ -190,6 +513,7 @@ STATIC mp_obj_t mod_re_compile(size_t n_args, const mp_obj_t *args) {
     }
     mp_obj_re_t *o = m_new_obj_var(mp_obj_re_t, char, size);
     o->base.type = &re_type;
+    o->pattern = args[0];
     int flags = 0;
     if (n_args > 1) {
         flags = mp_obj_get_int(args[1]);
@@ -206,9 +530,39 @@ error:
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_compile_obj, 1, 2, mod_re_compile);
 
+// Compile a regex for the module-level functions, reusing a recently compiled
+// one if it has the same pattern.  The cache is kept in most recently used
+// order, so the least recently used regex is the one dropped when it is full.
+STATIC mp_obj_t mod_re_compile_cached(mp_obj_t pattern) {
+    #if MICROPY_PY_URE_CACHE_SIZE
+    mp_obj_t *cache = MP_STATE_VM(ure_cache);
+    mp_obj_t self = MP_OBJ_NULL;
+    size_t i;
+    for (i = 0; i < MICROPY_PY_URE_CACHE_SIZE && cache[i] != MP_OBJ_NULL; i++) {
+        mp_obj_t cached = ((mp_obj_re_t*)MP_OBJ_TO_PTR(cache[i]))->pattern;
+        if (cached == pattern || (mp_obj_get_type(cached) == mp_obj_get_type(pattern)
+            && mp_obj_equal(cached, pattern))) {
+            self = cache[i];
+            break;
+        }
+    }
+    if (self == MP_OBJ_NULL) {
+        self = mod_re_compile(1, &pattern);
+        if (i == MICROPY_PY_URE_CACHE_SIZE) {
+            --i;
+        }
+    }
+    memmove(cache + 1, cache, i * sizeof(mp_obj_t));
+    cache[0] = self;
+    return self;
+    #else
+    return mod_re_compile(1, &pattern);
+    #endif
+}
+
 STATIC mp_obj_t mod_re_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     (void)n_args;
-    mp_obj_t self = mod_re_compile(1, args);
+    mp_obj_t self = mod_re_compile_cached(args[0]);
 
     const mp_obj_t args2[] = {self, args[1]};
     mp_obj_t match = ure_exec(is_anchored, 2, args2);
@@ -225,11 +579,27 @@ STATIC mp_obj_t mod_re_search(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_search_obj, 2, 4, mod_re_search);
 
+STATIC mp_obj_t mod_re_sub(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t args2[4] = {mod_re_compile_cached(args[0]), args[1], args[2]};
+    if (n_args > 3) {
+        args2[3] = args[3];
+    }
+    return re_sub(n_args, args2);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_sub_obj, 3, 4, mod_re_sub);
+
+STATIC mp_obj_t mod_re_finditer(mp_obj_t pattern, mp_obj_t str) {
+    return re_finditer(mod_re_compile_cached(pattern), str);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(mod_re_finditer_obj, mod_re_finditer);
+
 STATIC const mp_rom_map_elem_t mp_module_re_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ure) },
     { MP_ROM_QSTR(MP_QSTR_compile), MP_ROM_PTR(&mod_re_compile_obj) },
     { MP_ROM_QSTR(MP_QSTR_match), MP_ROM_PTR(&mod_re_match_obj) },
     { MP_ROM_QSTR(MP_QSTR_search), MP_ROM_PTR(&mod_re_search_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&mod_re_sub_obj) },
+    { MP_ROM_QSTR(MP_QSTR_finditer), MP_ROM_PTR(&mod_re_finditer_obj) },
     { MP_ROM_QSTR(MP_QSTR_DEBUG), MP_ROM_INT(FLAG_DEBUG) },
 };
 
@@ -247,6 +617,7 @@ const mp_obj_module_t mp_module_ure = {
 #include "re1.5/compilecode.c"
 #include "re1.5/dumpcode.c"
 #include "re1.5/recursiveloop.c"
+#include "re1.5/pikevm.c"
 #include "re1.5/charclass.c"
 
 #endif //MICROPY_PY_URE
@@ -42,29 +42,78 @@
 #define DEBUG_printf(...) (void)0
 #endif
 
+// Size of the chunks read from the source stream
+#define DECOMPIO_SRC_BUF_SIZE (256)
+
 typedef struct _mp_obj_decompio_t {
     mp_obj_base_t base;
     mp_obj_t src_stream;
     TINF_DATA decomp;
     bool eof;
+    bool seekable;
+    mp_obj_t unused_data;
+    byte src_buf[DECOMPIO_SRC_BUF_SIZE];
 } mp_obj_decompio_t;
 
-STATIC unsigned char read_src_stream(TINF_DATA *data) {
+STATIC int read_src_stream(TINF_DATA *data) {
     byte *p = (void*)data;
     p -= offsetof(mp_obj_decompio_t, decomp);
     mp_obj_decompio_t *self = (mp_obj_decompio_t*)p;
 
     const mp_stream_p_t *stream = mp_get_stream_raise(self->src_stream, MP_STREAM_OP_READ);
     int err;
-    byte c;
-    mp_uint_t out_sz = stream->read(self->src_stream, &c, 1, &err);
+    mp_uint_t out_sz = stream->read(self->src_stream, self->src_buf, sizeof(self->src_buf), &err);
     if (out_sz == MP_STREAM_ERROR) {
         mp_raise_OSError(err);
     }
     if (out_sz == 0) {
-        nlr_raise(mp_obj_new_exception(&mp_type_EOFError));
+        return -1;
+    }
+    data->source = self->src_buf + 1;
+    data->source_limit = self->src_buf + out_sz;
+    return self->src_buf[0];
+}
+
+// Put back the source read ahead of what the inflater has used, so the
+// stream is positioned just after the compressed data consumed so far.
+// A stream that can't seek keeps its position; once the compressed data
+// ends, the bytes read past it are kept in unused_data instead.
+STATIC void decompio_unread(mp_obj_decompio_t *o) {
+    TINF_DATA *d = &o->decomp;
+    mp_int_t in_tag = (d->bitcount >> 3) - d->pad;
+    if (in_tag < 0) {
+        in_tag = 0;
+    }
+    mp_int_t unused = in_tag + (d->source_limit - d->source);
+    if (unused <= 0) {
+        return;
+    }
+    if (!o->seekable) {
+        if (o->eof) {
+            vstr_t vstr;
+            vstr_init_len(&vstr, unused);
+            uint32_t tag = d->tag >> (d->bitcount & 7);
+            for (mp_int_t i = 0; i < in_tag; i++, tag >>= 8) {
+                vstr.buf[i] = tag & 0xff;
+            }
+            memcpy(vstr.buf + in_tag, d->source, d->source_limit - d->source);
+            o->unused_data = mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+            d->source = d->source_limit;
+        }
+        return;
+    }
+    const mp_stream_p_t *stream = mp_get_stream_raise(o->src_stream, MP_STREAM_OP_READ);
+    struct mp_stream_seek_t seek_s = { -unused, SEEK_CUR };
+    int err;
+    if (stream->ioctl(o->src_stream, MP_STREAM_SEEK, (uintptr_t)&seek_s, &err) == MP_STREAM_ERROR) {
+        mp_raise_OSError(err);
     }
-    return c;
+    // keep only the bits of the partly used byte
+    d->source = d->source_limit;
+    d->tag &= (1 << (d->bitcount & 7)) - 1;
+    d->bitcount &= 7;
+    d->pad = 0;
+    d->eof = 0;
 }
 
 STATIC mp_obj_t decompio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
@@ -75,6 +124,13 @@ STATIC mp_obj_t decompio_make_new(const mp_obj_type_t *type, size_t n_args, size
     o->decomp.readSource = read_src_stream;
     o->src_stream = args[0];
     o->eof = false;
+    o->unused_data = mp_const_empty_bytes;
+
+    const mp_stream_p_t *stream = mp_get_stream_raise(o->src_stream, MP_STREAM_OP_READ);
+    struct mp_stream_seek_t seek_s = { 0, SEEK_CUR };
+    int err;
+    o->seekable = stream->ioctl != NULL
+        && stream->ioctl(o->src_stream, MP_STREAM_SEEK, (uintptr_t)&seek_s, &err) != MP_STREAM_ERROR;
 
     mp_int_t dict_opt = 0;
     int dict_sz;
@@ -92,6 +148,9 @@ STATIC mp_obj_t decompio_make_new(const mp_obj_type_t *type, size_t n_args, size
         dict_opt = uzlib_zlib_parse_header(&o->decomp);
         if (dict_opt < 0) {
 header_error:
+            if (TINF_OVERRUN(&o->decomp)) {
+                nlr_raise(mp_obj_new_exception(&mp_type_EOFError));
+            }
             nlr_raise(mp_obj_new_exception_msg(&mp_type_ValueError, "compression header"));
         }
         dict_sz = 1 << dict_opt;
@@ -100,6 +159,7 @@ header_error:
     }
 
     uzlib_uncompress_init(&o->decomp, m_new(byte, dict_sz), dict_sz);
+    decompio_unread(o);
     return MP_OBJ_FROM_PTR(o);
 }
 
@@ -116,9 +176,13 @@ STATIC mp_uint_t decompio_read(mp_obj_t o_in, void *buf, mp_uint_t size, int *er
         o->eof = true;
     }
     if (st < 0) {
+        if (TINF_OVERRUN(&o->decomp)) {
+            nlr_raise(mp_obj_new_exception(&mp_type_EOFError));
+        }
         *errcode = MP_EINVAL;
         return MP_STREAM_ERROR;
     }
+    decompio_unread(o);
     return o->decomp.dest - (byte*)buf;
 }
 
@@ -130,6 +194,22 @@ STATIC const mp_rom_map_elem_t decompio_locals_dict_table[] = {
 
 STATIC MP_DEFINE_CONST_DICT(decompio_locals_dict, decompio_locals_dict_table);
 
+STATIC void decompio_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // not load attribute
+        return;
+    }
+    mp_obj_decompio_t *self = MP_OBJ_TO_PTR(self_in);
+    if (attr == MP_QSTR_unused_data) {
+        dest[0] = self->unused_data;
+        return;
+    }
+    mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&decompio_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+    if (elem != NULL) {
+        mp_convert_member_lookup(self_in, self->base.type, elem->value, dest);
+    }
+}
+
 STATIC const mp_stream_p_t decompio_stream_p = {
     .read = decompio_read,
 };
@@ -138,6 +218,7 @@ STATIC const mp_obj_type_t decompio_type = {
     { &mp_type_type },
     .name = MP_QSTR_DecompIO,
     .make_new = decompio_make_new,
+    .attr = decompio_attr,
     .protocol = &decompio_stream_p,
     .locals_dict = (void*)&decompio_locals_dict,
 };
@@ -156,9 +237,11 @@ STATIC mp_obj_t mod_uzlib_decompress(size_t n_args, const mp_obj_t *args) {
     byte *dest_buf = m_new(byte, dest_buf_size);
 
     decomp->dest = dest_buf;
+    decomp->destStart = dest_buf;
     decomp->destSize = dest_buf_size;
     DEBUG_printf("uzlib: Initial out buffer: " UINT_FMT " bytes\n", decomp->destSize);
     decomp->source = bufinfo.buf;
+    decomp->source_limit = (byte*)bufinfo.buf + bufinfo.len;
 
     int st;
     bool is_zlib = true;
@@ -182,11 +265,14 @@ STATIC mp_obj_t mod_uzlib_decompress(size_t n_args, const mp_obj_t *args) {
         if (st == TINF_DONE) {
             break;
         }
+        // grow the buffer geometrically, to not copy the output over and over
         size_t offset = decomp->dest - dest_buf;
-        dest_buf = m_renew(byte, dest_buf, dest_buf_size, dest_buf_size + 256);
-        dest_buf_size += 256;
+        size_t grow = dest_buf_size / 2 + 256;
+        dest_buf = m_renew(byte, dest_buf, dest_buf_size, dest_buf_size + grow);
+        dest_buf_size += grow;
         decomp->dest = dest_buf + offset;
-        decomp->destSize = 256;
+        decomp->destStart = dest_buf;
+        decomp->destSize = grow;
     }
 
     mp_uint_t final_sz = decomp->dest - dest_buf;
@@ -201,10 +287,177 @@ error:
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_decompress_obj, 1, 3, mod_uzlib_decompress);
 
+#if MICROPY_PY_UZLIB_COMPRESS
+
+#define COMPRESS_DEFAULT_WBITS (10)
+
+// Parse level and wbits arguments (wbits as in CPython's zlib: 9..15 for zlib
+// framing, 25..31 for gzip and -9..-15 for raw DEFLATE) and set up compressor.
+// Returns the size of the working memory allocated.
+STATIC size_t compress_init(UZLIB_COMP *comp, size_t n_args, const mp_obj_t *args) {
+    mp_int_t level = -1;
+    mp_int_t wbits = COMPRESS_DEFAULT_WBITS;
+    if (n_args > 0) {
+        level = mp_obj_get_int(args[0]);
+    }
+    if (n_args > 1) {
+        wbits = mp_obj_get_int(args[1]);
+    }
+    if (level < -1 || level > 9) {
+        mp_raise_ValueError("invalid level");
+    }
+
+    int checksum_type = TINF_CHKSUM_ADLER;
+    if (wbits >= 16 + 9) {
+        checksum_type = TINF_CHKSUM_CRC;
+        wbits -= 16;
+    } else if (wbits < 0) {
+        checksum_type = TINF_CHKSUM_NONE;
+        wbits = -wbits;
+    }
+    if (wbits < 9 || wbits > 15) {
+        mp_raise_ValueError("invalid wbits");
+    }
+
+    size_t mem_sz = uzlib_compress_mem_size(wbits);
+    memset(comp, 0, sizeof(*comp));
+    uzlib_compress_init(comp, m_new(byte, mem_sz), wbits, level, checksum_type);
+    return mem_sz;
+}
+
+typedef struct _mp_obj_compio_t {
+    mp_obj_base_t base;
+    mp_obj_t dest_stream;
+    UZLIB_COMP comp;
+    bool closed;
+} mp_obj_compio_t;
+
+STATIC void write_dest_stream(UZLIB_COMP *comp, const unsigned char *buf, unsigned int len) {
+    byte *p = (void*)comp;
+    p -= offsetof(mp_obj_compio_t, comp);
+    mp_obj_compio_t *self = (mp_obj_compio_t*)p;
+
+    int err;
+    mp_uint_t out_sz = mp_stream_write_exactly(self->dest_stream, buf, len, &err);
+    if (err != 0) {
+        mp_raise_OSError(err);
+    }
+    // A non-blocking stream may take only part of the data; the compressor
+    // can't go back to write the rest later, so that is an error too.
+    if (out_sz != len) {
+        mp_raise_OSError(MP_EIO);
+    }
+}
+
+STATIC mp_obj_t compio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 3, false);
+    mp_obj_compio_t *o = m_new_obj(mp_obj_compio_t);
+    o->base.type = type;
+    mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+    o->dest_stream = args[0];
+    o->closed = false;
+    compress_init(&o->comp, n_args - 1, args + 1);
+    o->comp.writeDest = write_dest_stream;
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_uint_t compio_write(mp_obj_t o_in, const void *buf, mp_uint_t size, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    if (o->closed) {
+        *errcode = MP_EINVAL;
+        return MP_STREAM_ERROR;
+    }
+    uzlib_compress(&o->comp, buf, size);
+    return size;
+}
+
+STATIC mp_uint_t compio_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    (void)arg;
+    if (request == MP_STREAM_FLUSH) {
+        if (o->closed) {
+            *errcode = MP_EINVAL;
+            return MP_STREAM_ERROR;
+        }
+        uzlib_compress_flush(&o->comp, 0);
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+// Ends the compressed stream; the underlying stream is left open.
+STATIC mp_obj_t compio_close(mp_obj_t self_in) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(self_in);
+    if (!o->closed) {
+        o->closed = true;
+        uzlib_compress_flush(&o->comp, 1);
+        o->comp.win = NULL;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(compio_close_obj, compio_close);
+
+STATIC const mp_rom_map_elem_t compio_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&compio_close_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(compio_locals_dict, compio_locals_dict_table);
+
+STATIC const mp_stream_p_t compio_stream_p = {
+    .write = compio_write,
+    .ioctl = compio_ioctl,
+};
+
+STATIC const mp_obj_type_t compio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_CompIO,
+    .make_new = compio_make_new,
+    .protocol = &compio_stream_p,
+    .locals_dict = (void*)&compio_locals_dict,
+};
+
+typedef struct _compress_buf_t {
+    UZLIB_COMP comp;
+    vstr_t vstr;
+} compress_buf_t;
+
+STATIC void write_dest_vstr(UZLIB_COMP *comp, const unsigned char *buf, unsigned int len) {
+    compress_buf_t *b = (compress_buf_t*)comp;
+    vstr_add_strn(&b->vstr, (const char*)buf, len);
+}
+
+STATIC mp_obj_t mod_uzlib_compress(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+
+    compress_buf_t *b = m_new_obj(compress_buf_t);
+    size_t mem_sz = compress_init(&b->comp, n_args - 1, args + 1);
+    b->comp.writeDest = write_dest_vstr;
+    vstr_init(&b->vstr, bufinfo.len / 2 + 16);
+
+    uzlib_compress(&b->comp, bufinfo.buf, bufinfo.len);
+    uzlib_compress_flush(&b->comp, 1);
+
+    mp_obj_t res = mp_obj_new_str_from_vstr(&mp_type_bytes, &b->vstr);
+    m_del(byte, b->comp.hash, mem_sz);
+    m_del_obj(compress_buf_t, b);
+    return res;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_compress_obj, 1, 3, mod_uzlib_compress);
+
+#endif // MICROPY_PY_UZLIB_COMPRESS
+
 STATIC const mp_rom_map_elem_t mp_module_uzlib_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uzlib) },
     { MP_ROM_QSTR(MP_QSTR_decompress), MP_ROM_PTR(&mod_uzlib_decompress_obj) },
     { MP_ROM_QSTR(MP_QSTR_DecompIO), MP_ROM_PTR(&decompio_type) },
+    #if MICROPY_PY_UZLIB_COMPRESS
+    { MP_ROM_QSTR(MP_QSTR_compress), MP_ROM_PTR(&mod_uzlib_compress_obj) },
+    { MP_ROM_QSTR(MP_QSTR_CompIO), MP_ROM_PTR(&compio_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uzlib_globals, mp_module_uzlib_globals_table);
@@ -220,6 +473,9 @@ const mp_obj_module_t mp_module_uzlib = {
 #include "uzlib/tinflate.c"
 #include "uzlib/tinfzlib.c"
 #include "uzlib/tinfgzip.c"
+#if MICROPY_PY_UZLIB_COMPRESS
+#include "uzlib/tdeflate.c"
+#endif
 #include "uzlib/adler32.c"
 #include "uzlib/crc32.c"
 
@@ -0,0 +1,191 @@
+// Copyright 2007-2009 Russ Cox.  All Rights Reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+#include "re1.5.h"
+
+// Pike VM: runs all threads of the program in lock step over the subject, so
+// it takes time linear in the subject length and never needs more stack than
+// the program is long.  Threads are kept in priority order, and a program
+// location is entered at most once per input position, which gives the same
+// (leftmost-first) result as the backtracking matchers.
+
+typedef struct {
+    int n;
+    const char **pc;
+    const char **sub; // nsubp entries per thread
+} ThreadList;
+
+typedef struct {
+    const char *base;
+    Subject *input;
+    unsigned char *mark;
+    int nsubp;
+} PikeVM;
+
+// add the thread at pc to the list, following all instructions that don't
+// consume input; sub is scratch space holding the thread's captures
+static void addthread(PikeVM *vm, ThreadList *l, const char *pc, const char *sp, const char **sub)
+{
+    for (;;) {
+        int off = pc - vm->base;
+        if (vm->mark[off >> 3] & (1 << (off & 7))) {
+            return;
+        }
+        vm->mark[off >> 3] |= 1 << (off & 7);
+
+        switch (*pc) {
+        case Jmp:
+            pc += 2 + (signed char)pc[1];
+            continue;
+        case Split:
+            addthread(vm, l, pc + 2, sp, sub);
+            pc += 2 + (signed char)pc[1];
+            continue;
+        case RSplit:
+            addthread(vm, l, pc + 2 + (signed char)pc[1], sp, sub);
+            pc += 2;
+            continue;
+        case Save: {
+            int n = (unsigned char)pc[1];
+            if (n >= vm->nsubp) {
+                pc += 2;
+                continue;
+            }
+            const char *old = sub[n];
+            sub[n] = sp;
+            addthread(vm, l, pc + 2, sp, sub);
+            sub[n] = old;
+            return;
+        }
+        case Bol:
+            if (sp != vm->input->begin_line) {
+                return;
+            }
+            pc++;
+            continue;
+        case Eol:
+            if (sp != vm->input->end) {
+                return;
+            }
+            pc++;
+            continue;
+        default:
+            // a consumer or Match: the thread waits here for the next input
+            l->pc[l->n] = pc;
+            const char **dest = l->sub + l->n++ * vm->nsubp;
+            for (int i = 0; i < vm->nsubp; i++) {
+                dest[i] = sub[i];
+            }
+            return;
+        }
+    }
+}
+
+int re1_5_pikevm_worksize(ByteProg *prog, int nsubp)
+{
+    // two thread lists, with at most one thread per instruction, plus scratch
+    // captures and a bitmap of visited locations
+    return (2 * prog->len * (nsubp + 1) + nsubp) * sizeof(char*) + (prog->bytelen + 7) / 8;
+}
+
+int re1_5_pikevm(ByteProg *prog, Subject *input, const char **subp, int nsubp, int is_anchored, void *work)
+{
+    PikeVM vm = { prog->insts, input, NULL, nsubp };
+    ThreadList lists[2];
+    const char **p = work;
+    for (int i = 0; i < 2; i++) {
+        lists[i].n = 0;
+        lists[i].pc = p;
+        p += prog->len;
+        lists[i].sub = p;
+        p += prog->len * nsubp;
+    }
+    const char **sub = p;
+    vm.mark = (unsigned char*)(p + nsubp);
+    int marklen = (prog->bytelen + 7) / 8;
+
+    ThreadList *clist = &lists[0];
+    ThreadList *nlist = &lists[1];
+    int matched = 0;
+
+    // when searching for a pattern that starts with a literal character, and
+    // no thread has got past it, skip straight to where that character occurs;
+    // the threads that are then waiting are the literal and the search prefix
+    const char *start = HANDLE_ANCHORED(prog->insts, is_anchored);
+    const char *first = NULL;
+    if (!is_anchored && start[NON_ANCHORED_PREFIX + 2] == Char) {
+        first = start + NON_ANCHORED_PREFIX + 2;
+    }
+
+    memcpy((char*)sub, subp, nsubp * sizeof(char*));
+    memset(vm.mark, 0, marklen);
+    addthread(&vm, clist, start, input->begin, sub);
+
+    for (const char *sp = input->begin; clist->n > 0; sp++) {
+        if (first != NULL && clist->n == 2 && clist->pc[0] == first && clist->pc[1] == start + 2) {
+            const char *next = memchr(sp, first[1], input->end - sp);
+            if (next == NULL) {
+                break;
+            }
+            if (next != sp) {
+                sp = next;
+                clist->n = 0;
+                memset(vm.mark, 0, marklen);
+                addthread(&vm, clist, start, sp, sub);
+            }
+        }
+        memset(vm.mark, 0, marklen);
+        nlist->n = 0;
+        for (int i = 0; i < clist->n; i++) {
+            const char *pc = clist->pc[i];
+            const char **tsub = clist->sub + i * nsubp;
+            if (*pc == Match) {
+                if (sp == input->nonempty_at && nsubp > 0 && tsub[0] == sp) {
+                    continue;
+                }
+                // lower priority threads can no longer win, so drop them
+                memcpy((char*)subp, tsub, nsubp * sizeof(char*));
+                matched = 1;
+                break;
+            }
+            if (sp >= input->end) {
+                continue;
+            }
+            switch (*pc++) {
+            case Char:
+                if (*sp != *pc++) {
+                    continue;
+                }
+                break;
+            case Any:
+                break;
+            case Class:
+            case ClassNot:
+                if (!_re1_5_classmatch(pc, sp)) {
+                    continue;
+                }
+                pc += *(unsigned char*)pc * 2 + 1;
+                break;
+            case NamedClass:
+                if (!_re1_5_namedclassmatch(pc, sp)) {
+                    continue;
+                }
+                pc++;
+                break;
+            default:
+                re1_5_fatal("pikevm");
+            }
+            // this thread is finished with, so its captures can be the scratch
+            addthread(&vm, nlist, pc, sp + 1, tsub);
+        }
+        if (sp >= input->end) {
+            break;
+        }
+        ThreadList *t = clist;
+        clist = nlist;
+        nlist = t;
+    }
+
+    return matched;
+}
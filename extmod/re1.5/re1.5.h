@@ -127,8 +127,13 @@ Sub *update(Sub*, int, const char*);
 void decref(Sub*);
 
 struct Subject {
+	// where to start matching, which may be after the start of the subject
 	const char *begin;
 	const char *end;
+	// the start of the subject, which is where ^ matches
+	const char *begin_line;
+	// an empty match starting here is rejected, unless this is NULL
+	const char *nonempty_at;
 };
 
 
@@ -136,8 +141,10 @@ struct Subject {
 #define HANDLE_ANCHORED(bytecode, is_anchored) ((is_anchored) ? (bytecode) + NON_ANCHORED_PREFIX : (bytecode))
 
 int re1_5_backtrack(ByteProg*, Subject*, const char**, int, int);
-int re1_5_pikevm(ByteProg*, Subject*, const char**, int, int);
+int re1_5_pikevm_worksize(ByteProg*, int);
+int re1_5_pikevm(ByteProg*, Subject*, const char**, int, int, void*);
 int re1_5_recursiveloopprog(ByteProg*, Subject*, const char**, int, int);
+int re1_5_recursiveloopprog_bounded(ByteProg*, Subject*, const char**, int, int, int, int);
 int re1_5_recursiveprog(ByteProg*, Subject*, const char**, int, int);
 int re1_5_thompsonvm(ByteProg*, Subject*, const char**, int, int);
 
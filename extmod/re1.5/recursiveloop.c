@@ -4,13 +4,20 @@
 
 #include "re1.5.h"
 
+// Returns 1 on a match, 0 if there is none, or -1 if the recursion depth or
+// the number of steps ran out, in which case the captures are undefined.
 static int
-recursiveloop(char *pc, const char *sp, Subject *input, const char **subp, int nsubp)
+recursiveloop(char *pc, const char *sp, Subject *input, const char **subp, int nsubp, int depth, int *steps)
 {
 	const char *old;
 	int off;
-	
+	int res;
+
+	if(depth == 0)
+		return -1;
 	for(;;) {
+		if(--*steps < 0)
+			return -1;
 		if(inst_is_consumer(*pc)) {
 			// If we need to match a character, but there's none left, it's fail
 			if(sp >= input->end)
@@ -37,6 +44,8 @@ recursiveloop(char *pc, const char *sp, Subject *input, const char **subp, int n
 			sp++;
 			continue;
 		case Match:
+			if(sp == input->nonempty_at && nsubp > 0 && subp[0] == sp)
+				return 0;
 			return 1;
 		case Jmp:
 			off = (signed char)*pc++;
@@ -44,14 +53,14 @@ recursiveloop(char *pc, const char *sp, Subject *input, const char **subp, int n
 			continue;
 		case Split:
 			off = (signed char)*pc++;
-			if(recursiveloop(pc, sp, input, subp, nsubp))
-				return 1;
+			if((res = recursiveloop(pc, sp, input, subp, nsubp, depth - 1, steps)) != 0)
+				return res;
 			pc = pc + off;
 			continue;
 		case RSplit:
 			off = (signed char)*pc++;
-			if(recursiveloop(pc + off, sp, input, subp, nsubp))
-				return 1;
+			if((res = recursiveloop(pc + off, sp, input, subp, nsubp, depth - 1, steps)) != 0)
+				return res;
 			continue;
 		case Save:
 			off = (unsigned char)*pc++;
@@ -60,12 +69,12 @@ recursiveloop(char *pc, const char *sp, Subject *input, const char **subp, int n
 			}
 			old = subp[off];
 			subp[off] = sp;
-			if(recursiveloop(pc, sp, input, subp, nsubp))
-				return 1;
+			if((res = recursiveloop(pc, sp, input, subp, nsubp, depth - 1, steps)) != 0)
+				return res;
 			subp[off] = old;
 			return 0;
 		case Bol:
-			if(sp != input->begin)
+			if(sp != input->begin_line)
 				return 0;
 			continue;
 		case Eol:
@@ -80,5 +89,15 @@ recursiveloop(char *pc, const char *sp, Subject *input, const char **subp, int n
 int
 re1_5_recursiveloopprog(ByteProg *prog, Subject *input, const char **subp, int nsubp, int is_anchored)
 {
-	return recursiveloop(HANDLE_ANCHORED(prog->insts, is_anchored), input->begin, input, subp, nsubp);
+	// effectively no limits, but a step count that runs out gives no match
+	int steps = -1u >> 1;
+	return recursiveloop(HANDLE_ANCHORED(prog->insts, is_anchored), input->begin, input, subp, nsubp, -1, &steps) > 0;
+}
+
+// Like re1_5_recursiveloopprog, but gives up, returning -1, once it would
+// recurse more than max_depth deep or execute more than max_steps instructions.
+int
+re1_5_recursiveloopprog_bounded(ByteProg *prog, Subject *input, const char **subp, int nsubp, int is_anchored, int max_depth, int max_steps)
+{
+	return recursiveloop(HANDLE_ANCHORED(prog->insts, is_anchored), input->begin, input, subp, nsubp, max_depth, &max_steps);
 }
@@ -0,0 +1,710 @@
+/*
+ * tdeflate  -  tiny deflate
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+/*
+ * Streaming compressor. Input is appended to a window buffer of twice the
+ * LZ77 window size, matches are found using hash chains, and the resulting
+ * literal/match symbols are collected per block. When a block is flushed
+ * it is emitted as whichever of a stored, fixed Huffman or dynamic Huffman
+ * block is smallest. All memory is supplied by the caller, its size is
+ * given by uzlib_compress_mem_size().
+ */
+
+#include <string.h>
+#include "tinf.h"
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+/* length 3 matches further away than this are not worth it */
+#define TOO_FAR 4096
+
+#define MAX_BITS 15
+#define MAX_CL_BITS 7
+
+extern const unsigned char clcidx[];
+
+/* per compression level: how many hash chain entries to try, and the match
+   length below which a match at the next position is also tried (lazy
+   matching, 0 to disable) */
+static const struct {
+   unsigned short max_chain;
+   unsigned short max_lazy;
+} tdefl_levels[10] = {
+   {0, 0}, {4, 0}, {8, 0}, {16, 0}, {16, 16},
+   {32, 32}, {64, 64}, {128, 128}, {256, MAX_MATCH}, {1024, MAX_MATCH},
+};
+
+static unsigned int tdefl_hash_bits(int wbits)
+{
+   return wbits < 12 ? wbits : 12;
+}
+
+static unsigned int tdefl_sym_max(int wbits)
+{
+   return 1 << (wbits < 12 ? wbits : 12);
+}
+
+unsigned int uzlib_compress_mem_size(int wbits)
+{
+   unsigned int w = 1 << wbits;
+   unsigned int sym_max = tdefl_sym_max(wbits);
+   return ((1 << tdefl_hash_bits(wbits)) + w + sym_max) * sizeof(unsigned short)
+      + 2 * w + sym_max;
+}
+
+/* ------------------ *
+ * -- output utils -- *
+ * ------------------ */
+
+static void tdefl_flush_out(UZLIB_COMP *c)
+{
+   if (c->outlen) {
+      c->writeDest(c, c->outbuf, c->outlen);
+      c->outlen = 0;
+   }
+}
+
+static void tdefl_put_byte(UZLIB_COMP *c, unsigned char b)
+{
+   c->outbuf[c->outlen++] = b;
+   if (c->outlen == sizeof(c->outbuf)) {
+      tdefl_flush_out(c);
+   }
+}
+
+/* write the num low bits of v, num <= 16 */
+static void tdefl_put_bits(UZLIB_COMP *c, unsigned int v, int num)
+{
+   c->bitbuf |= v << c->bitcount;
+   c->bitcount += num;
+   while (c->bitcount >= 8) {
+      tdefl_put_byte(c, c->bitbuf);
+      c->bitbuf >>= 8;
+      c->bitcount -= 8;
+   }
+}
+
+static void tdefl_align(UZLIB_COMP *c)
+{
+   if (c->bitcount) {
+      tdefl_put_bits(c, 0, 8 - c->bitcount);
+   }
+}
+
+static void tdefl_put_be_uint32(UZLIB_COMP *c, uint32_t v)
+{
+   int i;
+   for (i = 24; i >= 0; i -= 8) tdefl_put_byte(c, v >> i);
+}
+
+static void tdefl_put_le_uint32(UZLIB_COMP *c, uint32_t v)
+{
+   int i;
+   for (i = 0; i < 32; i += 8) tdefl_put_byte(c, v >> i);
+}
+
+/* --------------------------- *
+ * -- length/distance codes -- *
+ * --------------------------- */
+
+static unsigned int tdefl_log2(unsigned int v)
+{
+   unsigned int r = 0;
+   while (v >>= 1) r++;
+   return r;
+}
+
+/* map a match length to its code (0..28, symbol 257 + code) and extra bits */
+static unsigned int tdefl_len_code(unsigned int len, unsigned int *nbits)
+{
+   unsigned int l = len - MIN_MATCH;
+   if (l < 8 || len == MAX_MATCH) {
+      *nbits = 0;
+      return len == MAX_MATCH ? 28 : l;
+   }
+   *nbits = tdefl_log2(l) - 2;
+   return 4 * *nbits + 4 + ((l >> *nbits) & 3);
+}
+
+/* map a match distance to its code (0..29) and extra bits */
+static unsigned int tdefl_dist_code(unsigned int dist, unsigned int *nbits)
+{
+   unsigned int d = dist - 1;
+   if (d < 4) {
+      *nbits = 0;
+      return d;
+   }
+   *nbits = tdefl_log2(d) - 1;
+   return 2 * *nbits + 2 + ((d >> *nbits) & 1);
+}
+
+/* ------------------------ *
+ * -- Huffman code build -- *
+ * ------------------------ */
+
+/* compute code lengths, at most max_bits long, for the n symbols with the
+   given frequencies; always uses at least two codes so the tree is complete */
+static void tdefl_build_lengths(const unsigned short *freq, unsigned int n, unsigned int max_bits, unsigned char *lens)
+{
+   unsigned short sym[288];
+   unsigned short a[288];
+   unsigned short count[MAX_BITS + 1];
+   int num = 0, i, j;
+
+   memset(lens, 0, n);
+
+   /* collect the used symbols, sorted by increasing frequency */
+   for (i = 0; i < (int)n; ++i) {
+      if (freq[i]) {
+         for (j = num; j > 0 && a[j - 1] > freq[i]; --j) {
+            a[j] = a[j - 1];
+            sym[j] = sym[j - 1];
+         }
+         a[j] = freq[i];
+         sym[j] = i;
+         num++;
+      }
+   }
+
+   if (num < 2) {
+      /* a single code would make an incomplete tree, so add a dummy one */
+      if (num == 0) {
+         lens[0] = lens[1] = 1;
+      } else {
+         lens[sym[0]] = 1;
+         lens[sym[0] == 0 ? 1 : 0] = 1;
+      }
+      return;
+   }
+
+   /* Moffat and Katajainen's in-place computation of optimal code lengths:
+      first build the tree, with parent pointers replacing the weights... */
+   {
+      int root = 0, leaf = 2, next;
+      a[0] += a[1];
+      for (next = 1; next < num - 1; ++next) {
+         if (leaf >= num || a[root] < a[leaf]) {
+            a[next] = a[root];
+            a[root++] = next;
+         } else {
+            a[next] = a[leaf++];
+         }
+         if (leaf >= num || (root < next && a[root] < a[leaf])) {
+            a[next] += a[root];
+            a[root++] = next;
+         } else {
+            a[next] += a[leaf++];
+         }
+      }
+
+      /* ...then convert the parent pointers to internal node depths... */
+      a[num - 2] = 0;
+      for (next = num - 3; next >= 0; --next) {
+         a[next] = a[a[next]] + 1;
+      }
+
+      /* ...and finally the internal node depths to leaf depths */
+      {
+         int avail = 1, used = 0, depth = 0;
+         root = num - 2;
+         next = num - 1;
+         while (avail > 0) {
+            while (root >= 0 && a[root] == depth) {
+               used++;
+               root--;
+            }
+            while (avail > used) {
+               a[next--] = depth;
+               avail--;
+            }
+            avail = 2 * used;
+            depth++;
+            used = 0;
+         }
+      }
+   }
+
+   /* count codes per length, folding the too long ones into max_bits and
+      then lengthening shorter codes until the code is complete again */
+   memset(count, 0, sizeof(count));
+   for (i = 0; i < num; ++i) {
+      count[a[i] < max_bits ? a[i] : max_bits]++;
+   }
+   {
+      uint32_t total = 0;
+      for (i = max_bits; i > 0; --i) {
+         total += (uint32_t)count[i] << (max_bits - i);
+      }
+      while (total != (1UL << max_bits)) {
+         count[max_bits]--;
+         for (i = max_bits - 1; i > 0; --i) {
+            if (count[i]) {
+               count[i]--;
+               count[i + 1] += 2;
+               break;
+            }
+         }
+         total--;
+      }
+   }
+
+   /* the most frequent symbols get the shortest codes */
+   for (i = 1, j = num; i <= (int)max_bits; ++i) {
+      int k;
+      for (k = count[i]; k > 0; --k) {
+         lens[sym[--j]] = i;
+      }
+   }
+}
+
+/* assign canonical codes to the given lengths, bit reversed for output */
+static void tdefl_build_codes(const unsigned char *lens, unsigned int n, unsigned short *codes)
+{
+   unsigned short count[MAX_BITS + 1];
+   unsigned short next[MAX_BITS + 1];
+   unsigned int i, code = 0;
+
+   memset(count, 0, sizeof(count));
+   for (i = 0; i < n; ++i) count[lens[i]]++;
+   count[0] = 0;
+   for (i = 1; i <= MAX_BITS; ++i) {
+      code = (code + count[i - 1]) << 1;
+      next[i] = code;
+   }
+   for (i = 0; i < n; ++i) {
+      unsigned int len = lens[i], c, r = 0;
+      if (len == 0) continue;
+      for (c = next[len]++; len--; c >>= 1) {
+         r = (r << 1) | (c & 1);
+      }
+      codes[i] = r;
+   }
+}
+
+/* ------------------ *
+ * -- block output -- *
+ * ------------------ */
+
+static void tdefl_put_stored(UZLIB_COMP *c, const unsigned char *p, unsigned int len, int final)
+{
+   do {
+      unsigned int n = len < 0xffff ? len : 0xffff;
+      tdefl_put_bits(c, final && n == len, 3);
+      tdefl_align(c);
+      tdefl_put_byte(c, n);
+      tdefl_put_byte(c, n >> 8);
+      tdefl_put_byte(c, ~n);
+      tdefl_put_byte(c, ~n >> 8);
+      len -= n;
+      while (n--) tdefl_put_byte(c, *p++);
+   } while (len);
+}
+
+static void tdefl_put_symbols(UZLIB_COMP *c)
+{
+   unsigned int i;
+   for (i = 0; i < c->sym_count; ++i) {
+      unsigned int lit = c->sym_lit[i];
+      unsigned int dist = c->sym_dist[i];
+      if (dist == 0) {
+         tdefl_put_bits(c, c->lcode[lit], c->llen[lit]);
+      } else {
+         unsigned int nbits;
+         unsigned int code = 257 + tdefl_len_code(lit + MIN_MATCH, &nbits);
+         tdefl_put_bits(c, c->lcode[code], c->llen[code]);
+         if (nbits) tdefl_put_bits(c, lit & ((1 << nbits) - 1), nbits);
+         code = tdefl_dist_code(dist, &nbits);
+         tdefl_put_bits(c, c->dcode[code], c->dlen[code]);
+         if (nbits) tdefl_put_bits(c, (dist - 1) & ((1 << nbits) - 1), nbits);
+      }
+   }
+   tdefl_put_bits(c, c->lcode[256], c->llen[256]);
+}
+
+static void tdefl_flush_block(UZLIB_COMP *c, int final)
+{
+   unsigned char lens[286 + 30];
+   /* the code lengths, run length coded with the code length alphabet */
+   unsigned char rle[286 + 30];
+   unsigned char rle_extra[286 + 30];
+   unsigned short clfreq[19];
+   unsigned char cllen[19];
+   unsigned short clcode[19];
+   unsigned int hlit, hdist, hclen, nrle = 0, nlens, i;
+   uint32_t extra = 0, fixed_cost, dyn_cost, stored_cost = 0xffffffff;
+
+   c->lfreq[256] = 1;
+
+   /* extra bits of lengths and distances, the same for any Huffman block */
+   for (i = 8; i < 28; ++i) extra += (uint32_t)c->lfreq[257 + i] * ((i - 4) >> 2);
+   for (i = 4; i < 30; ++i) extra += (uint32_t)c->dfreq[i] * ((i - 2) >> 1);
+
+   /* fixed codes */
+   fixed_cost = 3 + extra;
+   for (i = 0; i < 286; ++i) {
+      fixed_cost += (uint32_t)c->lfreq[i] * (i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+   }
+   for (i = 0; i < 30; ++i) fixed_cost += (uint32_t)c->dfreq[i] * 5;
+
+   /* dynamic codes */
+   tdefl_build_lengths(c->lfreq, 286, MAX_BITS, c->llen);
+   tdefl_build_lengths(c->dfreq, 30, MAX_BITS, c->dlen);
+   for (hlit = 286; hlit > 257 && c->llen[hlit - 1] == 0; --hlit);
+   for (hdist = 30; hdist > 1 && c->dlen[hdist - 1] == 0; --hdist);
+   memcpy(lens, c->llen, hlit);
+   memcpy(lens + hlit, c->dlen, hdist);
+   nlens = hlit + hdist;
+
+   memset(clfreq, 0, sizeof(clfreq));
+   for (i = 0; i < nlens;) {
+      unsigned int len = lens[i], run = 1;
+      while (i + run < nlens && lens[i + run] == len) run++;
+      i += run;
+      if (len == 0) {
+         while (run >= 11) {
+            unsigned int r = run < 138 ? run : 138;
+            rle[nrle] = 18;
+            rle_extra[nrle++] = r - 11;
+            run -= r;
+         }
+         if (run >= 3) {
+            rle[nrle] = 17;
+            rle_extra[nrle++] = run - 3;
+            run = 0;
+         }
+      } else {
+         rle[nrle++] = len;
+         run--;
+         while (run >= 3) {
+            unsigned int r = run < 6 ? run : 6;
+            rle[nrle] = 16;
+            rle_extra[nrle++] = r - 3;
+            run -= r;
+         }
+      }
+      while (run--) {
+         rle[nrle++] = len;
+      }
+   }
+   for (i = 0; i < nrle; ++i) clfreq[rle[i]]++;
+
+   tdefl_build_lengths(clfreq, 19, MAX_CL_BITS, cllen);
+   for (hclen = 19; hclen > 4 && cllen[clcidx[hclen - 1]] == 0; --hclen);
+
+   dyn_cost = 3 + 14 + 3 * hclen + extra
+      + 2 * clfreq[16] + 3 * clfreq[17] + 7 * clfreq[18];
+   for (i = 0; i < 19; ++i) dyn_cost += (uint32_t)clfreq[i] * cllen[i];
+   for (i = 0; i < 286; ++i) dyn_cost += (uint32_t)c->lfreq[i] * c->llen[i];
+   for (i = 0; i < 30; ++i) dyn_cost += (uint32_t)c->dfreq[i] * c->dlen[i];
+
+   /* stored, only possible while all of the block's data is in the window */
+   if (c->block_start >= 0) {
+      unsigned int len = c->pos - c->block_start;
+      stored_cost = ((c->bitcount + 3 + 7) & ~7) - c->bitcount + 32 + 8 * len
+         + 40 * (len / 0xffff);
+   }
+
+   if (stored_cost <= fixed_cost && stored_cost <= dyn_cost) {
+      tdefl_put_stored(c, c->win + c->block_start, c->pos - c->block_start, final);
+   } else if (fixed_cost <= dyn_cost) {
+      for (i = 0; i < 144; ++i) c->llen[i] = 8;
+      for (; i < 256; ++i) c->llen[i] = 9;
+      for (; i < 280; ++i) c->llen[i] = 7;
+      for (; i < 288; ++i) c->llen[i] = 8;
+      for (i = 0; i < 30; ++i) c->dlen[i] = 5;
+      tdefl_build_codes(c->llen, 288, c->lcode);
+      tdefl_build_codes(c->dlen, 30, c->dcode);
+      tdefl_put_bits(c, final | 1 << 1, 3);
+      tdefl_put_symbols(c);
+   } else {
+      tdefl_build_codes(c->llen, hlit, c->lcode);
+      tdefl_build_codes(c->dlen, hdist, c->dcode);
+      tdefl_build_codes(cllen, 19, clcode);
+      tdefl_put_bits(c, final | 2 << 1, 3);
+      tdefl_put_bits(c, hlit - 257, 5);
+      tdefl_put_bits(c, hdist - 1, 5);
+      tdefl_put_bits(c, hclen - 4, 4);
+      for (i = 0; i < hclen; ++i) tdefl_put_bits(c, cllen[clcidx[i]], 3);
+      for (i = 0; i < nrle; ++i) {
+         unsigned int s = rle[i];
+         tdefl_put_bits(c, clcode[s], cllen[s]);
+         if (s >= 16) tdefl_put_bits(c, rle_extra[i], s == 16 ? 2 : s == 17 ? 3 : 7);
+      }
+      tdefl_put_symbols(c);
+   }
+
+   memset(c->lfreq, 0, sizeof(c->lfreq));
+   memset(c->dfreq, 0, sizeof(c->dfreq));
+   c->sym_count = 0;
+   c->block_start = c->pos;
+}
+
+/* ------------------- *
+ * -- match finding -- *
+ * ------------------- */
+
+static unsigned int tdefl_hash(UZLIB_COMP *c, unsigned int p)
+{
+   const unsigned char *s = c->win + p;
+   uint32_t v = (uint32_t)s[0] << 16 | s[1] << 8 | s[2];
+   return (v * 2654435761u) >> (32 - c->hash_bits);
+}
+
+/* add the positions before p to the hash chains, as far as there is data */
+static void tdefl_insert_upto(UZLIB_COMP *c, unsigned int p)
+{
+   while (c->ins < p && c->ins + MIN_MATCH <= c->end) {
+      unsigned int h = tdefl_hash(c, c->ins);
+      c->prev[c->ins & c->wmask] = c->hash[h];
+      c->hash[h] = c->ins++;
+   }
+}
+
+/* find the longest match for the data at p, returns its length (0 if none) */
+static unsigned int tdefl_find_match(UZLIB_COMP *c, unsigned int p, unsigned int *dist)
+{
+   const unsigned char *win = c->win;
+   unsigned int max_len = c->end - p;
+   unsigned int limit = p > c->wmask ? p - c->wmask : 0;
+   unsigned int chain = c->max_chain;
+   unsigned int best = MIN_MATCH - 1;
+   unsigned int cand;
+
+   if (max_len < MIN_MATCH) {
+      return 0;
+   }
+   if (max_len > MAX_MATCH) {
+      max_len = MAX_MATCH;
+   }
+   tdefl_insert_upto(c, p + 1);
+   cand = c->prev[p & c->wmask];
+
+   while (cand >= limit && cand < p && chain--) {
+      if (win[cand + best] == win[p + best] && win[cand] == win[p]) {
+         unsigned int len = 1;
+         while (len < max_len && win[cand + len] == win[p + len]) len++;
+         if (len > best) {
+            best = len;
+            *dist = p - cand;
+            if (len == max_len) break;
+         }
+      }
+      {
+         unsigned int next = c->prev[cand & c->wmask];
+         if (next >= cand) break;
+         cand = next;
+      }
+   }
+
+   if (best < MIN_MATCH || (best == MIN_MATCH && *dist > TOO_FAR)) {
+      return 0;
+   }
+   return best;
+}
+
+static void tdefl_record(UZLIB_COMP *c, unsigned int lit, unsigned int dist)
+{
+   c->sym_lit[c->sym_count] = lit;
+   c->sym_dist[c->sym_count] = dist;
+   if (dist == 0) {
+      c->lfreq[lit]++;
+   } else {
+      unsigned int nbits;
+      c->lfreq[257 + tdefl_len_code(lit + MIN_MATCH, &nbits)]++;
+      c->dfreq[tdefl_dist_code(dist, &nbits)]++;
+   }
+   c->sym_count++;
+}
+
+/* turn the buffered input into symbols; unless flushing, enough lookahead
+   is left unprocessed for the longest match at the next position */
+static void tdefl_process(UZLIB_COMP *c, int flush)
+{
+   unsigned int lookahead = flush ? 0 : MAX_MATCH + 1;
+   unsigned int next_len = 0, next_dist = 0;
+
+   while (c->pos + lookahead < c->end) {
+      unsigned int len = next_len, dist = next_dist;
+      if (c->max_chain == 0) {
+         len = 0;
+      } else if (len == 0) {
+         len = tdefl_find_match(c, c->pos, &dist);
+      }
+      next_len = 0;
+      if (len != 0 && len < c->max_lazy) {
+         next_len = tdefl_find_match(c, c->pos + 1, &next_dist);
+         if (next_len > len) {
+            /* better match at the next position, use a literal here */
+            len = 0;
+         } else {
+            next_len = 0;
+         }
+      }
+      if (len != 0) {
+         tdefl_record(c, len - MIN_MATCH, dist);
+         c->pos += len;
+         tdefl_insert_upto(c, c->pos);
+      } else {
+         tdefl_record(c, c->win[c->pos], 0);
+         c->pos++;
+      }
+      if (c->sym_count == c->sym_max) {
+         tdefl_flush_block(c, 0);
+      }
+   }
+}
+
+/* drop the oldest half of the window buffer */
+static void tdefl_slide(UZLIB_COMP *c)
+{
+   unsigned int w = c->wmask + 1, i;
+   memmove(c->win, c->win + w, c->end - w);
+   c->end -= w;
+   c->pos -= w;
+   c->ins = c->ins >= w ? c->ins - w : 0;
+   c->block_start -= w;
+   for (i = 0; i < (1u << c->hash_bits); ++i) {
+      c->hash[i] = c->hash[i] >= w ? c->hash[i] - w : 0;
+   }
+   for (i = 0; i < w; ++i) {
+      c->prev[i] = c->prev[i] >= w ? c->prev[i] - w : 0;
+   }
+}
+
+/* ------------------- *
+ * -- API functions -- *
+ * ------------------- */
+
+void uzlib_compress_init(UZLIB_COMP *c, void *mem, int wbits, int level, int checksum_type)
+{
+   unsigned int w = 1 << wbits;
+   unsigned char *p = mem;
+
+   c->hash_bits = tdefl_hash_bits(wbits);
+   c->sym_max = tdefl_sym_max(wbits);
+   c->hash = (unsigned short *)p;
+   p += (1 << c->hash_bits) * sizeof(unsigned short);
+   c->prev = (unsigned short *)p;
+   p += w * sizeof(unsigned short);
+   c->sym_dist = (unsigned short *)p;
+   p += c->sym_max * sizeof(unsigned short);
+   c->win = p;
+   p += 2 * w;
+   c->sym_lit = p;
+   memset(c->hash, 0, (1 << c->hash_bits) * sizeof(unsigned short));
+
+   if (level < 0 || level > 9) {
+      level = 6;
+   }
+   c->max_chain = tdefl_levels[level].max_chain;
+   c->max_lazy = tdefl_levels[level].max_lazy;
+   c->wmask = w - 1;
+   c->pos = c->end = c->ins = 0;
+   c->block_start = 0;
+   c->sym_count = 0;
+   c->bitbuf = c->bitcount = 0;
+   c->outlen = 0;
+   memset(c->lfreq, 0, sizeof(c->lfreq));
+   memset(c->dfreq, 0, sizeof(c->dfreq));
+
+   c->checksum_type = checksum_type;
+   c->insize = 0;
+   if (checksum_type == TINF_CHKSUM_ADLER) {
+      /* zlib header: window size, and compression level in FLEVEL */
+      unsigned int cmf = (wbits - 8) << 4 | 8;
+      unsigned int flg = (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+      flg |= 31 - (cmf * 256 + flg) % 31;
+      tdefl_put_byte(c, cmf);
+      tdefl_put_byte(c, flg);
+      c->checksum = 1;
+   } else if (checksum_type == TINF_CHKSUM_CRC) {
+      /* gzip header: no flags, no mtime, unknown OS */
+      static const unsigned char gzip_header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+      int i;
+      for (i = 0; i < 10; ++i) tdefl_put_byte(c, gzip_header[i]);
+      c->checksum = ~0;
+   }
+}
+
+void uzlib_compress(UZLIB_COMP *c, const void *src, unsigned int len)
+{
+   const unsigned char *s = src;
+   unsigned int w = c->wmask + 1;
+
+   if (c->checksum_type == TINF_CHKSUM_ADLER) {
+      c->checksum = uzlib_adler32(src, len, c->checksum);
+   } else if (c->checksum_type == TINF_CHKSUM_CRC) {
+      c->checksum = uzlib_crc32(src, len, c->checksum);
+   }
+   c->insize += len;
+
+   while (len) {
+      unsigned int n;
+      if (c->end == 2 * w) {
+         /* a block that is mostly literals may be best stored, which needs
+            its input, so end it before that leaves the window */
+         if (c->block_start >= 0 && c->block_start < (long)w
+            && c->sym_count > (c->pos - c->block_start) / 8 * 7) {
+            tdefl_flush_block(c, 0);
+         }
+         tdefl_slide(c);
+      }
+      n = 2 * w - c->end;
+      if (n > len) {
+         n = len;
+      }
+      memcpy(c->win + c->end, s, n);
+      c->end += n;
+      s += n;
+      len -= n;
+      tdefl_process(c, 0);
+   }
+}
+
+void uzlib_compress_flush(UZLIB_COMP *c, int finish)
+{
+   tdefl_process(c, 1);
+   if (finish) {
+      tdefl_flush_block(c, 1);
+      tdefl_align(c);
+      if (c->checksum_type == TINF_CHKSUM_ADLER) {
+         tdefl_put_be_uint32(c, c->checksum);
+      } else if (c->checksum_type == TINF_CHKSUM_CRC) {
+         tdefl_put_le_uint32(c, ~c->checksum);
+         tdefl_put_le_uint32(c, c->insize);
+      }
+   } else {
+      /* end the current block and add an empty stored block, so that all
+         the data so far can be decompressed */
+      if (c->sym_count) {
+         tdefl_flush_block(c, 0);
+      }
+      tdefl_put_stored(c, NULL, 0, 0);
+   }
+   tdefl_flush_out(c);
+}
@@ -41,20 +41,34 @@ extern "C" {
 
 /* data structures */
 
+/* codes up to this many bits are decoded with a single table lookup */
+#ifndef TINF_FAST_BITS
+#define TINF_FAST_BITS 9
+#endif
+
 typedef struct {
    unsigned short table[16];  /* table of code length counts */
    unsigned short trans[288]; /* code -> symbol translation table */
+   /* next TINF_FAST_BITS bits of stream -> code length << 9 | symbol,
+      or 0 if the code is longer */
+   unsigned short fast[1 << TINF_FAST_BITS];
 } TINF_TREE;
 
 struct TINF_DATA;
 typedef struct TINF_DATA {
    const unsigned char *source;
-   /* If source above is NULL, this function will be used to read
-      next byte from source stream */
-   unsigned char (*readSource)(struct TINF_DATA *data);
-
-   unsigned int tag;
+   const unsigned char *source_limit;
+   /* If source above reaches source_limit, this function will be used to
+      read next byte from source stream; it may refill source and
+      source_limit with further data. Returns -1 at end of stream */
+   int (*readSource)(struct TINF_DATA *data);
+
+   /* bit buffer, filled least significant bit first */
+   uint32_t tag;
    unsigned int bitcount;
+   /* zero bytes added to the bit buffer past the end of the source */
+   unsigned int pad;
+   char eof;
 
     /* Buffer start */
     unsigned char *destStart;
@@ -87,6 +101,9 @@ typedef struct TINF_DATA {
         if (d->dict_ring) { d->dict_ring[d->dict_idx++] = c; if (d->dict_idx == d->dict_size) d->dict_idx = 0; } \
     }
 
+/* true if the decoder has used data past the end of the source */
+#define TINF_OVERRUN(d) ((d)->pad * 8 > (d)->bitcount)
+
 unsigned char TINFCC uzlib_get_byte(TINF_DATA *d);
 
 /* Decompression API */
@@ -101,7 +118,53 @@ int TINFCC uzlib_gzip_parse_header(TINF_DATA *d);
 
 /* Compression API */
 
-void TINFCC uzlib_compress(void *data, const uint8_t *src, unsigned slen);
+typedef struct UZLIB_COMP {
+   /* called with each chunk of compressed output */
+   void (*writeDest)(struct UZLIB_COMP *c, const unsigned char *buf, unsigned int len);
+
+   unsigned char *win;         /* 2 * window size: history and new input */
+   unsigned short *hash;       /* last position seen for each hash value */
+   unsigned short *prev;       /* previous position with the same hash */
+   unsigned char *sym_lit;     /* block symbols: literal, or length - 3 */
+   unsigned short *sym_dist;   /* block symbols: 0 for literal, or distance */
+   unsigned int sym_count;
+   unsigned int sym_max;
+   unsigned int hash_bits;
+   unsigned int wmask;
+   unsigned int max_chain;
+   unsigned int max_lazy;
+
+   unsigned int pos;           /* next position in win to compress */
+   unsigned int end;           /* end of input in win */
+   unsigned int ins;           /* next position to add to the hash chains */
+   long block_start;           /* < 0 if the block's input left the window */
+
+   unsigned int bitbuf;
+   unsigned int bitcount;
+   unsigned int outlen;
+   unsigned char outbuf[64];
+
+   /* Accumulating checksum */
+   uint32_t checksum;
+   uint32_t insize;
+   char checksum_type;
+
+   unsigned short lfreq[286];
+   unsigned short dfreq[30];
+   unsigned char llen[288];
+   unsigned char dlen[30];
+   unsigned short lcode[288];
+   unsigned short dcode[30];
+} UZLIB_COMP;
+
+/* memory needed for a window of 2^wbits bytes, 9 <= wbits <= 15 */
+unsigned int TINFCC uzlib_compress_mem_size(int wbits);
+/* checksum_type selects zlib (ADLER), gzip (CRC) or raw (NONE) framing;
+   level is 0..9, or -1 for the default */
+void TINFCC uzlib_compress_init(UZLIB_COMP *c, void *mem, int wbits, int level, int checksum_type);
+void TINFCC uzlib_compress(UZLIB_COMP *c, const void *src, unsigned int len);
+/* finish == 0 does a sync flush, otherwise the stream is ended */
+void TINFCC uzlib_compress_flush(UZLIB_COMP *c, int finish);
 
 /* Checksum API */
 
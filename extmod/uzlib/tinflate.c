@@ -33,6 +33,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 #include "tinf.h"
 
 uint32_t tinf_get_le_uint32(TINF_DATA *d);
@@ -112,6 +113,33 @@ static void tinf_build_bits_base(unsigned char *bits, unsigned short *base, int
 }
 #endif
 
+/* fill the fast lookup table of a tree from its code length counts and
+   symbols, which are sorted by code */
+static void tinf_build_fast(TINF_TREE *t)
+{
+   unsigned int len, i, code = 0, idx = 0;
+
+   for (i = 0; i < (1 << TINF_FAST_BITS); ++i) t->fast[i] = 0;
+
+   for (len = 1; len <= TINF_FAST_BITS; ++len)
+   {
+      for (i = t->table[len]; i; --i, ++code, ++idx)
+      {
+         /* codes are stored most significant bit first, so reverse them
+            to index by the next bits of the stream */
+         unsigned int rev = 0, c = code, k;
+         for (k = len; k; --k, c >>= 1) rev = (rev << 1) | (c & 1);
+         rev &= (1 << len) - 1;
+         /* fill every entry whose low bits are this code */
+         for (; rev < (1 << TINF_FAST_BITS); rev += 1 << len)
+         {
+            t->fast[rev] = len << 9 | t->trans[idx];
+         }
+      }
+      code <<= 1;
+   }
+}
+
 /* build the fixed huffman trees */
 static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
 {
@@ -123,6 +151,7 @@ static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
    lt->table[7] = 24;
    lt->table[8] = 152;
    lt->table[9] = 112;
+   for (i = 10; i < 16; ++i) lt->table[i] = 0;
 
    for (i = 0; i < 24; ++i) lt->trans[i] = 256 + i;
    for (i = 0; i < 144; ++i) lt->trans[24 + i] = i;
@@ -133,8 +162,12 @@ static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
    for (i = 0; i < 5; ++i) dt->table[i] = 0;
 
    dt->table[5] = 32;
+   for (i = 6; i < 16; ++i) dt->table[i] = 0;
 
    for (i = 0; i < 32; ++i) dt->trans[i] = i;
+
+   tinf_build_fast(lt);
+   tinf_build_fast(dt);
 }
 
 /* given an array of code lengths, build a tree */
@@ -163,18 +196,67 @@ static void tinf_build_tree(TINF_TREE *t, const unsigned char *lengths, unsigned
    {
       if (lengths[i]) t->trans[offs[lengths[i]]++] = i;
    }
+
+   tinf_build_fast(t);
 }
 
 /* ---------------------- *
  * -- decode functions -- *
  * ---------------------- */
 
+/* get the next byte from the source, or -1 at its end */
+static int tinf_next_byte(TINF_DATA *d)
+{
+   if (d->source < d->source_limit) {
+      return *d->source++;
+   }
+   if (d->readSource && !d->eof) {
+      int c = d->readSource(d);
+      if (c >= 0) {
+         return c;
+      }
+   }
+   d->eof = 1;
+   return -1;
+}
+
+/* top up the bit buffer to more than 24 bits from the source buffer; once
+   that is used up, only take bytes from readSource, or pad past the end of
+   the source with zero bytes (which must not be consumed), while fewer than
+   need bits are held, so that a stream is not read further than needed */
+static void tinf_refill(TINF_DATA *d, unsigned int need)
+{
+   while (d->bitcount <= 24) {
+      int c;
+      if (d->source < d->source_limit) {
+         c = *d->source++;
+      } else if (d->bitcount >= need) {
+         break;
+      } else if ((c = tinf_next_byte(d)) < 0) {
+         c = 0;
+         d->pad++;
+      }
+      d->tag |= (uint32_t)c << d->bitcount;
+      d->bitcount += 8;
+   }
+}
+
+/* byte aligned read, which first takes whole bytes left in the bit buffer */
 unsigned char uzlib_get_byte(TINF_DATA *d)
 {
-    if (d->source) {
-        return *d->source++;
+    int c;
+    if (d->bitcount >= 8) {
+        c = d->tag & 0xff;
+        d->tag >>= 8;
+        d->bitcount -= 8;
+        return c;
+    }
+    c = tinf_next_byte(d);
+    if (c < 0) {
+        d->pad++;
+        return 0;
     }
-    return d->readSource(d);
+    return c;
 }
 
 uint32_t tinf_get_le_uint32(TINF_DATA *d)
@@ -197,53 +279,58 @@ uint32_t tinf_get_be_uint32(TINF_DATA *d)
     return val;
 }
 
-/* get one bit from source stream */
-static int tinf_getbit(TINF_DATA *d)
+/* skip to the next byte boundary */
+static void tinf_align(TINF_DATA *d)
 {
-   unsigned int bit;
-
-   /* check if tag is empty */
-   if (!d->bitcount--)
-   {
-      /* load next tag */
-      d->tag = uzlib_get_byte(d);
-      d->bitcount = 7;
-   }
-
-   /* shift bit out of tag */
-   bit = d->tag & 0x01;
-   d->tag >>= 1;
-
-   return bit;
+   d->tag >>= d->bitcount & 7;
+   d->bitcount &= ~7;
 }
 
 /* read a num bit value from a stream and add base */
 static unsigned int tinf_read_bits(TINF_DATA *d, int num, int base)
 {
-   unsigned int val = 0;
+   unsigned int val;
 
-   /* read num bits */
-   if (num)
-   {
-      unsigned int limit = 1 << (num);
-      unsigned int mask;
+   if (num == 0) return base;
 
-      for (mask = 1; mask < limit; mask *= 2)
-         if (tinf_getbit(d)) val += mask;
-   }
+   tinf_refill(d, num);
+   val = d->tag & ((1 << num) - 1);
+   d->tag >>= num;
+   d->bitcount -= num;
 
    return val + base;
 }
 
-/* given a data stream and a tree, decode a symbol */
+/* given a data stream and a tree, decode a symbol, -1 if no code matches */
 static int tinf_decode_symbol(TINF_DATA *d, TINF_TREE *t)
 {
-   int sum = 0, cur = 0, len = 0;
+   int sum = 0, cur = 0;
+   unsigned int len, e;
+
+   /* codes up to TINF_FAST_BITS long are looked up directly; the bits above
+      bitcount are zero, so the entry is right once it is no longer than that */
+   tinf_refill(d, 1);
+   for (;;) {
+      e = t->fast[d->tag & ((1 << TINF_FAST_BITS) - 1)];
+      len = e ? e >> 9 : TINF_FAST_BITS + 1;
+      if (len <= d->bitcount) break;
+      tinf_refill(d, d->bitcount + 1);
+   }
+   if (e) {
+      d->tag >>= len;
+      d->bitcount -= len;
+      return e & 0x1ff;
+   }
 
    /* get more bits while code value is above sum */
+   len = 0;
    do {
 
-      cur = 2*cur + tinf_getbit(d);
+      if (len == 15) return -1;
+
+      if (len == d->bitcount) tinf_refill(d, len + 1);
+
+      cur = 2*cur + ((d->tag >> len) & 1);
 
       ++len;
 
@@ -252,11 +339,14 @@ static int tinf_decode_symbol(TINF_DATA *d, TINF_TREE *t)
 
    } while (cur >= 0);
 
+   d->tag >>= len;
+   d->bitcount -= len;
+
    return t->trans[sum + cur];
 }
 
 /* given a data stream, decode dynamic trees from it */
-static void tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
+static int tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
 {
    unsigned char lengths[288+32];
    unsigned int hlit, hdist, hclen;
@@ -289,62 +379,125 @@ static void tinf_decode_trees(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
    for (num = 0; num < hlit + hdist; )
    {
       int sym = tinf_decode_symbol(d, lt);
+      unsigned char fill = 0;
 
       switch (sym)
       {
       case 16:
          /* copy previous code length 3-6 times (read 2 bits) */
-         {
-            unsigned char prev = lengths[num - 1];
-            for (length = tinf_read_bits(d, 2, 3); length; --length)
-            {
-               lengths[num++] = prev;
-            }
-         }
+         if (num == 0) return TINF_DATA_ERROR;
+         fill = lengths[num - 1];
+         length = tinf_read_bits(d, 2, 3);
          break;
       case 17:
          /* repeat code length 0 for 3-10 times (read 3 bits) */
-         for (length = tinf_read_bits(d, 3, 3); length; --length)
-         {
-            lengths[num++] = 0;
-         }
+         length = tinf_read_bits(d, 3, 3);
          break;
       case 18:
          /* repeat code length 0 for 11-138 times (read 7 bits) */
-         for (length = tinf_read_bits(d, 7, 11); length; --length)
-         {
-            lengths[num++] = 0;
-         }
+         length = tinf_read_bits(d, 7, 11);
          break;
       default:
          /* values 0-15 represent the actual code lengths */
-         lengths[num++] = sym;
+         if (sym < 0) return TINF_DATA_ERROR;
+         fill = sym;
+         length = 1;
          break;
       }
+
+      if (num + length > hlit + hdist) return TINF_DATA_ERROR;
+      for (; length; --length)
+      {
+         lengths[num++] = fill;
+      }
    }
 
    /* build dynamic trees */
    tinf_build_tree(lt, lengths, hlit);
    tinf_build_tree(dt, lengths + hlit, hdist);
+
+   return TINF_OK;
 }
 
 /* ----------------------------- *
  * -- block inflate functions -- *
  * ----------------------------- */
 
-/* given a stream and two trees, inflate a block of data */
-static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
+/* output n bytes which don't overlap the destination */
+static void tinf_put_bytes(TINF_DATA *d, const unsigned char *src, unsigned int n)
 {
-    if (d->curlen == 0) {
+   memcpy(d->dest, src, n);
+   if (d->dict_ring) {
+      /* copy into the ring from dest, as src may be in the ring too */
+      unsigned int k = d->dict_size - d->dict_idx;
+      if (k > n) k = n;
+      memcpy(d->dict_ring + d->dict_idx, d->dest, k);
+      memcpy(d->dict_ring, d->dest + k, n - k);
+      d->dict_idx += n;
+      if (d->dict_idx >= d->dict_size) d->dict_idx -= d->dict_size;
+   }
+   d->dest += n;
+}
+
+/* copy up to end from the current dictionary substring */
+static void tinf_copy_match(TINF_DATA *d, unsigned char *end)
+{
+   unsigned int n = end - d->dest;
+   if (n > d->curlen) n = d->curlen;
+   d->curlen -= n;
+
+   if (d->dict_ring) {
+      unsigned int dist = (d->dict_idx + d->dict_size - d->lzOff) % d->dict_size;
+      if (dist == 0) dist = d->dict_size;
+      while (n) {
+         /* a contiguous run of the ring, of bytes already written */
+         unsigned int k = d->dict_size - d->lzOff;
+         if (k > dist) k = dist;
+         if (k > n) k = n;
+         tinf_put_bytes(d, d->dict_ring + d->lzOff, k);
+         d->lzOff += k;
+         if ((unsigned)d->lzOff == d->dict_size) d->lzOff = 0;
+         n -= k;
+      }
+   } else if ((unsigned)-d->lzOff >= n) {
+      memcpy(d->dest, d->dest + d->lzOff, n);
+      d->dest += n;
+   } else {
+      /* overlapping, so repeating the last -lzOff bytes */
+      unsigned char *p = d->dest;
+      d->dest += n;
+      for (; n; --n, ++p) *p = p[d->lzOff];
+   }
+}
+
+/* given a stream and two trees, inflate a block of data up to end */
+static int tinf_inflate_block_data(TINF_DATA *d, unsigned char *end, TINF_TREE *lt, TINF_TREE *dt)
+{
+    for (;;) {
         unsigned int offs;
         int dist;
-        int sym = tinf_decode_symbol(d, lt);
+        int sym;
+
+        /* copy the rest of a dict substring */
+        if (d->curlen) {
+            tinf_copy_match(d, end);
+        }
+        if (d->dest == end) {
+            return TINF_OK;
+        }
+
+        sym = tinf_decode_symbol(d, lt);
         //printf("huff sym: %02x\n", sym);
 
+        /* check that the symbol was not decoded from past the end of input */
+        if (TINF_OVERRUN(d) || sym < 0) {
+            return TINF_DATA_ERROR;
+        }
+
         /* literal byte */
         if (sym < 256) {
             TINF_PUT(d, sym);
-            return TINF_OK;
+            continue;
         }
 
         /* end of block */
@@ -354,12 +507,21 @@ static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
 
         /* substring from sliding dictionary */
         sym -= 257;
+        if (sym >= 29) {
+            return TINF_DATA_ERROR;
+        }
         /* possibly get more bits from length code */
         d->curlen = tinf_read_bits(d, length_bits[sym], length_base[sym]);
 
         dist = tinf_decode_symbol(d, dt);
+        if (dist < 0 || dist >= 30) {
+            return TINF_DATA_ERROR;
+        }
         /* possibly get more bits from distance code */
         offs = tinf_read_bits(d, dist_bits[dist], dist_base[dist]);
+        if (TINF_OVERRUN(d)) {
+            return TINF_DATA_ERROR;
+        }
         if (d->dict_ring) {
             if (offs > d->dict_size) {
                 return TINF_DICT_ERROR;
@@ -369,30 +531,23 @@ static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
                 d->lzOff += d->dict_size;
             }
         } else {
+            if (d->destStart && offs > (unsigned)(d->dest - d->destStart)) {
+                return TINF_DICT_ERROR;
+            }
             d->lzOff = -offs;
         }
     }
-
-    /* copy next byte from dict substring */
-    if (d->dict_ring) {
-        TINF_PUT(d, d->dict_ring[d->lzOff]);
-        if ((unsigned)++d->lzOff == d->dict_size) {
-            d->lzOff = 0;
-        }
-    } else {
-        d->dest[0] = d->dest[d->lzOff];
-        d->dest++;
-    }
-    d->curlen--;
-    return TINF_OK;
 }
 
-/* inflate an uncompressed block of data */
-static int tinf_inflate_uncompressed_block(TINF_DATA *d)
+/* inflate an uncompressed block of data up to end */
+static int tinf_inflate_uncompressed_block(TINF_DATA *d, unsigned char *end)
 {
     if (d->curlen == 0) {
         unsigned int length, invlength;
 
+        /* make sure we start next block on a byte boundary */
+        tinf_align(d);
+
         /* get length */
         length = uzlib_get_byte(d) + 256 * uzlib_get_byte(d);
         /* get one's complement of length */
@@ -403,18 +558,36 @@ static int tinf_inflate_uncompressed_block(TINF_DATA *d)
         /* increment length to properly return TINF_DONE below, without
            producing data at the same time */
         d->curlen = length + 1;
-
-        /* make sure we start next block on a byte boundary */
-        d->bitcount = 0;
     }
 
-    if (--d->curlen == 0) {
-        return TINF_DONE;
+    while (d->curlen > 1) {
+        unsigned int n;
+
+        if (d->dest == end) {
+            return TINF_OK;
+        }
+
+        if (d->bitcount >= 8 || d->source == d->source_limit) {
+            /* bytes still in the bit buffer, or a new chunk of source */
+            unsigned char c = uzlib_get_byte(d);
+            if (TINF_OVERRUN(d)) {
+                return TINF_DATA_ERROR;
+            }
+            TINF_PUT(d, c);
+            d->curlen--;
+            continue;
+        }
+
+        n = d->source_limit - d->source;
+        if (n > d->curlen - 1) n = d->curlen - 1;
+        if (n > (unsigned)(end - d->dest)) n = end - d->dest;
+        tinf_put_bytes(d, d->source, n);
+        d->source += n;
+        d->curlen -= n;
     }
 
-    unsigned char c = uzlib_get_byte(d);
-    TINF_PUT(d, c);
-    return TINF_OK;
+    d->curlen = 0;
+    return TINF_DONE;
 }
 
 /* ---------------------- *
@@ -438,7 +611,10 @@ void uzlib_init(void)
 /* initialize decompression structure */
 void uzlib_uncompress_init(TINF_DATA *d, void *dict, unsigned int dictLen)
 {
+   d->tag = 0;
    d->bitcount = 0;
+   d->pad = 0;
+   d->eof = 0;
    d->bfinal = 0;
    d->btype = -1;
    d->dict_size = dictLen;
@@ -447,17 +623,18 @@ void uzlib_uncompress_init(TINF_DATA *d, void *dict, unsigned int dictLen)
    d->curlen = 0;
 }
 
-/* inflate next byte of compressed stream */
+/* inflate the next destSize bytes of compressed stream */
 int uzlib_uncompress(TINF_DATA *d)
 {
-    do {
+    unsigned char *end = d->dest + d->destSize;
+
+    while (d->dest < end) {
         int res;
 
         /* start a new block */
         if (d->btype == -1) {
-next_blk:
             /* read final block flag */
-            d->bfinal = tinf_getbit(d);
+            d->bfinal = tinf_read_bits(d, 1, 0);
             /* read block type (2 bits) */
             d->btype = tinf_read_bits(d, 2, 0);
 
@@ -468,7 +645,13 @@ next_blk:
                 tinf_build_fixed_trees(&d->ltree, &d->dtree);
             } else if (d->btype == 2) {
                 /* decode trees from stream */
-                tinf_decode_trees(d, &d->ltree, &d->dtree);
+                res = tinf_decode_trees(d, &d->ltree, &d->dtree);
+                if (res != TINF_OK) {
+                    return res;
+                }
+            }
+            if (TINF_OVERRUN(d)) {
+                return TINF_DATA_ERROR;
             }
         }
 
@@ -477,30 +660,34 @@ next_blk:
         {
         case 0:
             /* decompress uncompressed block */
-            res = tinf_inflate_uncompressed_block(d);
+            res = tinf_inflate_uncompressed_block(d, end);
             break;
         case 1:
         case 2:
             /* decompress block with fixed/dyanamic huffman trees */
             /* trees were decoded previously, so it's the same routine for both */
-            res = tinf_inflate_block_data(d, &d->ltree, &d->dtree);
+            res = tinf_inflate_block_data(d, end, &d->ltree, &d->dtree);
             break;
         default:
             return TINF_DATA_ERROR;
         }
 
-        if (res == TINF_DONE && !d->bfinal) {
-            /* the block has ended (without producing more data), but we
-               can't return without data, so start procesing next block */
-            goto next_blk;
+        if (res == TINF_DONE) {
+            if (d->bfinal) {
+                d->destSize = end - d->dest;
+                return TINF_DONE;
+            }
+            /* the block has ended, start procesing next block */
+            d->btype = -1;
+            continue;
         }
 
         if (res != TINF_OK) {
             return res;
         }
+    }
 
-    } while (--d->destSize);
-
+    d->destSize = 0;
     return TINF_OK;
 }
 
@@ -527,6 +714,9 @@ int uzlib_uncompress_chksum(TINF_DATA *d)
     if (res == TINF_DONE) {
         unsigned int val;
 
+        /* the trailer starts at the next byte boundary */
+        tinf_align(d);
+
         switch (d->checksum_type) {
 
         case TINF_CHKSUM_ADLER:
@@ -545,6 +735,10 @@ int uzlib_uncompress_chksum(TINF_DATA *d)
             val = tinf_get_le_uint32(d);
             break;
         }
+
+        if (TINF_OVERRUN(d)) {
+            return TINF_DATA_ERROR;
+        }
     }
 
     return res;
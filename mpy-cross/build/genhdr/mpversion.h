@@ -0,0 +1,8 @@
+// This file was generated by py/makeversionhdr.py
+#define MICROPY_GIT_TAG "1.9.0-45-gd29e4cf-dirty"
+#define MICROPY_GIT_HASH "d29e4cf-dirty"
+#define MICROPY_BUILD_DATE "2026-10-17"
+#define MICROPY_VERSION_MAJOR (1)
+#define MICROPY_VERSION_MINOR (9)
+#define MICROPY_VERSION_MICRO (0)
+#define MICROPY_VERSION_STRING "1.9.0"
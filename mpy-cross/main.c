@@ -34,6 +34,7 @@
 #include "py/compile.h"
 #include "py/persistentcode.h"
 #include "py/runtime.h"
+#include "py/bc.h"
 #include "py/gc.h"
 #include "py/stackctrl.h"
 #ifdef _WIN32
@@ -44,6 +45,22 @@
 STATIC uint emit_opt = MP_EMIT_OPT_NONE;
 mp_uint_t mp_verbose_flag = 0;
 
+// Native code targets: the name given to -march, the emitter, and the number
+// of words in the target's nlr_buf_t
+typedef struct _native_arch_t {
+    const char *name;
+    uint8_t arch;
+    uint8_t nlr_buf_words;
+} native_arch_t;
+
+STATIC const native_arch_t native_arch_table[] = {
+    {"x86", MP_NATIVE_ARCH_X86, 8},
+    {"x64", MP_NATIVE_ARCH_X64, 10},
+    {"armv6", MP_NATIVE_ARCH_ARM, 12},
+    {"armv7m", MP_NATIVE_ARCH_THUMB, 12},
+    {"xtensa", MP_NATIVE_ARCH_XTENSA, 12},
+};
+
 // Heap size of GC heap (if enabled)
 // Make it larger on a 64 bit machine, because pointers are larger.
 long heap_size = 1024*1024 * (sizeof(mp_uint_t) / 4);
@@ -102,6 +119,11 @@ STATIC int compile_and_save(const char *file, const char *output_file, const cha
     }
 }
 
+STATIC void set_native_arch(const native_arch_t *arch) {
+    mp_dynamic_compiler.native_arch = arch->arch;
+    mp_dynamic_compiler.native_nlr_buf_words = arch->nlr_buf_words;
+}
+
 STATIC int usage(char **argv) {
     printf(
 "usage: %s [<opts>] [-X <implopt>] <input filename>\n"
@@ -115,6 +137,10 @@ STATIC int usage(char **argv) {
 "-msmall-int-bits=number : set the maximum bits used to encode a small-int\n"
 "-mno-unicode : don't support unicode in compiled strings\n"
 "-mcache-lookup-bc : cache map lookups in the bytecode\n"
+"-msuperinstr : fuse common opcode sequences into superinstructions\n"
+"-mpystack : native code is for a target that uses a pystack\n"
+"-march=<arch> : set the architecture for native code; one of x86, x64,\n"
+"    armv6, armv7m, xtensa (defaults to that of the host, if supported)\n"
 "\n"
 "Implementation specific options:\n", argv[0]
 );
@@ -199,6 +225,20 @@ MP_NOINLINE int main_(int argc, char **argv) {
     mp_dynamic_compiler.small_int_bits = 31;
     mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode = 0;
     mp_dynamic_compiler.py_builtins_str_unicode = 1;
+    mp_dynamic_compiler.opt_superinstructions = 0;
+    mp_dynamic_compiler.native_code_state_words = sizeof(mp_code_state_t) / sizeof(mp_uint_t);
+    mp_dynamic_compiler.native_pystack = false;
+    #if defined(__x86_64__) && !defined(__CYGWIN__)
+    set_native_arch(&native_arch_table[1]);
+    #elif defined(__i386__)
+    set_native_arch(&native_arch_table[0]);
+    #elif defined(__thumb2__)
+    set_native_arch(&native_arch_table[3]);
+    #elif defined(__arm__)
+    set_native_arch(&native_arch_table[2]);
+    #else
+    mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_NONE;
+    #endif
 
     const char *input_file = NULL;
     const char *output_file = NULL;
@@ -246,6 +286,24 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 mp_dynamic_compiler.py_builtins_str_unicode = 0;
             } else if (strcmp(argv[a], "-municode") == 0) {
                 mp_dynamic_compiler.py_builtins_str_unicode = 1;
+            } else if (strcmp(argv[a], "-mno-superinstr") == 0) {
+                mp_dynamic_compiler.opt_superinstructions = 0;
+            } else if (strcmp(argv[a], "-msuperinstr") == 0) {
+                mp_dynamic_compiler.opt_superinstructions = 1;
+            } else if (strncmp(argv[a], "-march=", sizeof("-march=") - 1) == 0) {
+                const char *name = argv[a] + sizeof("-march=") - 1;
+                size_t i = 0;
+                while (strcmp(name, native_arch_table[i].name) != 0) {
+                    if (++i == MP_ARRAY_SIZE(native_arch_table)) {
+                        mp_printf(&mp_stderr_print, "unknown arch '%s'\n", name);
+                        return usage(argv);
+                    }
+                }
+                set_native_arch(&native_arch_table[i]);
+            } else if (strcmp(argv[a], "-mpystack") == 0) {
+                // the target's frames have an extra word for the pystack
+                mp_dynamic_compiler.native_code_state_words = sizeof(mp_code_state_t) / sizeof(mp_uint_t) + 1;
+                mp_dynamic_compiler.native_pystack = true;
             } else {
                 return usage(argv);
             }
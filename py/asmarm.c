@@ -209,12 +209,20 @@ void asm_arm_mov_reg_i32(asm_arm_t *as, uint rd, int imm) {
         emit_al(as, asm_arm_op_mvn_imm(rd, ~imm));
     } else {
         //Insert immediate into code and jump over it
-        emit_al(as, 0x59f0000 | (rd << 12)); // ldr rd, [pc]
-        emit_al(as, 0xa000000); // b pc
-        emit(as, imm);
+        asm_arm_mov_reg_i32_aligned(as, rd, imm);
     }
 }
 
+// imm is stored as a full word in the code, which is always word aligned
+// returns the offset of that word within the code
+size_t asm_arm_mov_reg_i32_aligned(asm_arm_t *as, uint rd, int imm) {
+    emit_al(as, 0x59f0000 | (rd << 12)); // ldr rd, [pc]
+    emit_al(as, 0xa000000); // b pc
+    size_t loc = as->base.code_offset;
+    emit(as, imm);
+    return loc;
+}
+
 void asm_arm_mov_local_reg(asm_arm_t *as, int local_num, uint rd) {
     // str rd, [sp, #local_num*4]
     emit_al(as, 0x58d0000 | (rd << 12) | (local_num << 2));
@@ -362,7 +370,7 @@ void asm_arm_bl_ind(asm_arm_t *as, void *fun_ptr, uint fun_id, uint reg_temp) {
     // Set lr after fun_ptr
     emit_al(as, asm_arm_op_add_imm(ASM_ARM_REG_LR, ASM_ARM_REG_PC, 4)); // add lr, pc, #4
     emit_al(as, asm_arm_op_mov_reg(ASM_ARM_REG_PC, reg_temp)); // mov pc, reg_temp
-    emit(as, (uint) fun_ptr);
+    emit(as, (uint)(uintptr_t)fun_ptr);
 }
 
 #endif // MICROPY_EMIT_ARM
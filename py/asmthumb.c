@@ -269,19 +269,24 @@ void asm_thumb_mov_reg_i32_optimised(asm_thumb_t *as, uint reg_dest, int i32) {
     }
 }
 
+#define OP_LDR_FROM_PC_OFFSET(rlo_dest, word_offset) (0x4800 | ((rlo_dest) << 8) | ((word_offset) & 0x00ff))
+
 // i32 is stored as a full word in the code, and aligned to machine-word boundary
-// TODO this is very inefficient, improve it!
-void asm_thumb_mov_reg_i32_aligned(asm_thumb_t *as, uint reg_dest, int i32) {
-    // align on machine-word + 2
-    if ((as->base.code_offset & 3) == 0) {
+// returns the offset of that word within the code
+size_t asm_thumb_mov_reg_i32_aligned(asm_thumb_t *as, uint rlo_dest, int i32) {
+    assert(rlo_dest < ASM_THUMB_REG_R8);
+    // align on machine-word
+    if ((as->base.code_offset & 3) != 0) {
         asm_thumb_op16(as, ASM_THUMB_OP_NOP);
     }
-    // jump over the i32 value (instruction prefetch adds 2 to PC)
+    // load the i32 value from the word that follows, then jump over it
+    // (instruction prefetch adds 4 to PC, and ldr rounds PC down to a word)
+    asm_thumb_op16(as, OP_LDR_FROM_PC_OFFSET(rlo_dest, 0));
     asm_thumb_op16(as, OP_B_N(2));
     // store i32 on machine-word aligned boundary
+    size_t loc = as->base.code_offset;
     mp_asm_base_data(&as->base, 4, i32);
-    // do the actual load of the i32 value
-    asm_thumb_mov_reg_i32_optimised(as, reg_dest, i32);
+    return loc;
 }
 
 #define OP_STR_TO_SP_OFFSET(rlo_dest, word_offset) (0x9000 | ((rlo_dest) << 8) | ((word_offset) & 0x00ff))
@@ -370,8 +375,9 @@ void asm_thumb_bl_ind(asm_thumb_t *as, void *fun_ptr, uint fun_id, uint reg_temp
         asm_thumb_op16(as, ASM_THUMB_FORMAT_9_10_ENCODE(ASM_THUMB_FORMAT_9_LDR | ASM_THUMB_FORMAT_9_WORD_TRANSFER, reg_temp, ASM_THUMB_REG_R7, fun_id));
         asm_thumb_op16(as, OP_BLX(reg_temp));
     } else {
-        // load ptr to function into register using immediate; 6 bytes
-        asm_thumb_mov_reg_i32(as, reg_temp, (mp_uint_t)fun_ptr);
+        // load ptr to function from table using a wide ldr; 6 bytes
+        (void)fun_ptr;
+        asm_thumb_op32(as, 0xf8d0 | ASM_THUMB_REG_R7, (reg_temp << 12) | (fun_id << 2));
         asm_thumb_op16(as, OP_BLX(reg_temp));
     }
 }
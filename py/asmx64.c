@@ -344,8 +344,7 @@ STATIC void asm_x64_mov_i32_to_r64(asm_x64_t *as, int src_i32, int dest_r64) {
 void asm_x64_mov_i64_to_r64(asm_x64_t *as, int64_t src_i64, int dest_r64) {
     // cpu defaults to i32 to r64
     // to mov i64 to r64 need to use REX prefix
-    assert(dest_r64 < 8);
-    asm_x64_write_byte_2(as, REX_PREFIX | REX_W, OPCODE_MOV_I64_TO_R64 | dest_r64);
+    asm_x64_write_byte_2(as, REX_PREFIX | REX_W | (dest_r64 < 8 ? 0 : REX_B), OPCODE_MOV_I64_TO_R64 | (dest_r64 & 7));
     asm_x64_write_word64(as, src_i64);
 }
 
@@ -361,12 +360,14 @@ void asm_x64_mov_i64_to_r64_optimised(asm_x64_t *as, int64_t src_i64, int dest_r
 }
 
 // src_i64 is stored as a full word in the code, and aligned to machine-word boundary
-void asm_x64_mov_i64_to_r64_aligned(asm_x64_t *as, int64_t src_i64, int dest_r64) {
+// returns the offset of that word within the code
+size_t asm_x64_mov_i64_to_r64_aligned(asm_x64_t *as, int64_t src_i64, int dest_r64) {
     // mov instruction uses 2 bytes for the instruction, before the i64
     while (((as->base.code_offset + 2) & (WORD_SIZE - 1)) != 0) {
         asm_x64_nop(as);
     }
     asm_x64_mov_i64_to_r64(as, src_i64, dest_r64);
+    return as->base.code_offset - 8;
 }
 
 void asm_x64_and_r64_r64(asm_x64_t *as, int dest_r64, int src_r64) {
@@ -611,13 +612,22 @@ void asm_x64_call_i1(asm_x64_t *as, void* func, int i1) {
 }
 */
 
-void asm_x64_call_ind(asm_x64_t *as, void *ptr, int temp_r64) {
+// the function pointer is always stored as a full 64-bit word so that it can
+// be relocated; returns the offset of that word within the code
+size_t asm_x64_call_ind(asm_x64_t *as, void *ptr, int temp_r64) {
     assert(temp_r64 < 8);
+#if MICROPY_PERSISTENT_CODE_SAVE
+    // the pointer is relinked when the code is loaded, and is aligned so that
+    // it can be written as a word when the code is frozen
+    size_t loc = asm_x64_mov_i64_to_r64_aligned(as, (int64_t)(intptr_t)ptr, temp_r64);
+#else
 #ifdef __LP64__
-    asm_x64_mov_i64_to_r64_optimised(as, (int64_t)ptr, temp_r64);
+    asm_x64_mov_i64_to_r64(as, (int64_t)ptr, temp_r64);
 #else
     // If we get here, sizeof(int) == sizeof(void*).
-    asm_x64_mov_i64_to_r64_optimised(as, (int64_t)(unsigned int)ptr, temp_r64);
+    asm_x64_mov_i64_to_r64(as, (int64_t)(unsigned int)ptr, temp_r64);
+#endif
+    size_t loc = as->base.code_offset - 8;
 #endif
     asm_x64_write_byte_2(as, OPCODE_CALL_RM32, MODRM_R64(2) | MODRM_RM_REG | MODRM_RM_R64(temp_r64));
     // this reduces code size by 2 bytes per call, but doesn't seem to speed it up at all
@@ -626,6 +636,7 @@ void asm_x64_call_ind(asm_x64_t *as, void *ptr, int temp_r64) {
     asm_x64_write_byte_1(as, OPCODE_CALL_REL32);
     asm_x64_write_word32(as, ptr - (void*)(as->code_base + as->code_offset + 4));
     */
+    return loc;
 }
 
 #endif // MICROPY_EMIT_X64
@@ -230,12 +230,14 @@ void asm_x86_mov_i32_to_r32(asm_x86_t *as, int32_t src_i32, int dest_r32) {
 }
 
 // src_i32 is stored as a full word in the code, and aligned to machine-word boundary
-void asm_x86_mov_i32_to_r32_aligned(asm_x86_t *as, int32_t src_i32, int dest_r32) {
+// returns the offset of that word within the code
+size_t asm_x86_mov_i32_to_r32_aligned(asm_x86_t *as, int32_t src_i32, int dest_r32) {
     // mov instruction uses 1 byte for the instruction, before the i32
     while (((as->base.code_offset + 1) & (WORD_SIZE - 1)) != 0) {
         asm_x86_nop(as);
     }
     asm_x86_mov_i32_to_r32(as, src_i32, dest_r32);
+    return as->base.code_offset - 4;
 }
 
 void asm_x86_and_r32_r32(asm_x86_t *as, int dest_r32, int src_r32) {
@@ -469,7 +471,8 @@ void asm_x86_push_local_addr(asm_x86_t *as, int local_num, int temp_r32)
 }
 #endif
 
-void asm_x86_call_ind(asm_x86_t *as, void *ptr, mp_uint_t n_args, int temp_r32) {
+// returns the offset within the code of the word holding the function pointer
+size_t asm_x86_call_ind(asm_x86_t *as, void *ptr, mp_uint_t n_args, int temp_r32) {
     // TODO align stack on 16-byte boundary before the call
     assert(n_args <= 5);
     if (n_args > 4) {
@@ -487,6 +490,11 @@ void asm_x86_call_ind(asm_x86_t *as, void *ptr, mp_uint_t n_args, int temp_r32)
     if (n_args > 0) {
         asm_x86_push_r32(as, ASM_X86_REG_ARG_1);
     }
+#if MICROPY_PERSISTENT_CODE_SAVE
+    // the pointer is relinked when the code is loaded, and is aligned so that
+    // it can be written as a word when the code is frozen
+    size_t loc = asm_x86_mov_i32_to_r32_aligned(as, (int32_t)(intptr_t)ptr, temp_r32);
+#else
 #ifdef __LP64__
     // We wouldn't run x86 code on an x64 machine.  This is here to enable
     // testing of the x86 emitter only.
@@ -494,6 +502,8 @@ void asm_x86_call_ind(asm_x86_t *as, void *ptr, mp_uint_t n_args, int temp_r32)
 #else
     // If we get here, sizeof(int) == sizeof(void*).
     asm_x86_mov_i32_to_r32(as, (int32_t)ptr, temp_r32);
+#endif
+    size_t loc = as->base.code_offset - 4;
 #endif
     asm_x86_write_byte_2(as, OPCODE_CALL_RM32, MODRM_R32(2) | MODRM_RM_REG | MODRM_RM_R32(temp_r32));
     // this reduces code size by 2 bytes per call, but doesn't seem to speed it up at all
@@ -506,6 +516,7 @@ void asm_x86_call_ind(asm_x86_t *as, void *ptr, mp_uint_t n_args, int temp_r32)
     if (n_args > 0) {
         asm_x86_add_i32_to_r32(as, WORD_SIZE * n_args, ASM_X86_REG_ESP);
     }
+    return loc;
 }
 
 #endif // MICROPY_EMIT_X86
@@ -148,14 +148,29 @@ void asm_xtensa_mov_reg_i32(asm_xtensa_t *as, uint reg_dest, uint32_t i32) {
     if (SIGNED_FIT12(i32)) {
         asm_xtensa_op_movi(as, reg_dest, i32);
     } else {
-        // load the constant
-        asm_xtensa_op_l32r(as, reg_dest, as->base.code_offset, 4 + as->cur_const * WORD_SIZE);
-        // store the constant in the table
-        if (as->const_table != NULL) {
-            as->const_table[as->cur_const] = i32;
-        }
-        ++as->cur_const;
+        asm_xtensa_mov_reg_i32_aligned(as, reg_dest, i32);
+    }
+}
+
+// i32 is always stored as a word in the constant table, which is word aligned
+// returns the offset of that word within the code
+size_t asm_xtensa_mov_reg_i32_aligned(asm_xtensa_t *as, uint reg_dest, uint32_t i32) {
+    // load the constant
+    size_t loc = 4 + as->cur_const * WORD_SIZE;
+    asm_xtensa_op_l32r(as, reg_dest, as->base.code_offset, loc);
+    // store the constant in the table
+    if (as->const_table != NULL) {
+        as->const_table[as->cur_const] = i32;
     }
+    ++as->cur_const;
+    return loc;
+}
+
+// returns the offset within the code of the word holding the function pointer
+size_t asm_xtensa_call_ind(asm_xtensa_t *as, void *ptr) {
+    size_t loc = asm_xtensa_mov_reg_i32_aligned(as, ASM_XTENSA_REG_A0, (uint32_t)(uintptr_t)ptr);
+    asm_xtensa_op_callx0(as, ASM_XTENSA_REG_A0);
+    return loc;
 }
 
 void asm_xtensa_mov_local_reg(asm_xtensa_t *as, int local_num, uint reg_src) {
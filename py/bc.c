@@ -54,6 +54,46 @@ mp_uint_t mp_decode_uint(const byte **ptr) {
     return unum;
 }
 
+// Find the block name, source file and source line of the opcode that the
+// given code state is executing, from the code info and its line number table.
+void mp_code_state_get_location(const mp_code_state_t *code_state, qstr *block_name, qstr *source_file, size_t *source_line) {
+    const byte *ip = code_state->code_info;
+    mp_uint_t code_info_size = mp_decode_uint(&ip);
+    #if MICROPY_PERSISTENT_CODE
+    *block_name = ip[0] | (ip[1] << 8);
+    *source_file = ip[2] | (ip[3] << 8);
+    ip += 4;
+    #else
+    *block_name = mp_decode_uint(&ip);
+    *source_file = mp_decode_uint(&ip);
+    #endif
+    size_t bc = code_state->ip - code_state->code_info - code_info_size;
+    size_t line = 1;
+    size_t c;
+    while ((c = *ip)) {
+        mp_uint_t b, l;
+        if ((c & 0x80) == 0) {
+            // 0b0LLBBBBB encoding
+            b = c & 0x1f;
+            l = c >> 5;
+            ip += 1;
+        } else {
+            // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
+            b = c & 0xf;
+            l = ((c << 4) & 0x700) | ip[1];
+            ip += 2;
+        }
+        if (bc >= b) {
+            bc -= b;
+            line += l;
+        } else {
+            // found source line corresponding to bytecode offset
+            break;
+        }
+    }
+    *source_line = line;
+}
+
 STATIC NORETURN void fun_pos_args_mismatch(mp_obj_fun_bc_t *f, size_t expected, size_t given) {
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE
     // generic message, used also for other argument issues
@@ -113,6 +153,17 @@ void mp_setup_code_state(mp_code_state_t *code_state, mp_obj_fun_bc_t *self, siz
     code_state->sp = &code_state->state[0] - 1;
     code_state->exc_sp = (mp_exc_stack_t*)(code_state->state + n_state) - 1;
 
+    if ((scope_flags & MP_SCOPE_FLAG_SIMPLE_ARGS) != 0 && n_args == n_pos_args && n_kw == 0) {
+        // fast path: the args are exactly the first locals and there's
+        // nothing else to fill in, so just copy them and zero the rest
+        mp_obj_t *fastn = &code_state->state[n_state - 1];
+        for (size_t i = 0; i < n_args; i++) {
+            fastn[-(mp_int_t)i] = args[i];
+        }
+        memset(code_state->state, 0, (n_state - n_args) * sizeof(*code_state->state));
+        goto setup_prelude;
+    }
+
     // zero out the local stack to begin with
     memset(code_state->state, 0, n_state * sizeof(*code_state->state));
 
@@ -241,6 +292,7 @@ continue2:;
         }
     }
 
+setup_prelude:;
     // get the ip and skip argument names
     const byte *ip = code_state->ip;
 
@@ -280,6 +332,9 @@ continue2:;
 //     MP_BC_LOAD_GLOBAL
 //     MP_BC_LOAD_ATTR
 //     MP_BC_STORE_ATTR
+// The superinstructions MP_BC_BINARY_OP_FAST_FAST, MP_BC_BINARY_OP_FAST_INT,
+// MP_BC_BINARY_OP_INT and MP_BC_BINARY_OP_TOP_TWO are marked as single byte
+// and their size is computed from the op byte that follows them.
 #define OC4(a, b, c, d) (a | (b << 2) | (c << 4) | (d << 6))
 #define U (0) // undefined opcode
 #define B (MP_OPCODE_BYTE) // single byte
@@ -293,18 +348,18 @@ STATIC const byte opcode_format_table[64] = {
     OC4(U, U, U, U), // 0x0c-0x0f
     OC4(B, B, B, U), // 0x10-0x13
     OC4(V, U, Q, V), // 0x14-0x17
-    OC4(B, U, V, V), // 0x18-0x1b
+    OC4(B, V, V, V), // 0x18-0x1b
     OC4(Q, Q, Q, Q), // 0x1c-0x1f
     OC4(B, B, V, V), // 0x20-0x23
     OC4(Q, Q, Q, B), // 0x24-0x27
     OC4(V, V, Q, Q), // 0x28-0x2b
-    OC4(U, U, U, U), // 0x2c-0x2f
+    OC4(B, B, B, B), // 0x2c-0x2f
     OC4(B, B, B, B), // 0x30-0x33
     OC4(B, O, O, O), // 0x34-0x37
     OC4(O, O, U, U), // 0x38-0x3b
     OC4(U, O, B, O), // 0x3c-0x3f
     OC4(O, B, B, O), // 0x40-0x43
-    OC4(B, B, O, U), // 0x44-0x47
+    OC4(B, B, O, O), // 0x44-0x47
     OC4(U, U, U, U), // 0x48-0x4b
     OC4(U, U, U, U), // 0x4c-0x4f
     OC4(V, V, U, V), // 0x50-0x53
@@ -368,7 +423,22 @@ STATIC const byte opcode_format_table[64] = {
 uint mp_opcode_format(const byte *ip, size_t *opcode_size) {
     uint f = (opcode_format_table[*ip >> 2] >> (2 * (*ip & 3))) & 3;
     const byte *ip_start = ip;
-    if (f == MP_OPCODE_QSTR) {
+    if (MP_BC_BINARY_OP_FAST_FAST <= *ip && *ip <= MP_BC_BINARY_OP_TOP_TWO) {
+        // superinstruction: op byte, 0 to 2 var-ints, tail
+        size_t n_args = *ip == MP_BC_BINARY_OP_TOP_TWO ? 0 : *ip == MP_BC_BINARY_OP_INT ? 1 : 2;
+        byte tail = ip[1] & MP_BC_TAIL_MASK;
+        ip += 2;
+        if (tail == MP_BC_TAIL_STORE_FAST) {
+            n_args += 1;
+        }
+        while (n_args--) {
+            while ((*ip++ & 0x80) != 0) {
+            }
+        }
+        if (tail == MP_BC_TAIL_POP_JUMP_IF_TRUE || tail == MP_BC_TAIL_POP_JUMP_IF_FALSE) {
+            ip += 2;
+        }
+    } else if (f == MP_OPCODE_QSTR) {
         ip += 3;
     } else {
         int extra_byte = (
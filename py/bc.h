@@ -80,6 +80,11 @@ typedef struct _mp_code_state_t {
     #if MICROPY_STACKLESS
     struct _mp_code_state_t *prev;
     #endif
+    #if MICROPY_ENABLE_PYSTACK
+    // pystack level just above this frame; anything above it belongs to
+    // calls the frame has in progress and is dropped when they're aborted
+    byte *pystack_top;
+    #endif
     size_t n_state;
     // Variable-length
     mp_obj_t state[0];
@@ -93,6 +98,7 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
 mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t func, size_t n_args, size_t n_kw, const mp_obj_t *args);
 struct _mp_obj_fun_bc_t;
 void mp_setup_code_state(mp_code_state_t *code_state, struct _mp_obj_fun_bc_t *self, size_t n_args, size_t n_kw, const mp_obj_t *args);
+void mp_code_state_get_location(const mp_code_state_t *code_state, qstr *block_name, qstr *source_file, size_t *source_line);
 void mp_bytecode_print(const void *descr, const byte *code, mp_uint_t len, const mp_uint_t *const_table);
 void mp_bytecode_print2(const byte *code, mp_uint_t len);
 const byte *mp_bytecode_print_str(const byte *ip);
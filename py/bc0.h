@@ -36,6 +36,7 @@
 #define MP_BC_LOAD_CONST_STRING  (0x16) // qstr
 #define MP_BC_LOAD_CONST_OBJ     (0x17) // ptr
 #define MP_BC_LOAD_NULL          (0x18)
+#define MP_BC_STORE_FAST_KEEP    (0x19) // uint
 
 #define MP_BC_LOAD_FAST_N        (0x1a) // uint
 #define MP_BC_LOAD_DEREF         (0x1b) // uint
@@ -58,6 +59,20 @@
 #define MP_BC_DELETE_NAME        (0x2a) // qstr
 #define MP_BC_DELETE_GLOBAL      (0x2b) // qstr
 
+// Superinstructions, see MICROPY_OPT_SUPERINSTRUCTIONS.  The first argument
+// is a byte with the binary op in the low 6 bits and the tail in the top 2.
+#define MP_BC_BINARY_OP_FAST_FAST    (0x2c) // op, uint, uint, tail
+#define MP_BC_BINARY_OP_FAST_INT     (0x2d) // op, uint, signed var-int, tail
+#define MP_BC_BINARY_OP_INT          (0x2e) // op, signed var-int, tail
+#define MP_BC_BINARY_OP_TOP_TWO      (0x2f) // op, tail
+
+// What a superinstruction does with the result of its binary op
+#define MP_BC_TAIL_MASK              (0xc0)
+#define MP_BC_TAIL_PUSH              (0x00)
+#define MP_BC_TAIL_STORE_FAST        (0x40) // uint
+#define MP_BC_TAIL_POP_JUMP_IF_TRUE  (0x80) // rel byte code offset, 16-bit signed, in excess
+#define MP_BC_TAIL_POP_JUMP_IF_FALSE (0xc0) // rel byte code offset, 16-bit signed, in excess
+
 #define MP_BC_DUP_TOP            (0x30)
 #define MP_BC_DUP_TOP_TWO        (0x31)
 #define MP_BC_POP_TOP            (0x32)
@@ -79,6 +94,7 @@
 #define MP_BC_POP_BLOCK          (0x44)
 #define MP_BC_POP_EXCEPT         (0x45)
 #define MP_BC_UNWIND_JUMP        (0x46) // rel byte code offset, 16-bit signed, in excess; then a byte
+#define MP_BC_FOR_RANGE          (0x47) // rel byte code offset, 16-bit unsigned; see MICROPY_OPT_SUPERINSTRUCTIONS
 
 #define MP_BC_BUILD_TUPLE        (0x50) // uint
 #define MP_BC_BUILD_LIST         (0x51) // uint
@@ -35,6 +35,7 @@
 #include "py/compile.h"
 #include "py/runtime.h"
 #include "py/asmbase.h"
+#include "py/persistentcode.h"
 
 #if MICROPY_ENABLE_COMPILER
 
@@ -70,7 +71,35 @@ typedef enum {
 
 #endif
 
-#if MICROPY_EMIT_NATIVE
+#if MICROPY_EMIT_NATIVE && MICROPY_DYNAMIC_COMPILER
+// the native emitter is selected at runtime from those that are enabled
+typedef struct _native_emitter_t {
+    emit_t *(*new)(mp_obj_t *error_slot, mp_uint_t max_num_labels);
+    void (*free)(emit_t *emit);
+    const emit_method_table_t *method_table;
+} native_emitter_t;
+
+STATIC const native_emitter_t native_emitter_table[] = {
+    #if MICROPY_EMIT_X86
+    [MP_NATIVE_ARCH_X86] = {emit_native_x86_new, emit_native_x86_free, &emit_native_x86_method_table},
+    #endif
+    #if MICROPY_EMIT_X64
+    [MP_NATIVE_ARCH_X64] = {emit_native_x64_new, emit_native_x64_free, &emit_native_x64_method_table},
+    #endif
+    #if MICROPY_EMIT_ARM
+    [MP_NATIVE_ARCH_ARM] = {emit_native_arm_new, emit_native_arm_free, &emit_native_arm_method_table},
+    #endif
+    #if MICROPY_EMIT_THUMB
+    [MP_NATIVE_ARCH_THUMB] = {emit_native_thumb_new, emit_native_thumb_free, &emit_native_thumb_method_table},
+    #endif
+    #if MICROPY_EMIT_XTENSA
+    [MP_NATIVE_ARCH_XTENSA] = {emit_native_xtensa_new, emit_native_xtensa_free, &emit_native_xtensa_method_table},
+    #endif
+};
+
+#define NATIVE_EMITTER(f) (native_emitter_table[mp_dynamic_compiler.native_arch].f)
+#define NATIVE_EMITTER_TABLE (NATIVE_EMITTER(method_table))
+#elif MICROPY_EMIT_NATIVE
 // define a macro to access external native emitter
 #if MICROPY_EMIT_X64
 #define NATIVE_EMITTER(f) emit_native_x64_##f
@@ -85,6 +114,7 @@ typedef enum {
 #else
 #error "unknown native emitter"
 #endif
+#define NATIVE_EMITTER_TABLE (&NATIVE_EMITTER(method_table))
 #endif
 
 #if MICROPY_EMIT_INLINE_ASM
@@ -1413,6 +1443,42 @@ STATIC void compile_for_stmt_optimised_range(compiler_t *comp, mp_parse_node_t p
     }
 }
 
+// This function compiles the same for-loop as above but using the FOR_RANGE
+// opcode, which keeps the range state in the frame.  The stack during the
+// for-loop contains the next value of <var>, then <end>, then <step>, and
+// FOR_RANGE checks the sign of <step> when it runs so <step> need not be a
+// constant.  FOR_RANGE is a superinstruction so this is only used for bytecode.
+STATIC void compile_for_stmt_range_op(compiler_t *comp, mp_parse_node_t pn_var, mp_parse_node_t pn_start, mp_parse_node_t pn_end, mp_parse_node_t pn_step, mp_parse_node_t pn_body, mp_parse_node_t pn_else) {
+    START_BREAK_CONTINUE_BLOCK
+
+    uint end_label = comp_next_label(comp);
+
+    compile_node(comp, pn_start);
+    compile_node(comp, pn_end);
+    compile_node(comp, pn_step);
+
+    EMIT_ARG(label_assign, continue_label);
+    EMIT_ARG(for_range, end_label);
+    c_assign(comp, pn_var, ASSIGN_STORE);
+    compile_node(comp, pn_body);
+    if (!EMIT(last_emit_was_return_value)) {
+        EMIT_ARG(jump, continue_label);
+    }
+    EMIT_ARG(label_assign, end_label);
+
+    // break/continue apply to outer loop (if any) in the else block
+    END_BREAK_CONTINUE_BLOCK
+
+    compile_node(comp, pn_else);
+
+    EMIT_ARG(label_assign, break_label);
+
+    // discard the next value, <end> and <step>
+    EMIT(pop_top);
+    EMIT(pop_top);
+    EMIT(pop_top);
+}
+
 STATIC void compile_for_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
     // this bit optimises: for <x> in range(...), turning it into an explicitly incremented variable
     // this is actually slower, but uses no heap memory
@@ -1429,6 +1495,9 @@ STATIC void compile_for_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
             mp_parse_node_t pn_range_end;
             mp_parse_node_t pn_range_step;
             bool optimize = false;
+            bool use_range_op = MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC
+                && comp->scope_cur->emit_options != MP_EMIT_OPT_NATIVE_PYTHON
+                && comp->scope_cur->emit_options != MP_EMIT_OPT_VIPER;
             if (1 <= n_args && n_args <= 3) {
                 optimize = true;
                 if (n_args == 1) {
@@ -1443,8 +1512,9 @@ STATIC void compile_for_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
                     pn_range_start = args[0];
                     pn_range_end = args[1];
                     pn_range_step = args[2];
-                    // We need to know sign of step. This is possible only if it's constant
-                    if (!MP_PARSE_NODE_IS_SMALL_INT(pn_range_step)) {
+                    // We need to know sign of step. This is possible only if it's
+                    // constant, unless FOR_RANGE is used which checks it at runtime
+                    if (!use_range_op && !MP_PARSE_NODE_IS_SMALL_INT(pn_range_step)) {
                         optimize = false;
                     }
                 }
@@ -1461,6 +1531,16 @@ STATIC void compile_for_stmt(compiler_t *comp, mp_parse_node_struct_t *pns) {
                         optimize = false;
                     }
                 }
+                if (optimize && MP_PARSE_NODE_IS_STRUCT(pn_range_step)) {
+                    int k = MP_PARSE_NODE_STRUCT_KIND((mp_parse_node_struct_t*)pn_range_step);
+                    if (k == PN_arglist_star || k == PN_arglist_dbl_star || k == PN_argument) {
+                        optimize = false;
+                    }
+                }
+            }
+            if (optimize && use_range_op) {
+                compile_for_stmt_range_op(comp, pns->nodes[0], pn_range_start, pn_range_end, pn_range_step, pns->nodes[2], pns->nodes[3]);
+                return;
             }
             if (optimize) {
                 compile_for_stmt_optimised_range(comp, pns->nodes[0], pn_range_start, pn_range_end, pn_range_step, pns->nodes[2], pns->nodes[3]);
@@ -3263,7 +3343,11 @@ STATIC void compile_scope_inline_asm(compiler_t *comp, scope_t *scope, pass_kind
             void *f = mp_asm_base_get_code((mp_asm_base_t*)comp->emit_inline_asm);
             mp_emit_glue_assign_native(comp->scope_cur->raw_code, MP_CODE_NATIVE_ASM,
                 f, mp_asm_base_get_code_size((mp_asm_base_t*)comp->emit_inline_asm),
-                NULL, comp->scope_cur->num_pos_args, 0, type_sig);
+                NULL,
+                #if MICROPY_PERSISTENT_CODE_SAVE
+                NULL, 0,
+                #endif
+                comp->scope_cur->num_pos_args, 0, type_sig);
         }
     }
 
@@ -3353,6 +3437,22 @@ STATIC void scope_compute_things(scope_t *scope) {
             scope->num_locals += num_free;
         }
     }
+
+    // flag functions whose args can be copied straight into their state
+    if (SCOPE_IS_FUNC_LIKE(scope->kind)
+        && (scope->scope_flags & (MP_SCOPE_FLAG_VARARGS | MP_SCOPE_FLAG_VARKEYWORDS | MP_SCOPE_FLAG_DEFKWARGS)) == 0
+        && scope->num_kwonly_args == 0 && scope->num_def_pos_args == 0) {
+        bool has_cell = false;
+        for (int i = 0; i < scope->id_info_len; i++) {
+            if (scope->id_info[i].kind == ID_INFO_KIND_CELL) {
+                has_cell = true;
+                break;
+            }
+        }
+        if (!has_cell) {
+            scope->scope_flags |= MP_SCOPE_FLAG_SIMPLE_ARGS;
+        }
+    }
 }
 
 #if !MICROPY_PERSISTENT_CODE_SAVE
@@ -3439,10 +3539,18 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
 #if MICROPY_EMIT_NATIVE
                 case MP_EMIT_OPT_NATIVE_PYTHON:
                 case MP_EMIT_OPT_VIPER:
+                    #if MICROPY_DYNAMIC_COMPILER
+                    if (mp_dynamic_compiler.native_arch >= MP_ARRAY_SIZE(native_emitter_table)
+                        || NATIVE_EMITTER_TABLE == NULL) {
+                        comp->scope_cur = s;
+                        compile_syntax_error(comp, s->pn, "invalid arch");
+                        continue;
+                    }
+                    #endif
                     if (emit_native == NULL) {
                         emit_native = NATIVE_EMITTER(new)(&comp->compile_error, max_num_labels);
                     }
-                    comp->emit_method_table = &NATIVE_EMITTER(method_table);
+                    comp->emit_method_table = NATIVE_EMITTER_TABLE;
                     comp->emit = emit_native;
                     EMIT_ARG(set_native_type, MP_EMIT_NATIVE_TYPE_ENABLE, s->emit_options == MP_EMIT_OPT_VIPER, 0);
                     break;
@@ -39,6 +39,21 @@
 #define BYTES_FOR_INT ((BYTES_PER_WORD * 8 + 6) / 7)
 #define DUMMY_DATA_SIZE (BYTES_FOR_INT)
 
+// The peephole optimiser that fuses superinstructions is needed if they may be emitted
+#define EMIT_BC_PEEPHOLE (MICROPY_OPT_SUPERINSTRUCTIONS || MICROPY_DYNAMIC_COMPILER)
+
+#if EMIT_BC_PEEPHOLE
+// An opcode that is held back because it may become part of a superinstruction.
+// The kind is the opcode (eg MP_BC_LOAD_FAST_N for any LOAD_FAST), or the
+// superinstruction once one has been matched.
+typedef struct _emit_bc_peep_t {
+    byte kind;
+    byte op; // binary op or condition, plus tail for a superinstruction
+    mp_int_t arg[2];
+    mp_uint_t tail_arg;
+} emit_bc_peep_t;
+#endif
+
 struct _emit_t {
     // Accessed as mp_obj_t, so must be aligned as such, and we rely on the
     // memory allocator returning a suitably aligned pointer.
@@ -70,6 +85,11 @@ struct _emit_t {
     uint16_t ct_cur_raw_code;
     #endif
     mp_uint_t *const_table;
+
+    #if EMIT_BC_PEEPHOLE
+    size_t peep_len;
+    emit_bc_peep_t peep[3];
+    #endif
 };
 
 emit_t *emit_bc_new(void) {
@@ -188,10 +208,8 @@ STATIC void emit_write_bytecode_byte_byte(emit_t* emit, byte b1, byte b2) {
     c[1] = b2;
 }
 
-// Similar to emit_write_bytecode_uint(), just some extra handling to encode sign
-STATIC void emit_write_bytecode_byte_int(emit_t *emit, byte b1, mp_int_t num) {
-    emit_write_bytecode_byte(emit, b1);
-
+// Similar to emit_write_uint(), just some extra handling to encode sign
+STATIC void emit_write_bytecode_int(emit_t *emit, mp_int_t num) {
     // We store each 7 bits in a separate byte, and that's how many bytes needed
     byte buf[BYTES_FOR_INT];
     byte *p = buf + sizeof(buf);
@@ -215,6 +233,11 @@ STATIC void emit_write_bytecode_byte_int(emit_t *emit, byte b1, mp_int_t num) {
     *c = *p;
 }
 
+STATIC void emit_write_bytecode_byte_int(emit_t *emit, byte b1, mp_int_t num) {
+    emit_write_bytecode_byte(emit, b1);
+    emit_write_bytecode_int(emit, num);
+}
+
 STATIC void emit_write_bytecode_byte_uint(emit_t *emit, byte b, mp_uint_t val) {
     emit_write_bytecode_byte(emit, b);
     emit_write_uint(emit, emit_get_cur_to_write_bytecode, val);
@@ -301,6 +324,237 @@ STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint
     c[2] = bytecode_offset >> 8;
 }
 
+#if EMIT_BC_PEEPHOLE
+// signed label at the end of a superinstruction, relative to ip following it
+STATIC void emit_write_bytecode_signed_label(emit_t *emit, mp_uint_t label) {
+    int bytecode_offset;
+    if (emit->pass < MP_PASS_EMIT) {
+        bytecode_offset = 0;
+    } else {
+        bytecode_offset = emit->label_offsets[label] - emit->bytecode_offset - 2 + 0x8000;
+    }
+    byte *c = emit_get_cur_to_write_bytecode(emit, 2);
+    c[0] = bytecode_offset;
+    c[1] = bytecode_offset >> 8;
+}
+#endif
+
+STATIC void emit_write_bytecode_load_fast(emit_t *emit, mp_uint_t local_num) {
+    if (local_num <= 15) {
+        emit_write_bytecode_byte(emit, MP_BC_LOAD_FAST_MULTI + local_num);
+    } else {
+        emit_write_bytecode_byte_uint(emit, MP_BC_LOAD_FAST_N, local_num);
+    }
+}
+
+STATIC void emit_write_bytecode_store_fast(emit_t *emit, mp_uint_t local_num) {
+    if (local_num <= 15) {
+        emit_write_bytecode_byte(emit, MP_BC_STORE_FAST_MULTI + local_num);
+    } else {
+        emit_write_bytecode_byte_uint(emit, MP_BC_STORE_FAST_N, local_num);
+    }
+}
+
+STATIC void emit_write_bytecode_load_const_small_int(emit_t *emit, mp_int_t arg) {
+    if (-16 <= arg && arg <= 47) {
+        emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg);
+    } else {
+        emit_write_bytecode_byte_int(emit, MP_BC_LOAD_CONST_SMALL_INT, arg);
+    }
+}
+
+STATIC void emit_write_bytecode_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
+    if (cond) {
+        emit_write_bytecode_byte_signed_label(emit, MP_BC_POP_JUMP_IF_TRUE, label);
+    } else {
+        emit_write_bytecode_byte_signed_label(emit, MP_BC_POP_JUMP_IF_FALSE, label);
+    }
+}
+
+#if EMIT_BC_PEEPHOLE
+
+// Superinstructions are formed from these sequences of opcodes:
+//     LOAD_FAST LOAD_FAST BINARY_OP            -> BINARY_OP_FAST_FAST
+//     LOAD_FAST LOAD_CONST_SMALL_INT BINARY_OP -> BINARY_OP_FAST_INT
+//     LOAD_CONST_SMALL_INT BINARY_OP           -> BINARY_OP_INT
+//     DUP_TOP_TWO ROT_TWO BINARY_OP            -> BINARY_OP_TOP_TWO
+//     DUP_TOP STORE_FAST                       -> STORE_FAST_KEEP
+// and the BINARY_OP_xxx ones may absorb a following STORE_FAST or
+// POP_JUMP_IF_xxx as their tail.  Opcodes are held back while they are the
+// start of such a sequence.  Whether they are fused depends only on the
+// sequence of emit calls, so the code size is the same in all passes.
+
+STATIC void emit_bc_peep_write(emit_t *emit, const emit_bc_peep_t *p) {
+    switch (p->kind) {
+        case MP_BC_LOAD_FAST_N:
+            emit_write_bytecode_load_fast(emit, p->arg[0]);
+            break;
+        case MP_BC_LOAD_CONST_SMALL_INT:
+            emit_write_bytecode_load_const_small_int(emit, p->arg[0]);
+            break;
+        case MP_BC_STORE_FAST_N:
+            emit_write_bytecode_store_fast(emit, p->arg[0]);
+            break;
+        case MP_BC_STORE_FAST_KEEP:
+            emit_write_bytecode_byte_uint(emit, MP_BC_STORE_FAST_KEEP, p->arg[0]);
+            break;
+        case MP_BC_POP_JUMP_IF_TRUE:
+            emit_write_bytecode_pop_jump_if(emit, p->op, p->arg[0]);
+            break;
+        case MP_BC_BINARY_OP_MULTI:
+            emit_write_bytecode_byte(emit, MP_BC_BINARY_OP_MULTI + p->op);
+            break;
+        case MP_BC_BINARY_OP_FAST_FAST:
+        case MP_BC_BINARY_OP_FAST_INT:
+        case MP_BC_BINARY_OP_INT:
+        case MP_BC_BINARY_OP_TOP_TWO:
+            emit_write_bytecode_byte_byte(emit, p->kind, p->op);
+            if (p->kind == MP_BC_BINARY_OP_FAST_FAST || p->kind == MP_BC_BINARY_OP_FAST_INT) {
+                emit_write_uint(emit, emit_get_cur_to_write_bytecode, p->arg[0]);
+            }
+            if (p->kind == MP_BC_BINARY_OP_FAST_FAST) {
+                emit_write_uint(emit, emit_get_cur_to_write_bytecode, p->arg[1]);
+            } else if (p->kind != MP_BC_BINARY_OP_TOP_TWO) {
+                emit_write_bytecode_int(emit, p->arg[1]);
+            }
+            if ((p->op & MP_BC_TAIL_MASK) == MP_BC_TAIL_STORE_FAST) {
+                emit_write_uint(emit, emit_get_cur_to_write_bytecode, p->tail_arg);
+            } else if ((p->op & MP_BC_TAIL_MASK) != MP_BC_TAIL_PUSH) {
+                emit_write_bytecode_signed_label(emit, p->tail_arg);
+            }
+            break;
+        default:
+            // DUP_TOP, DUP_TOP_TWO, ROT_TWO
+            emit_write_bytecode_byte(emit, p->kind);
+            break;
+    }
+}
+
+STATIC void emit_bc_peep_flush(emit_t *emit) {
+    for (size_t i = 0; i < emit->peep_len; ++i) {
+        emit_bc_peep_write(emit, &emit->peep[i]);
+    }
+    emit->peep_len = 0;
+}
+
+// Returns 0 if the pending opcodes can't start a superinstruction, 1 if they
+// may, and 2 if they were fused into a complete one which is now in peep[0].
+STATIC int emit_bc_peep_match(emit_t *emit) {
+    emit_bc_peep_t *p = emit->peep;
+    size_t n = emit->peep_len;
+    if (n == 1) {
+        return p[0].kind != MP_BC_ROT_TWO
+            && p[0].kind != MP_BC_STORE_FAST_N
+            && p[0].kind != MP_BC_POP_JUMP_IF_TRUE
+            && p[0].kind != MP_BC_BINARY_OP_MULTI;
+    }
+    switch (p[0].kind) {
+        case MP_BC_LOAD_FAST_N:
+            if (p[1].kind != MP_BC_LOAD_FAST_N && p[1].kind != MP_BC_LOAD_CONST_SMALL_INT) {
+                return 0;
+            }
+            if (n == 2) {
+                return 1;
+            }
+            if (p[2].kind != MP_BC_BINARY_OP_MULTI) {
+                return 0;
+            }
+            if (p[1].kind == MP_BC_LOAD_FAST_N) {
+                p[0].kind = MP_BC_BINARY_OP_FAST_FAST;
+            } else {
+                p[0].kind = MP_BC_BINARY_OP_FAST_INT;
+            }
+            p[0].op = p[2].op;
+            p[0].arg[1] = p[1].arg[0];
+            emit->peep_len = 1;
+            return 1;
+        case MP_BC_LOAD_CONST_SMALL_INT:
+            if (p[1].kind != MP_BC_BINARY_OP_MULTI) {
+                return 0;
+            }
+            p[0].kind = MP_BC_BINARY_OP_INT;
+            p[0].op = p[1].op;
+            p[0].arg[1] = p[0].arg[0];
+            emit->peep_len = 1;
+            return 1;
+        case MP_BC_DUP_TOP_TWO:
+            if (p[1].kind != MP_BC_ROT_TWO) {
+                return 0;
+            }
+            if (n == 2) {
+                return 1;
+            }
+            if (p[2].kind != MP_BC_BINARY_OP_MULTI) {
+                return 0;
+            }
+            p[0].kind = MP_BC_BINARY_OP_TOP_TWO;
+            p[0].op = p[2].op;
+            emit->peep_len = 1;
+            return 1;
+        case MP_BC_DUP_TOP:
+            if (p[1].kind != MP_BC_STORE_FAST_N) {
+                return 0;
+            }
+            p[0].kind = MP_BC_STORE_FAST_KEEP;
+            p[0].arg[0] = p[1].arg[0];
+            emit->peep_len = 1;
+            return 2;
+        case MP_BC_BINARY_OP_FAST_FAST:
+        case MP_BC_BINARY_OP_FAST_INT:
+        case MP_BC_BINARY_OP_INT:
+        case MP_BC_BINARY_OP_TOP_TWO:
+            if (p[1].kind == MP_BC_STORE_FAST_N) {
+                p[0].op |= MP_BC_TAIL_STORE_FAST;
+            } else if (p[1].kind == MP_BC_POP_JUMP_IF_TRUE) {
+                p[0].op |= p[1].op ? MP_BC_TAIL_POP_JUMP_IF_TRUE : MP_BC_TAIL_POP_JUMP_IF_FALSE;
+            } else {
+                return 0;
+            }
+            p[0].tail_arg = p[1].arg[0];
+            emit->peep_len = 1;
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+// Account for the stack and hold back an opcode that may form part of a
+// superinstruction.  Returns false if the caller should emit it as usual.
+STATIC bool emit_bc_pre_peep(emit_t *emit, mp_int_t stack_size_delta, byte kind, byte op, mp_int_t arg) {
+    if (!MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC || emit->pass == MP_PASS_SCOPE) {
+        return false;
+    }
+    assert((mp_int_t)emit->stack_size + stack_size_delta >= 0);
+    emit->stack_size += stack_size_delta;
+    if (emit->stack_size > emit->scope->stack_size) {
+        emit->scope->stack_size = emit->stack_size;
+    }
+    emit->last_emit_was_return_value = false;
+
+    emit_bc_peep_t *p = &emit->peep[emit->peep_len++];
+    p->kind = kind;
+    p->op = op;
+    p->arg[0] = arg;
+    for (;;) {
+        int match = emit_bc_peep_match(emit);
+        if (match == 1) {
+            break;
+        } else if (match == 2) {
+            emit_bc_peep_flush(emit);
+            break;
+        }
+        // the first pending opcode can't be fused, so write it and retry with the rest
+        emit_bc_peep_write(emit, &emit->peep[0]);
+        if (--emit->peep_len == 0) {
+            break;
+        }
+        memmove(&emit->peep[0], &emit->peep[1], emit->peep_len * sizeof(emit_bc_peep_t));
+    }
+    return true;
+}
+
+#endif // EMIT_BC_PEEPHOLE
+
 void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->pass = pass;
     emit->stack_size = 0;
@@ -313,6 +567,9 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     }
     emit->bytecode_offset = 0;
     emit->code_info_offset = 0;
+    #if EMIT_BC_PEEPHOLE
+    emit->peep_len = 0;
+    #endif
 
     // Write local state size and exception stack size.
     {
@@ -400,6 +657,10 @@ void mp_emit_bc_end_pass(emit_t *emit) {
     // check stack is back to zero size
     assert(emit->stack_size == 0);
 
+    #if EMIT_BC_PEEPHOLE
+    emit_bc_peep_flush(emit);
+    #endif
+
     emit_write_code_info_byte(emit, 0); // end of line number info
 
     #if MICROPY_PERSISTENT_CODE
@@ -416,14 +677,14 @@ void mp_emit_bc_end_pass(emit_t *emit) {
         // calculate size of total code-info + bytecode, in bytes
         emit->code_info_size = emit->code_info_offset;
         emit->bytecode_size = emit->bytecode_offset;
-        emit->code_base = m_new0(byte, emit->code_info_size + emit->bytecode_size);
+        emit->code_base = m_new0_long_lived(byte, emit->code_info_size + emit->bytecode_size);
 
         #if MICROPY_PERSISTENT_CODE
-        emit->const_table = m_new0(mp_uint_t,
+        emit->const_table = m_new0_long_lived(mp_uint_t,
             emit->scope->num_pos_args + emit->scope->num_kwonly_args
             + emit->ct_cur_obj + emit->ct_cur_raw_code);
         #else
-        emit->const_table = m_new0(mp_uint_t,
+        emit->const_table = m_new0_long_lived(mp_uint_t,
             emit->scope->num_pos_args + emit->scope->num_kwonly_args);
         #endif
 
@@ -448,6 +709,10 @@ void mp_emit_bc_adjust_stack_size(emit_t *emit, mp_int_t delta) {
 
 void mp_emit_bc_set_source_line(emit_t *emit, mp_uint_t source_line) {
     //printf("source: line %d -> %d  offset %d -> %d\n", emit->last_source_line, source_line, emit->last_source_line_offset, emit->bytecode_offset);
+    #if EMIT_BC_PEEPHOLE
+    // don't fuse opcodes across statements, and make bytecode_offset current
+    emit_bc_peep_flush(emit);
+    #endif
 #if MICROPY_ENABLE_SOURCE_LINE
     if (MP_STATE_VM(mp_optimise_value) >= 3) {
         // If we compile with -O3, don't store line numbers.
@@ -470,6 +735,9 @@ STATIC void emit_bc_pre(emit_t *emit, mp_int_t stack_size_delta) {
     if (emit->pass == MP_PASS_SCOPE) {
         return;
     }
+    #if EMIT_BC_PEEPHOLE
+    emit_bc_peep_flush(emit);
+    #endif
     assert((mp_int_t)emit->stack_size + stack_size_delta >= 0);
     emit->stack_size += stack_size_delta;
     if (emit->stack_size > emit->scope->stack_size) {
@@ -524,12 +792,13 @@ void mp_emit_bc_load_const_tok(emit_t *emit, mp_token_kind_t tok) {
 }
 
 void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
-    emit_bc_pre(emit, 1);
-    if (-16 <= arg && arg <= 47) {
-        emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg);
-    } else {
-        emit_write_bytecode_byte_int(emit, MP_BC_LOAD_CONST_SMALL_INT, arg);
+    #if EMIT_BC_PEEPHOLE
+    if (emit_bc_pre_peep(emit, 1, MP_BC_LOAD_CONST_SMALL_INT, 0, arg)) {
+        return;
     }
+    #endif
+    emit_bc_pre(emit, 1);
+    emit_write_bytecode_load_const_small_int(emit, arg);
 }
 
 void mp_emit_bc_load_const_str(emit_t *emit, qstr qst) {
@@ -549,12 +818,13 @@ void mp_emit_bc_load_null(emit_t *emit) {
 
 void mp_emit_bc_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     (void)qst;
-    emit_bc_pre(emit, 1);
-    if (local_num <= 15) {
-        emit_write_bytecode_byte(emit, MP_BC_LOAD_FAST_MULTI + local_num);
-    } else {
-        emit_write_bytecode_byte_uint(emit, MP_BC_LOAD_FAST_N, local_num);
+    #if EMIT_BC_PEEPHOLE
+    if (emit_bc_pre_peep(emit, 1, MP_BC_LOAD_FAST_N, 0, local_num)) {
+        return;
     }
+    #endif
+    emit_bc_pre(emit, 1);
+    emit_write_bytecode_load_fast(emit, local_num);
 }
 
 void mp_emit_bc_load_deref(emit_t *emit, qstr qst, mp_uint_t local_num) {
@@ -606,12 +876,13 @@ void mp_emit_bc_load_subscr(emit_t *emit) {
 
 void mp_emit_bc_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     (void)qst;
-    emit_bc_pre(emit, -1);
-    if (local_num <= 15) {
-        emit_write_bytecode_byte(emit, MP_BC_STORE_FAST_MULTI + local_num);
-    } else {
-        emit_write_bytecode_byte_uint(emit, MP_BC_STORE_FAST_N, local_num);
+    #if EMIT_BC_PEEPHOLE
+    if (emit_bc_pre_peep(emit, -1, MP_BC_STORE_FAST_N, 0, local_num)) {
+        return;
     }
+    #endif
+    emit_bc_pre(emit, -1);
+    emit_write_bytecode_store_fast(emit, local_num);
 }
 
 void mp_emit_bc_store_deref(emit_t *emit, qstr qst, mp_uint_t local_num) {
@@ -645,11 +916,17 @@ void mp_emit_bc_store_subscr(emit_t *emit) {
 
 void mp_emit_bc_delete_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     (void)qst;
+    #if EMIT_BC_PEEPHOLE
+    emit_bc_peep_flush(emit);
+    #endif
     emit_write_bytecode_byte_uint(emit, MP_BC_DELETE_FAST, local_num);
 }
 
 void mp_emit_bc_delete_deref(emit_t *emit, qstr qst, mp_uint_t local_num) {
     (void)qst;
+    #if EMIT_BC_PEEPHOLE
+    emit_bc_peep_flush(emit);
+    #endif
     emit_write_bytecode_byte_uint(emit, MP_BC_DELETE_DEREF, local_num);
 }
 
@@ -676,11 +953,21 @@ void mp_emit_bc_delete_subscr(emit_t *emit) {
 }
 
 void mp_emit_bc_dup_top(emit_t *emit) {
+    #if EMIT_BC_PEEPHOLE
+    if (emit_bc_pre_peep(emit, 1, MP_BC_DUP_TOP, 0, 0)) {
+        return;
+    }
+    #endif
     emit_bc_pre(emit, 1);
     emit_write_bytecode_byte(emit, MP_BC_DUP_TOP);
 }
 
 void mp_emit_bc_dup_top_two(emit_t *emit) {
+    #if EMIT_BC_PEEPHOLE
+    if (emit_bc_pre_peep(emit, 2, MP_BC_DUP_TOP_TWO, 0, 0)) {
+        return;
+    }
+    #endif
     emit_bc_pre(emit, 2);
     emit_write_bytecode_byte(emit, MP_BC_DUP_TOP_TWO);
 }
@@ -691,6 +978,11 @@ void mp_emit_bc_pop_top(emit_t *emit) {
 }
 
 void mp_emit_bc_rot_two(emit_t *emit) {
+    #if EMIT_BC_PEEPHOLE
+    if (emit_bc_pre_peep(emit, 0, MP_BC_ROT_TWO, 0, 0)) {
+        return;
+    }
+    #endif
     emit_bc_pre(emit, 0);
     emit_write_bytecode_byte(emit, MP_BC_ROT_TWO);
 }
@@ -706,12 +998,14 @@ void mp_emit_bc_jump(emit_t *emit, mp_uint_t label) {
 }
 
 void mp_emit_bc_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
-    emit_bc_pre(emit, -1);
-    if (cond) {
-        emit_write_bytecode_byte_signed_label(emit, MP_BC_POP_JUMP_IF_TRUE, label);
-    } else {
-        emit_write_bytecode_byte_signed_label(emit, MP_BC_POP_JUMP_IF_FALSE, label);
+    #if EMIT_BC_PEEPHOLE
+    // the kind is MP_BC_POP_JUMP_IF_TRUE for both conditions
+    if (emit_bc_pre_peep(emit, -1, MP_BC_POP_JUMP_IF_TRUE, cond, label)) {
+        return;
     }
+    #endif
+    emit_bc_pre(emit, -1);
+    emit_write_bytecode_pop_jump_if(emit, cond, label);
 }
 
 void mp_emit_bc_jump_if_or_pop(emit_t *emit, bool cond, mp_uint_t label) {
@@ -732,6 +1026,9 @@ void mp_emit_bc_unwind_jump(emit_t *emit, mp_uint_t label, mp_uint_t except_dept
         }
         emit_write_bytecode_byte_signed_label(emit, MP_BC_JUMP, label & ~MP_EMIT_BREAK_FROM_FOR);
     } else {
+        #if EMIT_BC_PEEPHOLE
+        emit_bc_peep_flush(emit);
+        #endif
         emit_write_bytecode_byte_signed_label(emit, MP_BC_UNWIND_JUMP, label & ~MP_EMIT_BREAK_FROM_FOR);
         emit_write_bytecode_byte(emit, ((label & MP_EMIT_BREAK_FROM_FOR) ? 0x80 : 0) | except_depth);
     }
@@ -782,6 +1079,11 @@ void mp_emit_bc_for_iter_end(emit_t *emit) {
     emit_bc_pre(emit, -1);
 }
 
+void mp_emit_bc_for_range(emit_t *emit, mp_uint_t label) {
+    emit_bc_pre(emit, 1);
+    emit_write_bytecode_byte_unsigned_label(emit, MP_BC_FOR_RANGE, label);
+}
+
 void mp_emit_bc_pop_block(emit_t *emit) {
     emit_bc_pre(emit, 0);
     emit_write_bytecode_byte(emit, MP_BC_POP_BLOCK);
@@ -806,6 +1108,11 @@ void mp_emit_bc_binary_op(emit_t *emit, mp_binary_op_t op) {
         invert = true;
         op = MP_BINARY_OP_IS;
     }
+    #if EMIT_BC_PEEPHOLE
+    if (!invert && emit_bc_pre_peep(emit, -1, MP_BC_BINARY_OP_MULTI, op, 0)) {
+        return;
+    }
+    #endif
     emit_bc_pre(emit, -1);
     emit_write_bytecode_byte(emit, MP_BC_BINARY_OP_MULTI + op);
     if (invert) {
@@ -1012,6 +1319,7 @@ const emit_method_table_t emit_bc_method_table = {
     mp_emit_bc_get_iter,
     mp_emit_bc_for_iter,
     mp_emit_bc_for_iter_end,
+    mp_emit_bc_for_range,
     mp_emit_bc_pop_block,
     mp_emit_bc_pop_except,
     mp_emit_bc_unary_op,
@@ -39,6 +39,22 @@ typedef enum {
     MP_CODE_NATIVE_ASM,
 } mp_raw_code_kind_t;
 
+// Values embedded in native machine code that depend on the running firmware.
+// They are recorded by the native emitter so the code can be saved to a .mpy
+// file, and patched when that file is loaded.  Each relocation is stored as
+// three words: the offset of the value within the code, the kind, and the
+// value (the mp_fun_table index for FUN, the qstr for the QSTR kinds).
+typedef enum {
+    MP_NATIVE_RELOC_FUN_TABLE,  // address of mp_fun_table
+    MP_NATIVE_RELOC_FUN,        // address of a function in mp_fun_table
+    MP_NATIVE_RELOC_QSTR,       // qstr, as a machine word
+    MP_NATIVE_RELOC_QSTR_OBJ,   // qstr object, as a machine word
+    MP_NATIVE_RELOC_QSTR16,     // qstr, as 16 bits in the prelude
+    MP_NATIVE_RELOC_CONST,      // None, False, True or Ellipsis
+    MP_NATIVE_RELOC_OBJ,        // constant object, such as a float or bytes
+    MP_NATIVE_RELOC_RAW_CODE,   // raw code of a nested function
+} mp_native_reloc_kind_t;
+
 typedef struct _mp_raw_code_t {
     mp_raw_code_kind_t kind : 3;
     mp_uint_t scope_flags : 7;
@@ -57,6 +73,11 @@ typedef struct _mp_raw_code_t {
             void *fun_data;
             const mp_uint_t *const_table;
             mp_uint_t type_sig; // for viper, compressed as 2-bit types; ret is MSB, then arg0, arg1, etc
+            #if MICROPY_PERSISTENT_CODE_SAVE
+            mp_uint_t fun_len;
+            const mp_uint_t *relocs;
+            mp_uint_t n_relocs;
+            #endif
         } u_native;
     } data;
 } mp_raw_code_t;
@@ -69,7 +90,11 @@ void mp_emit_glue_assign_bytecode(mp_raw_code_t *rc, const byte *code, mp_uint_t
     uint16_t n_obj, uint16_t n_raw_code,
     #endif
     mp_uint_t scope_flags);
-void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void *fun_data, mp_uint_t fun_len, const mp_uint_t *const_table, mp_uint_t n_pos_args, mp_uint_t scope_flags, mp_uint_t type_sig);
+void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void *fun_data, mp_uint_t fun_len, const mp_uint_t *const_table,
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    const mp_uint_t *relocs, mp_uint_t n_relocs,
+    #endif
+    mp_uint_t n_pos_args, mp_uint_t scope_flags, mp_uint_t type_sig);
 
 mp_obj_t mp_make_function_from_raw_code(const mp_raw_code_t *rc, mp_obj_t def_args, mp_obj_t def_kw_args);
 mp_obj_t mp_make_closure_from_raw_code(const mp_raw_code_t *rc, mp_uint_t n_closed_over, const mp_obj_t *args);
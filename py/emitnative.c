@@ -97,10 +97,8 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
     [MP_F_LIST_APPEND] = 2,
     [MP_F_BUILD_MAP] = 1,
     [MP_F_STORE_MAP] = 3,
-#if MICROPY_PY_BUILTINS_SET
     [MP_F_BUILD_SET] = 2,
     [MP_F_STORE_SET] = 2,
-#endif
     [MP_F_MAKE_FUNCTION_FROM_RAW_CODE] = 3,
     [MP_F_NATIVE_CALL_FUNCTION_N_KW] = 3,
     [MP_F_CALL_METHOD_N_KW] = 3,
@@ -113,9 +111,7 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
     [MP_F_IMPORT_NAME] = 3,
     [MP_F_IMPORT_FROM] = 2,
     [MP_F_IMPORT_ALL] = 1,
-#if MICROPY_PY_BUILTINS_SLICE
     [MP_F_NEW_SLICE] = 3,
-#endif
     [MP_F_UNPACK_SEQUENCE] = 3,
     [MP_F_UNPACK_EX] = 3,
     [MP_F_DELETE_NAME] = 1,
@@ -123,6 +119,8 @@ STATIC byte mp_f_n_args[MP_F_NUMBER_OF] = {
     [MP_F_NEW_CELL] = 1,
     [MP_F_MAKE_CLOSURE_FROM_RAW_CODE] = 3,
     [MP_F_SETUP_CODE_STATE] = 5,
+    [MP_F_NATIVE_PYSTACK_GET] = 0,
+    [MP_F_NATIVE_PYSTACK_SET] = 1,
 };
 
 #include "py/asmx86.h"
@@ -223,12 +221,19 @@ struct _emit_t {
     int n_state;
     int stack_start;
     int stack_size;
+    int pystack_slot; // local holding the pystack level on entry, or -1
 
     bool last_emit_was_return_value;
 
     scope_t *scope;
 
     ASM_T *as;
+
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    mp_uint_t relocs_alloc;
+    mp_uint_t n_relocs;
+    mp_uint_t *relocs;
+    #endif
 };
 
 emit_t *EXPORT_FUN(new)(mp_obj_t *error_slot, mp_uint_t max_num_labels) {
@@ -244,6 +249,9 @@ void EXPORT_FUN(free)(emit_t *emit) {
     m_del_obj(ASM_T, emit->as);
     m_del(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc);
     m_del(stack_info_t, emit->stack_info, emit->stack_info_alloc);
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    m_del(mp_uint_t, emit->relocs, emit->relocs_alloc);
+    #endif
     m_del_obj(emit_t, emit);
 }
 
@@ -282,7 +290,118 @@ STATIC void emit_post_push_reg(emit_t *emit, vtype_kind_t vtype, int reg);
 STATIC void emit_native_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num);
 STATIC void emit_native_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num);
 
-#define STATE_START (sizeof(mp_code_state_t) / sizeof(mp_uint_t))
+// native code keeps its mp_code_state_t on the C stack, so depends on its size
+#define STATE_START (MICROPY_NATIVE_CODE_STATE_WORDS_DYNAMIC)
+
+// and likewise for the nlr_buf_t of a try or with block, which is on the stack
+#define NLR_BUF_WORDS (MICROPY_NATIVE_NLR_BUF_WORDS_DYNAMIC)
+
+// whether a function with exception handlers must save the pystack level
+#define NEED_PYSTACK_SLOT(scope) (MICROPY_NATIVE_PYSTACK_DYNAMIC && (scope)->exc_stack_size > 0)
+
+#if MICROPY_PERSISTENT_CODE_SAVE
+// Record the location of a value in the code that depends on the firmware, so
+// that it can be relinked when the code is loaded from a .mpy file.  The value
+// is kept with the relocation, because when compiling for another architecture
+// the code may only have room for part of it.
+STATIC void emit_native_reloc(emit_t *emit, size_t loc, mp_native_reloc_kind_t kind, mp_uint_t val) {
+    if (emit->pass != MP_PASS_EMIT) {
+        return;
+    }
+    if (3 * emit->n_relocs + 3 > emit->relocs_alloc) {
+        mp_uint_t new_alloc = emit->relocs_alloc * 2 + 24;
+        emit->relocs = m_renew(mp_uint_t, emit->relocs, emit->relocs_alloc, new_alloc);
+        emit->relocs_alloc = new_alloc;
+    }
+    emit->relocs[3 * emit->n_relocs] = loc;
+    emit->relocs[3 * emit->n_relocs + 1] = kind;
+    emit->relocs[3 * emit->n_relocs + 2] = val;
+    emit->n_relocs += 1;
+}
+
+// Immediate objects are either tagged values that are the same in all firmware
+// (small ints, NULL, sentinels), or else need relocating.
+STATIC bool emit_native_obj_needs_reloc(mp_obj_t obj, mp_native_reloc_kind_t *kind) {
+    if (obj == mp_const_none || obj == mp_const_false || obj == mp_const_true
+        || obj == MP_OBJ_FROM_PTR(&mp_const_ellipsis_obj)) {
+        *kind = MP_NATIVE_RELOC_CONST;
+        return true;
+    } else if (MP_OBJ_IS_QSTR(obj)) {
+        *kind = MP_NATIVE_RELOC_QSTR_OBJ;
+        return true;
+    }
+    return false;
+}
+#endif
+
+// When saving code, values that need relocating are loaded using a fixed-size
+// instruction sequence that holds the value as a full word.
+
+STATIC void emit_native_mov_reg_obj(emit_t *emit, int reg_dest, mp_obj_t obj) {
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    mp_native_reloc_kind_t kind;
+    if (emit_native_obj_needs_reloc(obj, &kind)) {
+        size_t loc = ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, (mp_uint_t)obj, reg_dest);
+        emit_native_reloc(emit, loc, kind, kind == MP_NATIVE_RELOC_QSTR_OBJ ? MP_OBJ_QSTR_VALUE(obj) : (mp_uint_t)obj);
+        return;
+    }
+    #endif
+    ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)obj, reg_dest);
+}
+
+STATIC void emit_native_mov_local_obj(emit_t *emit, int local_num, mp_obj_t obj, int reg_temp) {
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    mp_native_reloc_kind_t kind;
+    if (emit_native_obj_needs_reloc(obj, &kind)) {
+        emit_native_mov_reg_obj(emit, reg_temp, obj);
+        ASM_MOV_REG_TO_LOCAL(emit->as, reg_temp, local_num);
+        return;
+    }
+    #endif
+    ASM_MOV_IMM_TO_LOCAL_USING(emit->as, (mp_uint_t)obj, local_num, reg_temp);
+}
+
+STATIC void emit_native_mov_reg_qstr(emit_t *emit, int reg_dest, qstr qst) {
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    size_t loc = ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, qst, reg_dest);
+    emit_native_reloc(emit, loc, MP_NATIVE_RELOC_QSTR, qst);
+    #else
+    ASM_MOV_IMM_TO_REG(emit->as, qst, reg_dest);
+    #endif
+}
+
+// the raw code is stored in the code aligned on a mp_uint_t boundary
+STATIC void emit_native_mov_reg_raw_code(emit_t *emit, int reg_dest, mp_raw_code_t *rc) {
+    size_t loc = ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, (mp_uint_t)rc, reg_dest);
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    emit_native_reloc(emit, loc, MP_NATIVE_RELOC_RAW_CODE, (mp_uint_t)rc);
+    #else
+    (void)loc;
+    #endif
+}
+
+#if N_THUMB || N_ARM
+// these emitters call runtime functions through mp_fun_table, held in r7
+STATIC void emit_native_mov_reg_fun_table(emit_t *emit, int reg_dest) {
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    size_t loc = ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, (mp_uint_t)mp_fun_table, reg_dest);
+    emit_native_reloc(emit, loc, MP_NATIVE_RELOC_FUN_TABLE, 0);
+    #elif N_THUMB
+    asm_thumb_mov_reg_i32(emit->as, reg_dest, (mp_uint_t)mp_fun_table);
+    #else
+    asm_arm_mov_reg_i32(emit->as, reg_dest, (mp_uint_t)mp_fun_table);
+    #endif
+}
+#endif
+
+STATIC void emit_native_call_ind(emit_t *emit, mp_fun_kind_t fun_kind) {
+    #if MICROPY_PERSISTENT_CODE_SAVE && !(N_THUMB || N_ARM)
+    size_t loc = ASM_CALL_IND(emit->as, mp_fun_table[fun_kind], fun_kind);
+    emit_native_reloc(emit, loc, MP_NATIVE_RELOC_FUN, fun_kind);
+    #else
+    ASM_CALL_IND(emit->as, mp_fun_table[fun_kind], fun_kind);
+    #endif
+}
 
 STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     DEBUG_printf("start_pass(pass=%u, scope=%p)\n", pass, scope);
@@ -290,8 +409,12 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
     emit->pass = pass;
     emit->stack_start = 0;
     emit->stack_size = 0;
+    emit->pystack_slot = -1;
     emit->last_emit_was_return_value = false;
     emit->scope = scope;
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    emit->n_relocs = 0;
+    #endif
 
     // allocate memory for keeping track of the types of locals
     if (emit->local_vtype_alloc < scope->num_locals) {
@@ -354,14 +477,17 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
             }
             emit->stack_start = num_locals;
             num_locals += scope->stack_size;
+            if (NEED_PYSTACK_SLOT(scope)) {
+                emit->pystack_slot = num_locals++;
+            }
         }
         ASM_ENTRY(emit->as, num_locals);
 
         // TODO don't load r7 if we don't need it
         #if N_THUMB
-        asm_thumb_mov_reg_i32(emit->as, ASM_THUMB_REG_R7, (mp_uint_t)mp_fun_table);
+        emit_native_mov_reg_fun_table(emit, ASM_THUMB_REG_R7);
         #elif N_ARM
-        asm_arm_mov_reg_i32(emit->as, ASM_ARM_REG_R7, (mp_uint_t)mp_fun_table);
+        emit_native_mov_reg_fun_table(emit, ASM_ARM_REG_R7);
         #endif
 
         #if N_X86
@@ -397,15 +523,18 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
     } else {
         // work out size of state (locals plus stack)
         emit->n_state = scope->num_locals + scope->stack_size;
+        if (NEED_PYSTACK_SLOT(scope)) {
+            emit->pystack_slot = STATE_START + emit->n_state;
+        }
 
         // allocate space on C-stack for code_state structure, which includes state
-        ASM_ENTRY(emit->as, STATE_START + emit->n_state);
+        ASM_ENTRY(emit->as, STATE_START + emit->n_state + (emit->pystack_slot >= 0));
 
         // TODO don't load r7 if we don't need it
         #if N_THUMB
-        asm_thumb_mov_reg_i32(emit->as, ASM_THUMB_REG_R7, (mp_uint_t)mp_fun_table);
+        emit_native_mov_reg_fun_table(emit, ASM_THUMB_REG_R7);
         #elif N_ARM
-        asm_arm_mov_reg_i32(emit->as, ASM_ARM_REG_R7, (mp_uint_t)mp_fun_table);
+        emit_native_mov_reg_fun_table(emit, ASM_ARM_REG_R7);
         #endif
 
         // prepare incoming arguments for call to mp_setup_code_state
@@ -431,8 +560,8 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         // XXX this encoding may change size
         ASM_MOV_IMM_TO_LOCAL_USING(emit->as, emit->prelude_offset, offsetof(mp_code_state_t, ip) / sizeof(mp_uint_t), REG_ARG_1);
 
-        // set code_state.n_state
-        ASM_MOV_IMM_TO_LOCAL_USING(emit->as, emit->n_state, offsetof(mp_code_state_t, n_state) / sizeof(mp_uint_t), REG_ARG_1);
+        // set code_state.n_state (the last entry before the state)
+        ASM_MOV_IMM_TO_LOCAL_USING(emit->as, emit->n_state, STATE_START - 1, REG_ARG_1);
 
         // put address of code_state into first arg
         ASM_MOV_LOCAL_ADDR_TO_REG(emit->as, 0, REG_ARG_1);
@@ -447,7 +576,7 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         asm_arm_bl_ind(emit->as, mp_fun_table[MP_F_SETUP_CODE_STATE], MP_F_SETUP_CODE_STATE, ASM_ARM_REG_R4);
         asm_arm_pop(emit->as, 1 << REG_RET); // pop dummy (was 5th arg)
         #else
-        ASM_CALL_IND(emit->as, mp_fun_table[MP_F_SETUP_CODE_STATE], MP_F_SETUP_CODE_STATE);
+        emit_native_call_ind(emit, MP_F_SETUP_CODE_STATE);
         #endif
 
         // cache some locals in registers
@@ -470,6 +599,11 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         }
     }
 
+    if (emit->pystack_slot >= 0) {
+        // save the pystack level, to restore when an exception is caught
+        emit_native_call_ind(emit, MP_F_NATIVE_PYSTACK_GET);
+        ASM_MOV_REG_TO_LOCAL(emit->as, REG_RET, emit->pystack_slot);
+    }
 }
 
 STATIC void emit_native_end_pass(emit_t *emit) {
@@ -487,6 +621,10 @@ STATIC void emit_native_end_pass(emit_t *emit) {
         // write code info
         #if MICROPY_PERSISTENT_CODE
         mp_asm_base_data(&emit->as->base, 1, 5);
+        #if MICROPY_PERSISTENT_CODE_SAVE
+        emit_native_reloc(emit, mp_asm_base_get_code_pos(&emit->as->base), MP_NATIVE_RELOC_QSTR16, emit->scope->simple_name);
+        emit_native_reloc(emit, mp_asm_base_get_code_pos(&emit->as->base) + 2, MP_NATIVE_RELOC_QSTR16, emit->scope->source_file);
+        #endif
         mp_asm_base_data(&emit->as->base, 1, emit->scope->simple_name);
         mp_asm_base_data(&emit->as->base, 1, emit->scope->simple_name >> 8);
         mp_asm_base_data(&emit->as->base, 1, emit->scope->source_file);
@@ -519,6 +657,9 @@ STATIC void emit_native_end_pass(emit_t *emit) {
                     break;
                 }
             }
+            #if MICROPY_PERSISTENT_CODE_SAVE
+            emit_native_reloc(emit, mp_asm_base_get_code_pos(&emit->as->base), MP_NATIVE_RELOC_QSTR_OBJ, qst);
+            #endif
             mp_asm_base_data(&emit->as->base, ASM_WORD_SIZE, (mp_uint_t)MP_OBJ_NEW_QSTR(qst));
         }
 
@@ -542,9 +683,17 @@ STATIC void emit_native_end_pass(emit_t *emit) {
             type_sig |= (emit->local_vtype[i] & 0xf) << (i * 4 + 4);
         }
 
+        #if MICROPY_PERSISTENT_CODE_SAVE
+        mp_uint_t *relocs = m_new(mp_uint_t, 3 * emit->n_relocs);
+        memcpy(relocs, emit->relocs, 3 * emit->n_relocs * sizeof(mp_uint_t));
+        #endif
+
         mp_emit_glue_assign_native(emit->scope->raw_code,
             emit->do_viper_types ? MP_CODE_NATIVE_VIPER : MP_CODE_NATIVE_PY,
             f, f_len, (mp_uint_t*)((byte*)f + emit->const_table_offset),
+            #if MICROPY_PERSISTENT_CODE_SAVE
+            relocs, emit->n_relocs,
+            #endif
             emit->scope->num_pos_args, emit->scope->scope_flags, type_sig);
     }
 }
@@ -679,7 +828,11 @@ STATIC void need_stack_settled(emit_t *emit) {
         if (si->kind == STACK_IMM) {
             DEBUG_printf("    imm(" INT_FMT ") to local(%u)\n", si->data.u_imm, emit->stack_start + i);
             si->kind = STACK_VALUE;
-            ASM_MOV_IMM_TO_LOCAL_USING(emit->as, si->data.u_imm, emit->stack_start + i, REG_TEMP0);
+            if (si->vtype == VTYPE_PYOBJ) {
+                emit_native_mov_local_obj(emit, emit->stack_start + i, (mp_obj_t)si->data.u_imm, REG_TEMP0);
+            } else {
+                ASM_MOV_IMM_TO_LOCAL_USING(emit->as, si->data.u_imm, emit->stack_start + i, REG_TEMP0);
+            }
         }
     }
 }
@@ -701,7 +854,11 @@ STATIC void emit_access_stack(emit_t *emit, int pos, vtype_kind_t *vtype, int re
             break;
 
         case STACK_IMM:
-            ASM_MOV_IMM_TO_REG(emit->as, si->data.u_imm, reg_dest);
+            if (si->vtype == VTYPE_PYOBJ) {
+                emit_native_mov_reg_obj(emit, reg_dest, (mp_obj_t)si->data.u_imm);
+            } else {
+                ASM_MOV_IMM_TO_REG(emit->as, si->data.u_imm, reg_dest);
+            }
             break;
     }
 }
@@ -802,36 +959,35 @@ STATIC void emit_post_push_reg_reg_reg_reg(emit_t *emit, vtype_kind_t vtypea, in
 
 STATIC void emit_call(emit_t *emit, mp_fun_kind_t fun_kind) {
     need_reg_all(emit);
-    ASM_CALL_IND(emit->as, mp_fun_table[fun_kind], fun_kind);
+    emit_native_call_ind(emit, fun_kind);
+}
+
+STATIC void emit_restore_pystack(emit_t *emit) {
+    if (emit->pystack_slot >= 0) {
+        // free whatever the calls aborted by an exception left on the pystack
+        need_reg_all(emit);
+        ASM_MOV_LOCAL_TO_REG(emit->as, emit->pystack_slot, REG_ARG_1);
+        emit_native_call_ind(emit, MP_F_NATIVE_PYSTACK_SET);
+    }
 }
 
 STATIC void emit_call_with_imm_arg(emit_t *emit, mp_fun_kind_t fun_kind, mp_int_t arg_val, int arg_reg) {
     need_reg_all(emit);
     ASM_MOV_IMM_TO_REG(emit->as, arg_val, arg_reg);
-    ASM_CALL_IND(emit->as, mp_fun_table[fun_kind], fun_kind);
+    emit_native_call_ind(emit, fun_kind);
 }
 
-// the first arg is stored in the code aligned on a mp_uint_t boundary
-STATIC void emit_call_with_imm_arg_aligned(emit_t *emit, mp_fun_kind_t fun_kind, mp_int_t arg_val, int arg_reg) {
+STATIC void emit_call_with_qstr_arg(emit_t *emit, mp_fun_kind_t fun_kind, qstr qst, int arg_reg) {
     need_reg_all(emit);
-    ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, arg_val, arg_reg);
-    ASM_CALL_IND(emit->as, mp_fun_table[fun_kind], fun_kind);
+    emit_native_mov_reg_qstr(emit, arg_reg, qst);
+    emit_native_call_ind(emit, fun_kind);
 }
 
 STATIC void emit_call_with_2_imm_args(emit_t *emit, mp_fun_kind_t fun_kind, mp_int_t arg_val1, int arg_reg1, mp_int_t arg_val2, int arg_reg2) {
     need_reg_all(emit);
     ASM_MOV_IMM_TO_REG(emit->as, arg_val1, arg_reg1);
     ASM_MOV_IMM_TO_REG(emit->as, arg_val2, arg_reg2);
-    ASM_CALL_IND(emit->as, mp_fun_table[fun_kind], fun_kind);
-}
-
-// the first arg is stored in the code aligned on a mp_uint_t boundary
-STATIC void emit_call_with_3_imm_args_and_first_aligned(emit_t *emit, mp_fun_kind_t fun_kind, mp_int_t arg_val1, int arg_reg1, mp_int_t arg_val2, int arg_reg2, mp_int_t arg_val3, int arg_reg3) {
-    need_reg_all(emit);
-    ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, arg_val1, arg_reg1);
-    ASM_MOV_IMM_TO_REG(emit->as, arg_val2, arg_reg2);
-    ASM_MOV_IMM_TO_REG(emit->as, arg_val3, arg_reg3);
-    ASM_CALL_IND(emit->as, mp_fun_table[fun_kind], fun_kind);
+    emit_native_call_ind(emit, fun_kind);
 }
 
 // vtype of all n_pop objects is VTYPE_PYOBJ
@@ -850,13 +1006,13 @@ STATIC void emit_get_stack_pointer_to_reg_for_pop(emit_t *emit, mp_uint_t reg_de
             si->kind = STACK_VALUE;
             switch (si->vtype) {
                 case VTYPE_PYOBJ:
-                    ASM_MOV_IMM_TO_LOCAL_USING(emit->as, si->data.u_imm, emit->stack_start + emit->stack_size - 1 - i, reg_dest);
+                    emit_native_mov_local_obj(emit, emit->stack_start + emit->stack_size - 1 - i, (mp_obj_t)si->data.u_imm, reg_dest);
                     break;
                 case VTYPE_BOOL:
                     if (si->data.u_imm == 0) {
-                        ASM_MOV_IMM_TO_LOCAL_USING(emit->as, (mp_uint_t)mp_const_false, emit->stack_start + emit->stack_size - 1 - i, reg_dest);
+                        emit_native_mov_local_obj(emit, emit->stack_start + emit->stack_size - 1 - i, mp_const_false, reg_dest);
                     } else {
-                        ASM_MOV_IMM_TO_LOCAL_USING(emit->as, (mp_uint_t)mp_const_true, emit->stack_start + emit->stack_size - 1 - i, reg_dest);
+                        emit_native_mov_local_obj(emit, emit->stack_start + emit->stack_size - 1 - i, mp_const_true, reg_dest);
                     }
                     si->vtype = VTYPE_PYOBJ;
                     break;
@@ -923,7 +1079,7 @@ STATIC void emit_native_import_name(emit_t *emit, qstr qst) {
         stack_info_t *top = peek_stack(emit, 0);
         if (top->vtype == VTYPE_PTR_NONE) {
             emit_pre_pop_discard(emit);
-            ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)mp_const_none, REG_ARG_2);
+            emit_native_mov_reg_obj(emit, REG_ARG_2, mp_const_none);
         } else {
             vtype_kind_t vtype_fromlist;
             emit_pre_pop_reg(emit, &vtype_fromlist, REG_ARG_2);
@@ -944,7 +1100,7 @@ STATIC void emit_native_import_name(emit_t *emit, qstr qst) {
         assert(vtype_level == VTYPE_PYOBJ);
     }
 
-    emit_call_with_imm_arg(emit, MP_F_IMPORT_NAME, qst, REG_ARG_1); // arg1 = import name
+    emit_call_with_qstr_arg(emit, MP_F_IMPORT_NAME, qst, REG_ARG_1); // arg1 = import name
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
@@ -954,7 +1110,7 @@ STATIC void emit_native_import_from(emit_t *emit, qstr qst) {
     vtype_kind_t vtype_module;
     emit_access_stack(emit, 1, &vtype_module, REG_ARG_1); // arg1 = module
     assert(vtype_module == VTYPE_PYOBJ);
-    emit_call_with_imm_arg(emit, MP_F_IMPORT_FROM, qst, REG_ARG_2); // arg2 = import name
+    emit_call_with_qstr_arg(emit, MP_F_IMPORT_FROM, qst, REG_ARG_2); // arg2 = import name
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
@@ -1025,7 +1181,12 @@ STATIC void emit_native_load_const_str(emit_t *emit, qstr qst) {
 STATIC void emit_native_load_const_obj(emit_t *emit, mp_obj_t obj) {
     emit_native_pre(emit);
     need_reg_single(emit, REG_RET, 0);
-    ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, (mp_uint_t)obj, REG_RET);
+    size_t loc = ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, (mp_uint_t)obj, REG_RET);
+    #if MICROPY_PERSISTENT_CODE_SAVE
+    emit_native_reloc(emit, loc, MP_NATIVE_RELOC_OBJ, (mp_uint_t)obj);
+    #else
+    (void)loc;
+    #endif
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
@@ -1073,7 +1234,7 @@ STATIC void emit_native_load_deref(emit_t *emit, qstr qst, mp_uint_t local_num)
 STATIC void emit_native_load_name(emit_t *emit, qstr qst) {
     DEBUG_printf("load_name(%s)\n", qstr_str(qst));
     emit_native_pre(emit);
-    emit_call_with_imm_arg(emit, MP_F_LOAD_NAME, qst, REG_ARG_1);
+    emit_call_with_qstr_arg(emit, MP_F_LOAD_NAME, qst, REG_ARG_1);
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
@@ -1094,7 +1255,7 @@ STATIC void emit_native_load_global(emit_t *emit, qstr qst) {
     } else if (emit->do_viper_types && qst == MP_QSTR_ptr32) {
         emit_post_push_imm(emit, VTYPE_BUILTIN_CAST, VTYPE_PTR32);
     } else {
-        emit_call_with_imm_arg(emit, MP_F_LOAD_GLOBAL, qst, REG_ARG_1);
+        emit_call_with_qstr_arg(emit, MP_F_LOAD_GLOBAL, qst, REG_ARG_1);
         emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
     }
 }
@@ -1107,7 +1268,7 @@ STATIC void emit_native_load_attr(emit_t *emit, qstr qst) {
     vtype_kind_t vtype_base;
     emit_pre_pop_reg(emit, &vtype_base, REG_ARG_1); // arg1 = base
     assert(vtype_base == VTYPE_PYOBJ);
-    emit_call_with_imm_arg(emit, MP_F_LOAD_ATTR, qst, REG_ARG_2); // arg2 = attribute name
+    emit_call_with_qstr_arg(emit, MP_F_LOAD_ATTR, qst, REG_ARG_2); // arg2 = attribute name
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
@@ -1116,7 +1277,7 @@ STATIC void emit_native_load_method(emit_t *emit, qstr qst) {
     emit_pre_pop_reg(emit, &vtype_base, REG_ARG_1); // arg1 = base
     assert(vtype_base == VTYPE_PYOBJ);
     emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_3, 2); // arg3 = dest ptr
-    emit_call_with_imm_arg(emit, MP_F_LOAD_METHOD, qst, REG_ARG_2); // arg2 = method name
+    emit_call_with_qstr_arg(emit, MP_F_LOAD_METHOD, qst, REG_ARG_2); // arg2 = method name
 }
 
 STATIC void emit_native_load_build_class(emit_t *emit) {
@@ -1309,7 +1470,7 @@ STATIC void emit_native_store_name(emit_t *emit, qstr qst) {
     vtype_kind_t vtype;
     emit_pre_pop_reg(emit, &vtype, REG_ARG_2);
     assert(vtype == VTYPE_PYOBJ);
-    emit_call_with_imm_arg(emit, MP_F_STORE_NAME, qst, REG_ARG_1); // arg1 = name
+    emit_call_with_qstr_arg(emit, MP_F_STORE_NAME, qst, REG_ARG_1); // arg1 = name
     emit_post(emit);
 }
 
@@ -1322,7 +1483,7 @@ STATIC void emit_native_store_global(emit_t *emit, qstr qst) {
         emit_call_with_imm_arg(emit, MP_F_CONVERT_NATIVE_TO_OBJ, vtype, REG_ARG_2); // arg2 = type
         ASM_MOV_REG_REG(emit->as, REG_ARG_2, REG_RET);
     }
-    emit_call_with_imm_arg(emit, MP_F_STORE_GLOBAL, qst, REG_ARG_1); // arg1 = name
+    emit_call_with_qstr_arg(emit, MP_F_STORE_GLOBAL, qst, REG_ARG_1); // arg1 = name
     emit_post(emit);
 }
 
@@ -1331,7 +1492,7 @@ STATIC void emit_native_store_attr(emit_t *emit, qstr qst) {
     emit_pre_pop_reg_reg(emit, &vtype_base, REG_ARG_1, &vtype_val, REG_ARG_3); // arg1 = base, arg3 = value
     assert(vtype_base == VTYPE_PYOBJ);
     assert(vtype_val == VTYPE_PYOBJ);
-    emit_call_with_imm_arg(emit, MP_F_STORE_ATTR, qst, REG_ARG_2); // arg2 = attribute name
+    emit_call_with_qstr_arg(emit, MP_F_STORE_ATTR, qst, REG_ARG_2); // arg2 = attribute name
     emit_post(emit);
 }
 
@@ -1532,13 +1693,13 @@ STATIC void emit_native_delete_deref(emit_t *emit, qstr qst, mp_uint_t local_num
 
 STATIC void emit_native_delete_name(emit_t *emit, qstr qst) {
     emit_native_pre(emit);
-    emit_call_with_imm_arg(emit, MP_F_DELETE_NAME, qst, REG_ARG_1);
+    emit_call_with_qstr_arg(emit, MP_F_DELETE_NAME, qst, REG_ARG_1);
     emit_post(emit);
 }
 
 STATIC void emit_native_delete_global(emit_t *emit, qstr qst) {
     emit_native_pre(emit);
-    emit_call_with_imm_arg(emit, MP_F_DELETE_GLOBAL, qst, REG_ARG_1);
+    emit_call_with_qstr_arg(emit, MP_F_DELETE_GLOBAL, qst, REG_ARG_1);
     emit_post(emit);
 }
 
@@ -1546,7 +1707,10 @@ STATIC void emit_native_delete_attr(emit_t *emit, qstr qst) {
     vtype_kind_t vtype_base;
     emit_pre_pop_reg(emit, &vtype_base, REG_ARG_1); // arg1 = base
     assert(vtype_base == VTYPE_PYOBJ);
-    emit_call_with_2_imm_args(emit, MP_F_STORE_ATTR, qst, REG_ARG_2, (mp_uint_t)MP_OBJ_NULL, REG_ARG_3); // arg2 = attribute name, arg3 = value (null for delete)
+    need_reg_all(emit);
+    emit_native_mov_reg_qstr(emit, REG_ARG_2, qst); // arg2 = attribute name
+    ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)MP_OBJ_NULL, REG_ARG_3); // arg3 = value (null for delete)
+    emit_native_call_ind(emit, MP_F_STORE_ATTR);
     emit_post(emit);
 }
 
@@ -1670,7 +1834,7 @@ STATIC void emit_native_setup_with(emit_t *emit, mp_uint_t label) {
     emit_access_stack(emit, 1, &vtype, REG_ARG_1); // arg1 = ctx_mgr
     assert(vtype == VTYPE_PYOBJ);
     emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_3, 2); // arg3 = dest ptr
-    emit_call_with_imm_arg(emit, MP_F_LOAD_METHOD, MP_QSTR___exit__, REG_ARG_2);
+    emit_call_with_qstr_arg(emit, MP_F_LOAD_METHOD, MP_QSTR___exit__, REG_ARG_2);
     // stack: (..., ctx_mgr, __exit__, self)
 
     emit_pre_pop_reg(emit, &vtype, REG_ARG_3); // self
@@ -1683,7 +1847,7 @@ STATIC void emit_native_setup_with(emit_t *emit, mp_uint_t label) {
 
     // get __enter__ method
     emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_3, 2); // arg3 = dest ptr
-    emit_call_with_imm_arg(emit, MP_F_LOAD_METHOD, MP_QSTR___enter__, REG_ARG_2); // arg2 = method name
+    emit_call_with_qstr_arg(emit, MP_F_LOAD_METHOD, MP_QSTR___enter__, REG_ARG_2); // arg2 = method name
     // stack: (..., __exit__, self, __enter__, self)
 
     // call __enter__ method
@@ -1694,11 +1858,11 @@ STATIC void emit_native_setup_with(emit_t *emit, mp_uint_t label) {
 
     // need to commit stack because we may jump elsewhere
     need_stack_settled(emit);
-    emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_1, sizeof(nlr_buf_t) / sizeof(mp_uint_t)); // arg1 = pointer to nlr buf
+    emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_1, NLR_BUF_WORDS); // arg1 = pointer to nlr buf
     emit_call(emit, MP_F_NLR_PUSH);
     ASM_JUMP_IF_REG_NONZERO(emit->as, REG_RET, label);
 
-    emit_access_stack(emit, sizeof(nlr_buf_t) / sizeof(mp_uint_t) + 1, &vtype, REG_RET); // access return value of __enter__
+    emit_access_stack(emit, NLR_BUF_WORDS + 1, &vtype, REG_RET); // access return value of __enter__
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET); // push return value of __enter__
     // stack: (..., __exit__, self, as_value, nlr_buf, as_value)
 }
@@ -1709,7 +1873,7 @@ STATIC void emit_native_with_cleanup(emit_t *emit, mp_uint_t label) {
     // stack: (..., __exit__, self, as_value, nlr_buf)
     emit_native_pre(emit);
     emit_call(emit, MP_F_NLR_POP);
-    adjust_stack(emit, -(mp_int_t)(sizeof(nlr_buf_t) / sizeof(mp_uint_t)) - 1);
+    adjust_stack(emit, -(mp_int_t)(NLR_BUF_WORDS) - 1);
     // stack: (..., __exit__, self)
 
     // call __exit__
@@ -1726,6 +1890,7 @@ STATIC void emit_native_with_cleanup(emit_t *emit, mp_uint_t label) {
 
     // nlr_catch
     emit_native_label_assign(emit, label);
+    emit_restore_pystack(emit);
 
     // adjust stack counter for: __exit__, self, as_value
     adjust_stack(emit, 3);
@@ -1776,7 +1941,7 @@ STATIC void emit_native_setup_except(emit_t *emit, mp_uint_t label) {
     emit_native_pre(emit);
     // need to commit stack because we may jump elsewhere
     need_stack_settled(emit);
-    emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_1, sizeof(nlr_buf_t) / sizeof(mp_uint_t)); // arg1 = pointer to nlr buf
+    emit_get_stack_pointer_to_reg_for_push(emit, REG_ARG_1, NLR_BUF_WORDS); // arg1 = pointer to nlr buf
     emit_call(emit, MP_F_NLR_PUSH);
     ASM_JUMP_IF_REG_NONZERO(emit->as, REG_RET, label);
     emit_post(emit);
@@ -1792,6 +1957,8 @@ STATIC void emit_native_end_finally(emit_t *emit) {
     //   if exc == None: pass
     //   else: raise exc
     // the check if exc is None is done in the MP_F_NATIVE_RAISE stub
+    // a finally block may be entered by an exception, so restore the pystack
+    emit_restore_pystack(emit);
     vtype_kind_t vtype;
     emit_pre_pop_reg(emit, &vtype, REG_ARG_1); // get nlr_buf.ret_val
     emit_pre_pop_discard(emit); // discard nlr_buf.prev
@@ -1831,7 +1998,7 @@ STATIC void emit_native_for_iter_end(emit_t *emit) {
 STATIC void emit_native_pop_block(emit_t *emit) {
     emit_native_pre(emit);
     emit_call(emit, MP_F_NLR_POP);
-    adjust_stack(emit, -(mp_int_t)(sizeof(nlr_buf_t) / sizeof(mp_uint_t)) + 1);
+    adjust_stack(emit, -(mp_int_t)(NLR_BUF_WORDS) + 1);
     emit_post(emit);
 }
 
@@ -1840,7 +2007,7 @@ STATIC void emit_native_pop_except(emit_t *emit) {
     /*
     emit_native_pre(emit);
     emit_call(emit, MP_F_NLR_POP);
-    adjust_stack(emit, -(mp_int_t)(sizeof(nlr_buf_t) / sizeof(mp_uint_t)));
+    adjust_stack(emit, -(mp_int_t)(NLR_BUF_WORDS));
     emit_post(emit);
     */
 }
@@ -2070,7 +2237,9 @@ STATIC void emit_native_build_slice(emit_t *emit, mp_uint_t n_args) {
         emit_pre_pop_reg_reg(emit, &vtype_stop, REG_ARG_2, &vtype_start, REG_ARG_1); // arg1 = start, arg2 = stop
         assert(vtype_start == VTYPE_PYOBJ);
         assert(vtype_stop == VTYPE_PYOBJ);
-        emit_call_with_imm_arg(emit, MP_F_NEW_SLICE, (mp_uint_t)mp_const_none, REG_ARG_3); // arg3 = step
+        need_reg_all(emit);
+        emit_native_mov_reg_obj(emit, REG_ARG_3, mp_const_none); // arg3 = step
+        emit_native_call_ind(emit, MP_F_NEW_SLICE);
         emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
     } else {
         assert(n_args == 3);
@@ -2136,14 +2305,18 @@ STATIC void emit_native_make_function(emit_t *emit, scope_t *scope, mp_uint_t n_
     // call runtime, with type info for args, or don't support dict/default params, or only support Python objects for them
     emit_native_pre(emit);
     if (n_pos_defaults == 0 && n_kw_defaults == 0) {
-        emit_call_with_3_imm_args_and_first_aligned(emit, MP_F_MAKE_FUNCTION_FROM_RAW_CODE, (mp_uint_t)scope->raw_code, REG_ARG_1, (mp_uint_t)MP_OBJ_NULL, REG_ARG_2, (mp_uint_t)MP_OBJ_NULL, REG_ARG_3);
+        need_reg_all(emit);
+        ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)MP_OBJ_NULL, REG_ARG_2);
+        ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)MP_OBJ_NULL, REG_ARG_3);
     } else {
         vtype_kind_t vtype_def_tuple, vtype_def_dict;
         emit_pre_pop_reg_reg(emit, &vtype_def_dict, REG_ARG_3, &vtype_def_tuple, REG_ARG_2);
         assert(vtype_def_tuple == VTYPE_PYOBJ);
         assert(vtype_def_dict == VTYPE_PYOBJ);
-        emit_call_with_imm_arg_aligned(emit, MP_F_MAKE_FUNCTION_FROM_RAW_CODE, (mp_uint_t)scope->raw_code, REG_ARG_1);
+        need_reg_all(emit);
     }
+    emit_native_mov_reg_raw_code(emit, REG_ARG_1, scope->raw_code);
+    emit_native_call_ind(emit, MP_F_MAKE_FUNCTION_FROM_RAW_CODE);
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
@@ -2156,8 +2329,8 @@ STATIC void emit_native_make_closure(emit_t *emit, scope_t *scope, mp_uint_t n_c
         emit_get_stack_pointer_to_reg_for_pop(emit, REG_ARG_3, n_closed_over + 2);
         ASM_MOV_IMM_TO_REG(emit->as, 0x100 | n_closed_over, REG_ARG_2);
     }
-    ASM_MOV_ALIGNED_IMM_TO_REG(emit->as, (mp_uint_t)scope->raw_code, REG_ARG_1);
-    ASM_CALL_IND(emit->as, mp_fun_table[MP_F_MAKE_CLOSURE_FROM_RAW_CODE], MP_F_MAKE_CLOSURE_FROM_RAW_CODE);
+    emit_native_mov_reg_raw_code(emit, REG_ARG_1, scope->raw_code);
+    emit_native_call_ind(emit, MP_F_MAKE_CLOSURE_FROM_RAW_CODE);
     emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
 }
 
@@ -2234,7 +2407,7 @@ STATIC void emit_native_return_value(emit_t *emit) {
         if (peek_vtype(emit, 0) == VTYPE_PTR_NONE) {
             emit_pre_pop_discard(emit);
             if (emit->return_vtype == VTYPE_PYOBJ) {
-                ASM_MOV_IMM_TO_REG(emit->as, (mp_uint_t)mp_const_none, REG_RET);
+                emit_native_mov_reg_obj(emit, REG_RET, mp_const_none);
             } else {
                 ASM_MOV_IMM_TO_REG(emit->as, 0, REG_RET);
             }
@@ -2283,6 +2456,7 @@ STATIC void emit_native_start_except_handler(emit_t *emit) {
     // This instruction follows an nlr_pop, so the stack counter is back to zero, when really
     // it should be up by a whole nlr_buf_t.  We then want to pop the nlr_buf_t here, but save
     // the first 2 elements, so we can get the thrown value.
+    emit_restore_pystack(emit);
     adjust_stack(emit, 1);
     vtype_kind_t vtype_nlr;
     emit_pre_pop_reg(emit, &vtype_nlr, REG_ARG_1); // get the thrown value
@@ -2356,6 +2530,7 @@ const emit_method_table_t EXPORT_FUN(method_table) = {
     emit_native_get_iter,
     emit_native_for_iter,
     emit_native_for_iter_end,
+    NULL, // for_range is only used for bytecode
     emit_native_pop_block,
     emit_native_pop_except,
     emit_native_unary_op,
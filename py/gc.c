@@ -32,6 +32,11 @@
 #include "py/gc.h"
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/objlist.h"
+#include "py/objarray.h"
+#include "py/binary.h"
+#include "py/bc.h"
+#include "py/builtin.h"
 
 #if MICROPY_ENABLE_GC
 
@@ -79,6 +84,29 @@
 #define ATB_HEAD_TO_MARK(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
 #define ATB_MARK_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
 
+#if MICROPY_GC_INCREMENTAL_SWEEP
+// Blocks from gc_sweep_block onwards have not been swept yet since the last
+// collection, so live chains there still have a marked head.
+#define ATB_IS_HEAD(block) (ATB_GET_KIND(block) == AT_HEAD || (ATB_GET_KIND(block) == AT_MARK && (block) >= MP_STATE_MEM(gc_sweep_block)))
+#else
+#define ATB_IS_HEAD(block) (ATB_GET_KIND(block) == AT_HEAD)
+#endif
+
+// The ATB can also be processed a machine word at a time, testing the entries
+// of BLOCKS_PER_ATB_WORD blocks together.  The masks below have bit 2*n set
+// if block n within the word is of the given kind (the low bit of each 2-bit
+// entry), so they can be compared against 0 regardless of byte order.
+#define BLOCKS_PER_ATB_WORD (BLOCKS_PER_ATB * sizeof(mp_uint_t))
+#define ATB_WORD_LOW_BITS ((mp_uint_t)-1 / 3)
+#define ATB_WORD_FREE(w) (~((w) | ((w) >> 1)) & ATB_WORD_LOW_BITS)
+#define ATB_WORD_HEADS(w) ((w) & ~((w) >> 1) & ATB_WORD_LOW_BITS)
+#define ATB_WORD_MARKS(w) ((w) & ((w) >> 1) & ATB_WORD_LOW_BITS)
+#define ATB_WORD_MARKS_TO_HEADS(w) ((w) & ~(ATB_WORD_MARKS(w) << 1))
+#define ATB_WORD_PTR(atb) ((mp_uint_t*)(void*)&MP_STATE_MEM(gc_alloc_table_start)[atb])
+// true if the ATB at index atb starts an aligned word that lies within the table
+#define ATB_WORD_AT(atb) ((((uintptr_t)ATB_WORD_PTR(atb) & (sizeof(mp_uint_t) - 1)) == 0) \
+    && (atb) + sizeof(mp_uint_t) <= MP_STATE_MEM(gc_alloc_table_byte_len))
+
 #define BLOCK_FROM_PTR(ptr) (((byte*)(ptr) - MP_STATE_MEM(gc_pool_start)) / BYTES_PER_BLOCK)
 #define PTR_FROM_BLOCK(block) (((block) * BYTES_PER_BLOCK + (uintptr_t)MP_STATE_MEM(gc_pool_start)))
 #define ATB_FROM_BLOCK(bl) ((bl) / BLOCKS_PER_ATB)
@@ -111,6 +139,49 @@ void __attribute__ ((noinline)) gc_log_change(uint32_t start_block, uint32_t len
 }
 #endif
 
+// Free-run indices
+//
+// MP_STATE_MEM(gc_first_free_atb_index)[n] is an ATB index such that no free
+// run of n + 1 or more blocks contains a block before it.  A search for such a
+// run can therefore start there and still find the first one in the heap.
+// The last index is shared by all runs that are at least that long.
+//
+// The indices only move forward when allocating (we know we took the first
+// suitable run) and only move back when blocks are freed outside of a sweep.
+// The sweep recomputes them exactly.
+
+#define FREE_ATB_INDEX(n_blocks) (MP_STATE_MEM(gc_first_free_atb_index)[((n_blocks) < MICROPY_ATB_INDICES ? (n_blocks) : MICROPY_ATB_INDICES) - 1])
+
+STATIC void gc_reset_free_atb_indices(size_t atb_index) {
+    for (size_t n = 0; n < MICROPY_ATB_INDICES; n++) {
+        MP_STATE_MEM(gc_first_free_atb_index)[n] = atb_index;
+    }
+}
+
+// Called when a run of blocks starting at "block" has just been freed.  The
+// new free run may extend back before "block", but by less than n + 1 blocks
+// if it is a run that index n did not already account for.
+STATIC void gc_update_free_atb_indices(size_t block) {
+    for (size_t n = 0; n < MICROPY_ATB_INDICES; n++) {
+        size_t atb_index = (block > n ? block - n : 0) / BLOCKS_PER_ATB;
+        if (atb_index < MP_STATE_MEM(gc_first_free_atb_index)[n]) {
+            MP_STATE_MEM(gc_first_free_atb_index)[n] = atb_index;
+        }
+    }
+}
+
+#if MICROPY_GC_LONG_LIVED
+// MP_STATE_MEM(gc_long_lived_atb_index) is one past the last ATB that may
+// contain a free block, where the top-down search for long-lived blocks
+// starts.  It is moved down when a single long-lived block is allocated and
+// must be moved up past any block that is freed.
+STATIC void gc_update_long_lived_atb_index(size_t block) {
+    if (block / BLOCKS_PER_ATB + 1 > MP_STATE_MEM(gc_long_lived_atb_index)) {
+        MP_STATE_MEM(gc_long_lived_atb_index) = block / BLOCKS_PER_ATB + 1;
+    }
+}
+#endif
+
 // TODO waste less memory; currently requires that all entries in alloc_table have a corresponding block in pool
 void gc_init(void *start, void *end) {
     // align end pointer on block boundary
@@ -152,8 +223,18 @@ void gc_init(void *start, void *end) {
     memset(MP_STATE_MEM(gc_finaliser_table_start), 0, gc_finaliser_table_byte_len);
 #endif
 
-    // set last free ATB index to start of heap
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    // set all free-run indices to start of heap
+    gc_reset_free_atb_indices(0);
+
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // nothing to sweep
+    MP_STATE_MEM(gc_sweep_block) = gc_pool_block_len;
+    #endif
+
+    #if MICROPY_GC_LONG_LIVED
+    // search for long-lived blocks from the end of the heap
+    MP_STATE_MEM(gc_long_lived_atb_index) = MP_STATE_MEM(gc_alloc_table_byte_len);
+    #endif
 
     // unlock the GC
     MP_STATE_MEM(gc_lock_depth) = 0;
@@ -171,6 +252,10 @@ void gc_init(void *start, void *end) {
     mp_thread_mutex_init(&MP_STATE_MEM(gc_mutex));
     #endif
 
+    #if MICROPY_GC_PARALLEL_MARK
+    mp_thread_mutex_init(&MP_STATE_MEM(gc_mark_mutex));
+    #endif
+
     DEBUG_printf("GC layout:\n");
     DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_alloc_table_start), MP_STATE_MEM(gc_alloc_table_byte_len), MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
 #if MICROPY_ENABLE_FINALISER
@@ -247,6 +332,12 @@ STATIC void gc_deal_with_stack_overflow(void) {
 
         // scan entire memory looking for blocks which have been marked but not their children
         for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
+            // skip whole words of the ATB with no marked blocks
+            if (block % BLOCKS_PER_ATB == 0 && ATB_WORD_AT(block / BLOCKS_PER_ATB)
+                && ATB_WORD_MARKS(*ATB_WORD_PTR(block / BLOCKS_PER_ATB)) == 0) {
+                block += BLOCKS_PER_ATB_WORD - 1;
+                continue;
+            }
             // trace (again) if mark bit set
             if (ATB_GET_KIND(block) == AT_MARK) {
                 *MP_STATE_MEM(gc_sp)++ = block;
@@ -256,13 +347,200 @@ STATIC void gc_deal_with_stack_overflow(void) {
     }
 }
 
-STATIC void gc_sweep(void) {
-    #if MICROPY_PY_GC_COLLECT_RETVAL
-    MP_STATE_MEM(gc_collected) = 0;
-    #endif
-    // free unmarked heads and their tails
+#if MICROPY_GC_PARALLEL_MARK
+
+#if !MICROPY_PY_THREAD
+#error MICROPY_GC_PARALLEL_MARK requires MICROPY_PY_THREAD
+#endif
+
+// Each marker keeps its own stack of blocks to trace, and hands the top
+// GC_MARK_SHARE entries of it to the shared gc_stack when another marker has
+// run out of work.  Idle markers take their work from gc_stack.
+#define GC_MARK_SHARE (16)
+
+#define GC_MARK_PARALLEL() (MP_STATE_MEM(gc_mark_threads) > 1)
+
+// Atomically turn a head into a marked head, true only for the marker that
+// made the change (and so must trace the block).
+#define ATB_HEAD_TO_MARK_ATOMIC(block) \
+    (((__atomic_fetch_or(&MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB], \
+        (byte)(AT_MARK << BLOCK_SHIFT(block)), __ATOMIC_RELAXED) >> BLOCK_SHIFT(block)) & AT_MARK) == AT_HEAD)
+
+// Take up to GC_MARK_SHARE blocks from the shared gc_stack onto the given
+// stack, returning the new stack pointer.  Must be called with the mark mutex.
+STATIC size_t *gc_mark_take(size_t *sp) {
+    for (size_t i = GC_MARK_SHARE; i > 0 && MP_STATE_MEM(gc_sp) > MP_STATE_MEM(gc_stack); i--) {
+        *sp++ = *--MP_STATE_MEM(gc_sp);
+    }
+    return sp;
+}
+
+// Trace all blocks on the given stack, and all blocks reachable from them,
+// returning the (empty) stack pointer.
+STATIC size_t *gc_mark_drain(size_t *stack, size_t *sp) {
+    while (sp > stack) {
+        size_t block = *--sp;
+
+        size_t n_blocks = 0;
+        do {
+            n_blocks += 1;
+        } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+
+        void **ptrs = (void**)PTR_FROM_BLOCK(block);
+        for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
+            void *ptr = *ptrs;
+            if (VERIFY_PTR(ptr)) {
+                size_t b = BLOCK_FROM_PTR(ptr);
+                if (ATB_GET_KIND(b) == AT_HEAD && ATB_HEAD_TO_MARK_ATOMIC(b)) {
+                    if (sp < &stack[MICROPY_GC_PARALLEL_MARK_STACK_SIZE]) {
+                        *sp++ = b;
+                    } else {
+                        MP_STATE_MEM(gc_stack_overflow) = 1;
+                    }
+                }
+            }
+        }
+
+        // give some of our work away if another marker is idle and there is
+        // nothing left for it on the shared stack
+        if (sp - stack > GC_MARK_SHARE
+            && __atomic_load_n(&MP_STATE_MEM(gc_mark_busy), __ATOMIC_RELAXED) < MP_STATE_MEM(gc_mark_threads)
+            && __atomic_load_n(&MP_STATE_MEM(gc_sp), __ATOMIC_RELAXED) == MP_STATE_MEM(gc_stack)) {
+            mp_thread_mutex_lock(&MP_STATE_MEM(gc_mark_mutex), 1);
+            for (size_t i = GC_MARK_SHARE; i > 0
+                && MP_STATE_MEM(gc_sp) < &MP_STATE_MEM(gc_stack)[MICROPY_ALLOC_GC_STACK_SIZE]; i--) {
+                *MP_STATE_MEM(gc_sp)++ = *--sp;
+            }
+            mp_thread_mutex_unlock(&MP_STATE_MEM(gc_mark_mutex));
+        }
+    }
+    return sp;
+}
+
+STATIC void gc_mark_worker(size_t id) {
+    size_t *stack = MP_STATE_MEM(gc_mark_stack)[id];
+    size_t *sp = stack;
+
+    if (MP_STATE_MEM(gc_mark_rescan)) {
+        // retrace the marked blocks in this marker's slice of the heap
+        size_t n_words = (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB + BLOCKS_PER_ATB_WORD - 1) / BLOCKS_PER_ATB_WORD;
+        size_t block = n_words * id / MP_STATE_MEM(gc_mark_threads) * BLOCKS_PER_ATB_WORD;
+        size_t end = n_words * (id + 1) / MP_STATE_MEM(gc_mark_threads) * BLOCKS_PER_ATB_WORD;
+        if (end > MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
+            end = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+        }
+        for (; block < end; block++) {
+            if (block % BLOCKS_PER_ATB == 0 && ATB_WORD_AT(block / BLOCKS_PER_ATB)
+                && ATB_WORD_MARKS(*ATB_WORD_PTR(block / BLOCKS_PER_ATB)) == 0) {
+                block += BLOCKS_PER_ATB_WORD - 1;
+                continue;
+            }
+            if (ATB_GET_KIND(block) == AT_MARK) {
+                *sp++ = block;
+                sp = gc_mark_drain(stack, sp);
+            }
+        }
+    }
+
+    for (;;) {
+        sp = gc_mark_drain(stack, sp);
+
+        // out of work, so try the shared stack
+        mp_thread_mutex_lock(&MP_STATE_MEM(gc_mark_mutex), 1);
+        sp = gc_mark_take(sp);
+        if (sp == stack) {
+            MP_STATE_MEM(gc_mark_busy) -= 1;
+        }
+        mp_thread_mutex_unlock(&MP_STATE_MEM(gc_mark_mutex));
+        if (sp > stack) {
+            continue;
+        }
+
+        // Wait for another marker to share its work.  Only busy markers add
+        // to the shared stack, and a marker only becomes idle when the shared
+        // stack is empty, so once no marker is busy the marking is complete.
+        for (;;) {
+            if (__atomic_load_n(&MP_STATE_MEM(gc_sp), __ATOMIC_ACQUIRE) > MP_STATE_MEM(gc_stack)) {
+                mp_thread_mutex_lock(&MP_STATE_MEM(gc_mark_mutex), 1);
+                sp = gc_mark_take(sp);
+                if (sp > stack) {
+                    MP_STATE_MEM(gc_mark_busy) += 1;
+                }
+                mp_thread_mutex_unlock(&MP_STATE_MEM(gc_mark_mutex));
+                if (sp > stack) {
+                    break;
+                }
+            } else if (__atomic_load_n(&MP_STATE_MEM(gc_mark_busy), __ATOMIC_ACQUIRE) == 0) {
+                return;
+            }
+            mp_thread_gc_parallel_idle();
+        }
+    }
+}
+
+// Trace from the blocks that the root scan left on gc_stack using all the
+// marking threads, repeating with a rescan of the heap while any of their
+// stacks overflow.
+STATIC void gc_mark_parallel(void) {
+    do {
+        MP_STATE_MEM(gc_mark_rescan) = MP_STATE_MEM(gc_stack_overflow);
+        MP_STATE_MEM(gc_stack_overflow) = 0;
+        MP_STATE_MEM(gc_mark_busy) = MP_STATE_MEM(gc_mark_threads);
+        mp_thread_gc_parallel(gc_mark_worker, MP_STATE_MEM(gc_mark_threads));
+    } while (MP_STATE_MEM(gc_stack_overflow));
+}
+
+#endif // MICROPY_GC_PARALLEL_MARK
+
+// Sweep the heap from the given block: free unmarked heads and their tails,
+// and turn marked heads back into heads.  The sweep stops at the first block
+// that is not a tail once it reaches limit or has seen a run of n_free free
+// blocks, so it always ends between chains, and returns that block.  It also
+// tracks the first free run of each length, so that a sweep of the whole heap
+// can set the free-run indices exactly.
+STATIC size_t gc_sweep(size_t block, size_t limit, size_t n_free) {
+    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t start_block = block;
     int free_tail = 0;
-    for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
+    size_t run_start = 0;
+    size_t run_len = 0;
+    size_t first_free_atb[MICROPY_ATB_INDICES];
+    size_t n_indices_found = 0;
+    for (; block < max_block; block++) {
+        if ((block >= limit || run_len >= n_free) && ATB_GET_KIND(block) != AT_TAIL) {
+            break;
+        }
+
+        // Sweep a whole word of the ATB at once if it has no unmarked heads
+        // (which may need finalising) and either only live blocks or only
+        // free blocks and tails of a dead chain.  Other words, and words not
+        // aligned in memory, are swept a block at a time.
+        if (block % BLOCKS_PER_ATB == 0 && ATB_WORD_AT(block / BLOCKS_PER_ATB)) {
+            mp_uint_t *w = ATB_WORD_PTR(block / BLOCKS_PER_ATB);
+            if (ATB_WORD_HEADS(*w) == 0) {
+                if (!free_tail && ATB_WORD_FREE(*w) == 0) {
+                    // tails of a live chain and marked heads
+                    *w = ATB_WORD_MARKS_TO_HEADS(*w);
+                    run_len = 0;
+                    block += BLOCKS_PER_ATB_WORD - 1;
+                    continue;
+                }
+                if ((free_tail || *w == 0) && ATB_WORD_MARKS(*w) == 0) {
+                    // free blocks and tails of a dead chain
+                    *w = 0;
+                    if (run_len == 0) {
+                        run_start = block;
+                    }
+                    run_len += BLOCKS_PER_ATB_WORD;
+                    while (n_indices_found < MICROPY_ATB_INDICES && n_indices_found < run_len) {
+                        first_free_atb[n_indices_found++] = run_start / BLOCKS_PER_ATB;
+                    }
+                    block += BLOCKS_PER_ATB_WORD - 1;
+                    continue;
+                }
+            }
+        }
+
         switch (ATB_GET_KIND(block)) {
             case AT_HEAD:
 #if MICROPY_ENABLE_FINALISER
@@ -307,36 +585,425 @@ STATIC void gc_sweep(void) {
                 free_tail = 0;
                 break;
         }
+
+        if (ATB_GET_KIND(block) == AT_FREE) {
+            if (run_len++ == 0) {
+                run_start = block;
+            }
+            // the first run of each length sets its index
+            while (n_indices_found < MICROPY_ATB_INDICES && n_indices_found < run_len) {
+                first_free_atb[n_indices_found++] = run_start / BLOCKS_PER_ATB;
+            }
+        } else {
+            run_len = 0;
+        }
+    }
+
+    #if MICROPY_GC_LONG_LIVED
+    MP_STATE_MEM(gc_long_lived_atb_index) = MP_STATE_MEM(gc_alloc_table_byte_len);
+    #endif
+
+    if (start_block == 0 && block == max_block) {
+        // there are no free runs of the remaining lengths
+        while (n_indices_found < MICROPY_ATB_INDICES) {
+            first_free_atb[n_indices_found++] = MP_STATE_MEM(gc_alloc_table_byte_len);
+        }
+        memcpy(MP_STATE_MEM(gc_first_free_atb_index), first_free_atb, sizeof(first_free_atb));
+    } else {
+        // only part of the heap was swept, and it may have been allocated
+        // from since the collection, so just account for the freed blocks
+        gc_update_free_atb_indices(start_block);
+    }
+
+    return block;
+}
+
+#if MICROPY_GC_INCREMENTAL_SWEEP
+// Sweep at least the next n_blocks blocks, or until a run of n_free free
+// blocks is found, if a sweep is pending.  This must be called with the GC
+// mutex held.  Finalisers run with the heap locked, as they do during a full
+// collection.
+STATIC void gc_sweep_step(size_t n_blocks, size_t n_free) {
+    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t block = MP_STATE_MEM(gc_sweep_block);
+    if (block < max_block) {
+        size_t limit = n_blocks < max_block - block ? block + n_blocks : max_block;
+        MP_STATE_MEM(gc_lock_depth)++;
+        MP_STATE_MEM(gc_sweep_block) = gc_sweep(block, limit, n_free);
+        MP_STATE_MEM(gc_lock_depth)--;
     }
 }
 
+void gc_sweep_all(void) {
+    GC_ENTER();
+    gc_sweep_step((size_t)-1, (size_t)-1);
+    GC_EXIT();
+}
+#endif
+
+#if MICROPY_GC_COMPACT
+
+// Compaction moves the buffers of lists, arrays and dicts down into free runs
+// lower in the heap, so that the free memory left behind them joins up.
+//
+// A buffer can move if its owner object is the only thing that refers to it:
+// the owner's pointer is then the one word that must be updated.  Owners are
+// recognised by their type and by the size they record for their buffer.
+// Each round of compaction is a gc_collect in which gc_collect_start picks
+// candidate buffers, the root scan and gc_collect_end pin any buffer that is
+// referred to from anywhere else (from the roots even by a pointer into its
+// middle), and gc_collect_end moves the rest.
+//
+// The candidates are kept on gc_stack, three entries each: the block of the
+// buffer, its length in blocks, and the address of the owner's pointer to it
+// with the low bit set once the buffer is pinned.
+
+#define GC_COMPACT_ENTRY_SIZE (3)
+#define GC_COMPACT_PINNED (1)
+
+// Return the number of blocks in the chain starting at the given head.
+STATIC size_t gc_chain_len(size_t block) {
+    size_t n_blocks = 0;
+    do {
+        n_blocks += 1;
+    } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+    return n_blocks;
+}
+
+// Return the first block of the first run of n_blocks free blocks that ends
+// before the block limit, or limit if there is none.
+STATIC size_t gc_compact_find(size_t n_blocks, size_t limit) {
+    size_t n_free = 0;
+    for (size_t block = FREE_ATB_INDEX(n_blocks) * BLOCKS_PER_ATB; block < limit; block++) {
+        // test a whole word of the ATB at once where possible
+        if (block % BLOCKS_PER_ATB == 0 && ATB_WORD_AT(block / BLOCKS_PER_ATB)) {
+            mp_uint_t w = *ATB_WORD_PTR(block / BLOCKS_PER_ATB);
+            if (w == 0 && n_free + BLOCKS_PER_ATB_WORD < n_blocks) {
+                n_free += BLOCKS_PER_ATB_WORD;
+                block += BLOCKS_PER_ATB_WORD - 1;
+                continue;
+            }
+            if (ATB_WORD_FREE(w) == 0) {
+                n_free = 0;
+                block += BLOCKS_PER_ATB_WORD - 1;
+                continue;
+            }
+        }
+        if (ATB_GET_KIND(block) == AT_FREE) {
+            if (++n_free == n_blocks) {
+                return block + 1 - n_blocks;
+            }
+        } else {
+            n_free = 0;
+        }
+    }
+    // there is no such run before the limit, so later (lower) searches for
+    // this length need not look there again
+    if (n_blocks <= MICROPY_ATB_INDICES && limit >= n_blocks) {
+        size_t atb_index = (limit + 1 - n_blocks) / BLOCKS_PER_ATB;
+        if (atb_index > FREE_ATB_INDEX(n_blocks)) {
+            FREE_ATB_INDEX(n_blocks) = atb_index;
+        }
+    }
+    return limit;
+}
+
+// If the object at the given head owns a buffer, return the address of its
+// pointer to the buffer and set *n_bytes to the buffer's size, else NULL.
+STATIC void **gc_compact_owner(size_t block, size_t *n_bytes) {
+    mp_obj_base_t *o = (mp_obj_base_t*)PTR_FROM_BLOCK(block);
+    size_t n_blocks = gc_chain_len(block);
+    #define OBJ_BLOCKS(t) ((sizeof(t) + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK)
+    if (o->type == &mp_type_list && n_blocks == OBJ_BLOCKS(mp_obj_list_t)) {
+        mp_obj_list_t *l = (mp_obj_list_t*)o;
+        if (l->len <= l->alloc) {
+            *n_bytes = l->alloc * sizeof(mp_obj_t);
+            return (void**)&l->items;
+        }
+    }
+    #if MICROPY_PY_BUILTINS_BYTEARRAY || MICROPY_PY_ARRAY
+    if ((0
+        #if MICROPY_PY_BUILTINS_BYTEARRAY
+        || o->type == &mp_type_bytearray
+        #endif
+        #if MICROPY_PY_ARRAY
+        || o->type == &mp_type_array
+        #endif
+        ) && n_blocks == OBJ_BLOCKS(mp_obj_array_t)) {
+        mp_obj_array_t *a = (mp_obj_array_t*)o;
+        size_t item_sz = mp_binary_get_size('@', a->typecode, NULL);
+        if (item_sz != 0) {
+            *n_bytes = (a->len + a->free) * item_sz;
+            return &a->items;
+        }
+    }
+    #endif
+    if ((o->type == &mp_type_dict
+        #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+        || o->type == &mp_type_ordereddict
+        #endif
+        ) && n_blocks == OBJ_BLOCKS(mp_obj_dict_t)) {
+        mp_map_t *map = &((mp_obj_dict_t*)o)->map;
+        if (!map->is_fixed && map->used <= map->alloc) {
+            *n_bytes = mp_map_table_bytes(map);
+            return (void**)&map->table;
+        }
+    }
+    #undef OBJ_BLOCKS
+    return NULL;
+}
+
+// Pick candidate buffers from the owners found from MP_STATE_MEM(gc_compact_block)
+// on, until gc_stack is full, sorted by block.
+STATIC void gc_compact_gather(void) {
+    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t *c = MP_STATE_MEM(gc_stack);
+    size_t *top = &MP_STATE_MEM(gc_stack)[MICROPY_ALLOC_GC_STACK_SIZE - GC_COMPACT_ENTRY_SIZE + 1];
+    size_t block = MP_STATE_MEM(gc_compact_block);
+    for (; block < max_block && c < top; block++) {
+        size_t n_bytes;
+        void **field;
+        if (ATB_GET_KIND(block) != AT_HEAD || (field = gc_compact_owner(block, &n_bytes)) == NULL) {
+            continue;
+        }
+        void *buf = *field;
+        if (!VERIFY_PTR(buf)) {
+            continue;
+        }
+        size_t buf_block = BLOCK_FROM_PTR(buf);
+        if (ATB_GET_KIND(buf_block) != AT_HEAD
+            #if MICROPY_ENABLE_FINALISER
+            || FTB_GET(buf_block)
+            #endif
+            ) {
+            continue;
+        }
+        // The buffer must be the size the owner says it is, and must not
+        // look like an owner itself, else it is not moved.
+        size_t n_blocks = gc_chain_len(buf_block);
+        size_t n_bytes_ignored;
+        if (n_blocks != (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK
+            || gc_compact_owner(buf_block, &n_bytes_ignored) != NULL) {
+            continue;
+        }
+        // only worth moving if there is room for it lower down
+        if (gc_compact_find(n_blocks, buf_block) == buf_block) {
+            continue;
+        }
+        // insert in order of block
+        size_t *p = c;
+        for (; p > MP_STATE_MEM(gc_stack) && p[-GC_COMPACT_ENTRY_SIZE] >= buf_block; p -= GC_COMPACT_ENTRY_SIZE) {
+            if (p[-GC_COMPACT_ENTRY_SIZE] == buf_block) {
+                // two owners claim the same buffer, so neither may move it
+                p[-1] |= GC_COMPACT_PINNED;
+                field = (void**)((uintptr_t)field | GC_COMPACT_PINNED);
+            }
+            memcpy(p, p - GC_COMPACT_ENTRY_SIZE, GC_COMPACT_ENTRY_SIZE * sizeof(size_t));
+        }
+        p[0] = buf_block;
+        p[1] = n_blocks;
+        p[2] = (uintptr_t)field;
+        c += GC_COMPACT_ENTRY_SIZE;
+    }
+    MP_STATE_MEM(gc_compact_block) = block;
+    MP_STATE_MEM(gc_sp) = c;
+}
+
+// Pin the candidate that the word at the given address points into, unless
+// the word is its owner's pointer to it.
+STATIC void gc_compact_pin(void **addr) {
+    void *ptr = *addr;
+    if (!(ptr >= (void*)MP_STATE_MEM(gc_pool_start) && ptr < (void*)MP_STATE_MEM(gc_pool_end))) {
+        return;
+    }
+    size_t block = BLOCK_FROM_PTR(ptr);
+    // binary search for the last candidate starting at or before the block
+    size_t lo = 0;
+    size_t hi = (MP_STATE_MEM(gc_sp) - MP_STATE_MEM(gc_stack)) / GC_COMPACT_ENTRY_SIZE;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (MP_STATE_MEM(gc_stack)[mid * GC_COMPACT_ENTRY_SIZE] <= block) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return;
+    }
+    size_t *c = &MP_STATE_MEM(gc_stack)[(lo - 1) * GC_COMPACT_ENTRY_SIZE];
+    if (block < c[0] + c[1] && (c[2] & ~(uintptr_t)GC_COMPACT_PINNED) != (uintptr_t)addr) {
+        c[2] |= GC_COMPACT_PINNED;
+    }
+}
+
+// Pin the candidates referred to from the heap, then move those that are left.
+STATIC void gc_compact_move(void) {
+    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    for (size_t block = 0; block < max_block; block++) {
+        // skip whole words of the ATB with no allocated blocks
+        if (block % BLOCKS_PER_ATB == 0 && ATB_WORD_AT(block / BLOCKS_PER_ATB)
+            && *ATB_WORD_PTR(block / BLOCKS_PER_ATB) == 0) {
+            block += BLOCKS_PER_ATB_WORD - 1;
+            continue;
+        }
+        if (ATB_GET_KIND(block) != AT_FREE) {
+            void **ptrs = (void**)PTR_FROM_BLOCK(block);
+            for (size_t i = BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
+                gc_compact_pin(ptrs);
+            }
+        }
+    }
+
+    // move the highest buffers first, to free the top of the heap
+    for (size_t *c = MP_STATE_MEM(gc_sp); c > MP_STATE_MEM(gc_stack);) {
+        c -= GC_COMPACT_ENTRY_SIZE;
+        if (c[2] & GC_COMPACT_PINNED) {
+            continue;
+        }
+        size_t from = c[0];
+        size_t n_blocks = c[1];
+        size_t to = gc_compact_find(n_blocks, from);
+        if (to == from) {
+            continue;
+        }
+        ATB_FREE_TO_HEAD(to);
+        for (size_t bl = to + 1; bl < to + n_blocks; bl++) {
+            ATB_FREE_TO_TAIL(bl);
+        }
+        memcpy((void*)PTR_FROM_BLOCK(to), (void*)PTR_FROM_BLOCK(from), n_blocks * BYTES_PER_BLOCK);
+        *(void**)c[2] = (void*)PTR_FROM_BLOCK(to);
+        for (size_t bl = from; bl < from + n_blocks; bl++) {
+            ATB_ANY_TO_FREE(bl);
+        }
+        gc_update_free_atb_indices(from);
+        #if MICROPY_GC_LONG_LIVED
+        gc_update_long_lived_atb_index(from + n_blocks - 1);
+        #endif
+        MP_STATE_MEM(gc_compacted) += n_blocks;
+    }
+    MP_STATE_MEM(gc_sp) = MP_STATE_MEM(gc_stack);
+}
+
+// Collect garbage, then move what buffers can be moved to defragment the heap.
+// Other threads must not be running Python code while this is done, because
+// they could use a buffer between it being pinned and moved (eg a readinto
+// with the GIL released), so nothing is moved while there are any and false
+// is returned.
+bool gc_compact(void) {
+    #if MICROPY_PY_THREAD
+    if (mp_thread_others_running()) {
+        return false;
+    }
+    #endif
+    gc_collect();
+    MP_STATE_MEM(gc_compacted) = 0;
+    MP_STATE_MEM(gc_compact_block) = 0;
+    while (MP_STATE_MEM(gc_compact_block) < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
+        // each round is a collection in compact mode, run by the port so that
+        // the root scan finds all pointers into the candidates
+        MP_STATE_MEM(gc_compacting) = 1;
+        gc_collect();
+    }
+    return true;
+}
+
+#endif // MICROPY_GC_COMPACT
+
+#if MICROPY_ALLOC_PROFILE
+STATIC void gc_alloc_profile_flush(void);
+#endif
+
 void gc_collect_start(void) {
     GC_ENTER();
+    #if MICROPY_ALLOC_PROFILE
+    // read the type of the last sample before its object can be freed
+    gc_alloc_profile_flush();
+    #endif
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // finish sweeping after the previous collection before marking again
+    gc_sweep_step((size_t)-1, (size_t)-1);
+    #endif
     MP_STATE_MEM(gc_lock_depth)++;
     #if MICROPY_GC_ALLOC_THRESHOLD
     MP_STATE_MEM(gc_alloc_amount) = 0;
     #endif
     MP_STATE_MEM(gc_stack_overflow) = 0;
     MP_STATE_MEM(gc_sp) = MP_STATE_MEM(gc_stack);
+    #if MICROPY_GC_COMPACT
+    if (MP_STATE_MEM(gc_compacting)) {
+        gc_compact_gather();
+    }
+    #endif
+    #if MICROPY_GC_PARALLEL_MARK
+    // small heaps are quicker to mark without the helpers
+    MP_STATE_MEM(gc_mark_threads) = 1;
+    if (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB >= MICROPY_GC_PARALLEL_MARK_MIN_BLOCKS) {
+        MP_STATE_MEM(gc_mark_threads) = mp_thread_gc_parallel_count();
+    }
+    #endif
     // Trace root pointers.  This relies on the root pointers being organised
     // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
     // dict_globals, then the root pointer section of mp_state_vm.
     void **ptrs = (void**)(void*)&mp_state_ctx;
     gc_collect_root(ptrs, offsetof(mp_state_ctx_t, vm.qstr_last_chunk) / sizeof(void*));
+
+    #if MICROPY_ENABLE_PYSTACK
+    // Trace root pointers from the live part of this thread's pystack.
+    ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
+    gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
+    #endif
 }
 
 void gc_collect_root(void **ptrs, size_t len) {
+    #if MICROPY_GC_COMPACT
+    if (MP_STATE_MEM(gc_compacting)) {
+        for (size_t i = 0; i < len; i++) {
+            gc_compact_pin(&ptrs[i]);
+        }
+        return;
+    }
+    #endif
     for (size_t i = 0; i < len; i++) {
         void *ptr = ptrs[i];
         VERIFY_MARK_AND_PUSH(ptr);
+        #if MICROPY_GC_PARALLEL_MARK
+        // leave the tracing to the marking threads in gc_collect_end
+        if (GC_MARK_PARALLEL()) {
+            continue;
+        }
+        #endif
         gc_drain_stack();
     }
 }
 
 void gc_collect_end(void) {
-    gc_deal_with_stack_overflow();
-    gc_sweep();
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    #if MICROPY_GC_COMPACT
+    if (MP_STATE_MEM(gc_compacting)) {
+        gc_compact_move();
+        MP_STATE_MEM(gc_compacting) = 0;
+        MP_STATE_MEM(gc_lock_depth)--;
+        GC_EXIT();
+        return;
+    }
+    #endif
+    #if MICROPY_GC_PARALLEL_MARK
+    if (GC_MARK_PARALLEL()) {
+        gc_mark_parallel();
+    } else
+    #endif
+    {
+        gc_deal_with_stack_overflow();
+    }
+    #if MICROPY_PY_GC_COLLECT_RETVAL
+    MP_STATE_MEM(gc_collected) = 0;
+    #endif
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // leave the sweep to be done a step at a time by gc_alloc
+    MP_STATE_MEM(gc_sweep_block) = 0;
+    #else
+    gc_sweep(0, MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB, (size_t)-1);
+    #endif
     MP_STATE_MEM(gc_lock_depth)--;
     GC_EXIT();
 }
@@ -350,6 +1017,9 @@ void gc_info(gc_info_t *info) {
     info->num_1block = 0;
     info->num_2block = 0;
     info->max_block = 0;
+    #if MICROPY_GC_COMPACT
+    info->compacted = MP_STATE_MEM(gc_compacted) * BYTES_PER_BLOCK;
+    #endif
     bool finish = false;
     for (size_t block = 0, len = 0, len_free = 0; !finish;) {
         size_t kind = ATB_GET_KIND(block);
@@ -360,6 +1030,8 @@ void gc_info(gc_info_t *info) {
                 len = 0;
                 break;
 
+            case AT_MARK:
+                // a live head that has not been swept yet
             case AT_HEAD:
                 info->used += 1;
                 len = 1;
@@ -369,10 +1041,6 @@ void gc_info(gc_info_t *info) {
                 info->used += 1;
                 len += 1;
                 break;
-
-            case AT_MARK:
-                // shouldn't happen
-                break;
         }
 
         block++;
@@ -382,7 +1050,7 @@ void gc_info(gc_info_t *info) {
             kind = ATB_GET_KIND(block);
         }
 
-        if (finish || kind == AT_FREE || kind == AT_HEAD) {
+        if (finish || kind != AT_TAIL) {
             if (len == 1) {
                 info->num_1block += 1;
             } else if (len == 2) {
@@ -391,7 +1059,7 @@ void gc_info(gc_info_t *info) {
             if (len > info->max_block) {
                 info->max_block = len;
             }
-            if (finish || kind == AT_HEAD) {
+            if (finish || kind != AT_FREE) {
                 if (len_free > info->max_free) {
                     info->max_free = len_free;
                 }
@@ -405,7 +1073,183 @@ void gc_info(gc_info_t *info) {
     GC_EXIT();
 }
 
-void *gc_alloc(size_t n_bytes, bool has_finaliser) {
+#if MICROPY_ALLOC_PROFILE
+
+// Allocation profiler
+//
+// Once started, an allocation is sampled each time another interval bytes
+// have been allocated, and an allocation of n intervals counts as n samples.
+// Samples are counted by the source line of the running bytecode and by the
+// type of the object allocated, which is only set up after gc_alloc returns
+// and so is read at the next allocation.  A buffer, such as the items of a
+// list or bytearray, is counted by the type of the object allocated just
+// before it if that object points to it.
+
+extern const mp_map_t mp_builtin_module_map;
+
+// Return true if the map holds the given type as a value.  A value found in
+// the map is an object, so is safe to check for being a type.
+STATIC bool gc_map_has_type(const mp_map_t *map, mp_const_obj_t type) {
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (map->table[i].value == type && MP_MAP_SLOT_IS_FILLED(map, i)) {
+            return MP_OBJ_IS_TYPE(type, &mp_type_type);
+        }
+    }
+    return false;
+}
+
+// Return the type of the object in the given block, if it is one the profiler
+// can be sure of, else NULL.  The first word of a block that does not hold an
+// object may be anything, so it is only followed if it points into the heap.
+STATIC const mp_obj_type_t *gc_alloc_profile_type(size_t block) {
+    if (ATB_GET_KIND(block) == AT_FREE || ATB_GET_KIND(block) == AT_TAIL) {
+        return NULL;
+    }
+    const mp_obj_type_t *type = ((mp_obj_base_t*)PTR_FROM_BLOCK(block))->type;
+    if (VERIFY_PTR((void*)type)) {
+        // a class defined in Python
+        size_t type_block = BLOCK_FROM_PTR(type);
+        if (ATB_GET_KIND(type_block) != AT_FREE && ATB_GET_KIND(type_block) != AT_TAIL
+            && type->base.type == &mp_type_type) {
+            return type;
+        }
+        return NULL;
+    }
+    // a built-in type, if it is one of the common ones without a name in any
+    // module, or is found in builtins or a built-in module
+    if (type == &mp_type_fun_bc || type == &mp_type_gen_instance || type == &mp_type_module) {
+        return type;
+    }
+    mp_const_obj_t value = MP_OBJ_FROM_PTR(type);
+    if (gc_map_has_type(&mp_module_builtins.globals->map, value)) {
+        return type;
+    }
+    const mp_map_t *modules = &mp_builtin_module_map;
+    for (size_t i = 0; i < modules->alloc; i++) {
+        if (MP_MAP_SLOT_IS_FILLED(modules, i)) {
+            mp_obj_module_t *module = MP_OBJ_TO_PTR(modules->table[i].value);
+            if (gc_map_has_type(&module->globals->map, value)) {
+                return type;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Return true if the object in the owner block holds a pointer to the block.
+STATIC bool gc_alloc_profile_owns(size_t owner, size_t block) {
+    if (owner >= MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB || ATB_GET_KIND(owner) != AT_HEAD) {
+        return false;
+    }
+    void *ptr = (void*)PTR_FROM_BLOCK(block);
+    void **words = (void**)PTR_FROM_BLOCK(owner);
+    size_t n_words = BYTES_PER_BLOCK / sizeof(void*);
+    for (size_t i = owner + 1; ATB_GET_KIND(i) == AT_TAIL; i++) {
+        n_words += BYTES_PER_BLOCK / sizeof(void*);
+    }
+    for (size_t i = 0; i < n_words; i++) {
+        if (words[i] == ptr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Add the pending sample, if any, to the profile.
+STATIC void gc_alloc_profile_flush(void) {
+    mp_alloc_profile_entry_t *pending = &MP_STATE_MEM(alloc_profile_pending);
+    if (pending->samples == 0) {
+        return;
+    }
+    size_t block = MP_STATE_MEM(alloc_profile_pending_block);
+    size_t owner = MP_STATE_MEM(alloc_profile_pending_owner);
+    const mp_obj_type_t *type = gc_alloc_profile_type(block);
+    if (type == NULL && gc_alloc_profile_owns(owner, block)) {
+        type = gc_alloc_profile_type(owner);
+    }
+    pending->type_name = type == NULL ? MP_QSTR_NULL : type->name;
+    for (size_t i = 0; i < MICROPY_ALLOC_PROFILE_ENTRIES; i++) {
+        mp_alloc_profile_entry_t *e = &MP_STATE_MEM(alloc_profile)[i];
+        if (e->samples == 0) {
+            *e = *pending;
+            pending->samples = 0;
+            return;
+        }
+        if (e->source_file == pending->source_file && e->block_name == pending->block_name
+            && e->source_line == pending->source_line && e->type_name == pending->type_name) {
+            e->samples += pending->samples;
+            pending->samples = 0;
+            return;
+        }
+    }
+    MP_STATE_MEM(alloc_profile_dropped) += pending->samples;
+    pending->samples = 0;
+}
+
+// Sample the allocation of n_bytes at the given block if it takes the count
+// past the next interval.
+STATIC void gc_alloc_profile_sample(size_t block, size_t n_bytes) {
+    size_t last_block = MP_STATE_MEM(alloc_profile_last_block);
+    MP_STATE_MEM(alloc_profile_last_block) = block;
+    if (n_bytes < MP_STATE_MEM(alloc_profile_countdown)) {
+        MP_STATE_MEM(alloc_profile_countdown) -= n_bytes;
+        return;
+    }
+    size_t interval = MP_STATE_MEM(alloc_profile_interval);
+    n_bytes -= MP_STATE_MEM(alloc_profile_countdown);
+    MP_STATE_MEM(alloc_profile_countdown) = interval - n_bytes % interval;
+    mp_alloc_profile_entry_t *pending = &MP_STATE_MEM(alloc_profile_pending);
+    mp_code_state_t *code_state = MP_STATE_THREAD(current_code_state);
+    if (code_state != NULL) {
+        mp_code_state_get_location(code_state, &pending->block_name, &pending->source_file, &pending->source_line);
+    } else {
+        // not called from bytecode
+        pending->block_name = MP_QSTR_NULL;
+        pending->source_file = MP_QSTR_NULL;
+        pending->source_line = 0;
+    }
+    MP_STATE_MEM(alloc_profile_pending_block) = block;
+    MP_STATE_MEM(alloc_profile_pending_owner) = last_block;
+    pending->samples = 1 + n_bytes / interval;
+}
+
+void gc_alloc_profile_start(size_t interval) {
+    GC_ENTER();
+    if (interval != 0) {
+        memset(MP_STATE_MEM(alloc_profile), 0, sizeof(MP_STATE_MEM(alloc_profile)));
+        MP_STATE_MEM(alloc_profile_pending).samples = 0;
+        MP_STATE_MEM(alloc_profile_dropped) = 0;
+        MP_STATE_MEM(alloc_profile_countdown) = interval;
+        MP_STATE_MEM(alloc_profile_sample_bytes) = interval;
+        MP_STATE_MEM(alloc_profile_last_block) = (size_t)-1;
+    }
+    MP_STATE_MEM(alloc_profile_interval) = interval;
+    GC_EXIT();
+}
+
+// Print the profile, one line per entry with the number of samples, the
+// source file and line, the function and the type (or "-").
+void gc_alloc_profile_dump(const mp_print_t *print) {
+    GC_ENTER();
+    gc_alloc_profile_flush();
+    mp_printf(print, "alloc profile: interval=%u dropped=%u\n",
+        (uint)MP_STATE_MEM(alloc_profile_sample_bytes), (uint)MP_STATE_MEM(alloc_profile_dropped));
+    for (size_t i = 0; i < MICROPY_ALLOC_PROFILE_ENTRIES; i++) {
+        mp_alloc_profile_entry_t *e = &MP_STATE_MEM(alloc_profile)[i];
+        if (e->samples == 0) {
+            break;
+        }
+        mp_printf(print, "%u %s:%u %s %s\n", (uint)e->samples,
+            e->source_file == MP_QSTR_NULL ? "-" : qstr_str(e->source_file), (uint)e->source_line,
+            e->block_name == MP_QSTR_NULL ? "-" : qstr_str(e->block_name),
+            e->type_name == MP_QSTR_NULL ? "-" : qstr_str(e->type_name));
+    }
+    GC_EXIT();
+}
+
+#endif // MICROPY_ALLOC_PROFILE
+
+STATIC void *gc_alloc_blocks(size_t n_bytes, bool has_finaliser, bool long_lived) {
     size_t n_blocks = ((n_bytes + BYTES_PER_BLOCK - 1) & (~(BYTES_PER_BLOCK - 1))) / BYTES_PER_BLOCK;
     DEBUG_printf("gc_alloc(" UINT_FMT " bytes -> " UINT_FMT " blocks)\n", n_bytes, n_blocks);
 
@@ -422,10 +1266,20 @@ void *gc_alloc(size_t n_bytes, bool has_finaliser) {
         return NULL;
     }
 
+    #if MICROPY_ALLOC_PROFILE
+    // the object from the last sampled allocation is now set up
+    gc_alloc_profile_flush();
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // do some of the sweeping left after the last collection
+    gc_sweep_step(MICROPY_GC_SWEEP_STEP_BLOCKS, (size_t)-1);
+    #endif
+
     size_t i;
     size_t end_block;
     size_t start_block;
-    size_t n_free = 0;
+    size_t n_free;
     int collected = !MP_STATE_MEM(gc_auto_collect_enabled);
 
     #if MICROPY_GC_ALLOC_THRESHOLD
@@ -438,8 +1292,67 @@ void *gc_alloc(size_t n_bytes, bool has_finaliser) {
 
     for (;;) {
 
-        // look for a run of n_blocks available blocks
-        for (i = MP_STATE_MEM(gc_last_free_atb_index); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
+        n_free = 0;
+
+        #if MICROPY_GC_LONG_LIVED
+        if (long_lived) {
+            // look for a run of n_blocks available blocks, from the top of
+            // the heap down, so long-lived chains are kept together there
+            for (i = MP_STATE_MEM(gc_long_lived_atb_index); i-- > 0;) {
+                // test a whole word of the ATB at once where possible
+                if (i + 1 >= sizeof(mp_uint_t) && ATB_WORD_AT(i + 1 - sizeof(mp_uint_t))) {
+                    mp_uint_t w = *ATB_WORD_PTR(i + 1 - sizeof(mp_uint_t));
+                    if (w == 0) {
+                        // all free
+                        if (n_free + BLOCKS_PER_ATB_WORD >= n_blocks) {
+                            i = (i + 1) * BLOCKS_PER_ATB + n_free - 1;
+                            n_free = n_blocks;
+                            goto found;
+                        }
+                        n_free += BLOCKS_PER_ATB_WORD;
+                        i -= sizeof(mp_uint_t) - 1;
+                        continue;
+                    }
+                    if (ATB_WORD_FREE(w) == 0) {
+                        // none free
+                        n_free = 0;
+                        i -= sizeof(mp_uint_t) - 1;
+                        continue;
+                    }
+                }
+                // on a match, set i to the last block of the run
+                byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
+                if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3 + n_blocks - 1; goto found; } } else { n_free = 0; }
+                if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2 + n_blocks - 1; goto found; } } else { n_free = 0; }
+                if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1 + n_blocks - 1; goto found; } } else { n_free = 0; }
+                if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0 + n_blocks - 1; goto found; } } else { n_free = 0; }
+            }
+        } else
+        #endif
+        // look for a run of n_blocks available blocks, starting from the first
+        // ATB that may hold one
+        for (i = FREE_ATB_INDEX(n_blocks); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
+            // test a whole word of the ATB at once where possible
+            if (ATB_WORD_AT(i)) {
+                mp_uint_t w = *ATB_WORD_PTR(i);
+                if (w == 0) {
+                    // all free
+                    if (n_free + BLOCKS_PER_ATB_WORD >= n_blocks) {
+                        i = i * BLOCKS_PER_ATB + (n_blocks - n_free) - 1;
+                        n_free = n_blocks;
+                        goto found;
+                    }
+                    n_free += BLOCKS_PER_ATB_WORD;
+                    i += sizeof(mp_uint_t) - 1;
+                    continue;
+                }
+                if (ATB_WORD_FREE(w) == 0) {
+                    // none free
+                    n_free = 0;
+                    i += sizeof(mp_uint_t) - 1;
+                    continue;
+                }
+            }
             byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
             if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
             if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
@@ -447,6 +1360,15 @@ void *gc_alloc(size_t n_bytes, bool has_finaliser) {
             if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
         }
 
+        #if MICROPY_GC_INCREMENTAL_SWEEP
+        // try again after sweeping until there is a run of free blocks
+        // that is long enough, if the sweep is not complete
+        if (MP_STATE_MEM(gc_sweep_block) < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
+            gc_sweep_step((size_t)-1, n_blocks);
+            continue;
+        }
+        #endif
+
         GC_EXIT();
         // nothing found!
         if (collected) {
@@ -464,13 +1386,25 @@ found:
     end_block = i;
     start_block = i - n_free + 1;
 
-    // Set last free ATB index to block after last block we found, for start of
-    // next scan.  To reduce fragmentation, we only do this if we were looking
-    // for a single free block, which guarantees that there are no free blocks
-    // before this one.  Also, whenever we free or shink a block we must check
-    // if this index needs adjusting (see gc_realloc and gc_free).
-    if (n_free == 1) {
-        MP_STATE_MEM(gc_last_free_atb_index) = (i + 1) / BLOCKS_PER_ATB;
+    // Advance the free-run indices past the blocks we found, for start of
+    // next scan.  This is the first run of n_blocks free blocks in the heap,
+    // so there is no run of this length or longer before it.  Shorter runs
+    // may remain, so their indices are left alone.  Whenever we free or
+    // shrink a block these indices must be moved back (see gc_realloc and
+    // gc_free).
+    #if MICROPY_GC_LONG_LIVED
+    // as for the free-run indices, but for a top-down search
+    if (long_lived && n_blocks == 1) {
+        MP_STATE_MEM(gc_long_lived_atb_index) = start_block / BLOCKS_PER_ATB + 1;
+    }
+    #endif
+    if (n_blocks <= MICROPY_ATB_INDICES && !long_lived) {
+        size_t next_atb_index = (end_block + 1) / BLOCKS_PER_ATB;
+        for (size_t n = n_blocks - 1; n < MICROPY_ATB_INDICES; n++) {
+            if (next_atb_index > MP_STATE_MEM(gc_first_free_atb_index)[n]) {
+                MP_STATE_MEM(gc_first_free_atb_index)[n] = next_atb_index;
+            }
+        }
     }
 
     #ifdef LOG_HEAP_ACTIVITY
@@ -480,10 +1414,23 @@ found:
     // mark first block as used head
     ATB_FREE_TO_HEAD(start_block);
 
-    // mark rest of blocks as used tail
-    // TODO for a run of many blocks can make this more efficient
-    for (size_t bl = start_block + 1; bl <= end_block; bl++) {
-        ATB_FREE_TO_TAIL(bl);
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // a new chain where the sweep has yet to reach must look live to it
+    if (start_block >= MP_STATE_MEM(gc_sweep_block)) {
+        ATB_HEAD_TO_MARK(start_block);
+    }
+    #endif
+
+    // mark rest of blocks as used tail, filling whole ATBs at once
+    for (size_t bl = start_block + 1; bl <= end_block;) {
+        if (bl % BLOCKS_PER_ATB == 0 && bl + BLOCKS_PER_ATB - 1 <= end_block) {
+            size_t n_atb = (end_block + 1 - bl) / BLOCKS_PER_ATB;
+            memset(&MP_STATE_MEM(gc_alloc_table_start)[bl / BLOCKS_PER_ATB], AT_TAIL * 0x55, n_atb);
+            bl += n_atb * BLOCKS_PER_ATB;
+        } else {
+            ATB_FREE_TO_TAIL(bl);
+            bl++;
+        }
     }
 
     // get pointer to first block
@@ -495,6 +1442,12 @@ found:
     MP_STATE_MEM(gc_alloc_amount) += n_blocks;
     #endif
 
+    #if MICROPY_ALLOC_PROFILE
+    if (MP_STATE_MEM(alloc_profile_interval) != 0) {
+        gc_alloc_profile_sample(start_block, n_bytes);
+    }
+    #endif
+
     GC_EXIT();
 
     #if MICROPY_GC_CONSERVATIVE_CLEAR
@@ -529,6 +1482,16 @@ found:
     return ret_ptr;
 }
 
+void *gc_alloc(size_t n_bytes, bool has_finaliser) {
+    return gc_alloc_blocks(n_bytes, has_finaliser, false);
+}
+
+#if MICROPY_GC_LONG_LIVED
+void *gc_alloc_long_lived(size_t n_bytes) {
+    return gc_alloc_blocks(n_bytes, false, true);
+}
+#endif
+
 /*
 void *gc_alloc(mp_uint_t n_bytes) {
     return _gc_alloc(n_bytes, false);
@@ -553,14 +1516,12 @@ void gc_free(void *ptr) {
 
     if (VERIFY_PTR(ptr)) {
         size_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+        if (ATB_IS_HEAD(block)) {
             #if MICROPY_ENABLE_FINALISER
             FTB_CLEAR(block);
             #endif
-            // set the last_free pointer to this block if it's earlier in the heap
-            if (block / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-                MP_STATE_MEM(gc_last_free_atb_index) = block / BLOCKS_PER_ATB;
-            }
+            // move the free-run indices back to this block if needed
+            gc_update_free_atb_indices(block);
 
             // free head and all of its tail blocks
             #ifdef LOG_HEAP_ACTIVITY
@@ -571,6 +1532,10 @@ void gc_free(void *ptr) {
                 block += 1;
             } while (ATB_GET_KIND(block) == AT_TAIL);
 
+            #if MICROPY_GC_LONG_LIVED
+            gc_update_long_lived_atb_index(block - 1);
+            #endif
+
             GC_EXIT();
 
             #if EXTENSIVE_HEAP_PROFILING
@@ -592,7 +1557,7 @@ size_t gc_nbytes(const void *ptr) {
     GC_ENTER();
     if (VERIFY_PTR(ptr)) {
         size_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+        if (ATB_IS_HEAD(block)) {
             // work out number of consecutive blocks in the chain starting with this on
             size_t n_blocks = 0;
             do {
@@ -662,7 +1627,7 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     GC_ENTER();
 
     // sanity check the ptr is pointing to the head of a block
-    if (ATB_GET_KIND(block) != AT_HEAD) {
+    if (!ATB_IS_HEAD(block)) {
         GC_EXIT();
         return NULL;
     }
@@ -714,10 +1679,11 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
             ATB_ANY_TO_FREE(bl);
         }
 
-        // set the last_free pointer to end of this block if it's earlier in the heap
-        if ((block + new_blocks) / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = (block + new_blocks) / BLOCKS_PER_ATB;
-        }
+        // move the free-run indices back to the freed blocks if needed
+        gc_update_free_atb_indices(block + new_blocks);
+        #if MICROPY_GC_LONG_LIVED
+        gc_update_long_lived_atb_index(block + n_blocks - 1);
+        #endif
 
         GC_EXIT();
 
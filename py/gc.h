@@ -26,10 +26,12 @@
 #ifndef __MICROPY_INCLUDED_PY_GC_H__
 #define __MICROPY_INCLUDED_PY_GC_H__
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "py/mpconfig.h"
 #include "py/misc.h"
+#include "py/mpprint.h"
 
 void gc_init(void *start, void *end);
 
@@ -45,7 +47,24 @@ void gc_collect_start(void);
 void gc_collect_root(void **ptrs, size_t len);
 void gc_collect_end(void);
 
+#if MICROPY_GC_INCREMENTAL_SWEEP
+// Finish sweeping the heap after an incremental collection.
+void gc_sweep_all(void);
+#endif
+
+#if MICROPY_GC_COMPACT
+// Collect garbage, then move buffers that only their owner refers to down
+// the heap, to join up the free memory.
+bool gc_compact(void);
+#endif
+
 void *gc_alloc(size_t n_bytes, bool has_finaliser);
+#if MICROPY_GC_LONG_LIVED
+// Allocate memory that is expected to live for the rest of the program, such
+// as compiled code and interned strings.  It is taken from the top of the heap
+// so it does not fragment the space used for short-lived objects.
+void *gc_alloc_long_lived(size_t n_bytes);
+#endif
 void gc_free(void *ptr); // does not call finaliser
 size_t gc_nbytes(const void *ptr);
 void *gc_realloc(void *ptr, size_t n_bytes, bool allow_move);
@@ -58,9 +77,18 @@ typedef struct _gc_info_t {
     size_t num_1block;
     size_t num_2block;
     size_t max_block;
+    #if MICROPY_GC_COMPACT
+    size_t compacted; // bytes moved by the last compaction
+    #endif
 } gc_info_t;
 
 void gc_info(gc_info_t *info);
+#if MICROPY_ALLOC_PROFILE
+// Clear the allocation profile and sample allocations every interval bytes,
+// or stop sampling if interval is 0; and print the profile.
+void gc_alloc_profile_start(size_t interval);
+void gc_alloc_profile_dump(const mp_print_t *print);
+#endif
 void gc_dump_info(void);
 void gc_dump_alloc_table(void);
 
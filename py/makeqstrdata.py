@@ -52,13 +52,39 @@ codepoint2name[ord('|')] = 'pipe'
 codepoint2name[ord('~')] = 'tilde'
 
 # this must match the equivalent function in qstr.c
-def compute_hash(qstr, bytes_hash):
+def compute_hash_unmasked(qstr):
     hash = 5381
     for b in qstr:
         hash = (hash * 33) ^ b
+    return hash
+
+def compute_hash(qstr, bytes_hash):
+    hash = compute_hash_unmasked(qstr)
     # Make sure that valid hash is never zero, zero means "hash not computed"
     return (hash & ((1 << (8 * bytes_hash)) - 1)) or 1
 
+# this must match the equivalent function in qstr.c
+def hash_index_size(n):
+    size = 1
+    while size <= n + n // 2:
+        size <<= 1
+    return size
+
+def make_hash_index(qstrs, first=0):
+    """Build the hash index of a pool from the qstrs in it, skipping the
+    first entries; each slot holds the index of the qstr plus one, or 0."""
+    assert len(qstrs) < 0x10000
+    index = [0] * hash_index_size(len(qstrs))
+    mask = len(index) - 1
+    for i, qstr in enumerate(qstrs):
+        if i < first:
+            continue
+        slot = compute_hash_unmasked(bytes_cons(qstr, 'utf8')) & mask
+        while index[slot]:
+            slot = (slot + 1) & mask
+        index[slot] = i + 1
+    return index
+
 def qstr_escape(qst):
     def esc_char(m):
         c = ord(m.group(0))
@@ -146,10 +172,19 @@ def print_qstr_data(qcfgs, qstrs):
     print('QDEF(MP_QSTR_NULL, (const byte*)"%s%s" "")' % ('\\x00' * cfg_bytes_hash, '\\x00' * cfg_bytes_len))
 
     # go through each qstr and print it out
-    for order, ident, qstr in sorted(qstrs.values(), key=lambda x: x[0]):
+    ordered = sorted(qstrs.values(), key=lambda x: x[0])
+    for order, ident, qstr in ordered:
         qbytes = make_bytes(cfg_bytes_len, cfg_bytes_hash, qstr)
         print('QDEF(MP_QSTR_%s, %s)' % (ident, qbytes))
 
+    # print the hash index of the pool, which doesn't include MP_QSTR_NULL
+    print('')
+    print('#ifdef QHASH_INDEX')
+    index = make_hash_index([''] + [qstr for _, _, qstr in ordered], first=1)
+    for i in range(0, len(index), 16):
+        print('QHASH_INDEX(%s)' % ', '.join(str(n) for n in index[i:i + 16]))
+    print('#endif')
+
 def do_work(infiles):
     qcfgs, qstrs = parse_input_headers(infiles)
     print_qstr_data(qcfgs, qstrs)
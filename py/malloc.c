@@ -124,6 +124,31 @@ void *m_malloc0(size_t num_bytes) {
     return ptr;
 }
 
+#if MICROPY_ENABLE_GC && MICROPY_GC_LONG_LIVED
+void *m_malloc_long_lived_maybe(size_t num_bytes) {
+    void *ptr = gc_alloc_long_lived(num_bytes);
+#if MICROPY_MEM_STATS
+    MP_STATE_MEM(total_bytes_allocated) += num_bytes;
+    MP_STATE_MEM(current_bytes_allocated) += num_bytes;
+    UPDATE_PEAK();
+#endif
+    DEBUG_printf("malloc long-lived %d : %p\n", num_bytes, ptr);
+    return ptr;
+}
+
+void *m_malloc_long_lived(size_t num_bytes) {
+    void *ptr = m_malloc_long_lived_maybe(num_bytes);
+    if (ptr == NULL && num_bytes != 0) {
+        return m_malloc_fail(num_bytes);
+    }
+    // If this config is set then the GC clears all memory, so we don't need to.
+    #if !MICROPY_GC_CONSERVATIVE_CLEAR
+    memset(ptr, 0, num_bytes);
+    #endif
+    return ptr;
+}
+#endif
+
 #if MICROPY_MALLOC_USES_ALLOCATED_SIZE
 void *m_realloc(void *ptr, size_t old_num_bytes, size_t new_num_bytes) {
 #else
@@ -70,13 +70,101 @@ STATIC mp_uint_t get_hash_alloc_greater_or_equal_to(mp_uint_t x) {
 /******************************************************************************/
 /* map                                                                        */
 
+// A hash map (one that's not ordered) keeps its entries densely in table[],
+// in the order they were added, so iterating over it is a plain scan.
+// Deleted entries have key MP_OBJ_SENTINEL and are reclaimed by rehashing,
+// which happens when all the entries are filled.
+//
+// A small hash map, with at most MAP_SMALL_MAX entries, is just the entries
+// and is searched linearly up to the first unused one.  This is no slower
+// than hashing for so few entries and keeps small dicts and instance
+// dicts as compact as possible.
+//
+// A larger hash map has, after the alloc entries, the number of entries
+// filled so far (counting the deleted ones) and then the index: an
+// open-addressed hash table with a third more slots than entries, each holding
+// 0 for empty or 1 + the number of an entry.  Slots are 1, 2 or 4 bytes wide
+// depending on alloc.  Deleting an entry leaves its index slot in place so
+// that probing isn't disturbed.
+//
+// An ordered map keeps its live entries in table[0 .. used) and is searched
+// linearly, so it doesn't need an index.
+
+#define MAP_SMALL_MAX (8)
+
+// Number of index slots for a hash map with the given number of entries,
+// which keeps the index at most 3/4 full.
+static inline mp_uint_t map_index_len(mp_uint_t alloc) {
+    return alloc + alloc / 3 + 1;
+}
+
+STATIC size_t map_table_bytes(mp_uint_t alloc) {
+    if (alloc <= MAP_SMALL_MAX) {
+        return alloc * sizeof(mp_map_elem_t);
+    }
+    size_t index_width = alloc < 0xff ? 1 : alloc < 0xffff ? 2 : 4;
+    return alloc * sizeof(mp_map_elem_t) + sizeof(mp_uint_t) + map_index_len(alloc) * index_width;
+}
+
+// Number of entries to allocate for a hash map that must hold at least n,
+// rounded up so the table uses all of the GC blocks it'll be given.
+STATIC mp_uint_t map_alloc_for(mp_uint_t n) {
+    #if MICROPY_ENABLE_GC
+    size_t n_bytes = (map_table_bytes(n) + MICROPY_BYTES_PER_GC_BLOCK - 1) & ~(MICROPY_BYTES_PER_GC_BLOCK - 1);
+    while (map_table_bytes(n + 1) <= n_bytes) {
+        n++;
+    }
+    #endif
+    return n;
+}
+
+static inline mp_uint_t *map_filled(const mp_map_t *map) {
+    return (mp_uint_t*)(void*)&map->table[map->alloc];
+}
+
+static inline byte *map_index(const mp_map_t *map) {
+    return (byte*)(map_filled(map) + 1);
+}
+
+static inline mp_uint_t map_index_get(const byte *idx, mp_uint_t alloc, mp_uint_t pos) {
+    if (alloc < 0xff) {
+        return idx[pos];
+    } else if (alloc < 0xffff) {
+        return ((const uint16_t*)(const void*)idx)[pos];
+    } else {
+        return ((const uint32_t*)(const void*)idx)[pos];
+    }
+}
+
+static inline void map_index_set(byte *idx, mp_uint_t alloc, mp_uint_t pos, mp_uint_t n) {
+    if (alloc < 0xff) {
+        idx[pos] = n;
+    } else if (alloc < 0xffff) {
+        ((uint16_t*)(void*)idx)[pos] = n;
+    } else {
+        ((uint32_t*)(void*)idx)[pos] = n;
+    }
+}
+
+// Size in bytes of the memory pointed to by map->table, for a map that
+// owns its table.
+size_t mp_map_table_bytes(const mp_map_t *map) {
+    if (map->table == NULL) {
+        return 0;
+    } else if (map->is_ordered) {
+        return map->alloc * sizeof(mp_map_elem_t);
+    } else {
+        return map_table_bytes(map->alloc);
+    }
+}
+
 void mp_map_init(mp_map_t *map, mp_uint_t n) {
     if (n == 0) {
         map->alloc = 0;
         map->table = NULL;
     } else {
-        map->alloc = n;
-        map->table = m_new0(mp_map_elem_t, map->alloc);
+        map->alloc = map_alloc_for(n);
+        map->table = (mp_map_elem_t*)m_new0(byte, map_table_bytes(map->alloc));
     }
     map->used = 0;
     map->all_keys_are_qstrs = 1;
@@ -102,7 +190,7 @@ mp_map_t *mp_map_new(mp_uint_t n) {
 // Differentiate from mp_map_clear() - semantics is different
 void mp_map_deinit(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(byte, map->table, mp_map_table_bytes(map));
     }
     map->used = map->alloc = 0;
 }
@@ -114,7 +202,7 @@ void mp_map_free(mp_map_t *map) {
 
 void mp_map_clear(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(byte, map->table, mp_map_table_bytes(map));
     }
     map->alloc = 0;
     map->used = 0;
@@ -123,22 +211,42 @@ void mp_map_clear(mp_map_t *map) {
     map->table = NULL;
 }
 
+// Make dest a copy of src, which may be fixed; dest's table is not freed.
+void mp_map_copy(mp_map_t *dest, const mp_map_t *src) {
+    dest->used = src->used;
+    dest->all_keys_are_qstrs = src->all_keys_are_qstrs;
+    dest->is_fixed = 0;
+    dest->is_ordered = src->is_ordered;
+    dest->alloc = src->alloc;
+    size_t n_bytes = mp_map_table_bytes(src);
+    dest->table = (mp_map_elem_t*)m_new(byte, n_bytes);
+    memcpy(dest->table, src->table, n_bytes);
+}
+
+// Move the live entries of a hash map into a new table with room to add
+// a quarter more of them while the map is small, and half more after that.
+// A map that filled up by adding grows, one whose entries were mostly
+// deleted keeps its size or shrinks.
 STATIC void mp_map_rehash(mp_map_t *map) {
     mp_uint_t old_alloc = map->alloc;
-    mp_uint_t new_alloc = get_hash_alloc_greater_or_equal_to(map->alloc + 1);
+    mp_uint_t old_filled = old_alloc <= MAP_SMALL_MAX ? old_alloc : *map_filled(map);
     mp_map_elem_t *old_table = map->table;
-    mp_map_elem_t *new_table = m_new0(mp_map_elem_t, new_alloc);
+    mp_uint_t used = map->used;
+    mp_uint_t new_alloc = map_alloc_for(used + (used < MAP_SMALL_MAX ? 2 : used / 4));
+    mp_map_elem_t *new_table = (mp_map_elem_t*)m_new0(byte, map_table_bytes(new_alloc));
     // If we reach this point, table resizing succeeded, now we can edit the old map.
     map->alloc = new_alloc;
     map->used = 0;
     map->all_keys_are_qstrs = 1;
     map->table = new_table;
-    for (mp_uint_t i = 0; i < old_alloc; i++) {
+    for (mp_uint_t i = 0; i < old_filled; i++) {
         if (old_table[i].key != MP_OBJ_NULL && old_table[i].key != MP_OBJ_SENTINEL) {
             mp_map_lookup(map, old_table[i].key, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)->value = old_table[i].value;
         }
     }
-    m_del(mp_map_elem_t, old_table, old_alloc);
+    if (old_table != NULL) {
+        m_del(byte, old_table, map_table_bytes(old_alloc));
+    }
 }
 
 // MP_MAP_LOOKUP behaviour:
@@ -178,8 +286,14 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         for (mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->used]; elem < top; elem++) {
             if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
                 if (MP_UNLIKELY(lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND)) {
+                    // close the gap, keeping the order, and park the removed
+                    // entry just past the end so the caller can access its value
+                    mp_map_elem_t removed = *elem;
+                    memmove(elem, elem + 1, (top - elem - 1) * sizeof(*elem));
+                    elem = top - 1;
                     elem->key = MP_OBJ_SENTINEL;
-                    // keep elem->value so that caller can access it if needed
+                    elem->value = removed.value;
+                    map->used--;
                 }
                 return elem;
             }
@@ -187,12 +301,12 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         if (MP_LIKELY(lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)) {
             return NULL;
         }
-        // TODO shrink array down over any previously-freed slots
         if (map->used == map->alloc) {
-            // TODO: Alloc policy
-            map->alloc += 4;
-            map->table = m_renew(mp_map_elem_t, map->table, map->used, map->alloc);
-            mp_seq_clear(map->table, map->used, map->alloc, sizeof(*map->table));
+            // grow by half, so that building a large ordered map is linear
+            mp_uint_t new_alloc = map->alloc + map->alloc / 2 + 4;
+            map->table = m_renew(mp_map_elem_t, map->table, map->alloc, new_alloc);
+            mp_seq_clear(map->table, map->alloc, new_alloc, sizeof(*map->table));
+            map->alloc = new_alloc;
         }
         mp_map_elem_t *elem = map->table + map->used++;
         elem->key = index;
@@ -212,81 +326,88 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
-    // get hash of index, with fast path for common case of qstr
-    mp_uint_t hash;
-    if (MP_OBJ_IS_QSTR(index)) {
-        hash = qstr_hash(MP_OBJ_QSTR_VALUE(index));
-    } else {
+    // get hash of index, with fast path for common case of qstr; a small map
+    // doesn't need the hash but it's still computed for other objects so that
+    // unhashable ones are rejected
+    mp_uint_t hash = 0;
+    if (!MP_OBJ_IS_QSTR(index)) {
         hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    } else if (map->alloc > MAP_SMALL_MAX) {
+        hash = qstr_hash(MP_OBJ_QSTR_VALUE(index));
     }
 
-    mp_uint_t pos = hash % map->alloc;
-    mp_uint_t start_pos = pos;
-    mp_map_elem_t *avail_slot = NULL;
     for (;;) {
-        mp_map_elem_t *slot = &map->table[pos];
-        if (slot->key == MP_OBJ_NULL) {
-            // found NULL slot, so index is not in table
-            if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
-                map->used += 1;
-                if (avail_slot == NULL) {
-                    avail_slot = slot;
+        mp_uint_t alloc = map->alloc;
+        if (alloc <= MAP_SMALL_MAX) {
+            mp_map_elem_t *elem = &map->table[0], *top = &map->table[alloc];
+            for (; elem < top && elem->key != MP_OBJ_NULL; elem++) {
+                if (elem->key == index
+                    || (!compare_only_ptrs && elem->key != MP_OBJ_SENTINEL && mp_obj_equal(elem->key, index))) {
+                    if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                        map->used--;
+                        elem->key = MP_OBJ_SENTINEL;
+                    }
+                    return elem;
                 }
-                avail_slot->key = index;
-                avail_slot->value = MP_OBJ_NULL;
+            }
+            if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+                return NULL;
+            }
+            if (elem < top) {
+                elem->key = index;
+                elem->value = MP_OBJ_NULL;
+                map->used++;
                 if (!MP_OBJ_IS_QSTR(index)) {
                     map->all_keys_are_qstrs = 0;
                 }
-                return avail_slot;
-            } else {
-                return NULL;
-            }
-        } else if (slot->key == MP_OBJ_SENTINEL) {
-            // found deleted slot, remember for later
-            if (avail_slot == NULL) {
-                avail_slot = slot;
+                return elem;
             }
-        } else if (slot->key == index || (!compare_only_ptrs && mp_obj_equal(slot->key, index))) {
-            // found index
-            // Note: CPython does not replace the index; try x={True:'true'};x[1]='one';x
-            if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
-                // delete element in this slot
-                map->used--;
-                if (map->table[(pos + 1) % map->alloc].key == MP_OBJ_NULL) {
-                    // optimisation if next slot is empty
-                    slot->key = MP_OBJ_NULL;
-                } else {
-                    slot->key = MP_OBJ_SENTINEL;
+        } else {
+            byte *idx = map_index(map);
+            mp_uint_t len = map_index_len(alloc);
+            mp_uint_t pos = hash % len;
+            mp_uint_t n;
+            while ((n = map_index_get(idx, alloc, pos)) != 0) {
+                mp_map_elem_t *elem = &map->table[n - 1];
+                if (elem->key == index
+                    || (!compare_only_ptrs && elem->key != MP_OBJ_SENTINEL && mp_obj_equal(elem->key, index))) {
+                    // found index
+                    // Note: CPython does not replace the index; try x={True:'true'};x[1]='one';x
+                    if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                        // delete the entry, keeping elem->value so that caller can access it
+                        map->used--;
+                        elem->key = MP_OBJ_SENTINEL;
+                    }
+                    return elem;
+                }
+                if (++pos == len) {
+                    pos = 0;
                 }
-                // keep slot->value so that caller can access it if needed
             }
-            return slot;
-        }
-
-        // not yet found, keep searching in this table
-        pos = (pos + 1) % map->alloc;
 
-        if (pos == start_pos) {
-            // search got back to starting position, so index is not in table
-            if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
-                if (avail_slot != NULL) {
-                    // there was an available slot, so use that
-                    map->used++;
-                    avail_slot->key = index;
-                    avail_slot->value = MP_OBJ_NULL;
-                    if (!MP_OBJ_IS_QSTR(index)) {
-                        map->all_keys_are_qstrs = 0;
-                    }
-                    return avail_slot;
-                } else {
-                    // not enough room in table, rehash it
-                    mp_map_rehash(map);
-                    // restart the search for the new element
-                    start_pos = pos = hash % map->alloc;
-                }
-            } else {
+            // index is not in the table
+            if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
                 return NULL;
             }
+            mp_uint_t *filled = map_filled(map);
+            if (*filled < alloc) {
+                // append a new entry and point the empty index slot at it
+                mp_map_elem_t *elem = &map->table[*filled];
+                elem->key = index;
+                elem->value = MP_OBJ_NULL;
+                map_index_set(idx, alloc, pos, ++*filled);
+                map->used++;
+                if (!MP_OBJ_IS_QSTR(index)) {
+                    map->all_keys_are_qstrs = 0;
+                }
+                return elem;
+            }
+        }
+
+        // no free entries left, so rehash and search again
+        mp_map_rehash(map);
+        if (MP_OBJ_IS_QSTR(index)) {
+            hash = qstr_hash(MP_OBJ_QSTR_VALUE(index));
         }
     }
 }
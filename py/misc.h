@@ -81,6 +81,13 @@ typedef unsigned int uint;
 #endif
 #define m_del_obj(type, ptr) (m_del(type, ptr, 1))
 
+// Allocate memory that will live for the rest of the program.  m_new0_long_lived
+// zeroes the memory and raises MemoryError on failure, like m_new0, while the
+// _maybe variants return NULL on failure.
+#define m_new0_long_lived(type, num) ((type*)(m_malloc_long_lived(sizeof(type) * (num))))
+#define m_new_long_lived_maybe(type, num) ((type*)(m_malloc_long_lived_maybe(sizeof(type) * (num))))
+#define m_new_obj_var_long_lived_maybe(obj_type, var_type, var_num) ((obj_type*)m_malloc_long_lived_maybe(sizeof(obj_type) + sizeof(var_type) * (var_num)))
+
 void *m_malloc(size_t num_bytes);
 void *m_malloc_maybe(size_t num_bytes);
 void *m_malloc_with_finaliser(size_t num_bytes);
@@ -94,6 +101,13 @@ void *m_realloc(void *ptr, size_t new_num_bytes);
 void *m_realloc_maybe(void *ptr, size_t new_num_bytes, bool allow_move);
 void m_free(void *ptr);
 #endif
+#if MICROPY_ENABLE_GC && MICROPY_GC_LONG_LIVED
+void *m_malloc_long_lived(size_t num_bytes);
+void *m_malloc_long_lived_maybe(size_t num_bytes);
+#else
+#define m_malloc_long_lived(num_bytes) m_malloc0(num_bytes)
+#define m_malloc_long_lived_maybe(num_bytes) m_malloc_maybe(num_bytes)
+#endif
 void *m_malloc_fail(size_t num_bytes);
 
 #if MICROPY_MEM_STATS
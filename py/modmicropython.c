@@ -25,11 +25,15 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/mpstate.h"
 #include "py/builtin.h"
+#include "py/runtime.h"
 #include "py/stackctrl.h"
 #include "py/gc.h"
+#include "py/bc.h"
+#include "py/mphal.h"
 
 // Various builtins specific to MicroPython runtime,
 // living in micropython module
@@ -108,6 +112,13 @@ STATIC mp_obj_t mp_micropython_stack_use(void) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_stack_use_obj, mp_micropython_stack_use);
 #endif
 
+#if MICROPY_ENABLE_PYSTACK
+STATIC mp_obj_t mp_micropython_pystack_use(void) {
+    return MP_OBJ_NEW_SMALL_INT(mp_pystack_usage());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_pystack_use_obj, mp_micropython_pystack_use);
+#endif
+
 #endif // MICROPY_PY_MICROPYTHON_MEM_INFO
 
 #if MICROPY_ENABLE_GC
@@ -124,6 +135,105 @@ STATIC mp_obj_t mp_micropython_heap_unlock(void) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_heap_unlock_obj, mp_micropython_heap_unlock);
 #endif
 
+#if MICROPY_ENABLE_GC && MICROPY_ALLOC_PROFILE
+STATIC mp_obj_t mp_micropython_alloc_profile(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        gc_alloc_profile_dump(&mp_plat_print);
+    } else {
+        // arg given means start (or with 0, stop) sampling every arg bytes
+        mp_int_t interval = mp_obj_get_int(args[0]);
+        if (interval < 0) {
+            mp_raise_ValueError("interval must be >= 0");
+        }
+        gc_alloc_profile_start(interval);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_alloc_profile_obj, 0, 1, mp_micropython_alloc_profile);
+#endif
+
+#if MICROPY_EXEC_PROFILE
+// This may interrupt anything, so it must not allocate or take locks.  The
+// VM stores code_state->ip before each opcode, so a sample is attributed to
+// the line of the opcode being executed.  Time spent in native code or in
+// built-in functions is counted against the bytecode that called them.
+void mp_exec_profile_sample(void) {
+    if (!MP_STATE_VM(exec_profile_running)) {
+        return;
+    }
+    mp_code_state_t *code_state = MP_STATE_THREAD(current_code_state);
+    if (code_state == NULL) {
+        // not executing bytecode
+        MP_STATE_VM(exec_profile_dropped) += 1;
+        return;
+    }
+    qstr block_name, source_file;
+    size_t source_line;
+    mp_code_state_get_location(code_state, &block_name, &source_file, &source_line);
+    for (size_t i = 0; i < MICROPY_EXEC_PROFILE_ENTRIES; i++) {
+        mp_exec_profile_entry_t *e = &MP_STATE_VM(exec_profile)[i];
+        if (e->samples == 0) {
+            e->source_file = source_file;
+            e->block_name = block_name;
+            e->source_line = source_line;
+            e->samples = 1;
+            return;
+        }
+        if (e->source_line == source_line && e->block_name == block_name && e->source_file == source_file) {
+            e->samples += 1;
+            return;
+        }
+    }
+    MP_STATE_VM(exec_profile_dropped) += 1;
+}
+
+STATIC mp_obj_t mp_micropython_profile_start(size_t n_args, const mp_obj_t *args) {
+    mp_int_t period_us = 1000;
+    if (n_args > 0) {
+        period_us = mp_obj_get_int(args[0]);
+        if (period_us <= 0) {
+            mp_raise_ValueError("period must be > 0");
+        }
+    }
+    mp_hal_exec_profile_stop();
+    MP_STATE_VM(exec_profile_running) = false;
+    memset(MP_STATE_VM(exec_profile), 0, sizeof(MP_STATE_VM(exec_profile)));
+    MP_STATE_VM(exec_profile_dropped) = 0;
+    MP_STATE_VM(exec_profile_running) = true;
+    mp_hal_exec_profile_start(period_us);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_profile_start_obj, 0, 1, mp_micropython_profile_start);
+
+// Returns a dict mapping (source file, function, line) to the number of
+// samples taken there, with the samples that couldn't be attributed to a
+// line under the key None, and clears the profile.
+STATIC mp_obj_t mp_micropython_profile_stop(void) {
+    mp_hal_exec_profile_stop();
+    MP_STATE_VM(exec_profile_running) = false;
+    mp_obj_t dict = mp_obj_new_dict(0);
+    for (size_t i = 0; i < MICROPY_EXEC_PROFILE_ENTRIES; i++) {
+        mp_exec_profile_entry_t *e = &MP_STATE_VM(exec_profile)[i];
+        if (e->samples == 0) {
+            break;
+        }
+        mp_obj_t key[3] = {
+            MP_OBJ_NEW_QSTR(e->source_file),
+            MP_OBJ_NEW_QSTR(e->block_name),
+            MP_OBJ_NEW_SMALL_INT(e->source_line),
+        };
+        mp_obj_dict_store(dict, mp_obj_new_tuple(3, key), MP_OBJ_NEW_SMALL_INT(e->samples));
+    }
+    if (MP_STATE_VM(exec_profile_dropped) != 0) {
+        mp_obj_dict_store(dict, mp_const_none, MP_OBJ_NEW_SMALL_INT(MP_STATE_VM(exec_profile_dropped)));
+    }
+    memset(MP_STATE_VM(exec_profile), 0, sizeof(MP_STATE_VM(exec_profile)));
+    MP_STATE_VM(exec_profile_dropped) = 0;
+    return dict;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mp_micropython_profile_stop_obj, mp_micropython_profile_stop);
+#endif
+
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_alloc_emergency_exception_buf_obj, mp_alloc_emergency_exception_buf);
 #endif
@@ -143,6 +253,9 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     #if MICROPY_STACK_CHECK
     { MP_ROM_QSTR(MP_QSTR_stack_use), MP_ROM_PTR(&mp_micropython_stack_use_obj) },
     #endif
+    #if MICROPY_ENABLE_PYSTACK
+    { MP_ROM_QSTR(MP_QSTR_pystack_use), MP_ROM_PTR(&mp_micropython_pystack_use_obj) },
+    #endif
 #endif
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && (MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0)
     { MP_ROM_QSTR(MP_QSTR_alloc_emergency_exception_buf), MP_ROM_PTR(&mp_alloc_emergency_exception_buf_obj) },
@@ -151,6 +264,13 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_heap_lock), MP_ROM_PTR(&mp_micropython_heap_lock_obj) },
     { MP_ROM_QSTR(MP_QSTR_heap_unlock), MP_ROM_PTR(&mp_micropython_heap_unlock_obj) },
     #endif
+    #if MICROPY_ENABLE_GC && MICROPY_ALLOC_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_alloc_profile), MP_ROM_PTR(&mp_micropython_alloc_profile_obj) },
+    #endif
+    #if MICROPY_EXEC_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_profile_start), MP_ROM_PTR(&mp_micropython_profile_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_profile_stop), MP_ROM_PTR(&mp_micropython_profile_stop_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_micropython_globals, mp_module_micropython_globals_table);
@@ -174,6 +174,19 @@ STATIC void *thread_entry(void *args_in) {
 
     mp_state_thread_t ts;
     mp_thread_set_state(&ts);
+    #if MICROPY_TRACK_CODE_STATE
+    ts.current_code_state = NULL;
+    #endif
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    memset(ts.class_lookup_cache, 0, sizeof(ts.class_lookup_cache));
+    #endif
+    #if MICROPY_ENABLE_PYSTACK
+    // the pystack is allocated below, and a collection run by that allocation
+    // must find an empty one
+    ts.pystack_start = NULL;
+    ts.pystack_end = NULL;
+    ts.pystack_cur = NULL;
+    #endif
 
     mp_stack_set_top(&ts + 1); // need to include ts in root-pointer scan
     mp_stack_set_limit(args->stack_size);
@@ -192,6 +205,11 @@ STATIC void *thread_entry(void *args_in) {
 
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
+        #if MICROPY_ENABLE_PYSTACK
+        // each thread gets its own pystack; it's kept alive by ts
+        byte *pystack = m_new(byte, MICROPY_PYSTACK_THREAD_SIZE);
+        mp_pystack_init(pystack, pystack + MICROPY_PYSTACK_THREAD_SIZE);
+        #endif
         mp_call_function_n_kw(args->fun, args->n_args, args->n_kw, args->args);
         nlr_pop();
     } else {
@@ -107,6 +107,99 @@
 #define MICROPY_ALLOC_GC_STACK_SIZE (64)
 #endif
 
+// Whether the GC sweeps the heap incrementally.  A collection then only does
+// the mark phase, and the sweep is done a few blocks at a time by subsequent
+// allocations, which shortens the pause of a collection on large heaps.
+// gc.collect() still completes the sweep before returning.  The mark phase
+// is not incremental: it still stops the world and its pause grows with the
+// amount of live data.
+#ifndef MICROPY_GC_INCREMENTAL_SWEEP
+#define MICROPY_GC_INCREMENTAL_SWEEP (0)
+#endif
+
+// Number of blocks swept by each allocation when the sweep is incremental.
+#ifndef MICROPY_GC_SWEEP_STEP_BLOCKS
+#define MICROPY_GC_SWEEP_STEP_BLOCKS (256)
+#endif
+
+// Whether the GC keeps long-lived allocations (compiled code, interned
+// strings) apart from short-lived ones, at the top of the heap.  This stops
+// them being scattered through the space used by temporary objects, where
+// they would fragment it.
+#ifndef MICROPY_GC_LONG_LIVED
+#define MICROPY_GC_LONG_LIVED (0)
+#endif
+
+// Whether the GC marks the heap using a pool of helper threads, which take
+// work from each other through the shared gc_stack.  Requires the port to
+// provide mp_thread_gc_parallel_count, mp_thread_gc_parallel and
+// mp_thread_gc_parallel_idle.  It has not yet been benchmarked on more than
+// one core, so ports only enable it for testing.
+#ifndef MICROPY_GC_PARALLEL_MARK
+#define MICROPY_GC_PARALLEL_MARK (0)
+#endif
+
+// Maximum number of threads, including the collecting one, used for marking.
+#ifndef MICROPY_GC_PARALLEL_MARK_MAX_THREADS
+#define MICROPY_GC_PARALLEL_MARK_MAX_THREADS (8)
+#endif
+
+// Number of entries in each marking thread's stack of blocks to trace.  The
+// stacks live in the GC state, so take MAX_THREADS times this many words.
+#ifndef MICROPY_GC_PARALLEL_MARK_STACK_SIZE
+#define MICROPY_GC_PARALLEL_MARK_STACK_SIZE (512)
+#endif
+
+// Heaps with fewer blocks than this are marked by the collecting thread alone.
+#ifndef MICROPY_GC_PARALLEL_MARK_MIN_BLOCKS
+#define MICROPY_GC_PARALLEL_MARK_MIN_BLOCKS (65536)
+#endif
+
+// Whether to provide gc_compact (and gc.compact), which moves the buffers of
+// lists, arrays and dicts down the heap to join up the free memory.  With
+// threads enabled the port must provide mp_thread_others_running.
+#ifndef MICROPY_GC_COMPACT
+#define MICROPY_GC_COMPACT (0)
+#endif
+
+// Whether to build in the allocation profiler (micropython.alloc_profile),
+// which samples allocations and counts them by source line and type.
+#ifndef MICROPY_ALLOC_PROFILE
+#define MICROPY_ALLOC_PROFILE (0)
+#endif
+
+// Number of distinct (source line, type) pairs the allocation profile holds.
+#ifndef MICROPY_ALLOC_PROFILE_ENTRIES
+#define MICROPY_ALLOC_PROFILE_ENTRIES (64)
+#endif
+
+// Whether to build in the sampling execution profiler
+// (micropython.profile_start/profile_stop), which counts the source lines
+// being executed at each tick of a timer provided by the port.  The port
+// must implement mp_hal_exec_profile_start/stop and call
+// mp_exec_profile_sample from the timer.  The profile takes
+// MICROPY_EXEC_PROFILE_ENTRIES * 4 words of RAM (2KB on 32-bit ports).
+#ifndef MICROPY_EXEC_PROFILE
+#define MICROPY_EXEC_PROFILE (0)
+#endif
+
+// Number of distinct source lines the execution profile holds.
+#ifndef MICROPY_EXEC_PROFILE_ENTRIES
+#define MICROPY_EXEC_PROFILE_ENTRIES (128)
+#endif
+
+// Whether each thread records the bytecode it's executing, which the
+// profilers use to attribute their samples.
+#define MICROPY_TRACK_CODE_STATE (MICROPY_ALLOC_PROFILE || MICROPY_EXEC_PROFILE)
+
+// Number of free-run indices kept by the GC allocator.  Index n records the
+// first allocation table byte that may begin a run of n + 1 free blocks, so
+// allocations of up to this many blocks skip over fragmented parts of the
+// heap instead of rescanning them.  Larger allocations use the last index.
+#ifndef MICROPY_ATB_INDICES
+#define MICROPY_ATB_INDICES (8)
+#endif
+
 // Be conservative and always clear to zero newly (re)allocated memory in the GC.
 // This helps eliminate stray pointers that hold on to memory that's no longer
 // used.  It decreases performance due to unnecessary memory clearing.
@@ -211,12 +304,36 @@
 #define MICROPY_QSTR_BYTES_IN_HASH (2)
 #endif
 
+// Whether each qstr pool has a hash index so that looking up a string is
+// constant-time per pool rather than a scan of every qstr.  The index of
+// the ROM pool is generated by makeqstrdata.py.  Costs 2-3 bytes per qstr.
+#ifndef MICROPY_QSTR_POOL_HASH_INDEX
+#define MICROPY_QSTR_POOL_HASH_INDEX (0)
+#endif
+
 // Avoid using C stack when making Python function calls. C stack still
 // may be used if there's no free heap.
 #ifndef MICROPY_STACKLESS
 #define MICROPY_STACKLESS (0)
 #endif
 
+// Allocate Python frames and temporary call argument arrays from a
+// dedicated, contiguous stack (the pystack) instead of alloca and the heap.
+// The port must call mp_pystack_init for each thread.
+#ifndef MICROPY_ENABLE_PYSTACK
+#define MICROPY_ENABLE_PYSTACK (0)
+#endif
+
+// Alignment in bytes of each allocation on the pystack
+#ifndef MICROPY_PYSTACK_ALIGN
+#define MICROPY_PYSTACK_ALIGN (8)
+#endif
+
+// Size in bytes of the pystack given to each new thread
+#ifndef MICROPY_PYSTACK_THREAD_SIZE
+#define MICROPY_PYSTACK_THREAD_SIZE (1024 * sizeof(void*))
+#endif
+
 // Never use C stack when making Python function calls. This may break
 // testsuite as will subtly change which exception is thrown in case
 // of too deep recursion and other similar cases.
@@ -321,9 +438,17 @@
 #if MICROPY_DYNAMIC_COMPILER
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE_DYNAMIC (mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode)
 #define MICROPY_PY_BUILTINS_STR_UNICODE_DYNAMIC (mp_dynamic_compiler.py_builtins_str_unicode)
+#define MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC (mp_dynamic_compiler.opt_superinstructions)
+#define MICROPY_NATIVE_CODE_STATE_WORDS_DYNAMIC (mp_dynamic_compiler.native_code_state_words)
+#define MICROPY_NATIVE_NLR_BUF_WORDS_DYNAMIC (mp_dynamic_compiler.native_nlr_buf_words)
+#define MICROPY_NATIVE_PYSTACK_DYNAMIC (mp_dynamic_compiler.native_pystack)
 #else
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE_DYNAMIC MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
 #define MICROPY_PY_BUILTINS_STR_UNICODE_DYNAMIC MICROPY_PY_BUILTINS_STR_UNICODE
+#define MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC MICROPY_OPT_SUPERINSTRUCTIONS
+#define MICROPY_NATIVE_CODE_STATE_WORDS_DYNAMIC (sizeof(mp_code_state_t) / sizeof(mp_uint_t))
+#define MICROPY_NATIVE_NLR_BUF_WORDS_DYNAMIC (sizeof(nlr_buf_t) / sizeof(mp_uint_t))
+#define MICROPY_NATIVE_PYSTACK_DYNAMIC MICROPY_ENABLE_PYSTACK
 #endif
 
 // Whether to enable constant folding; eg 1+2 rewritten as 3
@@ -384,6 +509,30 @@
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #endif
 
+// Whether the bytecode emitter fuses common sequences of opcodes into
+// superinstructions, eg LOAD_FAST LOAD_CONST_SMALL_INT BINARY_OP STORE_FAST,
+// or the increment and test of a "for i in range()" loop, and whether the VM
+// executes them.  Costs some VM code ROM, and the fused sequences usually
+// take a byte more bytecode than the separate opcodes.
+#ifndef MICROPY_OPT_SUPERINSTRUCTIONS
+#define MICROPY_OPT_SUPERINSTRUCTIONS (0)
+#endif
+
+// Whether to cache the result of looking up an attribute in the classes of
+// an instance (walking the bases of a user class and their dicts), keyed on
+// the type and attribute name.  Entries are invalidated whenever an attribute
+// of any class is stored or deleted, or a class is created; changes made to
+// a class's dict other than through the class are not seen.  Uses
+// MICROPY_OPT_CACHE_CLASS_LOOKUP_SIZE entries of 5 words per thread.
+#ifndef MICROPY_OPT_CACHE_CLASS_LOOKUP
+#define MICROPY_OPT_CACHE_CLASS_LOOKUP (0)
+#endif
+
+// Number of entries in the class lookup cache, must be a power of 2
+#ifndef MICROPY_OPT_CACHE_CLASS_LOOKUP_SIZE
+#define MICROPY_OPT_CACHE_CLASS_LOOKUP_SIZE (64)
+#endif
+
 // Whether to use fast versions of bitwise operations (and, or, xor) when the
 // arguments are both positive.  Increases Thumb2 code size by about 250 bytes.
 #ifndef MICROPY_OPT_MPZ_BITWISE
@@ -592,6 +741,13 @@ typedef double mp_float_t;
 #define MICROPY_MODULE_FROZEN_MPY (0)
 #endif
 
+// Attribute for the machine code of native functions in frozen .mpy files,
+// which is emitted as const data; ports that can't execute code from where
+// const data is placed should use it to put the code somewhere they can
+#ifndef MICROPY_FROZEN_NATIVE_CODE_ATTR
+#define MICROPY_FROZEN_NATIVE_CODE_ATTR
+#endif
+
 // Convenience macro for whether frozen modules are supported
 #ifndef MICROPY_MODULE_FROZEN
 #define MICROPY_MODULE_FROZEN (MICROPY_MODULE_FROZEN_STR || MICROPY_MODULE_FROZEN_MPY)
@@ -937,6 +1093,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_UZLIB (0)
 #endif
 
+// Whether to provide uzlib.compress and uzlib.CompIO
+// Depends on MICROPY_PY_UZLIB
+#ifndef MICROPY_PY_UZLIB_COMPRESS
+#define MICROPY_PY_UZLIB_COMPRESS (0)
+#endif
+
 #ifndef MICROPY_PY_UJSON
 #define MICROPY_PY_UJSON (0)
 #endif
@@ -945,6 +1107,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_URE (0)
 #endif
 
+// Number of compiled regexes that the module-level functions of ure keep
+// for reuse (0 to disable)
+#ifndef MICROPY_PY_URE_CACHE_SIZE
+#define MICROPY_PY_URE_CACHE_SIZE (4)
+#endif
+
 #ifndef MICROPY_PY_UHEAPQ
 #define MICROPY_PY_UHEAPQ (0)
 #endif
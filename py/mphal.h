@@ -70,6 +70,12 @@ mp_uint_t mp_hal_ticks_us(void);
 mp_uint_t mp_hal_ticks_cpu(void);
 #endif
 
+#if MICROPY_EXEC_PROFILE
+// start calling mp_exec_profile_sample about every period_us microseconds
+void mp_hal_exec_profile_start(mp_uint_t period_us);
+void mp_hal_exec_profile_stop(void);
+#endif
+
 // If port HAL didn't define its own pin API, use generic
 // "virtual pin" API from the core.
 #ifndef mp_hal_pin_obj_t
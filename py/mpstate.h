@@ -46,10 +46,53 @@ typedef struct mp_dynamic_compiler_t {
     uint8_t small_int_bits; // must be <= host small_int_bits
     bool opt_cache_map_lookup_in_bytecode;
     bool py_builtins_str_unicode;
+    bool opt_superinstructions;
+    uint8_t native_arch; // MP_NATIVE_ARCH_xxx of the native emitter to use
+    uint8_t native_code_state_words; // size of target's mp_code_state_t, without state
+    uint8_t native_nlr_buf_words; // size of target's nlr_buf_t
+    bool native_pystack; // whether the target uses a pystack
 } mp_dynamic_compiler_t;
 extern mp_dynamic_compiler_t mp_dynamic_compiler;
 #endif
 
+#if MICROPY_ALLOC_PROFILE
+// An entry of the allocation profile: the number of samples taken at a given
+// source line for objects of a given type.  The type is kept by name, since
+// a class may be freed while the profile holds it (MP_QSTR_NULL for other
+// allocations).
+typedef struct _mp_alloc_profile_entry_t {
+    qstr source_file;
+    qstr block_name;
+    size_t source_line;
+    qstr type_name;
+    size_t samples;
+} mp_alloc_profile_entry_t;
+#endif
+
+#if MICROPY_EXEC_PROFILE
+// An entry of the execution profile: the number of samples taken at a given
+// source line.
+typedef struct _mp_exec_profile_entry_t {
+    qstr source_file;
+    qstr block_name;
+    size_t source_line;
+    size_t samples;
+} mp_exec_profile_entry_t;
+#endif
+
+#if MICROPY_OPT_CACHE_CLASS_LOOKUP
+// An entry of the class lookup cache: the class dict value found for attr
+// when looking it up from type, and the class it was found in, or MP_OBJ_NULL
+// if no class has it.  It is valid while version equals class_lookup_version.
+typedef struct _mp_class_lookup_cache_entry_t {
+    const mp_obj_type_t *type;
+    qstr attr;
+    size_t version;
+    const mp_obj_type_t *member_type;
+    mp_obj_t member;
+} mp_class_lookup_cache_entry_t;
+#endif
+
 // This structure hold information about the memory allocation system.
 typedef struct _mp_state_mem_t {
     #if MICROPY_MEM_STATS
@@ -81,7 +124,59 @@ typedef struct _mp_state_mem_t {
     size_t gc_alloc_threshold;
     #endif
 
-    size_t gc_last_free_atb_index;
+    // Indices of the first ATB that may begin a run of free blocks, one per
+    // run length (see MICROPY_ATB_INDICES).  Entry n covers runs of at least
+    // n + 1 blocks; the last entry covers all longer runs too.
+    size_t gc_first_free_atb_index[MICROPY_ATB_INDICES];
+
+    #if MICROPY_GC_LONG_LIVED
+    size_t gc_long_lived_atb_index;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // The next block to be swept after a collection, or the total number of
+    // blocks if the sweep is complete.
+    size_t gc_sweep_block;
+    #endif
+
+    #if MICROPY_GC_PARALLEL_MARK
+    // Protects gc_stack while it is shared by the marking threads.
+    mp_thread_mutex_t gc_mark_mutex;
+    // Number of marking threads, and how many of them still have work.
+    size_t gc_mark_threads;
+    size_t gc_mark_busy;
+    // Whether the markers must rescan the heap after a stack overflow.
+    bool gc_mark_rescan;
+    // The stack of blocks to trace for each marking thread.
+    size_t gc_mark_stack[MICROPY_GC_PARALLEL_MARK_MAX_THREADS][MICROPY_GC_PARALLEL_MARK_STACK_SIZE];
+    #endif
+
+    #if MICROPY_GC_COMPACT
+    // Set while gc_collect is running a round of compaction.
+    uint8_t gc_compacting;
+    // The next block to look for buffer owners at, and the number of blocks
+    // moved by the last compaction.
+    size_t gc_compact_block;
+    size_t gc_compacted;
+    #endif
+
+    #if MICROPY_ALLOC_PROFILE
+    // An allocation is sampled each time another alloc_profile_interval
+    // bytes have been allocated, or never if it is 0.  The interval the
+    // recorded samples were taken with is kept when profiling is stopped.
+    size_t alloc_profile_interval;
+    size_t alloc_profile_sample_bytes;
+    size_t alloc_profile_countdown;
+    size_t alloc_profile_dropped;
+    // The latest sample, whose type is read at the next allocation, when its
+    // object has been set up.  Until then its block is kept, along with the
+    // block allocated before it, which may be the object owning it.
+    mp_alloc_profile_entry_t alloc_profile_pending;
+    size_t alloc_profile_pending_block;
+    size_t alloc_profile_pending_owner;
+    size_t alloc_profile_last_block;
+    mp_alloc_profile_entry_t alloc_profile[MICROPY_ALLOC_PROFILE_ENTRIES];
+    #endif
 
     #if MICROPY_PY_GC_COLLECT_RETVAL
     size_t gc_collected;
@@ -160,6 +255,11 @@ typedef struct _mp_state_vm_t {
     mp_obj_t lwip_slip_stream;
     #endif
 
+    #if MICROPY_PY_URE && MICROPY_PY_URE_CACHE_SIZE
+    // recently compiled regexes, most recently used first
+    mp_obj_t ure_cache[MICROPY_PY_URE_CACHE_SIZE];
+    #endif
+
     #if MICROPY_FSUSERMOUNT
     // for user-mountable block device (max fixed at compile time)
     struct _fs_user_mount_t *fs_user_mount[MICROPY_FATFS_VOLUMES];
@@ -182,6 +282,21 @@ typedef struct _mp_state_vm_t {
 
     mp_uint_t mp_optimise_value;
 
+    #if MICROPY_EXEC_PROFILE
+    // Samples are only recorded while exec_profile_running is set.  Those
+    // taken outside bytecode, or when the profile is full, are counted in
+    // exec_profile_dropped.
+    volatile bool exec_profile_running;
+    size_t exec_profile_dropped;
+    mp_exec_profile_entry_t exec_profile[MICROPY_EXEC_PROFILE_ENTRIES];
+    #endif
+
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    // bumped whenever a class attribute is stored or deleted, or a class
+    // is created, invalidating all class lookup cache entries
+    size_t class_lookup_version;
+    #endif
+
     // size of the emergency exception buf, if it's dynamically allocated
     #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0
     mp_int_t mp_emergency_exception_buf_size;
@@ -206,6 +321,23 @@ typedef struct _mp_state_thread_t {
     #if MICROPY_STACK_CHECK
     size_t stack_limit;
     #endif
+
+    #if MICROPY_ENABLE_PYSTACK
+    // Python frames and temporary call args are allocated from here
+    byte *pystack_start;
+    byte *pystack_end;
+    byte *pystack_cur;
+    #endif
+
+    #if MICROPY_TRACK_CODE_STATE
+    // The bytecode being executed, for the profilers.
+    struct _mp_code_state_t *current_code_state;
+    #endif
+
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    // per thread so that entries are never seen half-written
+    mp_class_lookup_cache_entry_t class_lookup_cache[MICROPY_OPT_CACHE_CLASS_LOOKUP_SIZE];
+    #endif
 } mp_state_thread_t;
 
 // This structure combines the above 3 structures, and adds the local
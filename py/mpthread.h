@@ -26,6 +26,8 @@
 #ifndef __MICROPY_INCLUDED_PY_MPTHREAD_H__
 #define __MICROPY_INCLUDED_PY_MPTHREAD_H__
 
+#include <stdbool.h>
+
 #include "py/mpconfig.h"
 
 #if MICROPY_PY_THREAD
@@ -47,6 +49,16 @@ void mp_thread_mutex_init(mp_thread_mutex_t *mutex);
 int mp_thread_mutex_lock(mp_thread_mutex_t *mutex, int wait);
 void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex);
 
+#if MICROPY_GC_PARALLEL_MARK
+size_t mp_thread_gc_parallel_count(void);
+void mp_thread_gc_parallel(void (*fun)(size_t id), size_t n);
+void mp_thread_gc_parallel_idle(void);
+#endif
+
+#if MICROPY_GC_COMPACT
+bool mp_thread_others_running(void);
+#endif
+
 #endif // MICROPY_PY_THREAD
 
 #if MICROPY_PY_THREAD && MICROPY_PY_THREAD_GIL
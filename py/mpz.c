@@ -422,12 +422,16 @@ STATIC mp_uint_t mpn_mul_dig_add_dig(mpz_dig_t *idig, mp_uint_t ilen, mpz_dig_t
     return idig - oidig;
 }
 
-/* computes i = j * k
+// Multiplications where both operands have at least this many digits use
+// Karatsuba's method instead of long multiplication.
+#define MPN_KARATSUBA_THRESHOLD (48)
+
+/* computes i = j * k by long multiplication
    returns number of digits in i
    assumes enough memory in i; assumes i is zeroed; assumes normalised j, k
    can have j, k point to same memory
 */
-STATIC mp_uint_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, mp_uint_t jlen, mpz_dig_t *kdig, mp_uint_t klen) {
+STATIC mp_uint_t mpn_mul_long(mpz_dig_t *idig, const mpz_dig_t *jdig, mp_uint_t jlen, const mpz_dig_t *kdig, mp_uint_t klen) {
     mpz_dig_t *oidig = idig;
     mp_uint_t ilen = 0;
 
@@ -436,7 +440,7 @@ STATIC mp_uint_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, mp_uint_t jlen, mpz_d
         mpz_dbl_dig_t carry = 0;
 
         mp_uint_t jl = jlen;
-        for (mpz_dig_t *jd = jdig; jl > 0; --jl, ++jd, ++id) {
+        for (const mpz_dig_t *jd = jdig; jl > 0; --jl, ++jd, ++id) {
             carry += (mpz_dbl_dig_t)*id + (mpz_dbl_dig_t)*jd * (mpz_dbl_dig_t)*kdig; // will never overflow so long as DIG_SIZE <= 8*sizeof(mpz_dbl_dig_t)/2
             *id = carry & DIG_MASK;
             carry >>= DIG_SIZE;
@@ -452,6 +456,131 @@ STATIC mp_uint_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, mp_uint_t jlen, mpz_d
     return ilen;
 }
 
+/* computes i = j + k over exactly ilen digits, where klen <= ilen
+   returns the carry out of the top digit
+   j, k need not be normalised; can have i, j, k pointing to same memory
+*/
+STATIC mpz_dig_t mpn_add_fixed(mpz_dig_t *idig, const mpz_dig_t *jdig, mp_uint_t ilen, const mpz_dig_t *kdig, mp_uint_t klen) {
+    mpz_dbl_dig_t carry = 0;
+    for (mp_uint_t n = 0; n < ilen; ++n) {
+        carry += (mpz_dbl_dig_t)jdig[n];
+        if (n < klen) {
+            carry += (mpz_dbl_dig_t)kdig[n];
+        }
+        idig[n] = carry & DIG_MASK;
+        carry >>= DIG_SIZE;
+    }
+    return carry;
+}
+
+/* computes i = i - k over exactly ilen digits, where klen <= ilen
+   assumes i >= k; i, k need not be normalised
+*/
+STATIC void mpn_sub_fixed(mpz_dig_t *idig, mp_uint_t ilen, const mpz_dig_t *kdig, mp_uint_t klen) {
+    mpz_dbl_dig_signed_t borrow = 0;
+    for (mp_uint_t n = 0; n < ilen && (n < klen || borrow != 0); ++n) {
+        borrow += (mpz_dbl_dig_t)idig[n];
+        if (n < klen) {
+            borrow -= (mpz_dbl_dig_t)kdig[n];
+        }
+        idig[n] = borrow & DIG_MASK;
+        borrow >>= DIG_SIZE;
+    }
+}
+
+/* returns the number of digits of scratch memory needed by mpn_mul_kara for n
+*/
+STATIC mp_uint_t mpn_mul_kara_tmp_len(mp_uint_t n) {
+    mp_uint_t len = 0;
+    while (n >= MPN_KARATSUBA_THRESHOLD) {
+        n = n - n / 2 + 1;
+        len += 4 * n;
+    }
+    return len;
+}
+
+/* computes i = j * k using Karatsuba's method, where j and k both have n
+   digits and i has 2n digits, which are all written
+   j, k need not be normalised; tmp must have mpn_mul_kara_tmp_len(n) digits
+*/
+STATIC void mpn_mul_kara(mpz_dig_t *idig, const mpz_dig_t *jdig, const mpz_dig_t *kdig, mp_uint_t n, mpz_dig_t *tmp) {
+    if (n < MPN_KARATSUBA_THRESHOLD) {
+        memset(idig, 0, 2 * n * sizeof(mpz_dig_t));
+        mpn_mul_long(idig, jdig, n, kdig, n);
+        return;
+    }
+
+    // split j = j1 * B^h + j0 and k = k1 * B^h + k0, with the high parts m long
+    mp_uint_t h = n / 2;
+    mp_uint_t m = n - h;
+    mpz_dig_t *jsum = tmp;
+    mpz_dig_t *ksum = jsum + m + 1;
+    mpz_dig_t *mid = ksum + m + 1;
+    tmp = mid + 2 * (m + 1);
+
+    // j0 * k0 and j1 * k1 go straight into the low and high halves of i
+    mpn_mul_kara(idig, jdig, kdig, h, tmp);
+    mpn_mul_kara(idig + 2 * h, jdig + h, kdig + h, m, tmp);
+
+    // j0 * k1 + j1 * k0 = (j0 + j1) * (k0 + k1) - j0 * k0 - j1 * k1
+    jsum[m] = mpn_add_fixed(jsum, jdig + h, m, jdig, h);
+    ksum[m] = mpn_add_fixed(ksum, kdig + h, m, kdig, h);
+    mpn_mul_kara(mid, jsum, ksum, m + 1, tmp);
+    mpn_sub_fixed(mid, 2 * (m + 1), idig, 2 * h);
+    mpn_sub_fixed(mid, 2 * (m + 1), idig + 2 * h, 2 * m);
+
+    // add in the middle term at digit h; there's no carry out of i
+    mpn_add_fixed(idig + h, idig + h, 2 * n - h, mid, 2 * (m + 1));
+}
+
+/* computes i = j * k
+   returns number of digits in i
+   assumes enough memory in i; assumes i is zeroed; assumes normalised j, k
+   can have j, k point to same memory
+*/
+STATIC mp_uint_t mpn_mul(mpz_dig_t *idig, const mpz_dig_t *jdig, mp_uint_t jlen, const mpz_dig_t *kdig, mp_uint_t klen) {
+    if (jlen < klen) {
+        const mpz_dig_t *t = jdig;
+        jdig = kdig;
+        kdig = t;
+        mp_uint_t tl = jlen;
+        jlen = klen;
+        klen = tl;
+    }
+
+    if (klen < MPN_KARATSUBA_THRESHOLD) {
+        return mpn_mul_long(idig, jdig, jlen, kdig, klen);
+    }
+
+    // multiply k by pieces of j that are each as long as k
+    mp_uint_t tmp_len = 3 * klen + mpn_mul_kara_tmp_len(klen);
+    mpz_dig_t *tmp = m_new(mpz_dig_t, tmp_len);
+    mpz_dig_t *prod = tmp;
+    mpz_dig_t *piece = prod + 2 * klen;
+    for (mp_uint_t pos = 0; pos < jlen; pos += klen) {
+        mp_uint_t n = MIN(klen, jlen - pos);
+        if (n == klen) {
+            mpn_mul_kara(prod, jdig + pos, kdig, klen, piece + klen);
+        } else if (n >= MPN_KARATSUBA_THRESHOLD) {
+            memcpy(piece, jdig + pos, n * sizeof(mpz_dig_t));
+            memset(piece + n, 0, (klen - n) * sizeof(mpz_dig_t));
+            mpn_mul_kara(prod, piece, kdig, klen, piece + klen);
+        } else {
+            memset(prod, 0, (n + klen) * sizeof(mpz_dig_t));
+            mpn_mul_long(prod, kdig, klen, jdig + pos, n);
+        }
+        mpz_dig_t carry = mpn_add_fixed(idig + pos, idig + pos, n + klen, prod, n + klen);
+        for (mpz_dig_t *id = idig + pos + n + klen; carry != 0; ++id) {
+            mpz_dbl_dig_t d = (mpz_dbl_dig_t)*id + carry;
+            *id = d & DIG_MASK;
+            carry = d >> DIG_SIZE;
+        }
+    }
+    m_del(mpz_dig_t, tmp, tmp_len);
+
+    return mpn_remove_trailing_zeros(idig, idig + jlen + klen);
+}
+
 /* natural_div - quo * den + new_num = old_num (ie num is replaced with rem)
    assumes den != 0
    assumes num_dig has enough memory to be extended by 1 digit
@@ -526,98 +655,41 @@ STATIC void mpn_div(mpz_dig_t *num_dig, mp_uint_t *num_len, const mpz_dig_t *den
         quo /= lead_den_digit;
 
         // Multiply quo by den and subtract from num to get remainder.
-        // We have different code here to handle different compile-time
-        // configurations of mpz:
-        //
-        //   1. DIG_SIZE is stricly less than half the number of bits
-        //      available in mpz_dbl_dig_t.  In this case we can use a
-        //      slightly more optimal (in time and space) routine that
-        //      uses the extra bits in mpz_dbl_dig_signed_t to store a
-        //      sign bit.
-        //
-        //   2. DIG_SIZE is exactly half the number of bits available in
-        //      mpz_dbl_dig_t.  In this (common) case we need to be careful
-        //      not to overflow the borrow variable.  And the shifting of
-        //      borrow needs some special logic (it's a shift right with
-        //      round up).
-
-        if (DIG_SIZE < 8 * sizeof(mpz_dbl_dig_t) / 2) {
-            const mpz_dig_t *d = den_dig;
-            mpz_dbl_dig_t d_norm = 0;
-            mpz_dbl_dig_signed_t borrow = 0;
-
-            for (mpz_dig_t *n = num_dig - den_len; n < num_dig; ++n, ++d) {
-                d_norm = ((mpz_dbl_dig_t)*d << norm_shift) | (d_norm >> DIG_SIZE);
-                borrow += (mpz_dbl_dig_t)*n - (mpz_dbl_dig_t)quo * (d_norm & DIG_MASK); // will overflow if DIG_SIZE >= 8*sizeof(mpz_dbl_dig_t)/2
-                *n = borrow & DIG_MASK;
-                borrow >>= DIG_SIZE;
-            }
-            borrow += *num_dig; // will overflow if DIG_SIZE >= 8*sizeof(mpz_dbl_dig_t)/2
-            *num_dig = borrow & DIG_MASK;
-            borrow >>= DIG_SIZE;
-
-            // adjust quotient if it is too big
-            for (; borrow != 0; --quo) {
-                d = den_dig;
-                d_norm = 0;
-                mpz_dbl_dig_t carry = 0;
-                for (mpz_dig_t *n = num_dig - den_len; n < num_dig; ++n, ++d) {
-                    d_norm = ((mpz_dbl_dig_t)*d << norm_shift) | (d_norm >> DIG_SIZE);
-                    carry += (mpz_dbl_dig_t)*n + (d_norm & DIG_MASK);
-                    *n = carry & DIG_MASK;
-                    carry >>= DIG_SIZE;
-                }
-                carry += *num_dig;
-                *num_dig = carry & DIG_MASK;
-                carry >>= DIG_SIZE;
-
-                borrow += carry;
-            }
-        } else { // DIG_SIZE == 8 * sizeof(mpz_dbl_dig_t) / 2
-            const mpz_dig_t *d = den_dig;
-            mpz_dbl_dig_t d_norm = 0;
-            mpz_dbl_dig_t borrow = 0;
+        // Must be careful with overflow of the borrow variable.  Both
+        // borrow and low_digs are signed values and need signed right-shift,
+        // but x is unsigned and may take a full-range value.
+        const mpz_dig_t *d = den_dig;
+        mpz_dbl_dig_t d_norm = 0;
+        mpz_dbl_dig_signed_t borrow = 0;
+        for (mpz_dig_t *n = num_dig - den_len; n < num_dig; ++n, ++d) {
+            // get the next digit in den
+            d_norm = ((mpz_dbl_dig_t)*d << norm_shift) | (d_norm >> DIG_SIZE);
+            // multiply the next digit in quo * den
+            mpz_dbl_dig_t x = (mpz_dbl_dig_t)quo * (d_norm & DIG_MASK);
+            // compute the low DIG_SIZE bits of the next digit in num - quo * den
+            mpz_dbl_dig_signed_t low_digs = (borrow & DIG_MASK) + *n - (x & DIG_MASK);
+            *n = low_digs & DIG_MASK;
+            // compute the borrow, shifting before summing to avoid overflow
+            borrow = (borrow >> DIG_SIZE) - (x >> DIG_SIZE) + (low_digs >> DIG_SIZE);
+        }
 
+        // Now either quo was right and borrow cancels the top digit of num,
+        // or quo was too big and we must add den back to num until the carry
+        // cancels the borrow.
+        borrow += *num_dig;
+        for (; borrow != 0; --quo) {
+            d = den_dig;
+            d_norm = 0;
+            mpz_dbl_dig_t carry = 0;
             for (mpz_dig_t *n = num_dig - den_len; n < num_dig; ++n, ++d) {
                 d_norm = ((mpz_dbl_dig_t)*d << norm_shift) | (d_norm >> DIG_SIZE);
-                mpz_dbl_dig_t x = (mpz_dbl_dig_t)quo * (d_norm & DIG_MASK);
-                if (x >= *n || *n - x <= borrow) {
-                    borrow += (mpz_dbl_dig_t)x - (mpz_dbl_dig_t)*n;
-                    *n = (-borrow) & DIG_MASK;
-                    borrow = (borrow >> DIG_SIZE) + ((borrow & DIG_MASK) == 0 ? 0 : 1); // shift-right with round-up
-                } else {
-                    *n = ((mpz_dbl_dig_t)*n - (mpz_dbl_dig_t)x - (mpz_dbl_dig_t)borrow) & DIG_MASK;
-                    borrow = 0;
-                }
-            }
-            if (borrow >= *num_dig) {
-                borrow -= (mpz_dbl_dig_t)*num_dig;
-                *num_dig = (-borrow) & DIG_MASK;
-                borrow = (borrow >> DIG_SIZE) + ((borrow & DIG_MASK) == 0 ? 0 : 1); // shift-right with round-up
-            } else {
-                *num_dig = (*num_dig - borrow) & DIG_MASK;
-                borrow = 0;
-            }
-
-            // adjust quotient if it is too big
-            for (; borrow != 0; --quo) {
-                d = den_dig;
-                d_norm = 0;
-                mpz_dbl_dig_t carry = 0;
-                for (mpz_dig_t *n = num_dig - den_len; n < num_dig; ++n, ++d) {
-                    d_norm = ((mpz_dbl_dig_t)*d << norm_shift) | (d_norm >> DIG_SIZE);
-                    carry += (mpz_dbl_dig_t)*n + (d_norm & DIG_MASK);
-                    *n = carry & DIG_MASK;
-                    carry >>= DIG_SIZE;
-                }
-                carry += (mpz_dbl_dig_t)*num_dig;
-                *num_dig = carry & DIG_MASK;
+                carry += (mpz_dbl_dig_t)*n + (d_norm & DIG_MASK);
+                *n = carry & DIG_MASK;
                 carry >>= DIG_SIZE;
-
-                //assert(borrow >= carry); // enable this to check the logic
-                borrow -= carry;
             }
+            borrow += carry;
         }
+        *num_dig = 0;
 
         // store this digit of the quotient
         *quo_dig = quo & DIG_MASK;
@@ -872,41 +944,139 @@ typedef uint32_t mp_float_int_t;
 }
 #endif
 
-// returns number of bytes from str that were processed
-mp_uint_t mpz_set_from_str(mpz_t *z, const char *str, mp_uint_t len, bool neg, mp_uint_t base) {
-    assert(base <= 36);
+// Radix conversion of long numbers is done by splitting them in half
+// recursively, using powers of the base that cover (chunk_chars << k) chars.
+// Below these sizes (in chars and digits respectively) the simple loops that
+// handle a digit's worth of chars at a time are faster.
+#define MPZ_FROM_STR_DC_THRESHOLD (1000)
+#define MPZ_AS_STR_DC_THRESHOLD (30)
 
-    const char *cur = str;
-    const char *top = str + len;
+/* returns the largest power of base that fits in a digit
+   the number of chars that it covers is returned in *chars
+*/
+STATIC mpz_dig_t mpz_radix_chunk(mp_uint_t base, mp_uint_t *chars) {
+    mpz_dbl_dig_t p = base;
+    mp_uint_t n = 1;
+    while (p * base <= DIG_MASK) {
+        p *= base;
+        n += 1;
+    }
+    *chars = n;
+    return p;
+}
 
-    mpz_need_dig(z, len * 8 / DIG_SIZE + 1);
+/* returns a new array of the powers chunk ** (2 ** k), for 0 <= k < n
+*/
+STATIC mpz_t *mpz_radix_powers(mpz_dig_t chunk, size_t n) {
+    mpz_t *pows = m_new(mpz_t, n);
+    mpz_init_from_int(&pows[0], chunk);
+    for (size_t k = 1; k < n; ++k) {
+        mpz_init_zero(&pows[k]);
+        mpz_mul_inpl(&pows[k], &pows[k - 1], &pows[k - 1]);
+    }
+    return pows;
+}
 
-    if (neg) {
-        z->neg = 1;
+STATIC void mpz_radix_powers_free(mpz_t *pows, size_t n) {
+    for (size_t k = 0; k < n; ++k) {
+        mpz_deinit(&pows[k]);
+    }
+    m_del(mpz_t, pows, n);
+}
+
+// returns the value of the char c as a digit, or 36 if it's not a digit
+static inline mp_uint_t mpz_digit_value(mp_uint_t c) {
+    if ('0' <= c && c <= '9') {
+        return c - '0';
+    } else if ('A' <= c && c <= 'Z') {
+        return c - ('A' - 10);
+    } else if ('a' <= c && c <= 'z') {
+        return c - ('a' - 10);
     } else {
-        z->neg = 0;
+        return 36;
     }
+}
 
-    z->len = 0;
-    for (; cur < top; ++cur) { // XXX UTF8 next char
-        //mp_uint_t v = char_to_numeric(cur#); // XXX UTF8 get char
-        mp_uint_t v = *cur;
-        if ('0' <= v && v <= '9') {
-            v -= '0';
-        } else if ('A' <= v && v <= 'Z') {
-            v -= 'A' - 10;
-        } else if ('a' <= v && v <= 'z') {
-            v -= 'a' - 10;
-        } else {
-            break;
+/* computes i = value of the n chars in str, which must all be valid digits
+   returns number of digits in i
+   assumes enough memory in i
+*/
+STATIC mp_uint_t mpn_from_str(mpz_dig_t *idig, const char *str, size_t n, mp_uint_t base) {
+    mp_uint_t chunk_chars;
+    mpz_radix_chunk(base, &chunk_chars);
+
+    // convert a digit's worth of chars at a time
+    mp_uint_t ilen = 0;
+    while (n > 0) {
+        mp_uint_t k = MIN(chunk_chars, n);
+        n -= k;
+        mpz_dig_t mul = 1;
+        mpz_dig_t add = 0;
+        for (; k > 0; --k) {
+            mul *= base;
+            add = add * base + mpz_digit_value((byte)*str++);
         }
-        if (v >= base) {
-            break;
+        ilen = mpn_mul_dig_add_dig(idig, ilen, mul, add);
+    }
+
+    return ilen;
+}
+
+/* computes z = value of the n chars in str, by splitting off the low
+   chunk_chars << (k - 1) chars and converting both halves recursively
+   pows are the powers from mpz_radix_powers; z must be non-negative
+*/
+STATIC void mpz_set_from_str_dc(mpz_t *z, const char *str, size_t n, mp_uint_t base, const mpz_t *pows, mp_uint_t chunk_chars, size_t k) {
+    while (k > 0 && (chunk_chars << (k - 1)) >= n) {
+        --k;
+    }
+
+    if (k == 0 || n < MPZ_FROM_STR_DC_THRESHOLD) {
+        mpz_need_dig(z, n * 8 / DIG_SIZE + 1);
+        z->len = mpn_from_str(z->dig, str, n, base);
+        return;
+    }
+
+    size_t low_chars = chunk_chars << (k - 1);
+    mpz_t low; mpz_init_zero(&low);
+    mpz_set_from_str_dc(z, str, n - low_chars, base, pows, chunk_chars, k - 1);
+    mpz_set_from_str_dc(&low, str + n - low_chars, low_chars, base, pows, chunk_chars, k - 1);
+    mpz_mul_inpl(z, z, &pows[k - 1]);
+    mpz_add_inpl(z, z, &low);
+    mpz_deinit(&low);
+}
+
+// returns number of bytes from str that were processed
+mp_uint_t mpz_set_from_str(mpz_t *z, const char *str, mp_uint_t len, bool neg, mp_uint_t base) {
+    assert(base <= 36);
+
+    // find the extent of the valid digits
+    size_t n = 0;
+    while (n < len && mpz_digit_value((byte)str[n]) < base) { // XXX UTF8
+        ++n;
+    }
+
+    z->neg = 0;
+    if (n < MPZ_FROM_STR_DC_THRESHOLD) {
+        mpz_need_dig(z, n * 8 / DIG_SIZE + 1);
+        z->len = mpn_from_str(z->dig, str, n, base);
+    } else {
+        mp_uint_t chunk_chars;
+        mpz_dig_t chunk = mpz_radix_chunk(base, &chunk_chars);
+        size_t k = 1;
+        while ((chunk_chars << k) < n) {
+            ++k;
         }
-        z->len = mpn_mul_dig_add_dig(z->dig, z->len, base, v);
+        mpz_t *pows = mpz_radix_powers(chunk, k);
+        mpz_set_from_str_dc(z, str, n, base, pows, chunk_chars, k);
+        mpz_radix_powers_free(pows, k);
+    }
+
+    if (neg) {
+        z->neg = 1;
     }
 
-    return cur - str;
+    return n;
 }
 
 bool mpz_is_zero(const mpz_t *z) {
@@ -1364,47 +1534,217 @@ void mpz_pow_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs) {
     mpz_free(n);
 }
 
-#if 0
-these functions are unused
+/* computes i = t / R mod m by Montgomery reduction, where R = 2 ** (DIG_SIZE * n)
+   t has 2n digits and is destroyed; i has n digits, which are all written
+   assumes t < m * R; minv is -1 / m mod 2 ** DIG_SIZE
+*/
+STATIC void mpn_redc(mpz_dig_t *idig, mpz_dig_t *tdig, const mpz_dig_t *mdig, mp_uint_t n, mpz_dig_t minv) {
+    mpz_dig_t top = 0;
 
-/* computes dest = (lhs ** rhs) % mod
-   can have dest, lhs, rhs the same; mod can't be the same as dest
+    for (mp_uint_t j = 0; j < n; ++j) {
+        // add the multiple of m that clears digit j of t
+        mpz_dig_t u = ((mpz_dbl_dig_t)tdig[j] * minv) & DIG_MASK;
+        mpz_dbl_dig_t carry = 0;
+        for (mp_uint_t k = 0; k < n; ++k) {
+            carry += (mpz_dbl_dig_t)tdig[j + k] + (mpz_dbl_dig_t)u * (mpz_dbl_dig_t)mdig[k]; // will never overflow
+            tdig[j + k] = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+        for (mp_uint_t k = j + n; carry != 0 && k < 2 * n; ++k) {
+            carry += (mpz_dbl_dig_t)tdig[k];
+            tdig[k] = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+        top += carry;
+    }
+
+    // t / R is now the top half of t (plus top * R), and is less than 2m
+    tdig += n;
+    int cmp = top;
+    for (mp_uint_t k = n; cmp == 0 && k-- > 0;) {
+        cmp = (tdig[k] > mdig[k]) - (tdig[k] < mdig[k]);
+    }
+    if (cmp >= 0) {
+        mpn_sub_fixed(tdig, n, mdig, n);
+    }
+    memcpy(idig, tdig, n * sizeof(mpz_dig_t));
+}
+
+/* computes dest = (x ** e) % m using Montgomery multiplication, with 4-bit
+   windows of the exponent
+   assumes m is odd, 0 <= x < m and e >= 0
 */
-void mpz_pow3_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t *mod) {
-    if (lhs->len == 0 || rhs->neg != 0) {
-        mpz_set_from_int(dest, 0);
-        return;
+STATIC void mpz_pow3_monty(mpz_t *dest, const mpz_t *x, const mpz_t *e, const mpz_t *m) {
+    const mp_uint_t n = m->len;
+
+    // -1 / m mod 2 ** DIG_SIZE by Newton's iteration; m is its own inverse to 3 bits
+    mpz_dbl_dig_t inv = m->dig[0];
+    for (mp_uint_t bits = 3; bits < DIG_SIZE; bits *= 2) {
+        inv = (inv * (2 - m->dig[0] * inv)) & DIG_MASK;
     }
+    mpz_dig_t minv = (0 - inv) & DIG_MASK;
 
-    if (rhs->len == 0) {
-        mpz_set_from_int(dest, 1);
-        return;
+    // table[w] = x ** w * R mod m, and acc and the product t after it
+    mp_uint_t tmp_len = 16 * n + n + 2 * n + mpn_mul_kara_tmp_len(n);
+    mpz_dig_t *table = m_new0(mpz_dig_t, tmp_len);
+    mpz_dig_t *acc = table + 16 * n;
+    mpz_dig_t *t = acc + n;
+    mpz_dig_t *kara_tmp = t + 2 * n;
+
+    // convert 1 and x to Montgomery form
+    mpz_t z; mpz_init_zero(&z);
+    mpz_t quo; mpz_init_zero(&quo);
+    for (int w = 0; w < 2; ++w) {
+        if (w == 0) {
+            mpz_set_from_int(&z, 1);
+            mpz_shl_inpl(&z, &z, n * DIG_SIZE);
+        } else {
+            mpz_shl_inpl(&z, x, n * DIG_SIZE);
+        }
+        mpz_divmod_inpl(&quo, &z, &z, m);
+        memcpy(table + w * n, z.dig, z.len * sizeof(mpz_dig_t));
+    }
+    mpz_deinit(&quo);
+    mpz_deinit(&z);
+
+    for (int w = 2; w < 16; ++w) {
+        mpn_mul_kara(t, table + (w - 1) * n, table + n, n, kara_tmp);
+        mpn_redc(table + w * n, t, m->dig, n, minv);
     }
 
-    mpz_t *x = mpz_clone(lhs);
+    // raise to the power e, working from the top window down
+    size_t e_bits = 0;
+    if (e->len > 0) {
+        e_bits = (e->len - 1) * DIG_SIZE;
+        for (mpz_dig_t d = e->dig[e->len - 1]; d != 0; d >>= 1) {
+            ++e_bits;
+        }
+    }
+    memcpy(acc, table, n * sizeof(mpz_dig_t));
+    size_t top = (e_bits + 3) & ~(size_t)3;
+    for (size_t pos = top; pos > 0;) {
+        mp_uint_t w = 0;
+        for (int b = 0; b < 4; ++b) {
+            --pos;
+            w = (w << 1) | ((pos < e_bits) && ((e->dig[pos / DIG_SIZE] >> (pos % DIG_SIZE)) & 1));
+            if (pos + 4 < top) {
+                mpn_mul_kara(t, acc, acc, n, kara_tmp);
+                mpn_redc(acc, t, m->dig, n, minv);
+            }
+        }
+        if (w != 0) {
+            mpn_mul_kara(t, acc, table + w * n, n, kara_tmp);
+            mpn_redc(acc, t, m->dig, n, minv);
+        }
+    }
+
+    // convert back from Montgomery form
+    memcpy(t, acc, n * sizeof(mpz_dig_t));
+    memset(t + n, 0, n * sizeof(mpz_dig_t));
+    mpn_redc(acc, t, m->dig, n, minv);
+
+    mpz_need_dig(dest, n);
+    memcpy(dest->dig, acc, n * sizeof(mpz_dig_t));
+    dest->len = mpn_remove_trailing_zeros(dest->dig, dest->dig + n);
+    dest->neg = 0;
+
+    m_del(mpz_dig_t, table, tmp_len);
+}
+
+/* computes dest = (lhs ** rhs) % mod, where the result has the sign of mod
+   can have dest, lhs, rhs the same; mod can't be the same as dest
+   assumes rhs >= 0 and mod != 0
+*/
+void mpz_pow3_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t *mod) {
+    assert(rhs->neg == 0 && !mpz_is_zero(mod));
+
+    // work with the absolute value of mod, sharing its digits
+    mpz_t m = *mod;
+    m.neg = 0;
+
+    mpz_t x; mpz_init_zero(&x);
     mpz_t *n = mpz_clone(rhs);
     mpz_t quo; mpz_init_zero(&quo);
+    mpz_divmod_inpl(&quo, &x, lhs, &m);
 
-    mpz_set_from_int(dest, 1);
+    if ((m.dig[0] & 1) != 0) {
+        mpz_pow3_monty(dest, &x, n, &m);
+    } else {
+        mpz_set_from_int(dest, 1);
+        mpz_divmod_inpl(&quo, dest, dest, &m);
 
-    while (n->len > 0) {
-        if ((n->dig[0] & 1) != 0) {
-            mpz_mul_inpl(dest, dest, x);
-            mpz_divmod_inpl(&quo, dest, dest, mod);
-        }
-        n->len = mpn_shr(n->dig, n->dig, n->len, 1);
-        if (n->len == 0) {
-            break;
+        while (n->len > 0) {
+            if ((n->dig[0] & 1) != 0) {
+                mpz_mul_inpl(dest, dest, &x);
+                mpz_divmod_inpl(&quo, dest, dest, &m);
+            }
+            n->len = mpn_shr(n->dig, n->dig, n->len, 1);
+            if (n->len == 0) {
+                break;
+            }
+            mpz_mul_inpl(&x, &x, &x);
+            mpz_divmod_inpl(&quo, &x, &x, &m);
         }
-        mpz_mul_inpl(x, x, x);
-        mpz_divmod_inpl(&quo, x, x, mod);
+    }
+
+    if (mod->neg && !mpz_is_zero(dest)) {
+        mpz_sub_inpl(dest, dest, &m);
     }
 
     mpz_deinit(&quo);
-    mpz_free(x);
+    mpz_deinit(&x);
     mpz_free(n);
 }
 
+/* computes dest = z ** -1 % mod, using the extended Euclidean algorithm
+   returns false if z is not invertible, ie if gcd(z, mod) != 1
+   the result is in the range [0, abs(mod)); can have dest and z the same
+   assumes mod != 0
+*/
+bool mpz_invmod_inpl(mpz_t *dest, const mpz_t *z, const mpz_t *mod) {
+    assert(!mpz_is_zero(mod));
+
+    // work with the absolute value of mod, sharing its digits
+    mpz_t m = *mod;
+    m.neg = 0;
+
+    mpz_t r0; mpz_init_zero(&r0);
+    mpz_t r1; mpz_init_zero(&r1);
+    mpz_t t0; mpz_init_zero(&t0);
+    mpz_t t1; mpz_init_from_int(&t1, 1);
+    mpz_t quo; mpz_init_zero(&quo);
+    mpz_t rem; mpz_init_zero(&rem);
+
+    // invariant: t0 * z == r0 and t1 * z == r1, modulo m
+    mpz_set(&r0, &m);
+    mpz_divmod_inpl(&quo, &r1, z, &m);
+    while (!mpz_is_zero(&r1)) {
+        mpz_divmod_inpl(&quo, &rem, &r0, &r1);
+        mpz_set(&r0, &r1);
+        mpz_set(&r1, &rem);
+        mpz_mul_inpl(&quo, &quo, &t1);
+        mpz_sub_inpl(&rem, &t0, &quo);
+        mpz_set(&t0, &t1);
+        mpz_set(&t1, &rem);
+    }
+
+    bool ok = r0.len == 1 && r0.dig[0] == 1;
+    if (ok) {
+        mpz_divmod_inpl(&quo, dest, &t0, &m);
+    }
+
+    mpz_deinit(&rem);
+    mpz_deinit(&quo);
+    mpz_deinit(&t1);
+    mpz_deinit(&t0);
+    mpz_deinit(&r1);
+    mpz_deinit(&r0);
+    return ok;
+}
+
+#if 0
+these functions are unused
+
 /* computes gcd(z1, z2)
    based on Knuth's modified gcd algorithm (I think?)
    gcd(z1, z2) >= 0
@@ -1494,6 +1834,7 @@ void mpz_divmod_inpl(mpz_t *dest_quo, mpz_t *dest_rem, const mpz_t *lhs, const m
     mpz_need_dig(dest_quo, lhs->len + 1); // +1 necessary?
     memset(dest_quo->dig, 0, (lhs->len + 1) * sizeof(mpz_dig_t));
     dest_quo->len = 0;
+    dest_quo->neg = 0;
     mpz_need_dig(dest_rem, lhs->len + 1); // +1 necessary?
     mpz_set(dest_rem, lhs);
     mpn_div(dest_rem->dig, &dest_rem->len, rhs->dig, rhs->len, dest_quo->dig, &dest_quo->len);
@@ -1652,6 +1993,97 @@ char *mpz_as_str(const mpz_t *i, mp_uint_t base) {
 }
 #endif
 
+static inline char mpz_char_from_digit(mp_uint_t d, char base_char) {
+    return d < 10 ? '0' + d : base_char + (d - 10);
+}
+
+/* writes the chars of i to str, least significant first, for a base that is
+   a power of 2; returns a pointer just past the last char written
+   assumes normalised i with ilen > 0
+*/
+STATIC char *mpn_as_str_pow2(char *str, const mpz_dig_t *idig, mp_uint_t ilen, mp_uint_t base, char base_char) {
+    mp_uint_t bits = 1;
+    while ((1u << bits) < base) {
+        ++bits;
+    }
+
+    size_t num_bits = (ilen - 1) * DIG_SIZE;
+    for (mpz_dig_t d = idig[ilen - 1]; d != 0; d >>= 1) {
+        ++num_bits;
+    }
+
+    for (size_t pos = 0; pos < num_bits; pos += bits) {
+        size_t n = pos / DIG_SIZE;
+        mp_uint_t shift = pos % DIG_SIZE;
+        mpz_dbl_dig_t d = idig[n] >> shift;
+        if (shift + bits > DIG_SIZE && n + 1 < ilen) {
+            d |= (mpz_dbl_dig_t)idig[n + 1] << (DIG_SIZE - shift);
+        }
+        *str++ = mpz_char_from_digit(d & (base - 1), base_char);
+    }
+
+    return str;
+}
+
+/* writes the chars of i to str, least significant first, zero padded to at
+   least pad chars; returns a pointer just past the last char written
+   the digits of i are destroyed
+*/
+STATIC char *mpn_as_str(char *str, mpz_dig_t *idig, mp_uint_t ilen, mp_uint_t base, char base_char, size_t pad) {
+    mp_uint_t chunk_chars;
+    mpz_dig_t chunk = mpz_radix_chunk(base, &chunk_chars);
+    char *s = str;
+
+    while (ilen > 0) {
+        // divide by the chunk, leaving a digit's worth of chars in a
+        mpz_dbl_dig_t a = 0;
+        for (mpz_dig_t *d = idig + ilen; --d >= idig;) {
+            a = (a << DIG_SIZE) | *d;
+            *d = a / chunk;
+            a %= chunk;
+        }
+        while (ilen > 0 && idig[ilen - 1] == 0) {
+            --ilen;
+        }
+
+        // all chars of a are needed, except leading zeros of the top chunk
+        for (mp_uint_t n = 0; n < chunk_chars && (ilen > 0 || a != 0); ++n) {
+            *s++ = mpz_char_from_digit(a % base, base_char);
+            a /= base;
+        }
+    }
+
+    while ((size_t)(s - str) < pad) {
+        *s++ = '0';
+    }
+
+    return s;
+}
+
+/* writes the chars of z to str like mpn_as_str, by dividing by the largest
+   power in pows that is shorter than z and converting both parts recursively
+   z must be non-negative, and is destroyed
+*/
+STATIC char *mpz_as_str_dc(char *str, mpz_t *z, size_t pad, mp_uint_t base, char base_char, const mpz_t *pows, mp_uint_t chunk_chars, size_t k) {
+    while (k > 0 && pows[k - 1].len >= z->len) {
+        --k;
+    }
+
+    if (k == 0 || z->len < MPZ_AS_STR_DC_THRESHOLD) {
+        return mpn_as_str(str, z->dig, z->len, base, base_char, pad);
+    }
+
+    size_t low_chars = chunk_chars << (k - 1);
+    mpz_t quo; mpz_init_zero(&quo);
+    mpz_t rem; mpz_init_zero(&rem);
+    mpz_divmod_inpl(&quo, &rem, z, &pows[k - 1]);
+    str = mpz_as_str_dc(str, &rem, low_chars, base, base_char, pows, chunk_chars, k - 1);
+    mpz_deinit(&rem);
+    str = mpz_as_str_dc(str, &quo, pad > low_chars ? pad - low_chars : 0, base, base_char, pows, chunk_chars, k);
+    mpz_deinit(&quo);
+    return str;
+}
+
 // assumes enough space as calculated by mp_int_format_size
 // returns length of string, not including null byte
 mp_uint_t mpz_as_str_inpl(const mpz_t *i, mp_uint_t base, const char *prefix, char base_char, char comma, char *str) {
@@ -1676,48 +2108,47 @@ mp_uint_t mpz_as_str_inpl(const mpz_t *i, mp_uint_t base, const char *prefix, ch
         return s - str;
     }
 
-    // make a copy of mpz digits, so we can do the div/mod calculation
-    mpz_dig_t *dig = m_new(mpz_dig_t, ilen);
-    memcpy(dig, i->dig, ilen * sizeof(mpz_dig_t));
-
-    // convert
-    char *last_comma = str;
-    bool done;
-    do {
-        mpz_dig_t *d = dig + ilen;
-        mpz_dbl_dig_t a = 0;
-
-        // compute next remainder
-        while (--d >= dig) {
-            a = (a << DIG_SIZE) | *d;
-            *d = a / base;
-            a %= base;
+    // convert, least significant char first
+    if ((base & (base - 1)) == 0) {
+        s = mpn_as_str_pow2(s, i->dig, ilen, base, base_char);
+    } else if (ilen < MPZ_AS_STR_DC_THRESHOLD) {
+        // make a copy of mpz digits, so we can do the div/mod calculation
+        mpz_dig_t *dig = m_new(mpz_dig_t, ilen);
+        memcpy(dig, i->dig, ilen * sizeof(mpz_dig_t));
+        s = mpn_as_str(s, dig, ilen, base, base_char, 0);
+        m_del(mpz_dig_t, dig, ilen);
+    } else {
+        // make powers of the base up to at least half the number of chars
+        mp_uint_t chunk_chars;
+        mpz_dig_t chunk = mpz_radix_chunk(base, &chunk_chars);
+        mp_uint_t log2_base = 1;
+        while ((2u << log2_base) <= base) {
+            ++log2_base;
         }
-
-        // convert to character
-        a += '0';
-        if (a > '9') {
-            a += base_char - '9' - 1;
+        size_t max_chars = ilen * DIG_SIZE / log2_base + 1;
+        size_t k = 1;
+        while ((chunk_chars << k) < max_chars) {
+            ++k;
         }
-        *s++ = a;
-
-        // check if number is zero
-        done = true;
-        for (d = dig; d < dig + ilen; ++d) {
-            if (*d != 0) {
-                done = false;
-                break;
+        mpz_t *pows = mpz_radix_powers(chunk, k);
+        mpz_t z; mpz_init_zero(&z);
+        mpz_abs_inpl(&z, i);
+        s = mpz_as_str_dc(s, &z, 0, base, base_char, pows, chunk_chars, k);
+        mpz_deinit(&z);
+        mpz_radix_powers_free(pows, k);
+    }
+
+    if (comma) {
+        // insert a comma between each group of 3 chars, starting from the top
+        size_t n = s - str;
+        s += (n - 1) / 3;
+        for (size_t k = n; k-- > 3;) {
+            str[k + k / 3] = str[k];
+            if (k % 3 == 0) {
+                str[k + k / 3 - 1] = comma;
             }
         }
-        if (comma && (s - last_comma) == 3) {
-            *s++ = comma;
-            last_comma = s;
-        }
     }
-    while (!done);
-
-    // free the copy of the digits array
-    m_del(mpz_dig_t, dig, ilen);
 
     if (prefix) {
         const char *p = &prefix[strlen(prefix)];
@@ -98,6 +98,21 @@ void mp_native_raise(mp_obj_t o) {
     }
 }
 
+#if MICROPY_ENABLE_PYSTACK
+
+// a native function that handles exceptions saves the pystack level on entry,
+// and restores it when it catches one, to free what the aborted calls left
+// on the pystack (the VM does the same using code_state->pystack_top)
+void *mp_native_pystack_get(void) {
+    return MP_STATE_THREAD(pystack_cur);
+}
+
+void mp_native_pystack_set(void *level) {
+    MP_STATE_THREAD(pystack_cur) = level;
+}
+
+#endif
+
 // these must correspond to the respective enum in runtime0.h
 void *const mp_fun_table[MP_F_NUMBER_OF] = {
     mp_convert_obj_to_native,
@@ -122,6 +137,9 @@ void *const mp_fun_table[MP_F_NUMBER_OF] = {
 #if MICROPY_PY_BUILTINS_SET
     mp_obj_new_set,
     mp_obj_set_store,
+#else
+    NULL,
+    NULL,
 #endif
     mp_make_function_from_raw_code,
     mp_native_call_function_n_kw,
@@ -137,6 +155,8 @@ void *const mp_fun_table[MP_F_NUMBER_OF] = {
     mp_import_all,
 #if MICROPY_PY_BUILTINS_SLICE
     mp_obj_new_slice,
+#else
+    NULL,
 #endif
     mp_unpack_sequence,
     mp_unpack_ex,
@@ -145,6 +165,13 @@ void *const mp_fun_table[MP_F_NUMBER_OF] = {
     mp_obj_new_cell,
     mp_make_closure_from_raw_code,
     mp_setup_code_state,
+#if MICROPY_ENABLE_PYSTACK
+    mp_native_pystack_get,
+    mp_native_pystack_set,
+#else
+    NULL,
+    NULL,
+#endif
 };
 
 /*
@@ -380,6 +380,8 @@ void mp_map_deinit(mp_map_t *map);
 void mp_map_free(mp_map_t *map);
 mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t lookup_kind);
 void mp_map_clear(mp_map_t *map);
+void mp_map_copy(mp_map_t *dest, const mp_map_t *src);
+size_t mp_map_table_bytes(const mp_map_t *map);
 void mp_map_dump(mp_map_t *map);
 
 // Underlying set implementation (not set object)
@@ -741,6 +743,10 @@ mp_map_t *mp_obj_dict_get_map(mp_obj_t self_in);
 // set
 void mp_obj_set_store(mp_obj_t self_in, mp_obj_t item);
 
+// enumerate and zip, for a result that is unpacked immediately and can be reused
+mp_obj_t mp_obj_enumerate_iternext_reuse(mp_obj_t self_in);
+mp_obj_t mp_obj_zip_iternext_reuse(mp_obj_t self_in);
+
 // slice
 void mp_obj_slice_get(mp_obj_t self_in, mp_obj_t *start, mp_obj_t *stop, mp_obj_t *step);
 
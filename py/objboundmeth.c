@@ -28,6 +28,7 @@
 
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/stackctrl.h"
 
 typedef struct _mp_obj_bound_meth_t {
     mp_obj_base_t base;
@@ -50,6 +51,10 @@ STATIC void bound_meth_print(const mp_print_t *print, mp_obj_t o_in, mp_print_ki
 mp_obj_t mp_call_method_self_n_kw(mp_obj_t meth, mp_obj_t self, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     // need to insert self before all other args and then call meth
     size_t n_total = n_args + 2 * n_kw;
+    #if MICROPY_ENABLE_PYSTACK
+    mp_obj_t *args2 = mp_pystack_alloc(sizeof(mp_obj_t) * (1 + n_total));
+    mp_obj_t *free_args2 = args2;
+    #else
     mp_obj_t *args2 = NULL;
     mp_obj_t *free_args2 = NULL;
     if (n_total > 4) {
@@ -61,11 +66,12 @@ mp_obj_t mp_call_method_self_n_kw(mp_obj_t meth, mp_obj_t self, size_t n_args, s
         // (fallback to) use stack to allocate temporary args array
         args2 = alloca(sizeof(mp_obj_t) * (1 + n_total));
     }
+    #endif
     args2[0] = self;
     memcpy(args2 + 1, args, n_total * sizeof(mp_obj_t));
     mp_obj_t res = mp_call_function_n_kw(meth, n_args + 1, n_kw, args2);
     if (free_args2 != NULL) {
-        m_del(mp_obj_t, free_args2, 1 + n_total);
+        mp_nonlocal_free(free_args2, sizeof(mp_obj_t) * (1 + n_total));
     }
     return res;
 }
@@ -28,6 +28,7 @@
 
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/stackctrl.h"
 
 typedef struct _mp_obj_closure_t {
     mp_obj_base_t base;
@@ -49,12 +50,12 @@ STATIC mp_obj_t closure_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
         memcpy(args2 + self->n_closed, args, (n_args + 2 * n_kw) * sizeof(mp_obj_t));
         return mp_call_function_n_kw(self->fun, self->n_closed + n_args, n_kw, args2);
     } else {
-        // use heap to allocate temporary args array
-        mp_obj_t *args2 = m_new(mp_obj_t, n_total);
+        // use heap (or pystack) to allocate temporary args array
+        mp_obj_t *args2 = mp_nonlocal_alloc(n_total * sizeof(mp_obj_t));
         memcpy(args2, self->closed, self->n_closed * sizeof(mp_obj_t));
         memcpy(args2 + self->n_closed, args, (n_args + 2 * n_kw) * sizeof(mp_obj_t));
         mp_obj_t res = mp_call_function_n_kw(self->fun, self->n_closed + n_args, n_kw, args2);
-        m_del(mp_obj_t, args2, n_total);
+        mp_nonlocal_free(args2, n_total * sizeof(mp_obj_t));
         return res;
     }
 }
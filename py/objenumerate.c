@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#include "py/objtuple.h"
 #include "py/runtime.h"
 
 #if MICROPY_PY_BUILTINS_ENUMERATE
@@ -35,6 +36,7 @@ typedef struct _mp_obj_enumerate_t {
     mp_obj_base_t base;
     mp_obj_t iter;
     mp_int_t cur;
+    mp_obj_tuple_t *reuse;
 } mp_obj_enumerate_t;
 
 STATIC mp_obj_t enumerate_iternext(mp_obj_t self_in);
@@ -58,12 +60,14 @@ STATIC mp_obj_t enumerate_make_new(const mp_obj_type_t *type, size_t n_args, siz
     o->base.type = type;
     o->iter = mp_getiter(arg_vals.iterable.u_obj);
     o->cur = arg_vals.start.u_int;
+    o->reuse = NULL;
 #else
     (void)n_kw;
     mp_obj_enumerate_t *o = m_new_obj(mp_obj_enumerate_t);
     o->base.type = type;
     o->iter = mp_getiter(args[0]);
     o->cur = n_args > 1 ? mp_obj_get_int(args[1]) : 0;
+    o->reuse = NULL;
 #endif
 
     return MP_OBJ_FROM_PTR(o);
@@ -89,4 +93,20 @@ STATIC mp_obj_t enumerate_iternext(mp_obj_t self_in) {
     }
 }
 
+// Used by the VM when the result is unpacked straight into variables, so the
+// same tuple can be handed out for every item
+mp_obj_t mp_obj_enumerate_iternext_reuse(mp_obj_t self_in) {
+    mp_obj_enumerate_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t next = mp_iternext(self->iter);
+    if (next == MP_OBJ_STOP_ITERATION) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    if (self->reuse == NULL) {
+        self->reuse = MP_OBJ_TO_PTR(mp_obj_new_tuple(2, NULL));
+    }
+    self->reuse->items[0] = MP_OBJ_NEW_SMALL_INT(self->cur++);
+    self->reuse->items[1] = next;
+    return MP_OBJ_FROM_PTR(self->reuse);
+}
+
 #endif // MICROPY_PY_BUILTINS_ENUMERATE
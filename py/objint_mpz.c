@@ -322,6 +322,58 @@ mp_obj_t mp_obj_int_binary_op(mp_uint_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
     }
 }
 
+// returns the mpz of the int arg, using temp to hold it if arg is a small int
+STATIC mpz_t *mp_mpz_for_int(mp_obj_t arg, mpz_t *temp) {
+    if (MP_OBJ_IS_SMALL_INT(arg)) {
+        mpz_init_from_int(temp, MP_OBJ_SMALL_INT_VALUE(arg));
+        return temp;
+    } else {
+        mp_obj_int_t *arg_p = MP_OBJ_TO_PTR(arg);
+        return &(arg_p->mpz);
+    }
+}
+
+// computes pow(base, exponent, modulus) for ints, without the huge intermediate
+mp_obj_t mp_obj_int_pow3(mp_obj_t base, mp_obj_t exponent, mp_obj_t modulus) {
+    mpz_t l_temp, r_temp, m_temp;
+    mpz_t *lhs = mp_mpz_for_int(base, &l_temp);
+    mpz_t *rhs = mp_mpz_for_int(exponent, &r_temp);
+    mpz_t *mod = mp_mpz_for_int(modulus, &m_temp);
+
+    if (mpz_is_zero(mod)) {
+        mp_raise_ValueError("pow() 3rd argument cannot be 0");
+    }
+
+    mp_obj_int_t *res = mp_obj_int_new_mpz();
+    if (rhs->neg) {
+        // a negative exponent raises the modular inverse of the base instead
+        if (!mpz_invmod_inpl(&res->mpz, lhs, mod)) {
+            mp_raise_ValueError("base is not invertible for the given modulus");
+        }
+        mpz_t e = *rhs;
+        e.neg = 0;
+        mpz_pow3_inpl(&res->mpz, &res->mpz, &e, mod);
+    } else {
+        mpz_pow3_inpl(&res->mpz, lhs, rhs, mod);
+    }
+
+    if (lhs == &l_temp) {
+        mpz_deinit(lhs);
+    }
+    if (rhs == &r_temp) {
+        mpz_deinit(rhs);
+    }
+    if (mod == &m_temp) {
+        mpz_deinit(mod);
+    }
+
+    mp_int_t val;
+    if (mpz_as_int_checked(&res->mpz, &val) && MP_SMALL_INT_FITS(val)) {
+        return MP_OBJ_NEW_SMALL_INT(val);
+    }
+    return MP_OBJ_FROM_PTR(res);
+}
+
 mp_obj_t mp_obj_new_int(mp_int_t value) {
     if (MP_SMALL_INT_FITS(value)) {
         return MP_OBJ_NEW_SMALL_INT(value);
@@ -281,35 +281,268 @@ STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args) {
     return ret;
 }
 
-STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj_t binop_less_result) {
-    MP_STACK_CHECK();
-    while (head < tail) {
-        mp_obj_t *h = head - 1;
-        mp_obj_t *t = tail;
-        mp_obj_t v = key_fn == MP_OBJ_NULL ? tail[0] : mp_call_function_1(key_fn, tail[0]); // get pivot using key_fn
-        for (;;) {
-            do ++h; while (h < t && mp_binary_op(MP_BINARY_OP_LESS, key_fn == MP_OBJ_NULL ? h[0] : mp_call_function_1(key_fn, h[0]), v) == binop_less_result);
-            do --t; while (h < t && mp_binary_op(MP_BINARY_OP_LESS, v, key_fn == MP_OBJ_NULL ? t[0] : mp_call_function_1(key_fn, t[0])) == binop_less_result);
-            if (h >= t) break;
-            mp_obj_t x = h[0];
-            h[0] = t[0];
-            t[0] = x;
+// list.sort() is a natural merge sort, a simplified timsort: the list is
+// split into ascending runs (descending ones are reversed), runs shorter than
+// a minimum length are extended with binary insertion sort, and runs are
+// merged so that their lengths on the pending stack shrink at least as fast
+// as the Fibonacci numbers.  Merging needs scratch space for the smaller of
+// the two runs, so at most half the list.  It is stable, and linear on
+// input that is already mostly in order.
+//
+// Elements are w words long: 1 when sorting the items directly, or 2 when a
+// key function is given and (key, item) pairs are sorted so that each key is
+// only computed once.  The first word is what's compared.
+
+typedef struct _list_sort_t {
+    mp_obj_t *base;
+    size_t w;
+    bool reverse;
+    mp_obj_t *tmp;
+    size_t tmp_alloc;
+    // while merging, base[hole] is missing hole_len elements that are in tmp
+    mp_obj_t *hole;
+    const mp_obj_t *hole_src;
+    size_t hole_len;
+    size_t n_runs;
+    struct { size_t start, len; } runs[BITS_PER_WORD * 3 / 2];
+} list_sort_t;
+
+STATIC bool list_sort_lt(const list_sort_t *s, mp_obj_t a, mp_obj_t b) {
+    if (s->reverse) {
+        mp_obj_t t = a;
+        a = b;
+        b = t;
+    }
+    if (MP_OBJ_IS_SMALL_INT(a) && MP_OBJ_IS_SMALL_INT(b)) {
+        return MP_OBJ_SMALL_INT_VALUE(a) < MP_OBJ_SMALL_INT_VALUE(b);
+    }
+    return mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, a, b));
+}
+
+static inline void list_sort_put(mp_obj_t *dest, const mp_obj_t *src, size_t w) {
+    dest[0] = src[0];
+    if (w == 2) {
+        dest[1] = src[1];
+    }
+}
+
+// Sort base[lo, hi) given that base[lo, start) is already sorted.
+STATIC void list_sort_insertion(list_sort_t *s, size_t lo, size_t start, size_t hi) {
+    size_t w = s->w;
+    mp_obj_t *base = s->base;
+    for (; start < hi; start++) {
+        mp_obj_t pivot[2];
+        list_sort_put(pivot, &base[start * w], w);
+        // find where pivot goes, after any elements equal to it
+        size_t l = lo;
+        size_t r = start;
+        while (l < r) {
+            size_t m = l + (r - l) / 2;
+            if (list_sort_lt(s, pivot[0], base[m * w])) {
+                r = m;
+            } else {
+                l = m + 1;
+            }
+        }
+        memmove(&base[(l + 1) * w], &base[l * w], (start - l) * w * sizeof(mp_obj_t));
+        list_sort_put(&base[l * w], pivot, w);
+    }
+}
+
+// Return the length of the run starting at lo, which is made ascending if
+// it is strictly descending (strictly so that reversing it is stable).
+STATIC size_t list_sort_count_run(list_sort_t *s, size_t lo, size_t hi) {
+    size_t w = s->w;
+    mp_obj_t *base = s->base;
+    size_t i = lo + 1;
+    if (i == hi) {
+        return 1;
+    }
+    if (list_sort_lt(s, base[i * w], base[(i - 1) * w])) {
+        for (i++; i < hi && list_sort_lt(s, base[i * w], base[(i - 1) * w]); i++) {
+        }
+        for (mp_obj_t *l = &base[lo * w], *r = &base[(i - 1) * w]; l < r; l += w, r -= w) {
+            mp_obj_t t[2];
+            list_sort_put(t, l, w);
+            list_sort_put(l, r, w);
+            list_sort_put(r, t, w);
+        }
+    } else {
+        for (i++; i < hi && !list_sort_lt(s, base[i * w], base[(i - 1) * w]); i++) {
+        }
+    }
+    return i - lo;
+}
+
+// Return how many of the n sorted elements at p go before key: those that
+// are less than it, or if after_equal is set those that are not greater.
+STATIC size_t list_sort_bisect(const list_sort_t *s, mp_obj_t key, const mp_obj_t *p, size_t n, bool after_equal) {
+    size_t l = 0;
+    size_t r = n;
+    while (l < r) {
+        size_t m = l + (r - l) / 2;
+        bool before;
+        if (after_equal) {
+            before = !list_sort_lt(s, key, p[m * s->w]);
+        } else {
+            before = list_sort_lt(s, p[m * s->w], key);
+        }
+        if (before) {
+            l = m + 1;
+        } else {
+            r = m;
         }
-        mp_obj_t x = h[0];
-        h[0] = tail[0];
-        tail[0] = x;
-        // do the smaller recursive call first, to keep stack within O(log(N))
-        if (t - head < tail - h - 1) {
-            mp_quicksort(head, t, key_fn, binop_less_result);
-            head = h + 1;
+    }
+    return l;
+}
+
+STATIC mp_obj_t *list_sort_get_tmp(list_sort_t *s, size_t n) {
+    if (s->tmp_alloc < n) {
+        m_del(mp_obj_t, s->tmp, s->tmp_alloc * s->w);
+        s->tmp = NULL;
+        s->tmp = m_new(mp_obj_t, n * s->w);
+        s->tmp_alloc = n;
+    }
+    return s->tmp;
+}
+
+// Merge the runs at a and b, where a comes just before b and is no longer.
+STATIC void list_sort_merge_lo(list_sort_t *s, mp_obj_t *a, size_t na, size_t nb) {
+    size_t w = s->w;
+    mp_obj_t *tmp = list_sort_get_tmp(s, na);
+    memcpy(tmp, a, na * w * sizeof(mp_obj_t));
+    mp_obj_t *dest = a;
+    mp_obj_t *pa = tmp;
+    mp_obj_t *pa_end = tmp + na * w;
+    mp_obj_t *pb = a + na * w;
+    mp_obj_t *pb_end = pb + nb * w;
+    s->hole = dest;
+    s->hole_src = pa;
+    s->hole_len = na;
+    while (pa < pa_end && pb < pb_end) {
+        if (list_sort_lt(s, pb[0], pa[0])) {
+            list_sort_put(dest, pb, w);
+            pb += w;
         } else {
-            mp_quicksort(h + 1, tail, key_fn, binop_less_result);
-            tail = t;
+            list_sort_put(dest, pa, w);
+            pa += w;
+            s->hole_src = pa;
+            s->hole_len -= 1;
         }
+        dest += w;
+        s->hole = dest;
     }
+    memcpy(dest, pa, (pa_end - pa) * sizeof(mp_obj_t));
+    s->hole_len = 0;
+}
+
+// Merge the runs at a and b, where a comes just before b and is longer.
+STATIC void list_sort_merge_hi(list_sort_t *s, mp_obj_t *a, size_t na, size_t nb) {
+    size_t w = s->w;
+    mp_obj_t *b = a + na * w;
+    mp_obj_t *tmp = list_sort_get_tmp(s, nb);
+    memcpy(tmp, b, nb * w * sizeof(mp_obj_t));
+    mp_obj_t *dest = b + nb * w;
+    mp_obj_t *pa = b;
+    mp_obj_t *pb = tmp + nb * w;
+    s->hole = pa;
+    s->hole_src = tmp;
+    s->hole_len = nb;
+    while (pa > a && pb > tmp) {
+        dest -= w;
+        if (list_sort_lt(s, pb[-w], pa[-w])) {
+            pa -= w;
+            list_sort_put(dest, pa, w);
+            s->hole = pa;
+        } else {
+            pb -= w;
+            list_sort_put(dest, pb, w);
+            s->hole_len -= 1;
+        }
+    }
+    memcpy(pa, tmp, (pb - tmp) * sizeof(mp_obj_t));
+    s->hole_len = 0;
+}
+
+// Merge pending runs i and i + 1.
+STATIC void list_sort_merge_at(list_sort_t *s, size_t i) {
+    size_t w = s->w;
+    mp_obj_t *a = &s->base[s->runs[i].start * w];
+    size_t na = s->runs[i].len;
+    mp_obj_t *b = a + na * w;
+    size_t nb = s->runs[i + 1].len;
+    s->runs[i].len += nb;
+    if (i + 2 < s->n_runs) {
+        s->runs[i + 1] = s->runs[i + 2];
+    }
+    s->n_runs -= 1;
+
+    // elements at the start of a that don't go after b[0] are already in place,
+    // as are those at the end of b that don't go before the last of a
+    size_t k = list_sort_bisect(s, b[0], a, na, true);
+    a += k * w;
+    na -= k;
+    if (na == 0) {
+        return;
+    }
+    nb = list_sort_bisect(s, a[(na - 1) * w], b, nb, false);
+    if (nb == 0) {
+        return;
+    }
+
+    if (na <= nb) {
+        list_sort_merge_lo(s, a, na, nb);
+    } else {
+        list_sort_merge_hi(s, a, na, nb);
+    }
+}
+
+STATIC void list_sort_collapse(list_sort_t *s, bool force) {
+    while (s->n_runs > 1) {
+        size_t n = s->n_runs - 2;
+        if (force) {
+            if (n > 0 && s->runs[n - 1].len < s->runs[n + 1].len) {
+                n -= 1;
+            }
+        } else if ((n > 0 && s->runs[n - 1].len <= s->runs[n].len + s->runs[n + 1].len)
+            || (n > 1 && s->runs[n - 2].len <= s->runs[n - 1].len + s->runs[n].len)) {
+            if (s->runs[n - 1].len < s->runs[n + 1].len) {
+                n -= 1;
+            }
+        } else if (s->runs[n].len > s->runs[n + 1].len) {
+            break;
+        }
+        list_sort_merge_at(s, n);
+    }
+}
+
+STATIC void list_sort(list_sort_t *s, size_t n) {
+    // lists shorter than 64 are a single run; longer ones use runs of 32 to
+    // 64 elements, chosen so that n / min_run is a power of 2 or just under
+    size_t min_run = n;
+    size_t extra = 0;
+    while (min_run >= 64) {
+        extra |= min_run & 1;
+        min_run >>= 1;
+    }
+    min_run += extra;
+
+    for (size_t lo = 0; lo < n;) {
+        size_t len = list_sort_count_run(s, lo, n);
+        if (len < min_run) {
+            size_t forced = MIN(min_run, n - lo);
+            list_sort_insertion(s, lo, lo + len, lo + forced);
+            len = forced;
+        }
+        s->runs[s->n_runs].start = lo;
+        s->runs[s->n_runs].len = len;
+        s->n_runs += 1;
+        list_sort_collapse(s, false);
+        lo += len;
+    }
+    list_sort_collapse(s, true);
 }
 
-// TODO Python defines sort to be stable but ours is not
 mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_key, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
@@ -325,14 +558,57 @@ mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_
 
     mp_check_self(MP_OBJ_IS_TYPE(pos_args[0], &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    size_t len = self->len;
+
+    if (len > 1) {
+        list_sort_t s;
+        s.reverse = args.reverse.u_bool;
+        s.tmp = NULL;
+        s.tmp_alloc = 0;
+        s.hole_len = 0;
+        s.n_runs = 0;
+
+        if (args.key.u_obj == mp_const_none) {
+            s.base = self->items;
+            s.w = 1;
+            nlr_buf_t nlr;
+            if (nlr_push(&nlr) == 0) {
+                list_sort(&s, len);
+                nlr_pop();
+            } else {
+                // a comparison raised; put back what was being merged so
+                // that the list still holds all of its items
+                memcpy(s.hole, s.hole_src, s.hole_len * sizeof(mp_obj_t));
+                nlr_jump(nlr.ret_val);
+            }
+        } else {
+            mp_obj_t *pairs = m_new(mp_obj_t, 2 * len);
+            for (size_t i = 0; i < len; i++) {
+                pairs[2 * i] = mp_call_function_1(args.key.u_obj, self->items[i]);
+                pairs[2 * i + 1] = self->items[i];
+                if (self->len != len) {
+                    goto modified;
+                }
+            }
+            s.base = pairs;
+            s.w = 2;
+            list_sort(&s, len);
+            if (self->len != len) {
+                goto modified;
+            }
+            for (size_t i = 0; i < len; i++) {
+                self->items[i] = pairs[2 * i + 1];
+            }
+            m_del(mp_obj_t, pairs, 2 * len);
+        }
 
-    if (self->len > 1) {
-        mp_quicksort(self->items, self->items + self->len - 1,
-                     args.key.u_obj == mp_const_none ? MP_OBJ_NULL : args.key.u_obj,
-                     args.reverse.u_bool ? mp_const_false : mp_const_true);
+        m_del(mp_obj_t, s.tmp, s.tmp_alloc * s.w);
     }
 
     return mp_const_none;
+
+modified:
+    mp_raise_ValueError("list modified during sort");
 }
 
 STATIC mp_obj_t list_clear(mp_obj_t self_in) {
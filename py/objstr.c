@@ -249,28 +249,87 @@ wrong_args:
     mp_raise_TypeError("wrong number of arguments");
 }
 
+// Haystacks shorter than this (beyond the needle length) are searched by
+// checking each position, since setting up the skip table would cost more.
+#define FIND_SUBBYTES_SIMPLE_MAX (32)
+
 // like strstr but with specified length and allows \0 bytes
-// TODO replace with something more efficient/standard
+// Uses memchr for single-byte needles and Boyer-Moore-Horspool for longer
+// ones, so a search doesn't compare the needle at every offset.  If
+// direction is negative the last occurrence is found.
 const byte *find_subbytes(const byte *haystack, mp_uint_t hlen, const byte *needle, mp_uint_t nlen, mp_int_t direction) {
-    if (hlen >= nlen) {
-        mp_uint_t str_index, str_index_end;
+    if (hlen < nlen) {
+        return NULL;
+    }
+    if (nlen == 0) {
+        return direction > 0 ? haystack : haystack + hlen;
+    }
+
+    if (nlen == 1) {
+        if (direction > 0) {
+            return memchr(haystack, needle[0], hlen);
+        }
+        for (const byte *p = haystack + hlen; p > haystack;) {
+            if (*--p == needle[0]) {
+                return p;
+            }
+        }
+        return NULL;
+    }
+
+    const byte *last = haystack + hlen - nlen;
+
+    if (hlen - nlen < FIND_SUBBYTES_SIMPLE_MAX) {
         if (direction > 0) {
-            str_index = 0;
-            str_index_end = hlen - nlen;
+            for (const byte *p = haystack; p <= last; p++) {
+                if (*p == needle[0] && memcmp(p, needle, nlen) == 0) {
+                    return p;
+                }
+            }
         } else {
-            str_index = hlen - nlen;
-            str_index_end = 0;
+            for (const byte *p = last; p >= haystack; p--) {
+                if (*p == needle[0] && memcmp(p, needle, nlen) == 0) {
+                    return p;
+                }
+            }
         }
-        for (;;) {
-            if (memcmp(&haystack[str_index], needle, nlen) == 0) {
-                //found
-                return haystack + str_index;
+        return NULL;
+    }
+
+    // skip[c] is how far the window can move when c is the byte in the
+    // haystack at the end of the window (its start when going backwards);
+    // shifts are capped at 255, which only makes long needles move slower
+    byte skip[256];
+    mp_uint_t max_skip = nlen < 255 ? nlen : 255;
+    memset(skip, max_skip, sizeof(skip));
+
+    if (direction > 0) {
+        for (mp_uint_t i = 0; i < nlen - 1; i++) {
+            mp_uint_t n = nlen - 1 - i;
+            skip[needle[i]] = n < max_skip ? n : max_skip;
+        }
+        byte needle_last = needle[nlen - 1];
+        for (const byte *p = haystack; p <= last;) {
+            byte c = p[nlen - 1];
+            if (c == needle_last && memcmp(p, needle, nlen - 1) == 0) {
+                return p;
+            }
+            p += skip[c];
+        }
+    } else {
+        for (mp_uint_t i = nlen - 1; i > 0; i--) {
+            skip[needle[i]] = i < max_skip ? i : max_skip;
+        }
+        byte needle_first = needle[0];
+        for (const byte *p = last;;) {
+            byte c = *p;
+            if (c == needle_first && memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+                return p;
             }
-            if (str_index == str_index_end) {
-                //not found
+            if ((mp_uint_t)(p - haystack) < skip[c]) {
                 break;
             }
-            str_index += direction;
+            p -= skip[c];
         }
     }
     return NULL;
@@ -522,14 +581,12 @@ mp_obj_t mp_obj_str_split(size_t n_args, const mp_obj_t *args) {
 
         for (;;) {
             const byte *start = s;
-            for (;;) {
-                if (splits == 0 || s + sep_len > top) {
-                    s = top;
-                    break;
-                } else if (memcmp(s, sep_str, sep_len) == 0) {
-                    break;
-                }
-                s++;
+            s = NULL;
+            if (splits != 0) {
+                s = find_subbytes(start, top - start, (const byte*)sep_str, sep_len, 1);
+            }
+            if (s == NULL) {
+                s = top;
             }
             mp_obj_list_append(res, mp_obj_new_str_of_type(self_type, start, s - start));
             if (s >= top) {
@@ -621,16 +678,11 @@ STATIC mp_obj_t str_rsplit(size_t n_args, const mp_obj_t *args) {
         const byte *beg = s;
         const byte *last = s + len;
         for (;;) {
-            s = last - sep_len;
-            for (;;) {
-                if (splits == 0 || s < beg) {
-                    break;
-                } else if (memcmp(s, sep_str, sep_len) == 0) {
-                    break;
-                }
-                s--;
+            s = NULL;
+            if (splits != 0) {
+                s = find_subbytes(beg, last - beg, (const byte*)sep_str, sep_len, -1);
             }
-            if (s < beg || splits == 0) {
+            if (s == NULL) {
                 res->items[idx] = mp_obj_new_str_of_type(self_type, beg, last - beg);
                 break;
             }
@@ -673,7 +725,10 @@ STATIC mp_obj_t str_finder(mp_uint_t n_args, const mp_obj_t *args, mp_int_t dire
         end = str_index_to_ptr(self_type, haystack, haystack_len, args[3], true);
     }
 
-    const byte *p = find_subbytes(start, end - start, needle, needle_len, direction);
+    const byte *p = NULL;
+    if (start <= end) {
+        p = find_subbytes(start, end - start, needle, needle_len, direction);
+    }
     if (p == NULL) {
         // not found
         if (is_index) {
@@ -1662,6 +1717,11 @@ STATIC mp_obj_t str_count(size_t n_args, const mp_obj_t *args) {
         end = str_index_to_ptr(self_type, haystack, haystack_len, args[3], true);
     }
 
+    // nothing can be found if the range is empty
+    if (end < start) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+
     // if needle_len is zero then we count each gap between characters as an occurrence
     if (needle_len == 0) {
         return MP_OBJ_NEW_SMALL_INT(unichar_charlen((const char*)start, end - start) + 1);
@@ -1669,13 +1729,13 @@ STATIC mp_obj_t str_count(size_t n_args, const mp_obj_t *args) {
 
     // count the occurrences
     mp_int_t num_occurrences = 0;
-    for (const byte *haystack_ptr = start; haystack_ptr + needle_len <= end;) {
-        if (memcmp(haystack_ptr, needle, needle_len) == 0) {
-            num_occurrences++;
-            haystack_ptr += needle_len;
-        } else {
-            haystack_ptr = utf8_next_char(haystack_ptr);
+    for (const byte *haystack_ptr = start; haystack_ptr < end;) {
+        haystack_ptr = find_subbytes(haystack_ptr, end - haystack_ptr, needle, needle_len, 1);
+        if (haystack_ptr == NULL) {
+            break;
         }
+        num_occurrences++;
+        haystack_ptr += needle_len;
     }
 
     return MP_OBJ_NEW_SMALL_INT(num_occurrences);
@@ -34,6 +34,7 @@
 #include "py/objtype.h"
 #include "py/runtime0.h"
 #include "py/runtime.h"
+#include "py/stackctrl.h"
 
 #if 0 // print debugging info
 #define DEBUG_PRINT (1)
@@ -99,12 +100,25 @@ struct class_lookup_data {
     mp_uint_t meth_offset;
     mp_obj_t *dest;
     bool is_type;
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    // set by the search for the class lookup cache
+    bool searched_native;
+    const mp_obj_type_t *member_type;
+    mp_obj_t member;
+    #endif
 };
 
-STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_type_t *type) {
+STATIC void mp_obj_class_lookup_mro(struct class_lookup_data  *lookup, const mp_obj_type_t *type) {
     assert(lookup->dest[0] == MP_OBJ_NULL);
     assert(lookup->dest[1] == MP_OBJ_NULL);
     for (;;) {
+        #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+        // what native types provide depends on more than the type and name
+        if (mp_obj_is_native_type(type)) {
+            lookup->searched_native = true;
+        }
+        #endif
+
         // Optimize special method lookup for native types
         // This avoids extra method_name => slot lookup. On the other hand,
         // this should not be applied to class types, as will result in extra
@@ -126,6 +140,10 @@ STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_
             mp_map_t *locals_map = &type->locals_dict->map;
             mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(lookup->attr), MP_MAP_LOOKUP);
             if (elem != NULL) {
+                #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+                lookup->member_type = type;
+                lookup->member = elem->value;
+                #endif
                 if (lookup->is_type) {
                     // If we look up a class method, we need to return original type for which we
                     // do a lookup, not a (base) type in which we found the class method.
@@ -180,7 +198,7 @@ STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_
                 // Not a "real" type
                 continue;
             }
-            mp_obj_class_lookup(lookup, bt);
+            mp_obj_class_lookup_mro(lookup, bt);
             if (lookup->dest[0] != MP_OBJ_NULL) {
                 return;
             }
@@ -196,6 +214,44 @@ STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_
     }
 }
 
+#if MICROPY_OPT_CACHE_CLASS_LOOKUP
+STATIC void mp_obj_class_lookup(struct class_lookup_data *lookup, const mp_obj_type_t *type) {
+    if (lookup->is_type) {
+        mp_obj_class_lookup_mro(lookup, type);
+        return;
+    }
+
+    size_t version = MP_STATE_VM(class_lookup_version);
+    mp_class_lookup_cache_entry_t *entry = &MP_STATE_THREAD(class_lookup_cache)[
+        (((mp_uint_t)type >> 4) ^ lookup->attr) & (MICROPY_OPT_CACHE_CLASS_LOOKUP_SIZE - 1)];
+    if (entry->type == type && entry->attr == lookup->attr && entry->version == version) {
+        // only user classes were searched, so there is no native sub-object
+        if (entry->member != MP_OBJ_NULL) {
+            mp_convert_member_lookup(MP_OBJ_FROM_PTR(lookup->obj), entry->member_type, entry->member, lookup->dest);
+        }
+        return;
+    }
+
+    lookup->searched_native = false;
+    lookup->member = MP_OBJ_NULL;
+    mp_obj_class_lookup_mro(lookup, type);
+    if (!lookup->searched_native) {
+        entry->type = type;
+        entry->attr = lookup->attr;
+        entry->version = version;
+        entry->member_type = lookup->member_type;
+        entry->member = lookup->member;
+    }
+}
+
+STATIC void mp_obj_class_lookup_invalidate(void) {
+    MP_STATE_VM(class_lookup_version) += 1;
+}
+#else
+#define mp_obj_class_lookup mp_obj_class_lookup_mro
+#define mp_obj_class_lookup_invalidate()
+#endif
+
 STATIC void instance_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
     qstr meth = (kind == PRINT_STR) ? MP_QSTR___str__ : MP_QSTR___repr__;
@@ -277,11 +333,11 @@ mp_obj_t mp_obj_instance_make_new(const mp_obj_type_t *self, size_t n_args, size
             mp_obj_t args2[1] = {MP_OBJ_FROM_PTR(self)};
             new_ret = mp_call_function_n_kw(init_fn[0], 1, 0, args2);
         } else {
-            mp_obj_t *args2 = m_new(mp_obj_t, 1 + n_args + 2 * n_kw);
+            mp_obj_t *args2 = mp_nonlocal_alloc((1 + n_args + 2 * n_kw) * sizeof(mp_obj_t));
             args2[0] = MP_OBJ_FROM_PTR(self);
             memcpy(args2 + 1, args, (n_args + 2 * n_kw) * sizeof(mp_obj_t));
             new_ret = mp_call_function_n_kw(init_fn[0], n_args + 1, n_kw, args2);
-            m_del(mp_obj_t, args2, 1 + n_args + 2 * n_kw);
+            mp_nonlocal_free(args2, (1 + n_args + 2 * n_kw) * sizeof(mp_obj_t));
         }
 
     }
@@ -305,12 +361,12 @@ mp_obj_t mp_obj_instance_make_new(const mp_obj_type_t *self, size_t n_args, size
         if (n_args == 0 && n_kw == 0) {
             init_ret = mp_call_method_n_kw(0, 0, init_fn);
         } else {
-            mp_obj_t *args2 = m_new(mp_obj_t, 2 + n_args + 2 * n_kw);
+            mp_obj_t *args2 = mp_nonlocal_alloc((2 + n_args + 2 * n_kw) * sizeof(mp_obj_t));
             args2[0] = init_fn[0];
             args2[1] = init_fn[1];
             memcpy(args2 + 2, args, (n_args + 2 * n_kw) * sizeof(mp_obj_t));
             init_ret = mp_call_method_n_kw(n_args, n_kw, args2);
-            m_del(mp_obj_t, args2, 2 + n_args + 2 * n_kw);
+            mp_nonlocal_free(args2, (2 + n_args + 2 * n_kw) * sizeof(mp_obj_t));
         }
         if (init_ret != mp_const_none) {
             if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
@@ -848,6 +904,7 @@ STATIC void type_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
         if (self->locals_dict != NULL) {
             assert(self->locals_dict->base.type == &mp_type_dict); // MicroPython restriction, for now
             mp_map_t *locals_map = &self->locals_dict->map;
+            mp_obj_class_lookup_invalidate();
             if (dest[1] == MP_OBJ_NULL) {
                 // delete attribute
                 mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
@@ -941,6 +998,9 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         }
     }
 
+    // a previous class may have had the same address
+    mp_obj_class_lookup_invalidate();
+
     return MP_OBJ_FROM_PTR(o);
 }
 
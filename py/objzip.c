@@ -32,6 +32,7 @@
 
 typedef struct _mp_obj_zip_t {
     mp_obj_base_t base;
+    mp_obj_tuple_t *reuse;
     mp_uint_t n_iters;
     mp_obj_t iters[];
 } mp_obj_zip_t;
@@ -41,6 +42,7 @@ STATIC mp_obj_t zip_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_
 
     mp_obj_zip_t *o = m_new_obj_var(mp_obj_zip_t, mp_obj_t, n_args);
     o->base.type = type;
+    o->reuse = NULL;
     o->n_iters = n_args;
     for (mp_uint_t i = 0; i < n_args; i++) {
         o->iters[i] = mp_getiter(args[i]);
@@ -67,6 +69,27 @@ STATIC mp_obj_t zip_iternext(mp_obj_t self_in) {
     return MP_OBJ_FROM_PTR(tuple);
 }
 
+// Used by the VM when the result is unpacked straight into variables, so the
+// same tuple can be handed out for every item
+mp_obj_t mp_obj_zip_iternext_reuse(mp_obj_t self_in) {
+    mp_obj_zip_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->n_iters == 0) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    if (self->reuse == NULL) {
+        self->reuse = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->n_iters, NULL));
+    }
+    mp_obj_tuple_t *tuple = self->reuse;
+    for (mp_uint_t i = 0; i < self->n_iters; i++) {
+        mp_obj_t next = mp_iternext(self->iters[i]);
+        if (next == MP_OBJ_STOP_ITERATION) {
+            return MP_OBJ_STOP_ITERATION;
+        }
+        tuple->items[i] = next;
+    }
+    return MP_OBJ_FROM_PTR(tuple);
+}
+
 const mp_obj_type_t mp_type_zip = {
     { &mp_type_type },
     .name = MP_QSTR_zip,
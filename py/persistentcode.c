@@ -30,6 +30,7 @@
 #include <assert.h>
 
 #include "py/reader.h"
+#include "py/runtime0.h"
 #include "py/emitglue.h"
 #include "py/persistentcode.h"
 #include "py/bc.h"
@@ -43,12 +44,57 @@
 #define MPY_FEATURE_FLAGS ( \
     ((MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE) << 0) \
     | ((MICROPY_PY_BUILTINS_STR_UNICODE) << 1) \
+    | ((MICROPY_OPT_SUPERINSTRUCTIONS) << 2) \
     )
 // This is a version of the flags that can be configured at runtime.
 #define MPY_FEATURE_FLAGS_DYNAMIC ( \
     ((MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE_DYNAMIC) << 0) \
     | ((MICROPY_PY_BUILTINS_STR_UNICODE_DYNAMIC) << 1) \
+    | ((MICROPY_OPT_SUPERINSTRUCTIONS_DYNAMIC) << 2) \
     )
+// Bytecode without superinstructions can run on a VM that supports them.
+#define MPY_FEATURE_SUPERINSTRUCTIONS (1 << 2)
+// Set if the file contains native code, in which case the header is followed
+// by the architecture and the sizes of mp_code_state_t and nlr_buf_t (which
+// native code allocates itself), and each raw code starts with its kind.
+#define MPY_FEATURE_NATIVE (1 << 3)
+
+// The native emitter that this build loads (or saves) machine code for.
+#if MICROPY_EMIT_X64
+#define MPY_NATIVE_ARCH (MP_NATIVE_ARCH_X64)
+#elif MICROPY_EMIT_X86
+#define MPY_NATIVE_ARCH (MP_NATIVE_ARCH_X86)
+#elif MICROPY_EMIT_THUMB
+#define MPY_NATIVE_ARCH (MP_NATIVE_ARCH_THUMB)
+#elif MICROPY_EMIT_ARM
+#define MPY_NATIVE_ARCH (MP_NATIVE_ARCH_ARM)
+#elif MICROPY_EMIT_XTENSA
+#define MPY_NATIVE_ARCH (MP_NATIVE_ARCH_XTENSA)
+#else
+#define MPY_NATIVE_ARCH (MP_NATIVE_ARCH_NONE)
+#endif
+
+// Native code builds tagged objects directly, so it also depends on the
+// object representation, which is stored in the upper bits of the arch byte.
+#define MPY_NATIVE_ARCH_BYTE (MPY_NATIVE_ARCH | (MICROPY_OBJ_REPR << 4))
+
+// mpy-cross can save native code for any architecture, selected at runtime.
+#if MICROPY_DYNAMIC_COMPILER
+#define MPY_NATIVE_ARCH_BYTE_DYNAMIC (mp_dynamic_compiler.native_arch | (MICROPY_OBJ_REPR << 4))
+#else
+#define MPY_NATIVE_ARCH_BYTE_DYNAMIC (MPY_NATIVE_ARCH_BYTE)
+#endif
+
+// Objects that native code may refer to by address, in the order they are
+// stored in a .mpy file for MP_NATIVE_RELOC_CONST.
+#if MICROPY_EMIT_NATIVE
+STATIC const void *const native_const_table[] = {
+    &mp_const_none_obj,
+    &mp_const_false_obj,
+    &mp_const_true_obj,
+    &mp_const_ellipsis_obj,
+};
+#endif
 
 #if MICROPY_PERSISTENT_CODE_LOAD || (MICROPY_PERSISTENT_CODE_SAVE && !MICROPY_DYNAMIC_COMPILER)
 // The bytecode will depend on the number of bits in a small-int, and
@@ -162,10 +208,131 @@ STATIC void load_bytecode_qstrs(mp_reader_t *reader, byte *ip, byte *ip_top) {
     }
 }
 
-STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader) {
+STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, bool native);
+
+#if MICROPY_EMIT_NATIVE
+STATIC mp_raw_code_t *load_native_code(mp_reader_t *reader, mp_raw_code_kind_t kind) {
+    if (kind != MP_CODE_NATIVE_PY && kind != MP_CODE_NATIVE_VIPER && kind != MP_CODE_NATIVE_ASM) {
+        mp_raise_ValueError("invalid .mpy file");
+    }
+
+    // load machine code into executable memory
+    mp_uint_t fun_len = read_uint(reader);
+    byte *fun_data;
+    mp_uint_t fun_alloc;
+    MP_PLAT_ALLOC_EXEC(fun_len, (void**)&fun_data, &fun_alloc);
+    if (fun_data == NULL) {
+        m_malloc_fail(fun_len);
+    }
+    read_bytes(reader, fun_data, fun_len);
+
+    mp_uint_t scope_flags = read_uint(reader);
+    mp_uint_t n_pos_args = read_uint(reader);
+    mp_uint_t type_sig = read_uint(reader);
+    mp_uint_t const_table_offset = 0;
+    if (kind == MP_CODE_NATIVE_PY) {
+        const_table_offset = read_uint(reader);
+    }
+
+    // link the code to this firmware
+    mp_uint_t n_relocs = read_uint(reader);
+    for (mp_uint_t i = 0; i < n_relocs; ++i) {
+        mp_uint_t loc = read_uint(reader);
+        byte reloc_kind = read_byte(reader);
+        mp_uint_t val;
+        switch (reloc_kind) {
+            case MP_NATIVE_RELOC_FUN_TABLE:
+                val = (mp_uint_t)(uintptr_t)mp_fun_table;
+                break;
+            case MP_NATIVE_RELOC_FUN: {
+                mp_uint_t idx = read_uint(reader);
+                if (idx >= MP_F_NUMBER_OF) {
+                    goto invalid;
+                }
+                val = (mp_uint_t)(uintptr_t)mp_fun_table[idx];
+                break;
+            }
+            case MP_NATIVE_RELOC_QSTR:
+                val = load_qstr(reader);
+                break;
+            case MP_NATIVE_RELOC_QSTR_OBJ:
+                val = (mp_uint_t)MP_OBJ_NEW_QSTR(load_qstr(reader));
+                break;
+            case MP_NATIVE_RELOC_QSTR16: {
+                qstr qst = load_qstr(reader);
+                if (loc + 2 > fun_len) {
+                    goto invalid;
+                }
+                fun_data[loc] = qst;
+                fun_data[loc + 1] = qst >> 8;
+                continue;
+            }
+            case MP_NATIVE_RELOC_CONST: {
+                byte idx = read_byte(reader);
+                if (idx >= MP_ARRAY_SIZE(native_const_table)) {
+                    goto invalid;
+                }
+                val = (mp_uint_t)MP_OBJ_FROM_PTR(native_const_table[idx]);
+                break;
+            }
+            case MP_NATIVE_RELOC_OBJ:
+                val = (mp_uint_t)load_obj(reader);
+                break;
+            case MP_NATIVE_RELOC_RAW_CODE:
+                val = (mp_uint_t)(uintptr_t)load_raw_code(reader, true);
+                break;
+            default:
+                goto invalid;
+        }
+        if (loc + sizeof(mp_uint_t) > fun_len) {
+            goto invalid;
+        }
+        memcpy(fun_data + loc, &val, sizeof(mp_uint_t));
+    }
+
+    #if defined(MP_PLAT_COMMIT_EXEC)
+    // the port may move the linked code, eg to flash, so get its final address
+    byte *code = MP_PLAT_COMMIT_EXEC(fun_data, fun_len);
+    if (code != fun_data) {
+        MP_PLAT_FREE_EXEC(fun_data, fun_alloc);
+        fun_data = code;
+    }
+    #endif
+
+    const mp_uint_t *const_table = NULL;
+    if (kind == MP_CODE_NATIVE_PY) {
+        const_table = (const mp_uint_t*)(fun_data + const_table_offset);
+    }
+
+    // create raw_code and return it
+    mp_raw_code_t *rc = mp_emit_glue_new_raw_code();
+    mp_emit_glue_assign_native(rc, kind, fun_data, fun_len, const_table,
+        #if MICROPY_PERSISTENT_CODE_SAVE
+        NULL, 0,
+        #endif
+        n_pos_args, scope_flags, type_sig);
+    return rc;
+
+invalid:
+    mp_raise_ValueError("invalid .mpy file");
+}
+#endif
+
+STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, bool native) {
+    #if MICROPY_EMIT_NATIVE
+    if (native) {
+        mp_raw_code_kind_t kind = read_byte(reader);
+        if (kind != MP_CODE_BYTECODE) {
+            return load_native_code(reader, kind);
+        }
+    }
+    #else
+    (void)native;
+    #endif
+
     // load bytecode
     mp_uint_t bc_len = read_uint(reader);
-    byte *bytecode = m_new(byte, bc_len);
+    byte *bytecode = m_new0_long_lived(byte, bc_len);
     read_bytes(reader, bytecode, bc_len);
 
     // extract prelude
@@ -184,7 +351,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader) {
     // load constant table
     mp_uint_t n_obj = read_uint(reader);
     mp_uint_t n_raw_code = read_uint(reader);
-    mp_uint_t *const_table = m_new(mp_uint_t, prelude.n_pos_args + prelude.n_kwonly_args + n_obj + n_raw_code);
+    mp_uint_t *const_table = m_new0_long_lived(mp_uint_t, prelude.n_pos_args + prelude.n_kwonly_args + n_obj + n_raw_code);
     mp_uint_t *ct = const_table;
     for (mp_uint_t i = 0; i < prelude.n_pos_args + prelude.n_kwonly_args; ++i) {
         *ct++ = (mp_uint_t)MP_OBJ_NEW_QSTR(load_qstr(reader));
@@ -193,7 +360,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader) {
         *ct++ = (mp_uint_t)load_obj(reader);
     }
     for (mp_uint_t i = 0; i < n_raw_code; ++i) {
-        *ct++ = (mp_uint_t)(uintptr_t)load_raw_code(reader);
+        *ct++ = (mp_uint_t)(uintptr_t)load_raw_code(reader, native);
     }
 
     // create raw_code and return it
@@ -212,10 +379,16 @@ mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader) {
     if (strncmp((char*)header, "M\x00", 2) != 0) {
         mp_raise_ValueError("invalid .mpy file");
     }
-    if (header[2] != MPY_FEATURE_FLAGS || header[3] > mp_small_int_bits()) {
+    bool native = (header[2] & MPY_FEATURE_NATIVE) != 0;
+    if (((header[2] & ~MPY_FEATURE_NATIVE) | (MPY_FEATURE_FLAGS & MPY_FEATURE_SUPERINSTRUCTIONS)) != MPY_FEATURE_FLAGS
+        || header[3] > mp_small_int_bits()
+        || (native && (MPY_NATIVE_ARCH == MP_NATIVE_ARCH_NONE
+            || read_byte(reader) != MPY_NATIVE_ARCH_BYTE
+            || read_byte(reader) != sizeof(mp_code_state_t) / sizeof(mp_uint_t)
+            || read_byte(reader) != sizeof(nlr_buf_t) / sizeof(mp_uint_t)))) {
         mp_raise_ValueError("incompatible .mpy file");
     }
-    mp_raw_code_t *rc = load_raw_code(reader);
+    mp_raw_code_t *rc = load_raw_code(reader, native);
     reader->close(reader->data);
     return rc;
 }
@@ -317,7 +490,94 @@ STATIC void save_bytecode_qstrs(mp_print_t *print, const byte *ip, const byte *i
     }
 }
 
-STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc) {
+STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, bool native);
+
+#if MICROPY_EMIT_NATIVE
+STATIC void save_native_code(mp_print_t *print, mp_raw_code_t *rc) {
+    const byte *fun_data = rc->data.u_native.fun_data;
+    mp_uint_t fun_len = rc->data.u_native.fun_len;
+    const mp_uint_t *relocs = rc->data.u_native.relocs;
+    mp_uint_t n_relocs = rc->data.u_native.n_relocs;
+
+    // the size of an address in the code, which is that of the target
+    #if MICROPY_DYNAMIC_COMPILER
+    size_t word_size = mp_dynamic_compiler.native_arch == MP_NATIVE_ARCH_X64 ? 8 : 4;
+    #else
+    size_t word_size = sizeof(mp_uint_t);
+    #endif
+
+    // save machine code, with the values to be relocated zeroed so that the
+    // output does not depend on where things were in memory when it was built
+    byte *code = m_new(byte, fun_len);
+    memcpy(code, fun_data, fun_len);
+    for (mp_uint_t i = 0; i < n_relocs; ++i) {
+        mp_uint_t loc = relocs[3 * i];
+        memset(code + loc, 0, relocs[3 * i + 1] == MP_NATIVE_RELOC_QSTR16 ? 2 : word_size);
+    }
+    mp_print_uint(print, fun_len);
+    mp_print_bytes(print, code, fun_len);
+    m_del(byte, code, fun_len);
+
+    mp_print_uint(print, rc->scope_flags);
+    mp_print_uint(print, rc->n_pos_args);
+    mp_print_uint(print, rc->data.u_native.type_sig);
+    if (rc->kind == MP_CODE_NATIVE_PY) {
+        mp_print_uint(print, (const byte*)rc->data.u_native.const_table - fun_data);
+    }
+
+    // save relocations, along with what they refer to
+    mp_print_uint(print, n_relocs);
+    for (mp_uint_t i = 0; i < n_relocs; ++i) {
+        mp_uint_t loc = relocs[3 * i];
+        byte reloc_kind = relocs[3 * i + 1];
+        mp_uint_t val = relocs[3 * i + 2];
+        mp_print_uint(print, loc);
+        mp_print_bytes(print, &reloc_kind, 1);
+        switch (reloc_kind) {
+            case MP_NATIVE_RELOC_FUN_TABLE:
+                break;
+            case MP_NATIVE_RELOC_FUN:
+                mp_print_uint(print, val);
+                break;
+            case MP_NATIVE_RELOC_QSTR:
+                save_qstr(print, val);
+                break;
+            case MP_NATIVE_RELOC_QSTR_OBJ:
+            case MP_NATIVE_RELOC_QSTR16:
+                save_qstr(print, val);
+                break;
+            case MP_NATIVE_RELOC_CONST: {
+                byte idx = 0;
+                while (MP_OBJ_FROM_PTR(native_const_table[idx]) != (mp_obj_t)val) {
+                    ++idx;
+                    assert(idx < MP_ARRAY_SIZE(native_const_table));
+                }
+                mp_print_bytes(print, &idx, 1);
+                break;
+            }
+            case MP_NATIVE_RELOC_OBJ:
+                save_obj(print, (mp_obj_t)val);
+                break;
+            default:
+                assert(reloc_kind == MP_NATIVE_RELOC_RAW_CODE);
+                save_raw_code(print, (mp_raw_code_t*)(uintptr_t)val, true);
+                break;
+        }
+    }
+}
+#endif
+
+STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, bool native) {
+    if (native) {
+        byte kind = rc->kind;
+        mp_print_bytes(print, &kind, 1);
+        #if MICROPY_EMIT_NATIVE
+        if (rc->kind != MP_CODE_BYTECODE) {
+            save_native_code(print, rc);
+            return;
+        }
+        #endif
+    }
     if (rc->kind != MP_CODE_BYTECODE) {
         mp_raise_ValueError("can only save bytecode");
     }
@@ -349,8 +609,27 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc) {
         save_obj(print, (mp_obj_t)*const_table++);
     }
     for (uint i = 0; i < rc->data.u_byte.n_raw_code; ++i) {
-        save_raw_code(print, (mp_raw_code_t*)(uintptr_t)*const_table++);
+        save_raw_code(print, (mp_raw_code_t*)(uintptr_t)*const_table++, native);
+    }
+}
+
+// returns true if any of the code in the tree rooted at rc is native code
+STATIC bool raw_code_has_native(mp_raw_code_t *rc) {
+    if (rc->kind != MP_CODE_BYTECODE) {
+        return true;
+    }
+    const byte *ip = rc->data.u_byte.bytecode;
+    const byte *ip2;
+    bytecode_prelude_t prelude;
+    extract_prelude(&ip, &ip2, &prelude);
+    const mp_uint_t *ct = rc->data.u_byte.const_table
+        + prelude.n_pos_args + prelude.n_kwonly_args + rc->data.u_byte.n_obj;
+    for (uint i = 0; i < rc->data.u_byte.n_raw_code; ++i) {
+        if (raw_code_has_native((mp_raw_code_t*)(uintptr_t)ct[i])) {
+            return true;
+        }
     }
+    return false;
 }
 
 void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
@@ -359,16 +638,27 @@ void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print) {
     //  byte  version
     //  byte  feature flags
     //  byte  number of bits in a small int
-    byte header[4] = {'M', 0, MPY_FEATURE_FLAGS_DYNAMIC,
+    // and if the native feature flag is set:
+    //  byte  native architecture
+    //  byte  number of words in mp_code_state_t
+    //  byte  number of words in nlr_buf_t
+    bool native = raw_code_has_native(rc);
+    byte header[7] = {'M', 0, MPY_FEATURE_FLAGS_DYNAMIC,
         #if MICROPY_DYNAMIC_COMPILER
         mp_dynamic_compiler.small_int_bits,
         #else
         mp_small_int_bits(),
         #endif
+        MPY_NATIVE_ARCH_BYTE_DYNAMIC,
+        MICROPY_NATIVE_CODE_STATE_WORDS_DYNAMIC,
+        MICROPY_NATIVE_NLR_BUF_WORDS_DYNAMIC,
     };
-    mp_print_bytes(print, header, sizeof(header));
+    if (native) {
+        header[2] |= MPY_FEATURE_NATIVE;
+    }
+    mp_print_bytes(print, header, native ? 7 : 4);
 
-    save_raw_code(print, rc);
+    save_raw_code(print, rc, native);
 }
 
 // here we define mp_raw_code_save_file depending on the port
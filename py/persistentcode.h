@@ -30,6 +30,16 @@
 #include "py/reader.h"
 #include "py/emitglue.h"
 
+// The architecture of any native code in a .mpy file
+enum {
+    MP_NATIVE_ARCH_NONE = 0,
+    MP_NATIVE_ARCH_X86,
+    MP_NATIVE_ARCH_X64,
+    MP_NATIVE_ARCH_ARM,
+    MP_NATIVE_ARCH_THUMB,
+    MP_NATIVE_ARCH_XTENSA,
+};
+
 mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader);
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len);
 mp_raw_code_t *mp_raw_code_load_file(const char *filename);
@@ -32,8 +32,8 @@
 #include "py/qstr.h"
 #include "py/gc.h"
 
-// NOTE: we are using linear arrays to store and search for qstr's (unique strings, interned strings)
-// ultimately we will replace this with a static hash table of some kind
+// NOTE: we are using linear arrays to store qstr's (unique strings, interned strings),
+// searched linearly or, with MICROPY_QSTR_POOL_HASH_INDEX, through a hash index per pool
 // also probably need to include the length in the string data, to allow null bytes in the string
 
 #if 0 // print debugging info
@@ -81,12 +81,17 @@
 #endif
 
 // this must match the equivalent function in makeqstrdata.py
-mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
+STATIC mp_uint_t qstr_compute_hash_unmasked(const byte *data, size_t len) {
     // djb2 algorithm; see http://www.cse.yorku.ca/~oz/hash.html
     mp_uint_t hash = 5381;
     for (const byte *top = data + len; data < top; data++) {
         hash = ((hash << 5) + hash) ^ (*data); // hash * 33 ^ data
     }
+    return hash;
+}
+
+// the stored hash is the unmasked one truncated to MICROPY_QSTR_BYTES_IN_HASH
+STATIC mp_uint_t qstr_mask_hash(mp_uint_t hash) {
     hash &= Q_HASH_MASK;
     // Make sure that valid hash is never zero, zero means "hash not computed"
     if (hash == 0) {
@@ -95,11 +100,45 @@ mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
     return hash;
 }
 
+mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
+    return qstr_mask_hash(qstr_compute_hash_unmasked(data, len));
+}
+
+#if MICROPY_QSTR_POOL_HASH_INDEX
+STATIC const uint16_t mp_qstr_const_hash_index[] = {
+#ifndef NO_QSTR
+#define QDEF(id, str)
+#define QHASH_INDEX(...) __VA_ARGS__,
+#include "genhdr/qstrdefs.generated.h"
+#undef QHASH_INDEX
+#undef QDEF
+#endif
+};
+
+// Number of slots in the hash index of a pool of n qstrs, keeping it at most
+// 2/3 full so that a probe always ends at an empty slot.
+// this must match the equivalent function in makeqstrdata.py
+STATIC size_t qstr_hash_index_size(size_t n) {
+    size_t size = 1;
+    while (size <= n + n / 2) {
+        size <<= 1;
+    }
+    return size;
+}
+
+// a pool's hash index stores index + 1 as a uint16_t
+#define QSTR_POOL_MAX_ALLOC (0xffff)
+#endif
+
 const qstr_pool_t mp_qstr_const_pool = {
     NULL,               // no previous pool
     0,                  // no previous pool
     10,                 // set so that the first dynamically allocated pool is twice this size; must be <= the len (just below)
     MP_QSTRnumber_of,   // corresponds to number of strings in array just below
+    #if MICROPY_QSTR_POOL_HASH_INDEX
+    mp_qstr_const_hash_index,
+    MP_ARRAY_SIZE(mp_qstr_const_hash_index) - 1,
+    #endif
     {
 #ifndef NO_QSTR
 #define QDEF(id, str) str,
@@ -138,48 +177,90 @@ STATIC const byte *find_qstr(qstr q) {
 }
 
 // qstr_mutex must be taken while in this function
-STATIC qstr qstr_add(const byte *q_ptr) {
+STATIC qstr qstr_add(const byte *q_ptr, mp_uint_t unmasked_hash) {
     DEBUG_printf("QSTR: add hash=%d len=%d data=%.*s\n", Q_GET_HASH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_LENGTH(q_ptr), Q_GET_DATA(q_ptr));
+    (void)unmasked_hash;
 
     // make sure we have room in the pool for a new qstr
     if (MP_STATE_VM(last_pool)->len >= MP_STATE_VM(last_pool)->alloc) {
-        qstr_pool_t *pool = m_new_obj_var_maybe(qstr_pool_t, const char*, MP_STATE_VM(last_pool)->alloc * 2);
+        size_t alloc = MP_STATE_VM(last_pool)->alloc * 2;
+        #if MICROPY_QSTR_POOL_HASH_INDEX
+        // the hash index lives in the same allocation, after the qstrs
+        alloc = MIN(alloc, QSTR_POOL_MAX_ALLOC);
+        size_t index_size = qstr_hash_index_size(alloc);
+        size_t n_bytes = sizeof(qstr_pool_t) + alloc * sizeof(const char*) + index_size * sizeof(uint16_t);
+        #else
+        size_t n_bytes = sizeof(qstr_pool_t) + alloc * sizeof(const char*);
+        #endif
+        qstr_pool_t *pool = m_malloc_long_lived_maybe(n_bytes);
         if (pool == NULL) {
             QSTR_EXIT();
-            m_malloc_fail(MP_STATE_VM(last_pool)->alloc * 2);
+            m_malloc_fail(n_bytes);
         }
         pool->prev = MP_STATE_VM(last_pool);
         pool->total_prev_len = MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len;
-        pool->alloc = MP_STATE_VM(last_pool)->alloc * 2;
+        pool->alloc = alloc;
         pool->len = 0;
+        #if MICROPY_QSTR_POOL_HASH_INDEX
+        pool->hash_index = (const uint16_t*)&pool->qstrs[alloc];
+        pool->hash_index_mask = index_size - 1;
+        memset((uint16_t*)pool->hash_index, 0, index_size * sizeof(uint16_t));
+        #endif
         MP_STATE_VM(last_pool) = pool;
         DEBUG_printf("QSTR: allocate new pool of size %d\n", MP_STATE_VM(last_pool)->alloc);
     }
 
     // add the new qstr
-    MP_STATE_VM(last_pool)->qstrs[MP_STATE_VM(last_pool)->len++] = q_ptr;
+    qstr_pool_t *pool = MP_STATE_VM(last_pool);
+    pool->qstrs[pool->len++] = q_ptr;
+
+    #if MICROPY_QSTR_POOL_HASH_INDEX
+    uint16_t *index = (uint16_t*)pool->hash_index;
+    size_t i = unmasked_hash & pool->hash_index_mask;
+    while (index[i] != 0) {
+        i = (i + 1) & pool->hash_index_mask;
+    }
+    index[i] = pool->len;
+    #endif
 
     // return id for the newly-added qstr
     return MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
 }
 
-qstr qstr_find_strn(const char *str, size_t str_len) {
-    // work out hash of str
-    mp_uint_t str_hash = qstr_compute_hash((const byte*)str, str_len);
+STATIC qstr qstr_find_strn_hash(const char *str, size_t str_len, mp_uint_t unmasked_hash) {
+    mp_uint_t str_hash = qstr_mask_hash(unmasked_hash);
 
     // search pools for the data
     for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != NULL; pool = pool->prev) {
+        #if MICROPY_QSTR_POOL_HASH_INDEX
+        for (size_t i = unmasked_hash & pool->hash_index_mask;; i = (i + 1) & pool->hash_index_mask) {
+            size_t n = pool->hash_index[i];
+            if (n == 0) {
+                // empty slot, so not in this pool
+                break;
+            }
+            const byte *q = pool->qstrs[n - 1];
+            if (Q_GET_HASH(q) == str_hash && Q_GET_LENGTH(q) == str_len && memcmp(Q_GET_DATA(q), str, str_len) == 0) {
+                return pool->total_prev_len + n - 1;
+            }
+        }
+        #else
         for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
             if (Q_GET_HASH(*q) == str_hash && Q_GET_LENGTH(*q) == str_len && memcmp(Q_GET_DATA(*q), str, str_len) == 0) {
                 return pool->total_prev_len + (q - pool->qstrs);
             }
         }
+        #endif
     }
 
     // not found; return null qstr
     return 0;
 }
 
+qstr qstr_find_strn(const char *str, size_t str_len) {
+    return qstr_find_strn_hash(str, str_len, qstr_compute_hash_unmasked((const byte*)str, str_len));
+}
+
 qstr qstr_from_str(const char *str) {
     return qstr_from_strn(str, strlen(str));
 }
@@ -187,7 +268,8 @@ qstr qstr_from_str(const char *str) {
 qstr qstr_from_strn(const char *str, size_t len) {
     assert(len < (1 << (8 * MICROPY_QSTR_BYTES_IN_LEN)));
     QSTR_ENTER();
-    qstr q = qstr_find_strn(str, len);
+    mp_uint_t unmasked_hash = qstr_compute_hash_unmasked((const byte*)str, len);
+    qstr q = qstr_find_strn_hash(str, len, unmasked_hash);
     if (q == 0) {
         // qstr does not exist in interned pool so need to add it
 
@@ -213,10 +295,10 @@ qstr qstr_from_strn(const char *str, size_t len) {
             if (al < MICROPY_ALLOC_QSTR_CHUNK_INIT) {
                 al = MICROPY_ALLOC_QSTR_CHUNK_INIT;
             }
-            MP_STATE_VM(qstr_last_chunk) = m_new_maybe(byte, al);
+            MP_STATE_VM(qstr_last_chunk) = m_new_long_lived_maybe(byte, al);
             if (MP_STATE_VM(qstr_last_chunk) == NULL) {
                 // failed to allocate a large chunk so try with exact size
-                MP_STATE_VM(qstr_last_chunk) = m_new_maybe(byte, n_bytes);
+                MP_STATE_VM(qstr_last_chunk) = m_new_long_lived_maybe(byte, n_bytes);
                 if (MP_STATE_VM(qstr_last_chunk) == NULL) {
                     QSTR_EXIT();
                     m_malloc_fail(n_bytes);
@@ -232,12 +314,12 @@ qstr qstr_from_strn(const char *str, size_t len) {
         MP_STATE_VM(qstr_last_used) += n_bytes;
 
         // store the interned strings' data
-        mp_uint_t hash = qstr_compute_hash((const byte*)str, len);
+        mp_uint_t hash = qstr_mask_hash(unmasked_hash);
         Q_SET_HASH(q_ptr, hash);
         Q_SET_LENGTH(q_ptr, len);
         memcpy(q_ptr + MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN, str, len);
         q_ptr[MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN + len] = '\0';
-        q = qstr_add(q_ptr);
+        q = qstr_add(q_ptr, unmasked_hash);
     }
     QSTR_EXIT();
     return q;
@@ -252,13 +334,14 @@ byte *qstr_build_start(size_t len, byte **q_ptr) {
 
 qstr qstr_build_end(byte *q_ptr) {
     QSTR_ENTER();
-    qstr q = qstr_find_strn((const char*)Q_GET_DATA(q_ptr), Q_GET_LENGTH(q_ptr));
+    size_t len = Q_GET_LENGTH(q_ptr);
+    mp_uint_t unmasked_hash = qstr_compute_hash_unmasked(Q_GET_DATA(q_ptr), len);
+    qstr q = qstr_find_strn_hash((const char*)Q_GET_DATA(q_ptr), len, unmasked_hash);
     if (q == 0) {
-        size_t len = Q_GET_LENGTH(q_ptr);
-        mp_uint_t hash = qstr_compute_hash(Q_GET_DATA(q_ptr), len);
+        mp_uint_t hash = qstr_mask_hash(unmasked_hash);
         Q_SET_HASH(q_ptr, hash);
         q_ptr[MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN + len] = '\0';
-        q = qstr_add(q_ptr);
+        q = qstr_add(q_ptr, unmasked_hash);
     } else {
         m_del(byte, q_ptr, Q_GET_ALLOC(q_ptr));
     }
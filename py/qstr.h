@@ -52,6 +52,12 @@ typedef struct _qstr_pool_t {
     size_t total_prev_len;
     size_t alloc;
     size_t len;
+    #if MICROPY_QSTR_POOL_HASH_INDEX
+    // Open-addressed table of (index in pool + 1), 0 for an empty slot,
+    // probed linearly from the low bits of the unmasked string hash.
+    const uint16_t *hash_index;
+    size_t hash_index_mask;
+    #endif
     const byte *qstrs[];
 } qstr_pool_t;
 
@@ -125,6 +125,7 @@ void mp_store_attr(mp_obj_t base, qstr attr, mp_obj_t val);
 
 mp_obj_t mp_getiter(mp_obj_t o);
 mp_obj_t mp_iternext_allow_raise(mp_obj_t o); // may return MP_OBJ_STOP_ITERATION instead of raising StopIteration()
+mp_obj_t mp_iternext_unpack_allow_raise(mp_obj_t o); // as above, but the caller unpacks the result and drops it
 mp_obj_t mp_iternext(mp_obj_t o); // will always return MP_OBJ_STOP_ITERATION instead of raising StopIteration(...)
 mp_vm_return_kind_t mp_resume(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t throw_value, mp_obj_t *ret_val);
 
@@ -157,6 +158,10 @@ mp_uint_t mp_convert_obj_to_native(mp_obj_t obj, mp_uint_t type);
 mp_obj_t mp_convert_native_to_obj(mp_uint_t val, mp_uint_t type);
 mp_obj_t mp_native_call_function_n_kw(mp_obj_t fun_in, mp_uint_t n_args_kw, const mp_obj_t *args);
 void mp_native_raise(mp_obj_t o);
+#if MICROPY_ENABLE_PYSTACK
+void *mp_native_pystack_get(void);
+void mp_native_pystack_set(void *level);
+#endif
 
 #define mp_sys_path (MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_sys_path_obj)))
 #define mp_sys_argv (MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_sys_argv_obj)))
@@ -167,4 +172,9 @@ void mp_warning(const char *msg, ...);
 #define mp_warning(msg, ...)
 #endif
 
+#if MICROPY_EXEC_PROFILE
+// called by the port's profiling timer, possibly from an interrupt or signal
+void mp_exec_profile_sample(void);
+#endif
+
 #endif // __MICROPY_INCLUDED_PY_RUNTIME_H__
@@ -78,6 +78,17 @@
 #endif
 
 const byte *mp_showbc_code_start;
+
+#if MICROPY_OPT_SUPERINSTRUCTIONS
+STATIC const byte *print_small_int(const byte *ip) {
+    mp_int_t num = (ip[0] & 0x40) != 0 ? -1 : 0;
+    do {
+        num = (num << 7) | (*ip & 0x7f);
+    } while ((*ip++ & 0x80) != 0);
+    printf(" " INT_FMT, num);
+    return ip;
+}
+#endif
 const mp_uint_t *mp_showbc_const_table;
 
 void mp_bytecode_print(const void *descr, const byte *ip, mp_uint_t len, const mp_uint_t *const_table) {
@@ -393,6 +404,11 @@ const byte *mp_bytecode_print_str(const byte *ip) {
             printf("FOR_ITER " UINT_FMT, (mp_uint_t)(ip + unum - mp_showbc_code_start));
             break;
 
+        case MP_BC_FOR_RANGE:
+            DECODE_ULABEL; // the jump offset if iteration finishes
+            printf("FOR_RANGE " UINT_FMT, (mp_uint_t)(ip + unum - mp_showbc_code_start));
+            break;
+
         case MP_BC_POP_BLOCK:
             // pops block and restores the stack
             printf("POP_BLOCK");
@@ -524,6 +540,57 @@ const byte *mp_bytecode_print_str(const byte *ip) {
             printf("IMPORT_STAR");
             break;
 
+        #if MICROPY_OPT_SUPERINSTRUCTIONS
+        case MP_BC_STORE_FAST_KEEP:
+            DECODE_UINT;
+            printf("STORE_FAST_KEEP " UINT_FMT, unum);
+            break;
+
+        case MP_BC_BINARY_OP_FAST_FAST:
+        case MP_BC_BINARY_OP_FAST_INT:
+        case MP_BC_BINARY_OP_INT:
+        case MP_BC_BINARY_OP_TOP_TWO: {
+            byte opcode = ip[-1];
+            byte op = *ip++;
+            if (opcode == MP_BC_BINARY_OP_FAST_FAST) {
+                printf("BINARY_OP_FAST_FAST");
+            } else if (opcode == MP_BC_BINARY_OP_FAST_INT) {
+                printf("BINARY_OP_FAST_INT");
+            } else if (opcode == MP_BC_BINARY_OP_INT) {
+                printf("BINARY_OP_INT");
+            } else {
+                printf("BINARY_OP_TOP_TWO");
+            }
+            if (opcode == MP_BC_BINARY_OP_FAST_FAST || opcode == MP_BC_BINARY_OP_FAST_INT) {
+                DECODE_UINT;
+                printf(" " UINT_FMT, unum);
+            }
+            if (opcode == MP_BC_BINARY_OP_FAST_FAST) {
+                DECODE_UINT;
+                printf(" " UINT_FMT, unum);
+            } else if (opcode != MP_BC_BINARY_OP_TOP_TWO) {
+                ip = print_small_int(ip);
+            }
+            mp_uint_t bop = op & ~MP_BC_TAIL_MASK;
+            printf(" " UINT_FMT " %s", bop, qstr_str(mp_binary_op_method_name[bop]));
+            switch (op & MP_BC_TAIL_MASK) {
+                case MP_BC_TAIL_STORE_FAST:
+                    DECODE_UINT;
+                    printf(" STORE_FAST " UINT_FMT, unum);
+                    break;
+                case MP_BC_TAIL_POP_JUMP_IF_TRUE:
+                    DECODE_SLABEL;
+                    printf(" POP_JUMP_IF_TRUE " UINT_FMT, (mp_uint_t)(ip + unum - mp_showbc_code_start));
+                    break;
+                case MP_BC_TAIL_POP_JUMP_IF_FALSE:
+                    DECODE_SLABEL;
+                    printf(" POP_JUMP_IF_FALSE " UINT_FMT, (mp_uint_t)(ip + unum - mp_showbc_code_start));
+                    break;
+            }
+            break;
+        }
+        #endif
+
         default:
             if (ip[-1] < MP_BC_LOAD_CONST_SMALL_INT_MULTI + 64) {
                 printf("LOAD_CONST_SMALL_INT " INT_FMT, (mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16);
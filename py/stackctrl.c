@@ -24,6 +24,8 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "py/mpstate.h"
 #include "py/nlr.h"
 #include "py/obj.h"
@@ -63,3 +65,43 @@ void mp_stack_check(void) {
 }
 
 #endif // MICROPY_STACK_CHECK
+
+#if MICROPY_ENABLE_PYSTACK
+
+void mp_pystack_init(void *start, void *end) {
+    MP_STATE_THREAD(pystack_start) = start;
+    MP_STATE_THREAD(pystack_end) = end;
+    MP_STATE_THREAD(pystack_cur) = start;
+}
+
+void *mp_pystack_alloc(size_t n_bytes) {
+    // this is on the path of every call so only look up the thread state once
+    #if MICROPY_PY_THREAD
+    mp_state_thread_t *ts = mp_thread_get_state();
+    #else
+    mp_state_thread_t *ts = &mp_state_ctx.thread;
+    #endif
+    n_bytes = MP_PYSTACK_ALIGN_UP(n_bytes);
+    byte *ptr = ts->pystack_cur;
+    if (n_bytes > (size_t)(ts->pystack_end - ptr)) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_RuntimeError,
+            MP_OBJ_NEW_QSTR(MP_QSTR_maximum_space_recursion_space_depth_space_exceeded)));
+    }
+    ts->pystack_cur = ptr + n_bytes;
+    return ptr;
+}
+
+void *mp_pystack_realloc(void *ptr, size_t old_n_bytes, size_t new_n_bytes) {
+    if ((byte*)ptr + MP_PYSTACK_ALIGN_UP(old_n_bytes) == MP_STATE_THREAD(pystack_cur)) {
+        // the block is on top of the pystack so it can grow in place
+        mp_pystack_free(ptr);
+        return mp_pystack_alloc(new_n_bytes);
+    }
+    // something was allocated after the block; leave the old one to be
+    // freed along with the block below it
+    void *ptr2 = mp_pystack_alloc(new_n_bytes);
+    memcpy(ptr2, ptr, old_n_bytes);
+    return ptr2;
+}
+
+#endif // MICROPY_ENABLE_PYSTACK
@@ -26,7 +26,7 @@
 #ifndef __MICROPY_INCLUDED_PY_STACKCTRL_H__
 #define __MICROPY_INCLUDED_PY_STACKCTRL_H__
 
-#include "py/mpconfig.h"
+#include "py/mpstate.h"
 
 void mp_stack_ctrl_init(void);
 void mp_stack_set_top(void *top);
@@ -45,4 +45,37 @@ void mp_stack_check(void);
 
 #endif
 
+#if MICROPY_ENABLE_PYSTACK
+
+// The pystack is a contiguous region that Python frames and temporary call
+// argument arrays are bump-allocated from, and freed in LIFO order.  Freeing
+// a block also frees everything that was allocated after it.
+
+#define MP_PYSTACK_ALIGN_UP(n_bytes) (((n_bytes) + (MICROPY_PYSTACK_ALIGN - 1)) & ~(MICROPY_PYSTACK_ALIGN - 1))
+
+void mp_pystack_init(void *start, void *end);
+void *mp_pystack_alloc(size_t n_bytes);
+void *mp_pystack_realloc(void *ptr, size_t old_n_bytes, size_t new_n_bytes);
+
+static inline void mp_pystack_free(void *ptr) {
+    MP_STATE_THREAD(pystack_cur) = (byte*)ptr;
+}
+
+static inline size_t mp_pystack_usage(void) {
+    return MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start);
+}
+
+// Temporary arrays that must be freed before the caller returns
+#define mp_nonlocal_alloc(n_bytes) mp_pystack_alloc(n_bytes)
+#define mp_nonlocal_realloc(ptr, old_n_bytes, new_n_bytes) mp_pystack_realloc((ptr), (old_n_bytes), (new_n_bytes))
+#define mp_nonlocal_free(ptr, n_bytes) mp_pystack_free(ptr)
+
+#else
+
+#define mp_nonlocal_alloc(n_bytes) ((void*)m_new(byte, (n_bytes)))
+#define mp_nonlocal_realloc(ptr, old_n_bytes, new_n_bytes) ((void*)m_renew(byte, (ptr), (old_n_bytes), (new_n_bytes)))
+#define mp_nonlocal_free(ptr, n_bytes) m_del(byte, (ptr), (n_bytes))
+
+#endif
+
 #endif // __MICROPY_INCLUDED_PY_STACKCTRL_H__
@@ -33,7 +33,9 @@
 #include "py/nlr.h"
 #include "py/emitglue.h"
 #include "py/objtype.h"
+#include "py/runtime0.h"
 #include "py/runtime.h"
+#include "py/smallint.h"
 #include "py/bc0.h"
 #include "py/bc.h"
 
@@ -96,6 +98,86 @@ typedef enum {
 
 #endif
 
+#if MICROPY_OPT_SUPERINSTRUCTIONS
+
+// Decode the local-variable and small-int operands of superinstructions
+#define DECODE_FAST(obj) do { \
+    mp_uint_t n = 0; \
+    do { \
+        n = (n << 7) + (*ip & 0x7f); \
+    } while ((*ip++ & 0x80) != 0); \
+    obj = fastn[-n]; \
+} while (0)
+#define DECODE_SMALL_INT(obj) do { \
+    mp_int_t num = (ip[0] & 0x40) != 0 ? -1 : 0; \
+    do { \
+        num = (num << 7) | (*ip & 0x7f); \
+    } while ((*ip++ & 0x80) != 0); \
+    obj = MP_OBJ_NEW_SMALL_INT(num); \
+} while (0)
+
+// The general case of FOR_RANGE, with the next value, end and step at sp[-2..0]:
+// returns the value for this iteration and advances the next value, or returns
+// MP_OBJ_STOP_ITERATION if the range is exhausted
+STATIC mp_obj_t vm_for_range(mp_obj_t *sp) {
+    // raise the TypeError that range() would for an argument that isn't an int
+    for (int i = -2; i <= 0; i++) {
+        if (!mp_obj_is_integer(sp[i])) {
+            mp_obj_get_int(sp[i]);
+        }
+    }
+    mp_obj_t zero = MP_OBJ_NEW_SMALL_INT(0);
+    mp_binary_op_t op;
+    if (mp_obj_is_true(mp_binary_op(MP_BINARY_OP_MORE, sp[0], zero))) {
+        op = MP_BINARY_OP_LESS;
+    } else if (mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, sp[0], zero))) {
+        op = MP_BINARY_OP_MORE;
+    } else {
+        mp_raise_ValueError("zero step");
+    }
+    mp_obj_t value = sp[-2];
+    if (!mp_obj_is_true(mp_binary_op(op, value, sp[-1]))) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    sp[-2] = mp_binary_op(MP_BINARY_OP_ADD, value, sp[0]);
+    return value;
+}
+
+// The binary op of a superinstruction, with the common small-int cases inline
+STATIC inline mp_obj_t vm_binary_op(mp_uint_t op, mp_obj_t lhs, mp_obj_t rhs) {
+    if (MP_OBJ_IS_SMALL_INT(lhs) && MP_OBJ_IS_SMALL_INT(rhs)) {
+        mp_int_t lhs_val = MP_OBJ_SMALL_INT_VALUE(lhs);
+        mp_int_t rhs_val = MP_OBJ_SMALL_INT_VALUE(rhs);
+        switch (op) {
+            case MP_BINARY_OP_ADD:
+            case MP_BINARY_OP_INPLACE_ADD:
+                // can't overflow an mp_int_t, but may no longer be a small int
+                lhs_val += rhs_val;
+                if (MP_SMALL_INT_FITS(lhs_val)) {
+                    return MP_OBJ_NEW_SMALL_INT(lhs_val);
+                }
+                break;
+            case MP_BINARY_OP_SUBTRACT:
+            case MP_BINARY_OP_INPLACE_SUBTRACT:
+                lhs_val -= rhs_val;
+                if (MP_SMALL_INT_FITS(lhs_val)) {
+                    return MP_OBJ_NEW_SMALL_INT(lhs_val);
+                }
+                break;
+            case MP_BINARY_OP_LESS: return mp_obj_new_bool(lhs_val < rhs_val);
+            case MP_BINARY_OP_MORE: return mp_obj_new_bool(lhs_val > rhs_val);
+            case MP_BINARY_OP_EQUAL: return mp_obj_new_bool(lhs_val == rhs_val);
+            case MP_BINARY_OP_LESS_EQUAL: return mp_obj_new_bool(lhs_val <= rhs_val);
+            case MP_BINARY_OP_MORE_EQUAL: return mp_obj_new_bool(lhs_val >= rhs_val);
+            case MP_BINARY_OP_NOT_EQUAL: return mp_obj_new_bool(lhs_val != rhs_val);
+            default: break;
+        }
+    }
+    return mp_binary_op(op, lhs, rhs);
+}
+
+#endif
+
 #define PUSH(val) *++sp = (val)
 #define POP() (*sp--)
 #define TOP() (*sp)
@@ -136,6 +218,10 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
 #define MARK_EXC_IP_SELECTIVE()
 #define MARK_EXC_IP_GLOBAL() { code_state->ip = ip; } /* stores ip pointing to last opcode */
 #endif
+#if SELECTIVE_EXC_IP && MICROPY_TRACK_CODE_STATE
+// the profilers read code_state->ip at any opcode, not just where it can raise
+#error SELECTIVE_EXC_IP is incompatible with MICROPY_TRACK_CODE_STATE
+#endif
 #if MICROPY_OPT_COMPUTED_GOTO
     #include "py/vmentrytable.h"
     #define DISPATCH() do { \
@@ -179,8 +265,17 @@ outer_dispatch_loop:
             const byte *ip = code_state->ip;
             mp_obj_t *sp = code_state->sp;
             mp_obj_t obj_shared;
+            #if MICROPY_OPT_SUPERINSTRUCTIONS
+            mp_uint_t super_op;
+            #endif
             MICROPY_VM_HOOK_INIT
 
+            #if MICROPY_TRACK_CODE_STATE
+            // let the profilers find the running bytecode; the caller
+            // restores the previous one when we return
+            MP_STATE_THREAD(current_code_state) = code_state;
+            #endif
+
             // If we have exception to inject, now that we finish setting up
             // execution context, raise it. This works as if RAISE_VARARGS
             // bytecode was executed.
@@ -726,7 +821,13 @@ unwind_jump:;
                     DECODE_ULABEL; // the jump offset if iteration finishes; for labels are always forward
                     code_state->sp = sp;
                     assert(TOP());
-                    mp_obj_t value = mp_iternext_allow_raise(TOP());
+                    mp_obj_t value;
+                    if (*ip == MP_BC_UNPACK_SEQUENCE) {
+                        // the value is unpacked straight away so it can't escape
+                        value = mp_iternext_unpack_allow_raise(TOP());
+                    } else {
+                        value = mp_iternext_allow_raise(TOP());
+                    }
                     if (value == MP_OBJ_STOP_ITERATION) {
                         --sp; // pop the exhausted iterator
                         ip += ulab; // jump to after for-block
@@ -923,7 +1024,11 @@ unwind_jump:;
 
                         mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(out_args.fun,
                             out_args.n_args, out_args.n_kw, out_args.args);
+                        #if !MICROPY_ENABLE_PYSTACK
+                        // with the pystack the args are below new_state, and
+                        // are freed with it when the call returns
                         m_del(mp_obj_t, out_args.args, out_args.n_alloc);
+                        #endif
                         if (new_state) {
                             new_state->prev = code_state;
                             code_state = new_state;
@@ -994,7 +1099,11 @@ unwind_jump:;
 
                         mp_code_state_t *new_state = mp_obj_fun_bc_prepare_codestate(out_args.fun,
                             out_args.n_args, out_args.n_kw, out_args.args);
+                        #if !MICROPY_ENABLE_PYSTACK
+                        // with the pystack the args are below new_state, and
+                        // are freed with it when the call returns
                         m_del(mp_obj_t, out_args.args, out_args.n_alloc);
+                        #endif
                         if (new_state) {
                             new_state->prev = code_state;
                             code_state = new_state;
@@ -1057,6 +1166,9 @@ unwind_return:
                         mp_obj_t res = *sp;
                         mp_globals_set(code_state->old_globals);
                         code_state = code_state->prev;
+                        #if MICROPY_ENABLE_PYSTACK
+                        MP_STATE_THREAD(pystack_cur) = code_state->pystack_top;
+                        #endif
                         *code_state->sp = res;
                         goto run_code_state;
                     }
@@ -1175,6 +1287,97 @@ yield:
                     mp_import_all(POP());
                     DISPATCH();
 
+#if MICROPY_OPT_SUPERINSTRUCTIONS
+                ENTRY(MP_BC_STORE_FAST_KEEP): {
+                    DECODE_UINT;
+                    fastn[-unum] = TOP();
+                    DISPATCH();
+                }
+
+                ENTRY(MP_BC_BINARY_OP_FAST_FAST): {
+                    MARK_EXC_IP_SELECTIVE();
+                    super_op = *ip++;
+                    mp_obj_t lhs, rhs;
+                    DECODE_FAST(lhs);
+                    DECODE_FAST(rhs);
+                    if (lhs == MP_OBJ_NULL || rhs == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    obj_shared = vm_binary_op(super_op & ~MP_BC_TAIL_MASK, lhs, rhs);
+                    goto binary_op_tail;
+                }
+
+                ENTRY(MP_BC_BINARY_OP_FAST_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    super_op = *ip++;
+                    mp_obj_t lhs, rhs;
+                    DECODE_FAST(lhs);
+                    DECODE_SMALL_INT(rhs);
+                    if (lhs == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    obj_shared = vm_binary_op(super_op & ~MP_BC_TAIL_MASK, lhs, rhs);
+                    goto binary_op_tail;
+                }
+
+                ENTRY(MP_BC_BINARY_OP_INT): {
+                    MARK_EXC_IP_SELECTIVE();
+                    super_op = *ip++;
+                    mp_obj_t rhs;
+                    DECODE_SMALL_INT(rhs);
+                    obj_shared = vm_binary_op(super_op & ~MP_BC_TAIL_MASK, POP(), rhs);
+                    goto binary_op_tail;
+                }
+
+                ENTRY(MP_BC_BINARY_OP_TOP_TWO): {
+                    // the operands stay on the stack, with the lhs on top
+                    MARK_EXC_IP_SELECTIVE();
+                    super_op = *ip++;
+                    obj_shared = vm_binary_op(super_op & ~MP_BC_TAIL_MASK, sp[0], sp[-1]);
+                    binary_op_tail:
+                    if ((super_op & MP_BC_TAIL_MASK) == MP_BC_TAIL_PUSH) {
+                        PUSH(obj_shared);
+                        DISPATCH();
+                    } else if ((super_op & MP_BC_TAIL_MASK) == MP_BC_TAIL_STORE_FAST) {
+                        DECODE_UINT;
+                        fastn[-unum] = obj_shared;
+                        DISPATCH();
+                    } else {
+                        DECODE_SLABEL;
+                        if (mp_obj_is_true(obj_shared) == ((super_op & MP_BC_TAIL_MASK) == MP_BC_TAIL_POP_JUMP_IF_TRUE)) {
+                            ip += slab;
+                        }
+                        DISPATCH_WITH_PEND_EXC_CHECK();
+                    }
+                }
+
+                ENTRY(MP_BC_FOR_RANGE): {
+                    // the stack holds the next value, the end and the step (on top)
+                    MARK_EXC_IP_SELECTIVE();
+                    DECODE_ULABEL; // the jump offset if iteration finishes; for labels are always forward
+                    mp_obj_t value = sp[-2];
+                    if (MP_OBJ_IS_SMALL_INT(value) && MP_OBJ_IS_SMALL_INT(sp[-1])
+                        && MP_OBJ_IS_SMALL_INT(sp[0]) && sp[0] != MP_OBJ_NEW_SMALL_INT(0)) {
+                        mp_int_t cur = MP_OBJ_SMALL_INT_VALUE(value);
+                        mp_int_t end = MP_OBJ_SMALL_INT_VALUE(sp[-1]);
+                        if (MP_OBJ_SMALL_INT_VALUE(sp[0]) > 0 ? cur >= end : cur <= end) {
+                            value = MP_OBJ_STOP_ITERATION;
+                        } else {
+                            sp[-2] = vm_binary_op(MP_BINARY_OP_ADD, value, sp[0]);
+                        }
+                    } else {
+                        code_state->sp = sp;
+                        value = vm_for_range(sp);
+                    }
+                    if (value == MP_OBJ_STOP_ITERATION) {
+                        ip += ulab; // jump to after for-block, leaving the range on the stack
+                    } else {
+                        PUSH(value);
+                    }
+                    DISPATCH();
+                }
+#endif
+
 #if MICROPY_OPT_COMPUTED_GOTO
                 ENTRY(MP_BC_LOAD_CONST_SMALL_INT_MULTI):
                     PUSH(MP_OBJ_NEW_SMALL_INT((mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16));
@@ -1254,6 +1457,11 @@ pending_exception_check:
 exception_handler:
             // exception occurred
 
+            #if MICROPY_ENABLE_PYSTACK
+            // drop whatever the aborted calls left on the pystack
+            MP_STATE_THREAD(pystack_cur) = code_state->pystack_top;
+            #endif
+
             #if MICROPY_PY_SYS_EXC_INFO
             MP_STATE_VM(cur_exception) = nlr.ret_val;
             #endif
@@ -1290,40 +1498,10 @@ unwind_loop:
             // But consider how to handle nested exceptions.
             // TODO need a better way of not adding traceback to constant objects (right now, just GeneratorExit_obj and MemoryError_obj)
             if (nlr.ret_val != &mp_const_GeneratorExit_obj && nlr.ret_val != &mp_const_MemoryError_obj) {
-                const byte *ip = code_state->code_info;
-                mp_uint_t code_info_size = mp_decode_uint(&ip);
-                #if MICROPY_PERSISTENT_CODE
-                qstr block_name = ip[0] | (ip[1] << 8);
-                qstr source_file = ip[2] | (ip[3] << 8);
-                ip += 4;
-                #else
-                qstr block_name = mp_decode_uint(&ip);
-                qstr source_file = mp_decode_uint(&ip);
-                #endif
-                size_t bc = code_state->ip - code_state->code_info - code_info_size;
-                size_t source_line = 1;
-                size_t c;
-                while ((c = *ip)) {
-                    mp_uint_t b, l;
-                    if ((c & 0x80) == 0) {
-                        // 0b0LLBBBBB encoding
-                        b = c & 0x1f;
-                        l = c >> 5;
-                        ip += 1;
-                    } else {
-                        // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
-                        b = c & 0xf;
-                        l = ((c << 4) & 0x700) | ip[1];
-                        ip += 2;
-                    }
-                    if (bc >= b) {
-                        bc -= b;
-                        source_line += l;
-                    } else {
-                        // found source line corresponding to bytecode offset
-                        break;
-                    }
-                }
+                qstr block_name;
+                qstr source_file;
+                size_t source_line;
+                mp_code_state_get_location(code_state, &block_name, &source_file, &source_line);
                 mp_obj_exception_add_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), source_file, source_line, block_name);
             }
 
@@ -1361,6 +1539,9 @@ unwind_loop:
                 // variables that are visible to the exception handler (declared volatile)
                 currently_in_except_block = MP_TAGPTR_TAG0(code_state->exc_sp); // 0 or 1, to detect nested exceptions
                 exc_sp = MP_TAGPTR_PTR(code_state->exc_sp); // stack grows up, exc_sp points to top of stack
+                #if MICROPY_ENABLE_PYSTACK
+                MP_STATE_THREAD(pystack_cur) = code_state->pystack_top;
+                #endif
                 goto unwind_loop;
 
             #endif
@@ -74,6 +74,9 @@ static const void *const entry_table[256] = {
     [MP_BC_END_FINALLY] = &&entry_MP_BC_END_FINALLY,
     [MP_BC_GET_ITER] = &&entry_MP_BC_GET_ITER,
     [MP_BC_FOR_ITER] = &&entry_MP_BC_FOR_ITER,
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    [MP_BC_FOR_RANGE] = &&entry_MP_BC_FOR_RANGE,
+    #endif
     [MP_BC_POP_BLOCK] = &&entry_MP_BC_POP_BLOCK,
     [MP_BC_POP_EXCEPT] = &&entry_MP_BC_POP_EXCEPT,
     [MP_BC_BUILD_TUPLE] = &&entry_MP_BC_BUILD_TUPLE,
@@ -104,6 +107,13 @@ static const void *const entry_table[256] = {
     [MP_BC_IMPORT_NAME] = &&entry_MP_BC_IMPORT_NAME,
     [MP_BC_IMPORT_FROM] = &&entry_MP_BC_IMPORT_FROM,
     [MP_BC_IMPORT_STAR] = &&entry_MP_BC_IMPORT_STAR,
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    [MP_BC_STORE_FAST_KEEP] = &&entry_MP_BC_STORE_FAST_KEEP,
+    [MP_BC_BINARY_OP_FAST_FAST] = &&entry_MP_BC_BINARY_OP_FAST_FAST,
+    [MP_BC_BINARY_OP_FAST_INT] = &&entry_MP_BC_BINARY_OP_FAST_INT,
+    [MP_BC_BINARY_OP_INT] = &&entry_MP_BC_BINARY_OP_INT,
+    [MP_BC_BINARY_OP_TOP_TWO] = &&entry_MP_BC_BINARY_OP_TOP_TWO,
+    #endif
     [MP_BC_LOAD_CONST_SMALL_INT_MULTI ... MP_BC_LOAD_CONST_SMALL_INT_MULTI + 63] = &&entry_MP_BC_LOAD_CONST_SMALL_INT_MULTI,
     [MP_BC_LOAD_FAST_MULTI ... MP_BC_LOAD_FAST_MULTI + 15] = &&entry_MP_BC_LOAD_FAST_MULTI,
     [MP_BC_STORE_FAST_MULTI ... MP_BC_STORE_FAST_MULTI + 15] = &&entry_MP_BC_STORE_FAST_MULTI,
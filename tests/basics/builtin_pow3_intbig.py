@@ -0,0 +1,36 @@
+# test builtin pow() with 3 integral arguments, including big ints
+
+print(pow(3, 4, 7))
+print(pow(3, 0, 1))
+print(pow(0, 0, 5))
+print(pow(-5, 3, 7))
+print(pow(5, 3, -7))
+print(pow(-5, 3, -7))
+print(pow(2, 10 ** 6, 1000007))
+
+# odd moduli
+x = 0x123456789abcdef0123456789abcdef
+print(pow(x, 65537, (1 << 521) - 1))
+print(pow(x, (1 << 300) + 1, 3 ** 400))
+print(pow(-x, 12345, 10 ** 50 + 151))
+
+# even moduli
+print(pow(x, 65537, 1 << 200))
+print(pow(x, 12345, 10 ** 50))
+
+# negative exponents use the modular inverse
+print(pow(2, -1, 5))
+print(pow(3, -1, -7))
+print(pow(-x, -3, 10 ** 50 + 151))
+print(pow(x, -65537, (1 << 521) - 1))
+print(pow(5, -2, 1))
+
+# errors
+try:
+    pow(2, -1, 4)
+except ValueError:
+    print('ValueError')
+try:
+    pow(2, 3, 0)
+except ValueError:
+    print('ValueError')
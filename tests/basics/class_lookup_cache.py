@@ -0,0 +1,67 @@
+# test that results of looking up attributes in classes follow changes
+
+class A:
+    x = 1
+    def f(self):
+        return 'A.f'
+
+class B(A):
+    pass
+
+class C(B):
+    pass
+
+def get(o):
+    return o.x, o.f()
+
+c = C()
+print(get(c))
+print(get(c))
+
+# change a method and a value in a base class
+A.f = lambda self: 'new A.f'
+A.x = 2
+print(get(c))
+
+# shadow them in an intermediate class
+B.f = lambda self: 'B.f'
+B.x = 3
+print(get(c))
+
+# remove them again
+del B.f
+del B.x
+print(get(c))
+
+# instance members take precedence
+c.x = 4
+print(get(c), get(C()))
+
+# attribute not found, then added
+def get_y(o):
+    try:
+        return o.y
+    except AttributeError:
+        return 'no y'
+print(get_y(c))
+A.y = 5
+print(get_y(c))
+del A.y
+print(get_y(c))
+
+# special methods
+class D:
+    pass
+try:
+    D()[0]
+except TypeError:
+    print('TypeError')
+D.__getitem__ = lambda self, i: i + 1
+print(D()[0])
+
+# a new class with the same attribute names
+for i in range(3):
+    class E:
+        def f(self, i=i):
+            return i
+    print(E().f())
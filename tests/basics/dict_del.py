@@ -19,3 +19,14 @@ for n in range(20):
             else:
                 if j != i:
                     print(j, 'not in d, but it should be')
+
+# repeatedly add and delete items, so deleted entries must be reclaimed
+d = {}
+for i in range(1000):
+    d[i] = i
+    if i >= 10:
+        del d[i - 10]
+print(len(d), sorted(d))
+for i in range(990, 1000):
+    del d[i]
+print(len(d), d)
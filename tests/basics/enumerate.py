@@ -8,3 +8,10 @@ print(list(enumerate(range(100))))
 print(list(enumerate([1, 2, 3], start=1)))
 print(list(enumerate(iterable=[1, 2, 3])))
 print(list(enumerate(iterable=[1, 2, 3], start=1)))
+
+# unpacking the result in a for loop
+for i, x in enumerate('abc'):
+    print(i, x)
+e = enumerate([1, 2, 3, 4])
+for i, x in e:
+    print(i, x, next(e))
@@ -61,3 +61,31 @@ try:
         print(x)
 except TypeError:
     print('TypeError')
+
+# step that is not a constant, including negative and zero
+def f(start, end, step):
+    for x in range(start, end, step):
+        print(x)
+    else:
+        print('else')
+f(0, 5, 2)
+f(5, -5, -3)
+f(1, 1, 1)
+try:
+    f(0, 1, 0)
+except ValueError:
+    print('ValueError')
+
+# break and continue
+for x in range(10):
+    if x == 1:
+        continue
+    if x == 3:
+        break
+    print(x)
+else:
+    print('else')
+
+# values that don't fit in a small int
+for x in range(2 ** 62 - 1, 2 ** 62 + 1):
+    print(x)
@@ -0,0 +1,58 @@
+# test calling functions that take only plain positional args
+
+def f0():
+    return 0
+
+def f2(a, b):
+    c = a + b
+    return a, b, c
+
+print(f0())
+print(f2(1, 2))
+print(f2(b=2, a=1))
+print(f2(*(3, 4)))
+
+# wrong number of args
+try:
+    f2(1)
+except TypeError:
+    print('TypeError')
+try:
+    f2(1, 2, 3)
+except TypeError:
+    print('TypeError')
+try:
+    f0(1)
+except TypeError:
+    print('TypeError')
+
+# closed over arg, needs a cell
+def f3(a):
+    return lambda: a
+print(f3(5)())
+
+# function that is itself a closure
+def f4(x):
+    def g(a, b):
+        return a + b + x
+    return g
+print(f4(1)(2, 3))
+
+# generator
+def gen(a, b):
+    yield a
+    yield b
+print(list(gen(6, 7)))
+
+# recursion
+def fib(n):
+    if n < 2:
+        return n
+    return fib(n - 1) + fib(n - 2)
+print(fib(15))
+
+# bound method
+class A:
+    def m(self, a):
+        return a + 1
+print(A().m(1))
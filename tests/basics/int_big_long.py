@@ -0,0 +1,28 @@
+# test operations on long big ints, which use different algorithms to short ones
+
+# multiplication
+x = 7 ** 2000
+y = 11 ** 1500
+print(x * y % (10 ** 60 + 7))
+print(x * x == (x * 3) * (x * 5) // 15)
+print((-x) * y == -(x * y))
+
+# division
+a = (1 << 3000) - 1
+b = (1 << 4000) - 1
+print(a * b // a == b, a * b % a)
+
+# conversion to and from strings in various bases
+for z in (x, -y, 10 ** 2000, 10 ** 2000 - 1):
+    s = str(z)
+    print(len(s), s[:10], s[-10:], int(s) == z)
+    print(int(hex(z), 16) == z, int(oct(z), 8) == z, int(bin(z), 2) == z)
+    print(hex(z)[:10], hex(z)[-10:])
+print(int('1234567890' * 200, 7 + 3) % (10 ** 9 + 7))
+print(int('0' * 3000 + '1') == 1)
+
+# thousands separator
+print('{:,}'.format(123456789012345678901234567890))
+print('{:,}'.format(-10 ** 30))
+s = '{:,}'.format(10 ** 2000)
+print(len(s), s[:8], s[-8:])
@@ -0,0 +1,38 @@
+# list.sort and sorted are stable, and work with runs in the input
+
+# pseudo-random numbers, so the test is repeatable
+x = 1
+def rand(n):
+    global x
+    x = (x * 1103515245 + 12345) & 0x7fffffff
+    return (x >> 8) % n
+
+for n in (5, 63, 64, 65, 300, 1000):
+    l = [(rand(10), i) for i in range(n)]
+    a = sorted(l, key=lambda p: p[0])
+    print(n, a == sorted(l), sorted(l, key=lambda p: p[0], reverse=True) == sorted(l, key=lambda p: (-p[0], p[1])))
+
+    # ascending and descending runs with some disorder
+    l = list(range(n)) + list(range(n, 0, -1)) + [rand(n) for i in range(n // 3)] + list(range(n))
+    a = sorted(l)
+    print(all(a[i] <= a[i + 1] for i in range(len(a) - 1)), len(a) == len(l), sum(a) == sum(l))
+    l.sort(reverse=True)
+    print(l == a[::-1])
+
+# each key is computed only once
+count = 0
+def key(v):
+    global count
+    count += 1
+    return -v
+l = [rand(100) for i in range(500)]
+l.sort(key=key)
+print(count)
+
+# an exception part way through leaves all the items in the list
+l = list(range(100, 0, -1)) + list(range(100)) + [None] + list(range(100))
+try:
+    l.sort()
+except TypeError:
+    print('TypeError')
+print(len(l), sorted([v for v in l if v is not None]) == sorted(list(range(100, 0, -1)) + list(range(100)) + list(range(100))))
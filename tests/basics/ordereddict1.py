@@ -14,3 +14,11 @@ print(list(d.values()))
 del d["b"]
 print(list(d.keys()))
 print(list(d.values()))
+print(len(d))
+
+# add after deleting
+d["c"] = 300
+del d[10]
+d["d"] = 400
+print(len(d))
+print(list(d.items()))
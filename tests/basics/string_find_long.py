@@ -0,0 +1,25 @@
+# searching haystacks long enough to use the skip table
+
+s = 'abcde' * 20 + 'xyz' + 'abcde' * 20 + 'xyz' + 'ab'
+for needle in ('xyz', 'abc', 'eab', 'cdeab', 'xyzab', 'zab', 'yz', 'q', 'abq', 'x' * 300, s, s + 'a'):
+    print(needle[:8], s.find(needle), s.rfind(needle), s.count(needle), needle in s)
+    print(s.find(needle, 3, 150), s.rfind(needle, 3, 150), s.count(needle, 3, 150))
+    print(len(s.split(needle)) if needle else 0, s.rsplit(needle, 1)[-1][:8], s.partition(needle)[0][:8])
+
+# repeated bytes, which are the worst case for simple searches
+s = 'a' * 200 + 'b' + 'a' * 200
+print(s.find('a' * 50 + 'b'), s.rfind('b' + 'a' * 50), s.count('aa'), s.find('a' * 202))
+print(s.replace('a' * 100, 'x'))
+
+# needle longer than the maximum shift
+n = ''.join(chr(ord('a') + i % 26) for i in range(600))
+s = 'q' * 300 + n + 'q' * 300 + n[:-1]
+print(s.find(n), s.rfind(n), s.count(n))
+
+# bytes
+b = b'\x00\x01\x02' * 30 + b'\xff\xfe' + b'\x00\x01\x02' * 30
+print(b.find(b'\xff\xfe'), b.rfind(b'\x02\x00'), b.count(b'\x01\x02'), b.split(b'\xfe')[1][:4])
+
+# start past end
+s = 'abc' * 20
+print(s.find('abc', 30, 10), s.rfind('abc', 30, 10), s.count('abc', 30, 10), s.count('', 30, 10))
@@ -0,0 +1,98 @@
+# test sequences of opcodes that the compiler may fuse into superinstructions
+
+def arith(a, b):
+    x = a + b
+    y = a - 3
+    z = a * b
+    a += 1
+    b -= a
+    return x, y, z, a, b, a < b, a > 2, 7 <= a, b != 1
+
+print(arith(1, 2))
+print(arith(-5, 10))
+print(arith(1.5, 2))
+
+# results that no longer fit in a small int
+def grow(x):
+    for i in range(5):
+        x = x + x
+        x += 1
+    return x, x - 1, x > 0
+
+print(grow(1 << 60))
+print(grow(-(1 << 60)))
+
+# comparisons feeding a jump
+def cmp(a, b):
+    r = []
+    if a < b:
+        r.append('lt')
+    if a >= 3:
+        r.append('ge3')
+    while a < b:
+        a += 2
+    if not a == b:
+        r.append('ne')
+    return r, a
+
+print(cmp(1, 6))
+print(cmp(3, 3))
+print(cmp(1.5, 4))
+
+# range loops with and without a constant end, and negative steps
+def loops(n):
+    r = []
+    for i in range(n):
+        r.append(i)
+    for i in range(3, 10, 3):
+        r.append(i)
+    for i in range(n, -2, -2):
+        r.append(i)
+    for i in range(2, n + 1):
+        if i == 3:
+            continue
+        if i > 4:
+            break
+        r.append(i)
+    else:
+        r.append('else')
+    return r, i
+
+print(loops(0))
+print(loops(6))
+
+# chained assignment
+def chain():
+    a = b = c = 5
+    a += 1
+    return a, b, c
+
+print(chain())
+
+# errors raised from a fused op
+def err1(a):
+    return a + 1
+
+try:
+    err1('s')
+except TypeError:
+    print('TypeError')
+
+def err2():
+    if x < 1:
+        pass
+    x = 1
+
+try:
+    err2()
+except NameError:
+    print('NameError')
+
+def err3(a):
+    b = a < y
+    y = 1
+
+try:
+    err3(1)
+except NameError:
+    print('NameError')
@@ -1,2 +1,14 @@
 print(list(zip()))
 print(list(zip([1], {2,3})))
+
+# unpacking the result in a for loop
+for a, b in zip('abc', [1, 2]):
+    print(a, b)
+z = zip(range(4), range(4, 8))
+for a, b in z:
+    print(a, b, next(z))
+try:
+    for a, b in zip('ab', 'cd', 'ef'):
+        pass
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,18 @@
+import bench
+import gc
+
+def test(num):
+    # fragment the heap: keep every other small object alive so the start
+    # of the heap is a long run of single free blocks
+    keep = []
+    for i in range(20000):
+        t = (i,)
+        if i & 1:
+            keep.append(t)
+    gc.collect()
+    # now churn through multi-block allocations
+    for i in range(num // 200):
+        bytearray(100)
+        [None] * 20
+
+bench.run(test)
@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    a = 7 ** 4000
+    b = 3 ** 7000
+    for i in iter(range(num // 10000)):
+        c = a * b
+        d = c * c
+
+bench.run(test)
@@ -0,0 +1,8 @@
+import bench
+
+def test(num):
+    a = 7 ** 6000
+    for i in iter(range(num // 400000)):
+        s = str(a)
+
+bench.run(test)
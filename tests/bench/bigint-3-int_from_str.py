@@ -0,0 +1,8 @@
+import bench
+
+def test(num):
+    s = '1234567890' * 500
+    for i in iter(range(num // 20000)):
+        a = int(s)
+
+bench.run(test)
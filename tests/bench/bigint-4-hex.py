@@ -0,0 +1,8 @@
+import bench
+
+def test(num):
+    a = 7 ** 6000
+    for i in iter(range(num // 200000)):
+        s = hex(a)
+
+bench.run(test)
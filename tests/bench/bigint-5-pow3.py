@@ -0,0 +1,10 @@
+import bench
+
+def test(num):
+    m = 3 ** 640 + 2
+    x = 5 ** 400
+    e = 7 ** 360
+    for i in iter(range(num // 1000000)):
+        y = pow(x, e, m)
+
+bench.run(test)
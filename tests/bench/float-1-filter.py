@@ -0,0 +1,15 @@
+import bench
+
+def test(num):
+    # exponential moving average and peak tracking over a sensor reading
+    avg = 0.0
+    peak = 0.0
+    x = 0.5
+    for i in range(num // 10):
+        x = x * 0.99 + 0.01
+        avg = avg + (x - avg) * 0.125
+        if avg > peak:
+            peak = avg
+        avg = avg * 2 - avg / 2
+
+bench.run(test)
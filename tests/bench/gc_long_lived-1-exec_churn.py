@@ -0,0 +1,16 @@
+import bench
+
+# Compiles functions that stay alive for a while, interleaved with short-lived
+# temporaries and the occasional large buffer.  Run with a small heap, eg
+# -X heapsize=256k, to compare builds with and without MICROPY_GC_LONG_LIVED.
+
+def test(num):
+    funcs = [None] * 500
+    for i in range(num // 1000):
+        exec('def f(x):\n return x + %d' % i)
+        funcs[i % 500] = f
+        tmp = [[j] for j in range(20)]
+        if i % 10 == 0:
+            big = bytearray(40000)
+
+bench.run(test)
@@ -0,0 +1,13 @@
+import bench
+import gc
+
+# Times collections of a heap with many live objects, so most of the time
+# is spent marking.  Compare with MICROPY_GC_PARALLEL_MARK on and off, on a
+# machine with several CPUs.
+
+def test(num):
+    live = [[[i, j] for j in range(10)] for i in range(1500)]
+    for i in range(num // 200000):
+        gc.collect()
+
+bench.run(test)
@@ -0,0 +1,24 @@
+import utime
+
+# Prints the typical pause of an automatic collection, in seconds, rather
+# than a total time: the median of the longest few allocation times.  Few
+# objects are live and most of the heap is garbage, so sweeping is a large
+# part of a full collection.  With MICROPY_GC_INCREMENTAL_SWEEP only the
+# mark is done in the pause and the sweep is spread over later allocations.
+# The mark is not incremental, so the pause still grows with the live data.
+
+N_LONGEST = 9
+
+def test(num):
+    live = [[i] for i in range(5000)]
+    longest = [0] * N_LONGEST
+    for i in range(num):
+        t = utime.ticks_us()
+        [i, i]
+        t = utime.ticks_diff(utime.ticks_us(), t)
+        if t > longest[0]:
+            longest[0] = t
+            longest.sort()
+    print(longest[N_LONGEST // 2] / 1000000)
+
+test(200000)
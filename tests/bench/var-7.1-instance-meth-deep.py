@@ -0,0 +1,26 @@
+import bench
+
+class Base:
+
+    def __init__(self):
+        self._num = 20000000
+
+    def num(self):
+        return self._num
+
+class Foo1(Base): pass
+class Foo2(Foo1): pass
+class Foo3(Foo2): pass
+class Foo4(Foo3): pass
+class Foo5(Foo4): pass
+class Foo6(Foo5): pass
+class Foo7(Foo6): pass
+class Foo8(Foo7): pass
+
+def test(num):
+    o = Foo8()
+    i = 0
+    while i < o.num():
+        i += 1
+
+bench.run(test)
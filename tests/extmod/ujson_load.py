@@ -9,3 +9,10 @@ print(json.load(StringIO('null')))
 print(json.load(StringIO('"abc\\u0064e"')))
 print(json.load(StringIO('[false, true, 1, -2]')))
 print(json.load(StringIO('{"a":true}')))
+
+# strings, numbers and escapes that span the chunks read from the stream
+for n in range(120, 140):
+    s = 'x' * n
+    print(json.load(StringIO('["%s", 1234567890, "%s\\nab", 0.5e1]' % (s, s))) == [s, 1234567890, s + '\nab', 5.0])
+print(json.load(StringIO(' ' * 126 + '12345678 ')))
+print(json.load(StringIO(' ' * 125 + '"a\\u0064b"')))
@@ -0,0 +1,32 @@
+# test patterns and subjects that are too costly for a backtracking matcher
+#
+# CPython's re takes exponential time on some of these, so the expected output
+# is given in the .exp file.
+
+try:
+    import ure as re
+except ImportError:
+    try:
+        import re
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+# nested repeats, exponential time for a backtracking matcher
+r = re.compile('(a*)*b')
+print(r.match('a' * 40))
+m = r.match('a' * 40 + 'b')
+print(len(m.group(0)))
+print(re.search('(x+x+)+y', 'x' * 40))
+
+# long subjects, which a backtracking matcher recurses over
+s = 'ab' * 5000
+m = re.match('(a|b)*', s)
+print(len(m.group(0)))
+m = re.search('(a+)(b+)c', 'ab' * 1000 + 'aabbc')
+print(m.group(0), m.group(1), m.group(2))
+m = re.match('(.*):(\\d+)', 'x' * 2000 + ':123')
+print(len(m.group(1)), m.group(2))
+m = re.search('[a-c]+?d', 'ac' * 1000 + 'd')
+print(len(m.group(0)))
+print(re.match('(\\w+) (\\w+)$', 'word ' * 1000))
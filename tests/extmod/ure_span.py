@@ -0,0 +1,50 @@
+try:
+    import ure as re
+except ImportError:
+    try:
+        import re
+    except ImportError:
+        print('SKIP')
+        raise SystemExit
+
+try:
+    re.finditer
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+# offsets of groups
+m = re.search('(a)(x)?(b+)', 'zzabbb')
+print(m.span(), m.start(), m.end())
+for i in range(4):
+    print(i, m.span(i), m.start(i), m.end(i))
+try:
+    m.span(4)
+except IndexError:
+    print('IndexError')
+m = re.match(b'\\d+', b'123abc')
+print(m.span())
+
+# iterating over matches
+def print_iter(p, s):
+    print([m.span() for m in re.finditer(p, s)], [m.group(0) for m in re.finditer(p, s)])
+
+print_iter('\\d+', 'a12b345c')
+print_iter('x*', 'axb')
+print_iter('^a', 'aaa')
+print_iter('^', 'ab')
+print_iter('', 'abc')
+print_iter('(a)|b', 'abba')
+print_iter('a*?', 'aa')
+print_iter('z', 'abc')
+
+it = re.compile('b+').finditer('abbcb')
+print(next(it).group(0), next(it).group(0))
+try:
+    next(it)
+except StopIteration:
+    print('StopIteration')
+
+# more patterns than are kept compiled, used in turn
+for i in range(3):
+    print([re.match('%d+' % j, '%d%d' % (j, j)).group(0) for j in range(10)])
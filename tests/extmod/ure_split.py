@@ -22,3 +22,8 @@ print(s)
 r = re.compile("[a-f]+")
 s = r.split("0a3b9")
 print(s)
+
+# ^ only matches at the start of the subject
+r = re.compile("^a")
+s = r.split("aXa")
+print(s)
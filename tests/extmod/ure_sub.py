@@ -0,0 +1,61 @@
+try:
+    import ure as re
+except ImportError:
+    try:
+        import re
+    except ImportError:
+        print('SKIP')
+        raise SystemExit
+
+try:
+    re.sub
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+def print_sub(*args):
+    print(repr(re.sub(*args)))
+
+# plain replacement
+print_sub('a', 'b', 'aaa')
+print_sub('ab', 'x', 'zzz')
+print_sub('a', 'b', 'aaaa', 2)
+print_sub('a+', '-', 'baaacaa')
+print_sub('a', 'b', 'aaa', -1)
+
+# ^ only matches at the start of the subject
+print_sub('^a', 'b', 'aaa')
+print_sub('^', '-', 'ab')
+
+# empty matches, including next to a non-empty match
+print_sub('x*', '-', 'abxd')
+print_sub('x*', '-', 'abc')
+print_sub('b*', '-', '')
+
+# group references and escapes in the replacement
+print_sub('(\\w+)=(\\d+)', '\\2=\\1', 'a=1, bb=22')
+print_sub('(\\w+)=(\\d+)', '\\g<2>:\\g<1>', 'a=1, bb=22')
+print_sub('a|(b)', '[\\1]', 'abc')
+print_sub('\\d', '\\\\', 'a1b')
+print_sub('c', 'q\\n\\t', 'abc')
+
+# callable replacement
+print_sub('(\\d+)', lambda m: str(int(m.group(1)) * 2), 'x1y22z333')
+
+# bytes
+print_sub(b'a+', b'-', b'baaac')
+
+# method on a compiled regex
+r = re.compile('(a)(b)?')
+print(repr(r.sub('<\\2\\1>', 'abcacab')))
+print(repr(r.sub('<\\1>', 'abcacab', 1)))
+
+# invalid group references
+try:
+    re.sub('(a)', '\\2', 'a')
+except Exception:
+    print('Exception')
+try:
+    re.sub('(a)', '\\g<1', 'a')
+except Exception:
+    print('Exception')
@@ -0,0 +1,85 @@
+try:
+    import uzlib
+    import uio as io
+except ImportError:
+    print('SKIP')
+    raise SystemExit
+
+try:
+    uzlib.compress
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+def lcg_bytes(n, seed=1):
+    b = bytearray(n)
+    for i in range(n):
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff
+        b[i] = seed >> 16 & 0xff
+    return bytes(b)
+
+DATA = [
+    b'',
+    b'a',
+    b'hello',
+    b'a' * 1000,
+    bytes(range(256)) * 4,
+    b''.join([b'%d: GET /index.html 200\n' % (i * 37 % 101) for i in range(500)]),
+    lcg_bytes(3000),
+]
+
+# round trip through zlib and raw framing, for a range of levels and windows
+for data in DATA:
+    res = []
+    for level in (-1, 0, 1, 6, 9):
+        for wbits in (9, 10, 15, -9, -15):
+            z = uzlib.compress(data, level, wbits)
+            res.append(uzlib.decompress(z, wbits) == data)
+    print(len(data), all(res))
+
+# default parameters, and headers
+z = uzlib.compress(b'hello')
+print(z[:2], uzlib.decompress(z))
+print(uzlib.compress(b'hello', 9, 15)[:2])
+print(uzlib.compress(b'hello', 1, 26)[:4])
+
+# compressible data gets smaller, incompressible data grows only a little
+print(len(uzlib.compress(DATA[3])) < 20)
+print(len(uzlib.compress(DATA[5])) < len(DATA[5]) // 4)
+print(len(uzlib.compress(DATA[6])) - len(DATA[6]) < 40)
+
+# streaming, with the output readable up to each flush
+data = DATA[5]
+buf = io.BytesIO()
+out = uzlib.CompIO(buf, -1, -10)
+res = []
+for i in range(0, len(data), 1000):
+    chunk = data[i:i + 1000]
+    out.write(chunk)
+    out.flush()
+    inp = uzlib.DecompIO(io.BytesIO(buf.getvalue()), -10)
+    res.append(inp.read(i + len(chunk)) == data[:i + len(chunk)])
+out.close()
+print(all(res))
+
+# gzip and zlib framing, written in small pieces
+for wbits in (10, 26):
+    buf = io.BytesIO()
+    out = uzlib.CompIO(buf, 6, wbits)
+    for i in range(0, len(data), 7):
+        out.write(data[i:i + 7])
+    out.close()
+    print(uzlib.DecompIO(io.BytesIO(buf.getvalue()), wbits).read() == data)
+
+# closed stream
+try:
+    out.write(b'x')
+except OSError:
+    print('OSError')
+
+# invalid arguments
+for args in ((-2, 10), (10, 10), (6, 8), (6, 16), (6, -8), (6, 32)):
+    try:
+        uzlib.compress(b'', *args)
+    except ValueError:
+        print('ValueError')
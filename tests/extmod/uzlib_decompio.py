@@ -30,3 +30,39 @@ try:
     print(inp.read())
 except OSError as e:
     print(repr(e))
+
+# zlib stream of a stored block, longer than the chunks read from the source
+import ustruct as struct
+def adler32(data):
+    a, b = 1, 0
+    for c in data:
+        a = (a + c) % 65521
+        b = (b + a) % 65521
+    return b << 16 | a
+data = bytes([(i * 7) & 0xff for i in range(600)])
+z = b'x\x01\x01' + struct.pack('<HH', len(data), len(data) ^ 0xffff) + data + struct.pack('>I', adler32(data))
+
+# data following the compressed stream is left in the source stream
+buf = io.BytesIO(z + b'tail')
+inp = zlib.DecompIO(buf)
+print(inp.read(100) == data[:100])
+print(inp.read() == data[100:])
+print(buf.read())
+
+# truncated stream
+inp = zlib.DecompIO(io.BytesIO(z[:300]))
+try:
+    inp.read()
+except EOFError:
+    print('EOFError')
+
+# a source that can't seek (another DecompIO) is read in chunks, and the
+# bytes read past the end of the compressed data are kept in unused_data
+inner = z + b'tail' * 100
+outer = b'x\x01\x01' + struct.pack('<HH', len(inner), len(inner) ^ 0xffff) + inner + struct.pack('>I', adler32(inner))
+src = zlib.DecompIO(io.BytesIO(outer))
+inp = zlib.DecompIO(src)
+print(inp.unused_data)
+print(inp.read() == data)
+print(inp.unused_data + src.read() == b'tail' * 100)
+print(zlib.DecompIO(io.BytesIO(z + b'tail')).unused_data)
@@ -0,0 +1,18 @@
+# test for+range with float arguments, which range() doesn't accept
+
+def f(start, end, step):
+    try:
+        for x in range(start, end, step):
+            print(x)
+    except TypeError:
+        print('TypeError')
+
+f(0, 2, 0.5)
+f(0.5, 2, 1)
+f(0, 2.5, 1)
+
+try:
+    for x in range(0, 2, 0.5):
+        print(x)
+except TypeError:
+    print('TypeError')
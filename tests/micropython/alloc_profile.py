@@ -0,0 +1,58 @@
+# test micropython.alloc_profile
+
+import micropython
+
+try:
+    micropython.alloc_profile
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+def f():
+    for i in range(3):
+        b = bytearray(100000)
+    return b
+
+# every buffer is larger than the interval, so each is sampled exactly once
+micropython.alloc_profile(100000)
+f()
+micropython.alloc_profile(0)
+micropython.alloc_profile()
+
+# nothing is sampled while profiling is stopped
+f()
+micropython.alloc_profile()
+
+# the buffer of a list is counted by the type of the list
+def g():
+    return [0] * 30000
+micropython.alloc_profile(100000)
+g()
+micropython.alloc_profile(0)
+micropython.alloc_profile()
+
+# a class is counted by name, and may be freed before the profile is shown
+def h():
+    class C:
+        pass
+    l = [None] * 1000
+    micropython.alloc_profile(1000)
+    for i in range(1000):
+        l[i] = C()
+    micropython.alloc_profile(0)
+h()
+import gc
+gc.collect()
+for i in range(100):
+    [0] * 50
+micropython.alloc_profile()
+
+# restarting clears the profile
+micropython.alloc_profile(100000)
+micropython.alloc_profile(0)
+micropython.alloc_profile()
+
+try:
+    micropython.alloc_profile(-1)
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,73 @@
+# test gc.compact, which moves buffers of lists, arrays and dicts
+
+import gc
+
+try:
+    gc.compact
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+try:
+    import array
+except ImportError:
+    array = None
+
+# fragment the heap: free every other buffer, keeping the owners alive
+def make(n):
+    owners = []
+    junk = []
+    for i in range(n):
+        junk.append([0] * 16)
+        owners.append([i] * 8)
+        junk.append(bytearray(200))
+        owners.append(bytearray([i] * 10))
+        junk.append({j: j for j in range(10)})
+        owners.append({'k': i, 'v': str(i)})
+    return owners, junk
+
+owners, junk = make(50)
+junk = None
+gc.collect()
+print(gc.compact() > 0)
+
+# all data must have survived the moves
+ok = True
+for i in range(50):
+    l, b, d = owners[3 * i:3 * i + 3]
+    ok = ok and l == [i] * 8 and b == bytearray([i] * 10) and d == {'k': i, 'v': str(i)}
+print(ok)
+
+# the moved objects must still work
+l = owners[0]
+l.append(1)
+owners[1].extend(b'xyz')
+owners[2]['new'] = 1
+print(len(l), owners[1][-3:], sorted(owners[2].keys()))
+
+# a buffer shared with a memoryview stays put
+b = bytearray(b'shared')
+m = memoryview(b)
+junk = [bytearray(100) for i in range(20)]
+junk = None
+gc.compact()
+b[0] = ord('S')
+print(b, bytes(m))
+
+# a list being sorted is in use by C code and must not move
+def key(x):
+    gc.compact()
+    return -x
+l = list(range(20))
+l.sort(key=key)
+print(l)
+
+# arrays of other types
+if array:
+    a = array.array('i', range(10))
+    junk = [[0] * 50 for i in range(20)]
+    junk = None
+    gc.compact()
+    print(list(a))
+else:
+    print(list(range(10)))
@@ -0,0 +1,25 @@
+# test that compiled code, which is allocated as long-lived when the GC keeps
+# it apart from other data, stays usable while temporaries come and go
+
+import gc
+
+gc.collect()
+funcs = []
+tmp = []
+for i in range(150):
+    exec('def f(x):\n return x * %d' % i)
+    funcs.append(f)
+    tmp.append([[j] for j in range(10)])
+    tmp.append(bytearray(100))
+    if i % 50 == 0:
+        gc.collect()
+
+# the temporaries are freed, leaving room for a large block
+tmp = None
+gc.collect()
+b = bytearray(40000)
+print(len(b))
+
+print(sum([f(2) for f in funcs]))
+gc.collect()
+print(sum([f(3) for f in funcs]))
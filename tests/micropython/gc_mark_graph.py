@@ -0,0 +1,30 @@
+# test that collections keep a large object graph alive, including chains
+# deeper than a marker's stack and objects shared between many parents
+
+import gc
+
+# a linked list, which is traced one block at a time
+head = None
+for i in range(5000):
+    head = [i, head]
+
+# a wide tree whose leaves are shared by many parents
+leaves = [[i] for i in range(100)]
+tree = [[leaves[(i * j) % 100] for j in range(20)] for i in range(2000)]
+leaves = None
+
+for i in range(3):
+    # garbage to be freed between the live objects
+    tmp = [[j] for j in range(2000)]
+    tmp = None
+    gc.collect()
+
+n = 0
+total = 0
+l = head
+while l is not None:
+    total += l[0]
+    n += 1
+    l = l[1]
+print(n, total)
+print(sum([sum([leaf[0] for leaf in node]) for node in tree]))
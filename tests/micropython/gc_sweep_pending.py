@@ -0,0 +1,34 @@
+# test freeing and resizing chains that a pending incremental sweep has yet
+# to reach; with a full sweep after each collection this is a plain workout
+
+import gc
+
+try:
+    gc.threshold
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+gc.collect()
+
+# many objects, so that the sweep after a collection takes many steps
+objs = [([i] * 8, {i: i}, bytearray(i % 40)) for i in range(1000)]
+
+# collect automatically every few allocations, leaving most of the heap to
+# be swept by the allocations that follow
+gc.threshold(2048)
+for r in range(5):
+    for i in range(len(objs)):
+        l, d, b = objs[i]
+        l.extend(range(32)) # grows by gc_realloc
+        while len(l) > 8:
+            l.pop() # shrinks by gc_realloc
+        d.clear() # gc_free of the table
+        d[i] = r
+        b.extend(b'xy') # grows by gc_realloc
+gc.threshold(-1)
+gc.collect()
+
+print(all([l == [i] * 8 for i, (l, d, b) in enumerate(objs)]))
+print(all([d == {i: 4} for i, (l, d, b) in enumerate(objs)]))
+print(all([b == bytes(i % 40) + b'xy' * 5 for i, (l, d, b) in enumerate(objs)]))
@@ -0,0 +1,35 @@
+# test micropython.profile_start/profile_stop
+
+import micropython
+
+try:
+    micropython.profile_start
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+def f(n):
+    x = 0
+    for i in range(n):
+        x += i * i
+    return x
+
+micropython.profile_start(1000)
+for i in range(4):
+    f(300000)
+prof = micropython.profile_stop()
+
+# samples in f are attributed to the lines of its loop
+in_f = [k for k in prof if k is not None and k[1] == 'f']
+print(len(in_f) > 0)
+print(all(k[0].endswith('profile.py') and 13 <= k[2] <= 14 for k in in_f))
+print(all(v > 0 for v in prof.values()))
+
+# nothing is sampled while profiling is stopped
+f(100000)
+print(micropython.profile_stop())
+
+try:
+    micropython.profile_start(0)
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,72 @@
+# test the dedicated stack for Python frames
+
+try:
+    from micropython import pystack_use
+except ImportError:
+    print('SKIP')
+    raise SystemExit
+
+def f(n):
+    return n if n == 0 else f(n - 1)
+
+# frames are freed when they return
+base = pystack_use()
+f(10)
+print(pystack_use() == base)
+
+# exceptions that abort calls mustn't leave anything on the pystack
+class A:
+    def meth(self, *args):
+        raise ValueError
+
+def g(*args, **kwargs):
+    raise ValueError
+
+m = A().meth
+for i in range(1000):
+    try:
+        m(1, 2, 3, 4, 5, 6)
+    except ValueError:
+        pass
+    try:
+        g(*(1, 2), **{'a': 1})
+    except ValueError:
+        pass
+print(pystack_use() == base)
+
+# the same for calls that fail before they start, caught by except, with
+# and finally blocks
+def h(a, b):
+    pass
+
+class CM:
+    def __enter__(self):
+        return self
+    def __exit__(self, a, b, c):
+        return True
+
+for i in range(1000):
+    try:
+        h(1)
+    except TypeError:
+        pass
+    with CM():
+        h(1)
+    try:
+        try:
+            h(1)
+        finally:
+            pass
+    except TypeError:
+        pass
+print(pystack_use() == base)
+
+# deep recursion runs out of pystack (or C stack) cleanly
+def rec(n):
+    return rec(n + 1)
+
+try:
+    rec(0)
+except RuntimeError:
+    print('RuntimeError')
+print(pystack_use() == base)
@@ -0,0 +1,16 @@
+# intern many strings as attribute names, spanning several qstr pools
+
+class A:
+    pass
+
+a = A()
+for i in range(2000):
+    setattr(a, 'attr%d' % i, i)
+
+s = 0
+for i in range(2000):
+    s += getattr(a, 'attr%d' % i)
+print(s)
+
+# names of builtins must still be found in the ROM pool
+print(getattr(a, 'attr' + '1999'), hasattr(a, 'app' + 'end'), getattr([], 'app' + 'end') is not None)
@@ -0,0 +1,44 @@
+# test that gc.compact refuses to move buffers while other threads run
+
+import gc
+try:
+    gc.compact
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+try:
+    import utime as time
+except ImportError:
+    import time
+import _thread
+
+lock = _thread.allocate_lock()
+lock.acquire()
+done = _thread.allocate_lock()
+done.acquire()
+
+def thread_entry():
+    buf = bytearray(b'thread')
+    lock.acquire()
+    print(buf)
+    done.release()
+
+_thread.start_new_thread(thread_entry, ())
+
+try:
+    gc.compact()
+except RuntimeError:
+    print('RuntimeError')
+
+lock.release()
+done.acquire()
+
+# once the thread has finished compaction is allowed again
+for i in range(100):
+    try:
+        gc.compact()
+        break
+    except RuntimeError:
+        time.sleep(0.01)
+print(i < 100)
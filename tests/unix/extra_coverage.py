@@ -29,3 +29,7 @@ from frzstr_pkg2.mod import Foo
 print(Foo.x)
 from frzmpy_pkg2.mod import Foo
 print(Foo.x)
+
+# test import of frozen native and viper code
+import frzmpy_native
+print(frzmpy_native.native(1.0))
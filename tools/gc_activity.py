@@ -18,6 +18,35 @@ def change_root(trace, size):
         level[file_location]["blocks"] += size
         level = level[file_location]["subcalls"]
 
+def print_frame(frame, indent=0, unit="blocks"):
+    for key in sorted(frame):
+        if not frame[key]["blocks"] or key.startswith("../py/malloc.c") or key.startswith("../py/gc.c"):
+            continue
+        print(" " * (indent - 1), key, frame[key]["function"], frame[key]["blocks"], unit)
+        print_frame(frame[key]["subcalls"], indent + 2, unit)
+
+def print_total(unit="blocks"):
+    total = 0
+    for key in sorted(root):
+        total += root[key]["blocks"]
+    print(total, "total", unit)
+
+# Output of micropython.alloc_profile(): each sample stands for roughly
+# `interval` bytes allocated at the given Python call site.
+with open(sys.argv[1], "r") as f:
+    header = f.readline().split()
+    if header[:2] == ["alloc", "profile:"]:
+        interval = int(header[2].split("=")[1])
+        for line in f:
+            fields = line.split()
+            if len(fields) != 4:
+                continue
+            samples, location, function, type_name = fields
+            change_root([("0x0", type_name, function), ("0x0", location + " " + function, "")], int(samples) * interval)
+        print_frame(root, unit="bytes")
+        print_total("bytes")
+        sys.exit(0)
+
 total_actions = 0
 with open(sys.argv[1], "r") as f:
     for line in f:
@@ -77,18 +106,8 @@ for alloc in current_heap.values():
     alloc["end_time"] = total_actions
     allocation_history.append(alloc)
 
-def print_frame(frame, indent=0):
-    for key in sorted(frame):
-        if not frame[key]["blocks"] or key.startswith("../py/malloc.c") or key.startswith("../py/gc.c"):
-            continue
-        print(" " * (indent - 1), key, frame[key]["function"], frame[key]["blocks"], "blocks")
-        print_frame(frame[key]["subcalls"], indent + 2)
-
 print_frame(root)
-total_blocks = 0
-for key in sorted(root):
-    total_blocks += root[key]["blocks"]
-print(total_blocks, "total blocks")
+print_total()
 
 with open("allocation_history.json", "w") as f:
     json.dump(allocation_history, f)
@@ -48,6 +48,34 @@ from collections import namedtuple
 sys.path.append('../py')
 import makeqstrdata as qstrutil
 
+# feature flag set in the .mpy header when the file contains native code
+MPY_FEATURE_NATIVE = 8
+
+# these must match mp_raw_code_kind_t in py/emitglue.h
+MP_CODE_BYTECODE = 2
+MP_CODE_NATIVE_PY = 3
+MP_CODE_NATIVE_VIPER = 4
+
+# these must match the enum in py/persistentcode.h; the value is the
+# MICROPY_EMIT_xxx option and the size in bytes of a machine word
+MP_NATIVE_ARCH = {
+    1: ('X86', 4),
+    2: ('X64', 8),
+    3: ('ARM', 4),
+    4: ('THUMB', 4),
+    5: ('XTENSA', 4),
+}
+
+# these must match mp_native_reloc_kind_t in py/emitglue.h
+MP_NATIVE_RELOC_FUN_TABLE = 0
+MP_NATIVE_RELOC_FUN = 1
+MP_NATIVE_RELOC_QSTR = 2
+MP_NATIVE_RELOC_QSTR_OBJ = 3
+MP_NATIVE_RELOC_QSTR16 = 4
+MP_NATIVE_RELOC_CONST = 5
+MP_NATIVE_RELOC_OBJ = 6
+MP_NATIVE_RELOC_RAW_CODE = 7
+
 class FreezeError(Exception):
     def __init__(self, rawcode, msg):
         self.rawcode = rawcode
@@ -56,10 +84,182 @@ class FreezeError(Exception):
     def __str__(self):
         return 'error while freezing %s: %s' % (self.rawcode.source_file, self.msg)
 
+# the functions in mp_fun_table, in the order of mp_fun_kind_t in py/runtime0.h
+native_fun_table = (
+    'mp_convert_obj_to_native',
+    'mp_convert_native_to_obj',
+    'mp_load_name',
+    'mp_load_global',
+    'mp_load_build_class',
+    'mp_load_attr',
+    'mp_load_method',
+    'mp_store_name',
+    'mp_store_global',
+    'mp_store_attr',
+    'mp_obj_subscr',
+    'mp_obj_is_true',
+    'mp_unary_op',
+    'mp_binary_op',
+    'mp_obj_new_tuple',
+    'mp_obj_new_list',
+    'mp_obj_list_append',
+    'mp_obj_new_dict',
+    'mp_obj_dict_store',
+    'mp_obj_new_set',
+    'mp_obj_set_store',
+    'mp_make_function_from_raw_code',
+    'mp_native_call_function_n_kw',
+    'mp_call_method_n_kw',
+    'mp_call_method_n_kw_var',
+    'mp_getiter',
+    'mp_iternext',
+    'nlr_push',
+    'nlr_pop',
+    'mp_native_raise',
+    'mp_import_name',
+    'mp_import_from',
+    'mp_import_all',
+    'mp_obj_new_slice',
+    'mp_unpack_sequence',
+    'mp_unpack_ex',
+    'mp_delete_name',
+    'mp_delete_global',
+    'mp_obj_new_cell',
+    'mp_make_closure_from_raw_code',
+    'mp_setup_code_state',
+    'mp_native_pystack_get',
+    'mp_native_pystack_set',
+)
+
+# the objects that MP_NATIVE_RELOC_CONST refers to, in the order of
+# native_const_table in py/persistentcode.c
+native_const_table = (
+    'mp_const_none_obj',
+    'mp_const_false_obj',
+    'mp_const_true_obj',
+    'mp_const_ellipsis_obj',
+)
+
+class NativeRawCode:
+    # machine code from a .mpy file; when it is frozen the values that are
+    # relocated at load time are instead filled in by the C compiler
+    def __init__(self, kind, code, prelude, const_table_offset, relocs):
+        self.kind = kind
+        self.code = code
+        self.prelude = prelude
+        self.const_table_offset = const_table_offset
+        self.relocs = relocs
+        self.raw_codes = [val for loc, rkind, val in relocs if rkind == MP_NATIVE_RELOC_RAW_CODE]
+        qstr16 = [val for loc, rkind, val in relocs if rkind == MP_NATIVE_RELOC_QSTR16]
+        if len(qstr16) > 1:
+            self.simple_name = global_qstrs[qstr16[0]]
+            self.source_file = global_qstrs[qstr16[1]]
+        else:
+            # viper code has no prelude, so no names
+            self.simple_name = qstr_type('<viper>', 'viper', None)
+            self.source_file = qstr_type('<viper>', 'viper', None)
+
+    def freeze_child(self, parent):
+        # viper code doesn't record its source file, so take it from the parent
+        if self.source_file.qstr_id is None:
+            self.source_file = parent.source_file
+        self.freeze(parent.escaped_name + '_')
+
+    def dump(self):
+        print('native code (kind %u): %u bytes, %u relocations' % (self.kind, len(self.code), len(self.relocs)))
+        for rc in self.raw_codes:
+            rc.dump()
+
+    def _word_expr(self, word):
+        # combine the bytes of a word, some of which may be C expressions,
+        # into a single expression for that word
+        const = 0
+        exprs = []
+        for i, b in enumerate(word):
+            if is_int_type(b):
+                const |= b << (8 * i)
+            else:
+                exprs.append('(mp_uint_t)(%s) << %u' % (b, 8 * i) if i else '(mp_uint_t)(%s)' % b)
+        if const or not exprs:
+            exprs.append('0x%0*x' % (2 * len(word), const))
+        return ' | '.join(exprs)
+
+    def freeze(self, parent_name):
+        arch, word_size = MP_NATIVE_ARCH[config.native[0]]
+        self.escaped_name = unique_escaped_name(parent_name, self.simple_name)
+
+        # emit children first
+        for rc in self.raw_codes:
+            rc.freeze_child(self)
+
+        # the code is emitted as an array of machine words, so that the values
+        # that are relocated can be filled in as (constant) C expressions
+        code = list(self.code)
+        code.extend([0] * (-len(code) % word_size))
+        for i, (loc, rkind, val) in enumerate(self.relocs):
+            if rkind == MP_NATIVE_RELOC_QSTR16:
+                qst = global_qstrs[val].qstr_id
+                code[loc] = '%s & 0xff' % qst
+                code[loc + 1] = '%s >> 8' % qst
+                continue
+            if rkind == MP_NATIVE_RELOC_FUN_TABLE:
+                expr = '&mp_fun_table'
+            elif rkind == MP_NATIVE_RELOC_FUN:
+                expr = native_fun_table[val]
+            elif rkind == MP_NATIVE_RELOC_QSTR:
+                expr = global_qstrs[val].qstr_id
+            elif rkind == MP_NATIVE_RELOC_QSTR_OBJ:
+                expr = 'MP_OBJ_NEW_QSTR(%s)' % global_qstrs[val].qstr_id
+            elif rkind == MP_NATIVE_RELOC_CONST:
+                expr = 'MP_OBJ_FROM_PTR(&%s)' % native_const_table[val]
+            elif rkind == MP_NATIVE_RELOC_OBJ:
+                obj_name = 'const_obj_%s_%u' % (self.escaped_name, i)
+                freeze_const_obj(self, obj_name, val)
+                expr = 'MP_OBJ_FROM_PTR(&%s)' % obj_name
+            else:
+                assert rkind == MP_NATIVE_RELOC_RAW_CODE
+                expr = '&raw_code_%s' % val.escaped_name
+            code[loc:loc + word_size] = [expr] + [0] * (word_size - 1)
+
+        # generate machine code
+        print()
+        print('// frozen native code for file %s, scope %s%s' % (self.source_file.str, parent_name, self.simple_name.str))
+        print('STATIC const mp_uint_t fun_data_%s[%u] MICROPY_FROZEN_NATIVE_CODE_ATTR = {'
+            % (self.escaped_name, len(code) // word_size))
+        for i in range(0, len(code), word_size):
+            print('    %s,' % self._word_expr(code[i:i + word_size]))
+        print('};')
+
+        # generate raw code
+        print('STATIC const mp_raw_code_t raw_code_%s = {' % self.escaped_name)
+        print('    .kind = %s,' % ('MP_CODE_NATIVE_PY' if self.kind == MP_CODE_NATIVE_PY else 'MP_CODE_NATIVE_VIPER'))
+        print('    .scope_flags = 0x%02x,' % self.prelude[0])
+        print('    .n_pos_args = %u,' % self.prelude[1])
+        print('    .data.u_native = {')
+        print('        .fun_data = (void*)fun_data_%s,' % self.escaped_name)
+        if self.kind == MP_CODE_NATIVE_PY:
+            print('        .const_table = (const mp_uint_t*)((const byte*)fun_data_%s + %u),'
+                % (self.escaped_name, self.const_table_offset))
+        else:
+            print('        .const_table = NULL,')
+        print('        .type_sig = 0x%x,' % self.prelude[2])
+        print('        #if MICROPY_PERSISTENT_CODE_SAVE')
+        print('        .fun_len = %u,' % len(self.code))
+        print('        .relocs = NULL,')
+        print('        .n_relocs = 0,')
+        print('        #endif')
+        print('    },')
+        print('};')
+
 class Config:
     MICROPY_LONGINT_IMPL_NONE = 0
     MICROPY_LONGINT_IMPL_LONGLONG = 1
     MICROPY_LONGINT_IMPL_MPZ = 2
+    # set if any of the .mpy files uses superinstructions
+    MICROPY_OPT_SUPERINSTRUCTIONS = False
+    # if any of the .mpy files has native code, the architecture, object
+    # representation, and words in mp_code_state_t and nlr_buf_t it is for
+    native = None
 config = Config()
 
 MP_OPCODE_BYTE = 0
@@ -76,6 +276,13 @@ MP_BC_LOAD_NAME = 0x1c
 MP_BC_LOAD_GLOBAL = 0x1d
 MP_BC_LOAD_ATTR = 0x1e
 MP_BC_STORE_ATTR = 0x26
+# superinstructions, size depends on the op byte:
+MP_BC_BINARY_OP_FAST_FAST = 0x2c
+MP_BC_BINARY_OP_FAST_INT = 0x2d
+MP_BC_BINARY_OP_INT = 0x2e
+MP_BC_BINARY_OP_TOP_TWO = 0x2f
+MP_BC_TAIL_MASK = 0xc0
+MP_BC_TAIL_STORE_FAST = 0x40
 
 def make_opcode_format():
     def OC4(a, b, c, d):
@@ -93,18 +300,18 @@ def make_opcode_format():
     OC4(U, U, U, U), # 0x0c-0x0f
     OC4(B, B, B, U), # 0x10-0x13
     OC4(V, U, Q, V), # 0x14-0x17
-    OC4(B, U, V, V), # 0x18-0x1b
+    OC4(B, V, V, V), # 0x18-0x1b
     OC4(Q, Q, Q, Q), # 0x1c-0x1f
     OC4(B, B, V, V), # 0x20-0x23
     OC4(Q, Q, Q, B), # 0x24-0x27
     OC4(V, V, Q, Q), # 0x28-0x2b
-    OC4(U, U, U, U), # 0x2c-0x2f
+    OC4(B, B, B, B), # 0x2c-0x2f
     OC4(B, B, B, B), # 0x30-0x33
     OC4(B, O, O, O), # 0x34-0x37
     OC4(O, O, U, U), # 0x38-0x3b
     OC4(U, O, B, O), # 0x3c-0x3f
     OC4(O, B, B, O), # 0x40-0x43
-    OC4(B, B, O, U), # 0x44-0x47
+    OC4(B, B, O, O), # 0x44-0x47
     OC4(U, U, U, U), # 0x48-0x4b
     OC4(U, U, U, U), # 0x4c-0x4f
     OC4(V, V, U, V), # 0x50-0x53
@@ -164,7 +371,20 @@ def mp_opcode_format(bytecode, ip, opcode_format=make_opcode_format()):
     opcode = bytecode[ip]
     ip_start = ip
     f = (opcode_format[opcode >> 2] >> (2 * (opcode & 3))) & 3
-    if f == MP_OPCODE_QSTR:
+    if MP_BC_BINARY_OP_FAST_FAST <= opcode <= MP_BC_BINARY_OP_TOP_TWO:
+        # superinstruction: op byte, 0 to 2 var-ints, tail
+        n_args = {MP_BC_BINARY_OP_TOP_TWO: 0, MP_BC_BINARY_OP_INT: 1}.get(opcode, 2)
+        tail = bytecode[ip + 1] & MP_BC_TAIL_MASK
+        ip += 2
+        if tail == MP_BC_TAIL_STORE_FAST:
+            n_args += 1
+        for _ in range(n_args):
+            while bytecode[ip] & 0x80 != 0:
+                ip += 1
+            ip += 1
+        if tail > MP_BC_TAIL_STORE_FAST:
+            ip += 2
+    elif f == MP_OPCODE_QSTR:
         ip += 3
     else:
         extra_byte = (
@@ -215,10 +435,64 @@ def extract_prelude(bytecode):
     # ip2 points to simple_name qstr
     return ip, ip2, (n_state, n_exc_stack, scope_flags, n_pos_args, n_kwonly_args, n_def_pos_args, code_info_size)
 
-class RawCode:
-    # a set of all escaped names, to make sure they are unique
-    escaped_names = set()
+# a set of all escaped names, to make sure they are unique
+escaped_names = set()
+
+def unique_escaped_name(parent_name, simple_name):
+    escaped_name = parent_name + simple_name.qstr_esc
+    i = 2
+    while escaped_name in escaped_names:
+        escaped_name = parent_name + simple_name.qstr_esc + str(i)
+        i += 1
+    escaped_names.add(escaped_name)
+    return escaped_name
+
+def freeze_const_obj(rc, obj_name, obj):
+    if is_str_type(obj) or is_bytes_type(obj):
+        if is_str_type(obj):
+            obj = bytes_cons(obj, 'utf8')
+            obj_type = 'mp_type_str'
+        else:
+            obj_type = 'mp_type_bytes'
+        print('STATIC const mp_obj_str_t %s = {{&%s}, %u, %u, (const byte*)"%s"};'
+            % (obj_name, obj_type, qstrutil.compute_hash(obj, config.MICROPY_QSTR_BYTES_IN_HASH),
+                len(obj), ''.join(('\\x%02x' % b) for b in obj)))
+    elif is_int_type(obj):
+        if config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_NONE:
+            # TODO check if we can actually fit this long-int into a small-int
+            raise FreezeError(rc, 'target does not support long int')
+        elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_LONGLONG:
+            # TODO
+            raise FreezeError(rc, 'freezing int to long-long is not implemented')
+        elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_MPZ:
+            neg = 0
+            if obj < 0:
+                obj = -obj
+                neg = 1
+            bits_per_dig = config.MPZ_DIG_SIZE
+            digs = []
+            z = obj
+            while z:
+                digs.append(z & ((1 << bits_per_dig) - 1))
+                z >>= bits_per_dig
+            ndigs = len(digs)
+            digs = ','.join(('%#x' % d) for d in digs)
+            print('STATIC const mp_obj_int_t %s = {{&mp_type_int}, '
+                '{.neg=%u, .fixed_dig=1, .alloc=%u, .len=%u, .dig=(uint%u_t[]){%s}}};'
+                % (obj_name, neg, ndigs, ndigs, bits_per_dig, digs))
+    elif type(obj) is float:
+        print('#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B')
+        print('STATIC const mp_obj_float_t %s = {{&mp_type_float}, %.16g};'
+            % (obj_name, obj))
+        print('#endif')
+    elif type(obj) is complex:
+        print('STATIC const mp_obj_complex_t %s = {{&mp_type_complex}, %.16g, %.16g};'
+            % (obj_name, obj.real, obj.imag))
+    else:
+        # TODO
+        raise FreezeError(rc, 'freezing of object %r is not implemented' % (obj,))
 
+class RawCode:
     def __init__(self, bytecode, qstrs, objs, raw_codes):
         # set core variables
         self.bytecode = bytecode
@@ -235,6 +509,9 @@ class RawCode:
         qst = self.bytecode[ip] | self.bytecode[ip + 1] << 8
         return global_qstrs[qst]
 
+    def freeze_child(self, parent):
+        self.freeze(parent.escaped_name + '_')
+
     def dump(self):
         # dump children first
         for rc in self.raw_codes:
@@ -242,18 +519,11 @@ class RawCode:
         # TODO
 
     def freeze(self, parent_name):
-        self.escaped_name = parent_name + self.simple_name.qstr_esc
-
-        # make sure the escaped name is unique
-        i = 2
-        while self.escaped_name in RawCode.escaped_names:
-            self.escaped_name = parent_name + self.simple_name.qstr_esc + str(i)
-            i += 1
-        RawCode.escaped_names.add(self.escaped_name)
+        self.escaped_name = unique_escaped_name(parent_name, self.simple_name)
 
         # emit children first
         for rc in self.raw_codes:
-            rc.freeze(self.escaped_name + '_')
+            rc.freeze_child(self)
 
         # generate bytecode data
         print()
@@ -286,49 +556,7 @@ class RawCode:
         # generate constant objects
         for i, obj in enumerate(self.objs):
             obj_name = 'const_obj_%s_%u' % (self.escaped_name, i)
-            if is_str_type(obj) or is_bytes_type(obj):
-                if is_str_type(obj):
-                    obj = bytes_cons(obj, 'utf8')
-                    obj_type = 'mp_type_str'
-                else:
-                    obj_type = 'mp_type_bytes'
-                print('STATIC const mp_obj_str_t %s = {{&%s}, %u, %u, (const byte*)"%s"};'
-                    % (obj_name, obj_type, qstrutil.compute_hash(obj, config.MICROPY_QSTR_BYTES_IN_HASH),
-                        len(obj), ''.join(('\\x%02x' % b) for b in obj)))
-            elif is_int_type(obj):
-                if config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_NONE:
-                    # TODO check if we can actually fit this long-int into a small-int
-                    raise FreezeError(self, 'target does not support long int')
-                elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_LONGLONG:
-                    # TODO
-                    raise FreezeError(self, 'freezing int to long-long is not implemented')
-                elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_MPZ:
-                    neg = 0
-                    if obj < 0:
-                        obj = -obj
-                        neg = 1
-                    bits_per_dig = config.MPZ_DIG_SIZE
-                    digs = []
-                    z = obj
-                    while z:
-                        digs.append(z & ((1 << bits_per_dig) - 1))
-                        z >>= bits_per_dig
-                    ndigs = len(digs)
-                    digs = ','.join(('%#x' % d) for d in digs)
-                    print('STATIC const mp_obj_int_t %s = {{&mp_type_int}, '
-                        '{.neg=%u, .fixed_dig=1, .alloc=%u, .len=%u, .dig=(uint%u_t[]){%s}}};'
-                        % (obj_name, neg, ndigs, ndigs, bits_per_dig, digs))
-            elif type(obj) is float:
-                print('#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B')
-                print('STATIC const mp_obj_float_t %s = {{&mp_type_float}, %.16g};'
-                    % (obj_name, obj))
-                print('#endif')
-            elif type(obj) is complex:
-                print('STATIC const mp_obj_complex_t %s = {{&mp_type_complex}, %.16g, %.16g};'
-                    % (obj_name, obj.real, obj.imag))
-            else:
-                # TODO
-                raise FreezeError(self, 'freezing of object %r is not implemented' % (obj,))
+            freeze_const_obj(self, obj_name, obj)
 
         # generate constant table
         print('STATIC const mp_uint_t const_table_data_%s[%u] = {'
@@ -419,7 +647,38 @@ def read_bytecode_qstrs(file, bytecode, ip):
             read_qstr_and_pack(file, bytecode, ip + 1)
         ip += sz
 
-def read_raw_code(f):
+def read_native_code(f, kind):
+    code = bytes_cons(f.read(read_uint(f)))
+    scope_flags = read_uint(f)
+    n_pos_args = read_uint(f)
+    type_sig = read_uint(f)
+    const_table_offset = None
+    if kind == MP_CODE_NATIVE_PY:
+        const_table_offset = read_uint(f)
+    relocs = []
+    for _ in range(read_uint(f)):
+        loc = read_uint(f)
+        rkind = bytes_cons(f.read(1))[0]
+        if rkind == MP_NATIVE_RELOC_FUN:
+            val = read_uint(f)
+        elif rkind in (MP_NATIVE_RELOC_QSTR, MP_NATIVE_RELOC_QSTR_OBJ, MP_NATIVE_RELOC_QSTR16):
+            val = read_qstr(f)
+        elif rkind == MP_NATIVE_RELOC_CONST:
+            val = bytes_cons(f.read(1))[0]
+        elif rkind == MP_NATIVE_RELOC_OBJ:
+            val = read_obj(f)
+        elif rkind == MP_NATIVE_RELOC_RAW_CODE:
+            val = read_raw_code(f, True)
+        else:
+            val = None
+        relocs.append((loc, rkind, val))
+    return NativeRawCode(kind, code, (scope_flags, n_pos_args, type_sig), const_table_offset, relocs)
+
+def read_raw_code(f, native):
+    if native:
+        kind = bytes_cons(f.read(1))[0]
+        if kind != MP_CODE_BYTECODE:
+            return read_native_code(f, kind)
     bc_len = read_uint(f)
     bytecode = bytearray(f.read(bc_len))
     ip, ip2, prelude = extract_prelude(bytecode)
@@ -430,7 +689,7 @@ def read_raw_code(f):
     n_raw_code = read_uint(f)
     qstrs = [read_qstr(f) for _ in range(prelude[3] + prelude[4])]
     objs = [read_obj(f) for _ in range(n_obj)]
-    raw_codes = [read_raw_code(f) for _ in range(n_raw_code)]
+    raw_codes = [read_raw_code(f, native) for _ in range(n_raw_code)]
     return RawCode(bytecode, qstrs, objs, raw_codes)
 
 def read_mpy(filename):
@@ -443,14 +702,37 @@ def read_mpy(filename):
         feature_flags = header[2]
         config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE = (feature_flags & 1) != 0
         config.MICROPY_PY_BUILTINS_STR_UNICODE = (feature_flags & 2) != 0
+        config.MICROPY_OPT_SUPERINSTRUCTIONS |= (feature_flags & 4) != 0
         config.mp_small_int_bits = header[3]
-        return read_raw_code(f)
+        native = (feature_flags & MPY_FEATURE_NATIVE) != 0
+        if native:
+            arch, code_state_words, nlr_buf_words = bytes_cons(f.read(3))
+            native_config = (arch & 0xf, arch >> 4, code_state_words, nlr_buf_words)
+            if config.native is not None and config.native != native_config:
+                raise Exception('native code in %s is for a different target' % filename)
+            config.native = native_config
+        return read_raw_code(f, native)
 
 def dump_mpy(raw_codes):
     for rc in raw_codes:
         rc.dump()
 
+def check_freezable(rc):
+    if isinstance(rc, NativeRawCode):
+        if config.native[0] not in MP_NATIVE_ARCH:
+            raise FreezeError(rc, 'unknown native architecture %u' % config.native[0])
+        word_size = MP_NATIVE_ARCH[config.native[0]][1]
+        for loc, rkind, val in rc.relocs:
+            if rkind != MP_NATIVE_RELOC_QSTR16 and loc % word_size != 0:
+                raise FreezeError(rc, 'relocation at %u is not word aligned' % loc)
+    for child in rc.raw_codes:
+        check_freezable(child)
+
 def freeze_mpy(base_qstrs, raw_codes):
+    # fail before any output is generated if there is code that can't be frozen
+    for rc in raw_codes:
+        check_freezable(rc)
+
     # add to qstrs
     new = {}
     for q in global_qstrs:
@@ -464,6 +746,9 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('#include "py/objint.h"')
     print('#include "py/objstr.h"')
     print('#include "py/emitglue.h"')
+    if config.native is not None:
+        print('#include "py/runtime.h"')
+        print('#include "py/bc.h"')
     print()
 
     print('#if MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE != %u' % config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE)
@@ -471,6 +756,26 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('#endif')
     print()
 
+    if config.MICROPY_OPT_SUPERINSTRUCTIONS:
+        print('#if !MICROPY_OPT_SUPERINSTRUCTIONS')
+        print('#error "incompatible MICROPY_OPT_SUPERINSTRUCTIONS"')
+        print('#endif')
+        print()
+
+    if config.native is not None:
+        arch, obj_repr, code_state_words, nlr_buf_words = config.native
+        print('#if !MICROPY_EMIT_%s' % MP_NATIVE_ARCH[arch][0])
+        print('#error "incompatible native architecture, need MICROPY_EMIT_%s"' % MP_NATIVE_ARCH[arch][0])
+        print('#endif')
+        print('#if MICROPY_OBJ_REPR != %u' % obj_repr)
+        print('#error "incompatible MICROPY_OBJ_REPR"')
+        print('#endif')
+        print('typedef char mp_frozen_native_code_state_check[sizeof(mp_code_state_t) == %u * sizeof(mp_uint_t) ? 1 : -1];'
+            % code_state_words)
+        print('typedef char mp_frozen_native_nlr_buf_check[sizeof(nlr_buf_t) == %u * sizeof(mp_uint_t) ? 1 : -1];'
+            % nlr_buf_words)
+        print()
+
     print('#if MICROPY_LONGINT_IMPL != %u' % config.MICROPY_LONGINT_IMPL)
     print('#error "incompatible MICROPY_LONGINT_IMPL"')
     print('#endif')
@@ -508,6 +813,15 @@ def freeze_mpy(base_qstrs, raw_codes):
             print('    MP_QSTR_%s,' % new[i][1])
     print('};')
 
+    print()
+    print('#if MICROPY_QSTR_POOL_HASH_INDEX')
+    print('STATIC const uint16_t mp_qstr_frozen_const_hash_index[] = {')
+    index = qstrutil.make_hash_index([qstr for _, _, qstr in new])
+    for i in range(0, len(index), 16):
+        print('    %s,' % ', '.join(str(n) for n in index[i:i + 16]))
+    print('};')
+    print('#endif')
+
     print()
     print('extern const qstr_pool_t mp_qstr_const_pool;');
     print('const qstr_pool_t mp_qstr_frozen_const_pool = {')
@@ -515,6 +829,10 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('    MP_QSTRnumber_of, // previous pool size')
     print('    %u, // allocated entries' % len(new))
     print('    %u, // used entries' % len(new))
+    print('    #if MICROPY_QSTR_POOL_HASH_INDEX')
+    print('    mp_qstr_frozen_const_hash_index,')
+    print('    %u, // hash index mask' % (len(index) - 1))
+    print('    #endif')
     print('    {')
     for _, _, qstr in new:
         print('        %s,'
@@ -0,0 +1,13 @@
+import micropython
+
+@micropython.native
+def native(x, y=2):
+    def inner(z):
+        return z * 1.5 + y
+    return (inner(x), 'str', b'bytes', 1 << 80, None, True, ...)
+
+@micropython.viper
+def viper(x:int) -> int:
+    return x + 1
+
+print('frzmpy_native', native(2), viper(3))
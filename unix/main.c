@@ -60,6 +60,11 @@ STATIC uint emit_opt = MP_EMIT_OPT_NONE;
 long heap_size = 1024*1024 * (sizeof(mp_uint_t) / 4);
 #endif
 
+#if MICROPY_ENABLE_PYSTACK
+// Size of the stack that Python frames are allocated from
+long pystack_size = 16 * 1024 * (sizeof(mp_uint_t) / 4);
+#endif
+
 STATIC void stderr_print_strn(void *env, const char *str, size_t len) {
     (void)env;
     ssize_t dummy = write(STDERR_FILENO, str, len);
@@ -310,6 +315,12 @@ STATIC int usage(char **argv) {
 , heap_size);
     impl_opts_cnt++;
 #endif
+#if MICROPY_ENABLE_PYSTACK
+    printf(
+"  pystack=<n>[w][K|M] -- set the size of the Python frame stack (default %ld)\n"
+, pystack_size);
+    impl_opts_cnt++;
+#endif
 
     if (impl_opts_cnt == 0) {
         printf("  (none)\n");
@@ -318,6 +329,40 @@ STATIC int usage(char **argv) {
     return 1;
 }
 
+#if MICROPY_ENABLE_GC || MICROPY_ENABLE_PYSTACK
+// Parse a size given as <n>[w][K|M], returning -1 if it's invalid
+STATIC long parse_size(const char *str) {
+    char *end;
+    long size = strtol(str, &end, 0);
+    // Don't bring unneeded libc dependencies like tolower()
+    // If there's 'w' immediately after number, adjust it for
+    // target word size. Note that it should be *before* size
+    // suffix like K or M, to avoid confusion with kilowords,
+    // etc. the size is still in bytes, just can be adjusted
+    // for word size (taking 32bit as baseline).
+    bool word_adjust = false;
+    if ((*end | 0x20) == 'w') {
+        word_adjust = true;
+        end++;
+    }
+    if ((*end | 0x20) == 'k') {
+        size *= 1024;
+    } else if ((*end | 0x20) == 'm') {
+        size *= 1024 * 1024;
+    } else {
+        // Compensate for ++ below
+        --end;
+    }
+    if (*++end != 0) {
+        return -1;
+    }
+    if (word_adjust) {
+        size = size * BYTES_PER_WORD / 4;
+    }
+    return size;
+}
+#endif
+
 // Process options which set interpreter init options
 STATIC void pre_process_options(int argc, char **argv) {
     for (int a = 1; a < argc; a++) {
@@ -337,33 +382,19 @@ STATIC void pre_process_options(int argc, char **argv) {
                     emit_opt = MP_EMIT_OPT_VIPER;
 #if MICROPY_ENABLE_GC
                 } else if (strncmp(argv[a + 1], "heapsize=", sizeof("heapsize=") - 1) == 0) {
-                    char *end;
-                    heap_size = strtol(argv[a + 1] + sizeof("heapsize=") - 1, &end, 0);
-                    // Don't bring unneeded libc dependencies like tolower()
-                    // If there's 'w' immediately after number, adjust it for
-                    // target word size. Note that it should be *before* size
-                    // suffix like K or M, to avoid confusion with kilowords,
-                    // etc. the size is still in bytes, just can be adjusted
-                    // for word size (taking 32bit as baseline).
-                    bool word_adjust = false;
-                    if ((*end | 0x20) == 'w') {
-                        word_adjust = true;
-                        end++;
-                    }
-                    if ((*end | 0x20) == 'k') {
-                        heap_size *= 1024;
-                    } else if ((*end | 0x20) == 'm') {
-                        heap_size *= 1024 * 1024;
-                    } else {
-                        // Compensate for ++ below
-                        --end;
-                    }
-                    if (*++end != 0) {
+                    long size = parse_size(argv[a + 1] + sizeof("heapsize=") - 1);
+                    if (size < 0) {
                         goto invalid_arg;
                     }
-                    if (word_adjust) {
-                        heap_size = heap_size * BYTES_PER_WORD / 4;
+                    heap_size = size;
+#endif
+#if MICROPY_ENABLE_PYSTACK
+                } else if (strncmp(argv[a + 1], "pystack=", sizeof("pystack=") - 1) == 0) {
+                    long size = parse_size(argv[a + 1] + sizeof("pystack=") - 1);
+                    if (size <= 0) {
+                        goto invalid_arg;
                     }
+                    pystack_size = size;
 #endif
                 } else {
 invalid_arg:
@@ -413,6 +444,11 @@ MP_NOINLINE int main_(int argc, char **argv) {
     gc_init(heap, heap + heap_size);
 #endif
 
+#if MICROPY_ENABLE_PYSTACK
+    char *pystack = malloc(pystack_size);
+    mp_pystack_init(pystack, pystack + pystack_size);
+#endif
+
     mp_init();
 
     // create keyboard interrupt object
@@ -600,6 +636,9 @@ MP_NOINLINE int main_(int argc, char **argv) {
     // process, but doing so helps to find memory leaks.
     free(heap);
 #endif
+#if MICROPY_ENABLE_PYSTACK && !defined(NDEBUG)
+    free(pystack);
+#endif
 
     //printf("total bytes = %d\n", m_get_total_bytes_allocated());
     return ret & 0xff;
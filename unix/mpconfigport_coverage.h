@@ -36,3 +36,13 @@
 #define MICROPY_FSUSERMOUNT            (1)
 #define MICROPY_VFS_FAT                (1)
 #define MICROPY_PY_FRAMEBUF            (1)
+#define MICROPY_GC_INCREMENTAL_SWEEP   (1)
+#define MICROPY_GC_LONG_LIVED          (1)
+#if MICROPY_PY_THREAD
+#define MICROPY_GC_PARALLEL_MARK       (1)
+#define MICROPY_GC_PARALLEL_MARK_MIN_BLOCKS (0)
+// the root scan leaves its blocks on gc_stack for the marking threads
+#define MICROPY_ALLOC_GC_STACK_SIZE    (1024)
+#endif
+#define MICROPY_GC_COMPACT             (1)
+#define MICROPY_ALLOC_PROFILE          (1)
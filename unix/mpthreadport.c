@@ -37,6 +37,7 @@
 
 #include <signal.h>
 #include <sched.h>
+#include <unistd.h>
 
 // this structure forms a linked list, one node per active thread
 typedef struct _thread_t {
@@ -63,6 +64,10 @@ STATIC void mp_thread_gc(int signo, siginfo_t *info, void *context) {
     if (signo == SIGUSR1) {
         void gc_collect_regs_and_stack(void);
         gc_collect_regs_and_stack();
+        #if MICROPY_ENABLE_PYSTACK
+        void **ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
+        gc_collect_root(ptrs, (MP_STATE_THREAD(pystack_cur) - MP_STATE_THREAD(pystack_start)) / sizeof(void*));
+        #endif
         // We have access to the context (regs, stack) of the thread but it seems
         // that we don't need the extra information, enough is captured by the
         // gc_collect_regs_and_stack function above
@@ -115,6 +120,100 @@ void mp_thread_gc_others(void) {
     pthread_mutex_unlock(&thread_mutex);
 }
 
+#if MICROPY_GC_PARALLEL_MARK
+
+// Helper threads for the GC to mark the heap with.  They are created the
+// first time they are needed and then sleep until the next collection.
+STATIC pthread_mutex_t gc_helper_mutex = PTHREAD_MUTEX_INITIALIZER;
+STATIC pthread_cond_t gc_helper_start_cond = PTHREAD_COND_INITIALIZER;
+STATIC pthread_cond_t gc_helper_done_cond = PTHREAD_COND_INITIALIZER;
+STATIC size_t gc_helper_count; // 0 until the helpers have been created
+STATIC unsigned int gc_helper_generation;
+STATIC void (*gc_helper_fun)(size_t);
+STATIC size_t gc_helper_n;
+STATIC size_t gc_helper_pending;
+
+STATIC void *gc_helper_entry(void *arg) {
+    size_t id = (uintptr_t)arg;
+
+    // signals are for the Python threads to handle
+    sigset_t set;
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    // the helpers are all created before the first run
+    unsigned int generation = 0;
+    pthread_mutex_lock(&gc_helper_mutex);
+    for (;;) {
+        while (gc_helper_generation == generation) {
+            pthread_cond_wait(&gc_helper_start_cond, &gc_helper_mutex);
+        }
+        generation = gc_helper_generation;
+        if (id < gc_helper_n) {
+            pthread_mutex_unlock(&gc_helper_mutex);
+            gc_helper_fun(id);
+            pthread_mutex_lock(&gc_helper_mutex);
+            if (--gc_helper_pending == 0) {
+                pthread_cond_signal(&gc_helper_done_cond);
+            }
+        }
+    }
+    return NULL;
+}
+
+// Return the number of threads, including the calling one, that
+// mp_thread_gc_parallel can run on, creating the helpers if needed.
+size_t mp_thread_gc_parallel_count(void) {
+    if (gc_helper_count == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n < 1) {
+            // the number of CPUs is unknown
+            n = 1;
+        } else if (n > MICROPY_GC_PARALLEL_MARK_MAX_THREADS) {
+            n = MICROPY_GC_PARALLEL_MARK_MAX_THREADS;
+        }
+        gc_helper_count = 1;
+        for (; gc_helper_count < (size_t)n; gc_helper_count++) {
+            pthread_t id;
+            if (pthread_create(&id, NULL, gc_helper_entry, (void*)(uintptr_t)gc_helper_count) != 0) {
+                break;
+            }
+            pthread_detach(id);
+        }
+    }
+    return gc_helper_count;
+}
+
+// Called by a marker that is waiting for another one to share its work.
+void mp_thread_gc_parallel_idle(void) {
+    #if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+    #endif
+    sched_yield();
+}
+
+// Call fun(id) for each id from 0 to n - 1 concurrently, id 0 on the calling
+// thread, and return when all calls have returned.
+void mp_thread_gc_parallel(void (*fun)(size_t id), size_t n) {
+    pthread_mutex_lock(&gc_helper_mutex);
+    gc_helper_fun = fun;
+    gc_helper_n = n;
+    gc_helper_pending = n - 1;
+    gc_helper_generation += 1;
+    pthread_cond_broadcast(&gc_helper_start_cond);
+    pthread_mutex_unlock(&gc_helper_mutex);
+
+    fun(0);
+
+    pthread_mutex_lock(&gc_helper_mutex);
+    while (gc_helper_pending != 0) {
+        pthread_cond_wait(&gc_helper_done_cond, &gc_helper_mutex);
+    }
+    pthread_mutex_unlock(&gc_helper_mutex);
+}
+
+#endif // MICROPY_GC_PARALLEL_MARK
+
 mp_state_thread_t *mp_thread_get_state(void) {
     return (mp_state_thread_t*)pthread_getspecific(tls_key);
 }
@@ -188,15 +287,33 @@ er:
 
 void mp_thread_finish(void) {
     pthread_mutex_lock(&thread_mutex);
-    // TODO unlink from list
+    // unlink from list, the thread won't run any more Python code
+    for (thread_t **th = &thread; *th != NULL; th = &(*th)->next) {
+        if ((*th)->id == pthread_self()) {
+            thread_t *done = *th;
+            *th = done->next;
+            free(done);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&thread_mutex);
+}
+
+#if MICROPY_GC_COMPACT
+// Return whether any thread other than the calling one may run Python code.
+bool mp_thread_others_running(void) {
+    bool running = false;
+    pthread_mutex_lock(&thread_mutex);
     for (thread_t *th = thread; th != NULL; th = th->next) {
-        if (th->id == pthread_self()) {
-            th->ready = 0;
+        if (th->id != pthread_self()) {
+            running = true;
             break;
         }
     }
     pthread_mutex_unlock(&thread_mutex);
+    return running;
 }
+#endif
 
 void mp_thread_mutex_init(mp_thread_mutex_t *mutex) {
     pthread_mutex_init(mutex, NULL);
@@ -82,6 +82,38 @@ void mp_hal_set_interrupt_char(char c) {
     }
 }
 
+#if MICROPY_EXEC_PROFILE
+// Profiling samples are taken on SIGPROF, which fires after each period of
+// CPU time used by the process.
+
+STATIC void exec_profile_sighandler(int signum) {
+    (void)signum;
+    mp_exec_profile_sample();
+}
+
+STATIC void exec_profile_set_timer(mp_uint_t period_us) {
+    struct itimerval it;
+    it.it_interval.tv_sec = period_us / 1000000;
+    it.it_interval.tv_usec = period_us % 1000000;
+    it.it_value = it.it_interval;
+    setitimer(ITIMER_PROF, &it, NULL);
+}
+
+void mp_hal_exec_profile_start(mp_uint_t period_us) {
+    struct sigaction sa;
+    // restart interrupted system calls so that the profiled code doesn't see them
+    sa.sa_flags = SA_RESTART;
+    sa.sa_handler = exec_profile_sighandler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, NULL);
+    exec_profile_set_timer(period_us);
+}
+
+void mp_hal_exec_profile_stop(void) {
+    exec_profile_set_timer(0);
+}
+#endif
+
 #if MICROPY_USE_READLINE == 1
 
 #include <termios.h>